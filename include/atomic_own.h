@@ -0,0 +1,23 @@
+// This file defines ATOMIC_OWN_H and is called atomic_own.h so it does not conflict with
+// the util/atomic.h header of avr-libc (and so the include guards do not conflict too).
+
+#ifndef ATOMIC_OWN_H
+#define ATOMIC_OWN_H
+
+/*
+ * ATOMIC_SECTION { ... } runs the enclosed block with interrupts disabled on the Arduino,
+ * restoring the previous interrupt state afterwards. Use it to read or write multi-byte
+ * variables which are shared with an ISR.
+ *
+ * On native there are no real ISRs (the tests call the ISR bodies inline), so it does nothing.
+ */
+#if defined(BUILD_ARDUINO)
+#   include <util/atomic.h>
+#   define ATOMIC_SECTION ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#elif defined(BUILD_NATIVE)
+#   define ATOMIC_SECTION /* Nothing */
+#else
+#   error "Either one of BUILD_NATIVE or BUILD_ARDUINO should be set"
+#endif
+
+#endif // ATOMIC_OWN_H
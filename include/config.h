@@ -29,6 +29,12 @@ constexpr T sqr(T t) {
     return t * t;
 }
 
+// Square root usable in constant expressions (Newton's method, only meant for compile time)
+constexpr double constexprSqrt(double x, double guess = 1.0, int iterations = 64) {
+    return (x <= 0.0 || iterations == 0) ? (x <= 0.0 ? 0.0 : guess)
+                                         : constexprSqrt(x, 0.5 * (guess + x / guess), iterations - 1);
+}
+
 // ================================
 // CONTROL SYSTEM PARAMETERS
 // ================================
@@ -65,6 +71,8 @@ struct TimingConfig {
     static constexpr float SAFE_TIMER_S = 0.5f;        // Safety delay before MPV
     static constexpr float RECOVERY_DWELL_S = 3.0f;    // Time in forced open loop before recovery
     static constexpr float REDBAND_TIMEOUT = 2.0f;      // Time until redband activation
+    static constexpr float ENCODER_SAMPLE_PERIOD_S = 0.025f; // Encoder sampling period for the position estimator
+    static constexpr float MONITOR_RATE_HZ = 100.0f;   // Rate of the global monitors (abort, MPV, comm watchdog, sync)
 };
 
 // ================================
@@ -133,6 +141,18 @@ struct HardwareConfig {
     static constexpr float MAX_12_BIT_VAL = 4095.0f; 
 };
 
+// ================================
+// MOTION PLANNING (STEP RATE PROFILE)
+// ================================
+
+// Trapezoidal step rate profile used by the step engine. Moves start (and end) at the
+// conservative STEP_PERIOD_US, then accelerate up to the cruise rate.
+struct MotionConfig {
+    static constexpr uint16_t START_STEP_PERIOD_US = HardwareConfig::STEP_PERIOD_US; // Rate that is safe from rest
+    static constexpr uint16_t MIN_STEP_PERIOD_US = 300;         // Cruise rate (max velocity)
+    static constexpr float ACCEL_STEPS_PER_S2 = 40000.0f;       // Acceleration (and deceleration)
+};
+
 // ================================
 // MOTOR INNER-LOOP (PROPORTIONAL)
 // ================================
@@ -187,6 +207,13 @@ struct FDIRConfig {
     // Encoder fault detection
     static constexpr float MOTION_EXPECTED_ANGLE_THRESHOLD = 0.25f; // Minimum detectable motion (degrees)
     static constexpr float MOTION_DETECTED_ANGLE_THRESHOLD = 0.05f;
+    static constexpr int CONSEC_NO_MOTION_THRESHOLD = 3;            // No. of consecutive encoder samples without motion
+                                                                    // (while stepping) before a no motion fault
+
+    // Disagreement between the encoder and the commanded steps (degrees), and the no. of consecutive
+    // encoder samples exceeding it before an encoder mismatch fault
+    static constexpr float ENCODER_MISMATCH_THRESHOLD = 1.0f;
+    static constexpr int CONSEC_MISMATCH_THRESHOLD = 3;
 
     // Threshold constants for sign change detection
     static constexpr int CONSEC_SAME_SIGN_THRESHOLD = 5;        // No. of consecutive readings of a particular magnitude of a
@@ -201,9 +228,95 @@ struct FDIRConfig {
 struct CommConfig {
     static constexpr unsigned long BAUD_RATE = 115200;
     static constexpr int INPUT_BUFFER_SIZE = 128;
+
+    // Received bytes are moved from the Arduino core's 64 byte buffer into a larger ring
+    // (see serial_rx.h) from a timer ISR, so they survive long gaps between loop() passes
+    static constexpr uint16_t RX_RING_SIZE = 128;           // Power of two up to 256 (~11 ms of bytes)
+    static constexpr uint16_t RX_DRAIN_PERIOD_US = 1000;
+    static constexpr uint16_t CORE_RX_BUFFER_SIZE = 64;     // SERIAL_RX_BUFFER_SIZE of the core
+#ifdef USE_COMPACT_TELEMETRY
+    static constexpr float TELEMETRY_RATE_HZ = 50.0f;   // Enough to follow a valve transient
+#else
     static constexpr float TELEMETRY_RATE_HZ = 5.0f;  
+#endif
+    static constexpr float TELEMETRY_LINK_SHARE = 0.5f; // Max share of the TX link for telemetry
 
     static constexpr int MAX_NUM_CONSEC_INVALIDS = 5;
+
+    // Minimum time between event packets (state changes, fault latches), so a flapping state
+    // cannot flood the link. A few events are held back until then, further ones are dropped
+    static constexpr unsigned long EVENT_MIN_INTERVAL_MS = 20;
+};
+
+// ================================
+// RUNTIME COMMANDS
+// ================================
+
+// Bounds of the values that command packets may set (see comm_handler.h); anything outside is
+// rejected rather than clamped
+struct CommandConfig {
+    static constexpr float GAIN_MIN = 0.0f;
+    static constexpr float GAIN_MAX = 7.9f;                 // The fixed point gains hold up to 7.99
+    static constexpr float TARGET_PRESSURE_MIN_PSI = 0.0f;
+    static constexpr float TARGET_PRESSURE_MAX_PSI = 800.0f;
+    static constexpr float REDBAND_MIN_PSI = 1.0f;
+    static constexpr float REDBAND_MAX_PSI = 100.0f;
+    static constexpr float MAX_ANGLE_CHANGE_MIN = 0.1f;     // Degrees per cycle
+    static constexpr float MAX_ANGLE_CHANGE_MAX = 20.0f;
+    static constexpr float MOVE_FILTER_SCALE_MIN = 0.05f;
+    static constexpr float MOVE_FILTER_SCALE_MAX = 1.0f;
+};
+
+// ================================
+// LOOP PROFILER (USE_LOOP_PROFILER)
+// ================================
+
+struct ProfilerConfig {
+    static constexpr float DIAG_RATE_HZ = 1.0f; // Diagnostics packet rate (the stats are per packet)
+
+    // Per-phase time budgets (us); longer runs count as overruns
+    static constexpr uint16_t LOOP_BUDGET_US = 10000;
+    static constexpr uint16_t COMM_BUDGET_US = 1000;
+    static constexpr uint16_t MONITORS_BUDGET_US = 2000;
+    static constexpr uint16_t CONTROL_BUDGET_US = 5000;
+    static constexpr uint16_t ENCODER_BUDGET_US = 200;
+    static constexpr uint16_t MOTOR_BUDGET_US = 1000;
+    static constexpr uint16_t TELEMETRY_BUDGET_US = 2000;
+};
+
+// ================================
+// FLIGHT RECORDER
+// ================================
+
+struct RecorderConfig {
+    static constexpr uint8_t NUM_RECORDS = 24;          // One per control tick (1.2 s at 20 Hz)
+    static constexpr uint8_t RECORDS_PER_DUMP_PACKET = 3;
+};
+
+// ================================
+// INPUT JOURNAL (USE_INPUT_JOURNAL)
+// ================================
+
+struct JournalConfig {
+    static constexpr uint8_t CHUNK_SIZE = 32;       // Journal bytes per journal packet
+    // The comms run on this grid instead of on every pass (serialRxRing holds ~11 ms of bytes),
+    // so that the passes of loop(), and with them the journal, stay sparse
+    static constexpr float COMMS_RATE_HZ = 200.0f;
+};
+
+// ================================
+// SRAM BUDGET
+// ================================
+
+// The globals of the firmware are checked against the SRAM at compile time (see src/main.cpp),
+// leaving room for the Arduino core and the stack. CommHandler lives in static storage too, so
+// that avr-size's data + bss figure is (almost) all of the SRAM in use
+struct MemoryConfig {
+    static constexpr uint16_t SRAM_BYTES = 2048;    // ATmega328P
+    static constexpr uint16_t CORE_BYTES = 200;     // Serial (two 64 byte buffers), the millis() timer, SPI
+    // Deepest call chain of loop() plus an ISR: the packets built on the stack (up to the
+    // diagnostics packet with USE_LOOP_PROFILER) and the locals of the control tick
+    static constexpr uint16_t STACK_BYTES = 320;
 };
 
 // ================================
@@ -225,13 +338,37 @@ static_assert(ValveConfig::OPENLOOP_TARGET_ANGLE >= ValveConfig::MIN_VALVE_ANGLE
 static_assert(ValveConfig::MOVE_FILTER_SCALE > 0 && ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE > 0,
                 "Constants used for applying the move filter on the motor must be positive");
               
+static_assert(MotionConfig::MIN_STEP_PERIOD_US > 0 &&
+              MotionConfig::MIN_STEP_PERIOD_US <= MotionConfig::START_STEP_PERIOD_US,
+              "Cruise step period must be positive and no longer than the start step period");
+
+static_assert(MotionConfig::ACCEL_STEPS_PER_S2 > 0,
+              "Step acceleration must be positive");
+
 static_assert(SensorConfig::P_MIN < SensorConfig::P_MAX, 
               "Invalid pressure sensor range");
               
 static_assert(TimingConfig::CONTROL_PERIOD_HZ > 0, 
               "Invalid control period");
 
+static_assert(TimingConfig::MONITOR_RATE_HZ >= TimingConfig::CONTROL_PERIOD_HZ,
+              "Monitors should run at least as often as the controller");
+
+static_assert(CommandConfig::TARGET_PRESSURE_MAX_PSI < SensorConfig::P_MAX &&
+              CommandConfig::MAX_ANGLE_CHANGE_MAX < ValveConfig::MAX_VALVE_ANGLE - ValveConfig::MIN_VALVE_ANGLE &&
+              CommandConfig::MOVE_FILTER_SCALE_MIN > 0,
+              "Invalid command bounds");
+
 static_assert(ControllerConfig::I_MIN < ControllerConfig::I_MAX,
               "Invalid integral limits");
 
+// 10 bits per byte on the wire (8N1)
+static_assert(CommConfig::RX_DRAIN_PERIOD_US < (CommConfig::CORE_RX_BUFFER_SIZE - 1) * 10 * 1e6 / CommConfig::BAUD_RATE,
+              "The core's RX buffer fills up before it is drained");
+
+#ifdef USE_INPUT_JOURNAL
+static_assert(CommConfig::RX_RING_SIZE - 1 >= 2 * CommConfig::BAUD_RATE / 10 / JournalConfig::COMMS_RATE_HZ,
+              "serialRxRing does not hold two comms periods of bytes");
+#endif
+
 #endif // CONFIG_H
\ No newline at end of file
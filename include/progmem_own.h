@@ -0,0 +1,31 @@
+// This file defines PROGMEM_OWN_H and is called progmem_own.h so it does not conflict with
+// the avr/pgmspace.h header of avr-libc (and so the include guards do not conflict too).
+
+#ifndef PROGMEM_OWN_H
+#define PROGMEM_OWN_H
+
+/*
+ * Lookup tables are placed in flash with PROGMEM on the Arduino (the Uno only has 2KB of RAM)
+ * and must then be read back with pgm_read_*(). On native they are ordinary const arrays.
+ */
+#if defined(BUILD_ARDUINO)
+#   include <avr/pgmspace.h>
+#elif defined(BUILD_NATIVE)
+#   ifndef PROGMEM
+#       define PROGMEM /* Nothing */
+#   endif
+#   ifndef pgm_read_byte
+#       define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#   endif
+#   ifndef pgm_read_word
+#       define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#   endif
+#   ifndef memcpy_P
+#       include <string.h>
+#       define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+#   endif
+#else
+#   error "Either one of BUILD_NATIVE or BUILD_ARDUINO should be set"
+#endif
+
+#endif // PROGMEM_OWN_H
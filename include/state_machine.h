@@ -4,6 +4,8 @@
 #include <Arduino.h>
 
 #include "config.h"
+#include <input_journal.h>
+#include <valve_angle.h>
 
 // System states according to the flow diagram
 enum class SystemStateEnum : uint8_t {
@@ -38,6 +40,9 @@ struct FaultFlags {
     }
 };
 
+// Called by SystemState::changeStateTo() when the state actually changes
+typedef void (*StateChangeHook)(SystemStateEnum from, SystemStateEnum to);
+
 // System state (most importantly of the state machine)
 struct SystemState {
     SystemStateEnum currentState = SystemStateEnum::BOOT_INIT;
@@ -49,30 +54,54 @@ struct SystemState {
     // Time variables
     unsigned long preClosedLoopTimer = 0;
     unsigned long stateEntryTime = 0;
-    unsigned long lastControlTime = 0;
+    unsigned long lastControlTime = 0;  // micros(), for the controller dt
     unsigned long enterClosedLoopTime = 0;
+
+    StateChangeHook onStateChange = nullptr;
     
     SystemState() : currentState(SystemStateEnum::BOOT_INIT), systemInitialized(false), 
-                    mpvWasOpen(false), preClosedLoopTimer(0), stateEntryTime(0), lastControlTime(0) {}
+                    mpvWasOpen(false), preClosedLoopTimer(0), stateEntryTime(0), lastControlTime(0),
+                    onStateChange(nullptr) {}
                    
     void changeStateTo(SystemStateEnum stateTo) {
-        stateEntryTime = millis();
+        stateEntryTime = inputMillis();
+        SystemStateEnum stateFrom = currentState;
         currentState = stateTo;
+        if (onStateChange != nullptr && stateFrom != stateTo)
+            onStateChange(stateFrom, stateTo);
     }
     void initTimers() {
-        preClosedLoopTimer = millis();
-        stateEntryTime = millis();
-        lastControlTime = millis();
+        preClosedLoopTimer = inputMillis();
+        stateEntryTime = inputMillis();
+        lastControlTime = inputMicros();
     }
 };
 
 // Channel controller state (single manifold)
 struct ChannelState {
     float prevError;
-    float targetAngle;
-    float currentAngle;
+    float pressure;     // Last manifold pressure and pressure error seen in closed loop
+    float error;
+    angle_t targetAngle;
+    angle_t currentAngle;
     
-    ChannelState() : prevError(0.0f), targetAngle(ValveConfig::START_ANGLE), currentAngle(ValveConfig::START_ANGLE) {}
+    ChannelState() : prevError(0.0f), pressure(0.0f), error(0.0f), targetAngle(degToAngle(ValveConfig::START_ANGLE)), currentAngle(degToAngle(ValveConfig::START_ANGLE)) {}
+};
+
+// Parameters that can be changed at run time by command packets (see comm_handler.h), only in
+// the safe states. They start at their config.h values; the PID gains live in the controller
+struct Tunables {
+    float targetPressurePsi;
+    float redbandUpperPsi;      // Allowed pressure above / below the target
+    float redbandLowerPsi;
+    angle_t maxAngleChange;     // Move filter (see applyMoveFilter())
+    scale_q8_t moveFilterScale; // In Q8 (see scaleToQ8())
+
+    Tunables() : targetPressurePsi(ControllerConfig::TARGET_PRESSURE_PSI),
+                 redbandUpperPsi(MotorControlConfig::REDBAND_PRESSURE_UPPER),
+                 redbandLowerPsi(MotorControlConfig::REDBAND_PRESSURE_LOWER),
+                 maxAngleChange(degToAngle(ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE)),
+                 moveFilterScale(scaleToQ8(ValveConfig::MOVE_FILTER_SCALE)) {}
 };
 
 #endif // STATE_MACHINE_H
\ No newline at end of file
@@ -10,6 +10,12 @@ AMT22::AMT22(uint8_t cs, uint8_t resolution) {
     digitalWrite(cs, HIGH);   //Get the CS line high which is the default inactive state
     _cs = cs;
     _resolution = resolution;
+    _lastReadUs = 0;
+#if defined(ARDUINO_ARCH_AVR)
+    //cache the port and mask of the CS pin so that toggling it does not need the pin lookups of digitalWrite
+    _csPort = portOutputRegister(digitalPinToPort(cs));
+    _csMask = digitalPinToBitMask(cs);
+#endif
 }
 
 /*
@@ -20,31 +26,61 @@ AMT22::AMT22(uint8_t cs, uint8_t resolution) {
  * Error values are returned as 0xFFFF
  */
 uint16_t AMT22::getPositionSPI(){
-    uint16_t currentPosition;       //16-bit response from encoder
-    bool binaryArray[16];           //after receiving the position we will populate this array and use it for calculating the checksum
+    return decodeResponse(transferPosition(), _resolution);
+}
 
-    //get first byte which is the high byte, shift it 8 bits. don't release line for the first byte
-    currentPosition = spiWriteRead(AMT22_NOP, false) << 8;
+/*
+ * Same as getPositionSPI(), but reports a bad position through the return value instead of 0xFFFF.
+ */
+bool AMT22::readPositionRaw(uint16_t& position){
+    uint16_t decoded = getPositionSPI();
+    if (decoded == 0xFFFF) return false;
+    position = decoded;
+    return true;
+}
 
-    //this is the time required between bytes as specified in the datasheet.
-    delayMicroseconds(3);
+/*
+ * The checkbits are odd parity over the odd bits (K1, bit 15) and over the even bits (K0, bit 14) of the response, i.e. each half
+ * of the bits must XOR to 1. Folding the word onto itself by even shifts XORs together bits of the same parity, leaving the parity
+ * of the even bits in bit 0 and that of the odd bits in bit 1.
+ */
+bool AMT22::checkbitsValid(uint16_t response){
+    uint8_t folded = (uint8_t)(response ^ (response >> 8));
+    folded ^= folded >> 4;
+    folded ^= folded >> 2;
+    return (folded & 0x3) == 0x3;
+}
 
-    //OR the low byte with the currentPosition variable. release line after second byte
-    currentPosition |= spiWriteRead(AMT22_NOP,true);
+/*
+ * Checks and strips the checkbits of a raw 16-bit response, returning 0xFFFF for a bad position.
+ */
+uint16_t AMT22::decodeResponse(uint16_t response, uint8_t resolution){
+    if (!checkbitsValid(response)) return 0xFFFF;
+
+    uint16_t position = response & 0x3FFF;
+    return (resolution == RES12) ? position >> 2 : position;
+}
 
-    //run through the 16 bits of position and put each bit into a slot in the array so we can do the checksum calculation
-    for(int i = 0; i < 16; i++) binaryArray[i] = (0x01) & (currentPosition >> (i));
+/*
+ * Clocks both position bytes out of the encoder within a single CS assertion, only observing the minimum times from the datasheet.
+ * Instead of sleeping after every read, the minimum time between reads is waited out before the next read if it comes too early.
+ */
+uint16_t AMT22::transferPosition(){
+    unsigned long sinceLastRead = micros() - _lastReadUs;
+    if (sinceLastRead < AMT22_T_READ_US) delayMicroseconds(AMT22_T_READ_US - sinceLastRead);
+
+    setCSLine(LOW);
+    delayMicroseconds(AMT22_T_CS_US);
 
-    //using the equation on the datasheet we can calculate the checksums and then make sure they match what the encoder sent
-    if ((binaryArray[15] == !(binaryArray[13] ^ binaryArray[11] ^ binaryArray[9] ^ binaryArray[7] ^ binaryArray[5] ^ binaryArray[3] ^ binaryArray[1])) && (binaryArray[14] == !(binaryArray[12] ^ binaryArray[10] ^ binaryArray[8] ^ binaryArray[6] ^ binaryArray[4] ^ binaryArray[2] ^ binaryArray[0])))
-        currentPosition &= 0x3FFF; //we got back a good position, so just mask away the checkbits
-    else
-        currentPosition = 0xFFFF; //bad position
+    uint16_t response = (uint16_t)SPI.transfer(AMT22_NOP) << 8;
+    delayMicroseconds(AMT22_T_BYTE_US);
+    response |= SPI.transfer(AMT22_NOP);
 
-    //If the resolution is 12-bits, and wasn't 0xFFFF, then shift position, otherwise do nothing
-    if ((_resolution == RES12) && (currentPosition != 0xFFFF)) currentPosition = currentPosition >> 2;
+    delayMicroseconds(AMT22_T_CS_US);
+    setCSLine(HIGH);
 
-    return currentPosition;
+    _lastReadUs = micros();
+    return response;
 }
 
 /*
@@ -74,7 +110,15 @@ uint8_t AMT22::spiWriteRead(uint8_t sendByte, uint8_t releaseLine){
  * This function sets the state of the SPI line.
  */
 void AMT22::setCSLine(uint8_t csLine){
+#if defined(ARDUINO_ARCH_AVR)
+    uint8_t oldSREG = SREG;
+    cli();
+    if (csLine) *_csPort |= _csMask;
+    else *_csPort &= ~_csMask;
+    SREG = oldSREG;
+#else
     digitalWrite(_cs, csLine);
+#endif
 }
 
 /*
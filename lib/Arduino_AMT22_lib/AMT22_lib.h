@@ -16,20 +16,35 @@
 
 #define RES12           12
 
+/* Timing requirements from the datasheet (microseconds) */
+#define AMT22_T_CS_US       3   // CS low to first clock, and last clock to CS high
+#define AMT22_T_BYTE_US     3   // Between the two bytes of a transfer
+#define AMT22_T_READ_US     40  // Between the end of one read and the start of the next
+
 class AMT22
 {
 public:
     AMT22(uint8_t cs, uint8_t resolution);
     uint16_t getPositionSPI();
+    bool readPositionRaw(uint16_t& position);
     void setZeroSPI();
     void resetAMT22();
     void setResolution(uint8_t resolution);
 
+    // Response decoding (no SPI involved, so these are usable on native)
+    static bool checkbitsValid(uint16_t response);
+    static uint16_t decodeResponse(uint16_t response, uint8_t resolution);
 
 private:
     uint8_t _cs, _resolution;
+    unsigned long _lastReadUs;
+#if defined(ARDUINO_ARCH_AVR)
+    volatile uint8_t* _csPort;
+    uint8_t _csMask;
+#endif
     uint8_t spiWriteRead(uint8_t sendByte, uint8_t releaseLine);
     void setCSLine (uint8_t csLine);
+    uint16_t transferPosition();
 
 };
 
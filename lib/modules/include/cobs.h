@@ -0,0 +1,61 @@
+#ifndef COBS_H
+#define COBS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Consistent Overhead Byte Stuffing (COBS), used for the framed wire protocol (the
+ * USE_COBS_FRAMING build flag). COBS removes all zero bytes from a frame at the cost of one byte
+ * per 254 bytes, so a zero can delimit frames: whatever garbage a receiver has seen, the next
+ * zero puts it back in sync.
+ *
+ * Both the encoder and the decoder work a byte at a time, so frames can be built from several
+ * buffers and decoded straight into the packet buffer as bytes arrive.
+ */
+
+#define COBS_DELIMITER 0x00
+
+// Encoded size of a frame of length bytes, including a delimiter before and after it
+constexpr size_t cobsFrameSize(size_t length) {
+    return length + length / 254 + 1 + 2;
+}
+
+class CobsEncoder {
+public:
+    // out must hold cobsFrameSize() bytes of everything that will be added
+    explicit CobsEncoder(uint8_t* out);
+
+    void add(uint8_t byte);
+    void add(const uint8_t* data, size_t length);
+    // Closes the frame, returns the number of bytes written to out
+    size_t finish();
+
+private:
+    uint8_t* m_out;
+    size_t m_len;
+    size_t m_codeIdx;
+    uint8_t m_code;
+};
+
+enum class CobsEvent : uint8_t {
+    NONE,           // Code byte, nothing decoded
+    BYTE,           // One byte of the frame decoded
+    FRAME_END,      // Delimiter after a well formed frame
+    FRAME_ERROR     // Delimiter in the middle of a block (truncated or corrupted frame)
+};
+
+class CobsDecoder {
+public:
+    CobsDecoder();
+
+    // Decodes one byte from the wire. On CobsEvent::BYTE, decoded holds the frame byte
+    CobsEvent feed(uint8_t c, uint8_t& decoded);
+    void reset();
+
+private:
+    uint8_t m_blockLeft;     // Data bytes left in the current block
+    bool m_zeroPending;      // The current block ends with an (implicit) zero
+};
+
+#endif // COBS_H
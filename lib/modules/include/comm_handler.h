@@ -1,9 +1,15 @@
 #ifndef COMM_HANDLER_H
 #define COMM_HANDLER_H
 
-#include <CRC.h>
-
+#include "cobs.h"
+#include "crc16_xmodem.h"
+#include "encoder_sampler.h"
+#include "flight_recorder.h"
+#include "loop_profiler.h"
+#include "progmem_own.h"
+#include "scheduler.h"
 #include "state_machine.h"
+#include "tx_queue.h"
 
 /* 
  * NOTE ABOUT ENDIANNESS: All fields in the packet structs, except for the magic bytes
@@ -28,13 +34,56 @@
  *  +--------+--------+--------+--------+
  *  |      Registered PT2 Reading       |
  *  +--------+--------+--------+--------+
+ *  |  TX Frames Sent | TX Coal| TX Drop|
+ *  +--------+--------+--------+--------+
+ *  |    Sequence     |   RX Received   |
+ *  +--------+--------+--------+--------+
+ *  |  RX Last Seq.   |     RX Lost     |
+ *  +--------+--------+--------+--------+
+ *  |  RX Duplicates  |  RX CRC Errors  |
+ *  +--------+--------+--------+--------+
+ *  |   RX Resyncs    | RX Jitter (us)  |
+ *  +--------+--------+--------+--------+
+ *  |        Echoed Pi Timestamp        |
+ *  +--------+--------+--------+--------+
+ *  |        Sample RX Time (us)        |
+ *  +--------+--------+--------+--------+
+ *  |           TX Time (us)            |
+ *  +--------+--------+--------+--------+
  * 
- * If the build flag USE_3_PTS is true, then we add an extra row at the end for the 3rd PT reading. 
+ * If the build flag USE_3_PTS is true, then we add an extra row for the 3rd PT reading before
+ * the TX counters.
+ *
+ * The TX counters are the frames sent, coalesced (replaced by a newer one before they went out)
+ * and dropped by the transmit queue (see tx_queue.h) since boot. They wrap around, the last two
+ * at 8 bits.
+ *
+ * Sequence goes up by one for every telemetry packet built (so a gap seen by the Pi is a packet
+ * coalesced or lost). The RX fields are the LinkStats of the pressure update packets received.
+ *
+ * The last three fields measure the latency of the pressure samples: the Pi timestamp of the
+ * last new pressure update packet, micros() when its magic bytes (or its frame) started to be
+ * processed, and micros() when this packet was built. The Pi can then compute the round trip
+ * (its receive time - Echoed Pi Timestamp - (TX Time - Sample RX Time)) and, with its own
+ * estimate of the clock offset, the one way latency.
  */
 
 #define MAGIC_START 0xadfb // NOTE: THIS IS LITTLE ENDIAN - WE SHOULD BE RECEIVING 0xfbad
 #define MAGIC_START_LEN 2
 
+/*
+ * FRAMING: By default packets are sent as they are, and the receiver syncs on the magic bytes.
+ * With the USE_COBS_FRAMING build flag, every packet (in both directions) is instead sent as
+ *
+ *     0x00 | COBS(Version | Packet) | 0x00
+ *
+ * where Version is COMM_PROTOCOL_VERSION and Packet is the packet struct as below (magic bytes
+ * included). See cobs.h. A receiver that lost sync (noise, dropped bytes, a packet with the magic
+ * in its payload) is back in sync at the next zero, i.e. it loses at most the damaged frame.
+ * Frames with another version or length are dropped.
+ */
+#define COMM_PROTOCOL_VERSION 1
+
 #define TELPKT_FLAGS_MPV_OPEN_DETECTED 0x1
 #define TELPKT_FLAGS_MPV_SHD_BE_CLOSED 0x2
 #define TELPKT_FLAGS_SYSTEM_TYPE 0x4 // FUEL is 1, OX is 0
@@ -49,6 +98,20 @@
     #define TELPKT_FAULTS_OSCILLATION_DETECTED 0x80
 #endif
 
+/*
+ * Quality of the link from the Pi, from the pressure update packets. All counters are since
+ * boot and wrap around.
+ */
+struct LinkStats {
+    uint16_t received;      // Packets with a valid checksum
+    uint16_t lastSequence;  // Of the last new packet
+    uint16_t lost;          // Sequence numbers skipped
+    uint16_t duplicates;    // Packets repeating (or older than) the last sequence number
+    uint16_t crcErrors;
+    uint16_t resyncs;       // Times the receiver lost sync (skipped bytes or dropped frames)
+    uint16_t jitterUs;      // Inter-arrival jitter (as in RFC 3550), saturates
+};
+
 #define TELPKT_SIZE sizeof(telemetryPacket_t)
 
 typedef struct {
@@ -67,6 +130,17 @@ typedef struct {
 #if USE_3_PTS
     float pt3Reading;
 #endif
+
+    uint16_t txSent;
+    uint8_t txCoalesced;
+    uint8_t txDropped;
+
+    uint16_t sequence;
+    LinkStats link;
+
+    uint32_t piTimestampEcho;
+    uint32_t sampleRxUs;
+    uint32_t txUs;
 } telemetryPacket_t;
 
 typedef union {
@@ -74,13 +148,320 @@ typedef union {
     uint8_t bytes[TELPKT_SIZE];
 } telemetryPacketU_t;
 
+/*
+ *  Compact Telemetry Packet Layout (sent instead of the above with the USE_COMPACT_TELEMETRY
+ *  build flag, at a higher TELEMETRY_RATE_HZ). The magic bytes are b'\xfb\xac'.
+ *  0        8       16       24       32 (Bits)
+ *  +--------+--------+--------+--------+
+ *  |   Magic Bytes   |    Checksum     |
+ *  +--------+--------+--------+--------+
+ *  | State  | Flags  | Faults | Unused |
+ *  +--------+--------+--------+--------+
+ *  |          Timestamp (ms)           |
+ *  +--------+--------+--------+--------+
+ *  |   Motor Angle   |   Delta Angle   |
+ *  +--------+--------+--------+--------+
+ *  | Integral Error  |   PT1 Reading   |
+ *  +--------+--------+--------+--------+
+ *  |   PT2 Reading   |   PT3 Reading   |
+ *  +--------+--------+--------+--------+
+ *  |  TX Frames Sent | TX Coal| TX Drop|
+ *  +--------+--------+--------+--------+
+ *  |    Sequence     |   RX Received   |
+ *  +--------+--------+--------+--------+
+ *  |  RX Last Seq.   |     RX Lost     |
+ *  +--------+--------+--------+--------+
+ *  |  RX Duplicates  |  RX CRC Errors  |
+ *  +--------+--------+--------+--------+
+ *  |   RX Resyncs    | RX Jitter (us)  |
+ *  +--------+--------+--------+--------+
+ *  |        Echoed Pi Timestamp        |
+ *  +--------+--------+--------+--------+
+ *  |        Sample RX Time (us)        |
+ *  +--------+--------+--------+--------+
+ *  |           TX Time (us)            |
+ *  +--------+--------+--------+--------+
+ *
+ * The state, flags, faults, TX counters, sequence, RX and timing fields are as in the telemetry
+ * packet. The timestamp is
+ * millis() when the packet was built. The other fields are signed 16-bit integers scaled by the
+ * CTELPKT_*_SCALE factors below (angles in 0.01 degree, the integral error in 0.001 psi s and
+ * pressures in 0.1 psi), saturating at the int16 range. Without USE_3_PTS, PT3 is unused (0).
+ * telemetry_decoder.h decodes both telemetry packets on the host.
+ */
+
+#define MAGIC_COMPACT 0xacfb // NOTE: THIS IS LITTLE ENDIAN - WE SEND 0xfbac
+
+#define CTELPKT_ANGLE_SCALE 100.0f
+#define CTELPKT_INTEGRAL_SCALE 1000.0f
+#define CTELPKT_PRESSURE_SCALE 10.0f
+
+#define CTELPKT_SIZE sizeof(compactTelemetryPacket_t)
+
+typedef struct {
+    uint16_t _magic;
+    uint16_t _checksum;
+    SystemStateEnum systemState;
+    uint8_t flags;
+    uint8_t faults;
+    uint8_t _unused; // Should be set to 0 so checksumming works
+
+    uint32_t timestampMs;
+    int16_t curMotorAngle;
+    int16_t curDeltaAngle;
+    int16_t curIntError;
+    int16_t pt1Reading;
+    int16_t pt2Reading;
+    int16_t pt3Reading;
+
+    uint16_t txSent;
+    uint8_t txCoalesced;
+    uint8_t txDropped;
+
+    uint16_t sequence;
+    LinkStats link;
+
+    uint32_t piTimestampEcho;
+    uint32_t sampleRxUs;
+    uint32_t txUs;
+} compactTelemetryPacket_t;
+
+typedef union {
+    compactTelemetryPacket_t data;
+    uint8_t bytes[CTELPKT_SIZE];
+} compactTelemetryPacketU_t;
+
+// The telemetry packet that is sent
+#ifdef USE_COMPACT_TELEMETRY
+    #define TX_TELPKT_SIZE CTELPKT_SIZE
+#else
+    #define TX_TELPKT_SIZE TELPKT_SIZE
+#endif
+
+#ifdef USE_LOOP_PROFILER
+/*
+ *  Diagnostics Packet Layout (only sent with the USE_LOOP_PROFILER build flag, at
+ *  ProfilerConfig::DIAG_RATE_HZ). The magic bytes are b'\xfb\xae', to tell it apart from telemetry.
+ *  0        8       16       24       32 (Bits)
+ *  +--------+--------+--------+--------+
+ *  |   Magic Bytes   |    Checksum     |
+ *  +--------+--------+--------+--------+
+ *  | Phases | Tasks  |  RX Overflows   |
+ *  +--------+--------+--------+--------+
+ *  |    Min (us)     |    Max (us)     |  \
+ *  +--------+--------+--------+--------+   |
+ *  |    Mean (us)    |      Count      |   > One block per LoopPhase, in enum order
+ *  +--------+--------+--------+--------+   |
+ *  |    Overruns     |     Unused      |  /
+ *  +--------+--------+--------+--------+
+ *  |      Runs       |    Overruns     |  \ One block per scheduler task slot, in the order
+ *  +--------+--------+--------+--------+   > the tasks were added (TaskScheduler::MAX_TASKS,
+ *  | Max Latency(us) |   Max Run (us)  |  /  only the first Tasks are used, the others are 0)
+ *  +--------+--------+--------+--------+
+ *  |  Encoder Reads  |   Reads Saved   |
+ *  +--------+--------+--------+--------+
+ *
+ * The stats cover the time since the previous diagnostics packet. Counts and times saturate at
+ * 0xffff. RX Overflows is the number of received bytes dropped since boot because serialRxRing
+ * was full. A task's overruns are the releases it skipped, and its latency is from its release
+ * to its start (see scheduler.h). Reads Saved are the encoder samples that were shared within a
+ * pass of loop() instead of read again (see encoder_sampler.h).
+ */
+
+#define MAGIC_DIAG 0xaefb // NOTE: THIS IS LITTLE ENDIAN - WE SEND 0xfbae
+
+#define DIAGPKT_SIZE sizeof(diagnosticsPacket_t)
+
+typedef struct {
+    uint16_t minUs;
+    uint16_t maxUs;
+    uint16_t meanUs;
+    uint16_t count;
+    uint16_t overruns;
+    uint16_t _unused;
+} diagnosticsPhase_t;
+
+typedef struct {
+    uint16_t runs;
+    uint16_t overruns;
+    uint16_t maxLatencyUs;
+    uint16_t maxRunUs;
+} diagnosticsTask_t;
+
+typedef struct {
+    uint16_t _magic;
+    uint16_t _checksum;
+    uint8_t numPhases;
+    uint8_t numTasks;
+    uint16_t rxOverflows;
+
+    diagnosticsPhase_t phases[(uint8_t)LoopPhase::COUNT];
+    diagnosticsTask_t tasks[TaskScheduler::MAX_TASKS];
+    uint16_t encoderReads;
+    uint16_t encoderReadsSaved;
+} diagnosticsPacket_t;
+
+typedef union {
+    diagnosticsPacket_t data;
+    uint8_t bytes[DIAGPKT_SIZE];
+} diagnosticsPacketU_t;
+#endif
+
+/*
+ *  Flight Recorder Dump Packet Layout (sent after the flight recorder froze, see
+ *  flight_recorder.h). The magic bytes are b'\xfb\xaf'.
+ *  0        8       16       24       32 (Bits)
+ *  +--------+--------+--------+--------+
+ *  |   Magic Bytes   |    Checksum     |
+ *  +--------+--------+--------+--------+
+ *  | First  | Count  | Total  | Unused |
+ *  +--------+--------+--------+--------+
+ *  |    Time (ms)    |    Pressure     |  \
+ *  +--------+--------+--------+--------+   |
+ *  |      Error      |     Output      |   |
+ *  +--------+--------+--------+--------+    > RecorderConfig::RECORDS_PER_DUMP_PACKET records
+ *  |  Target Angle   |  Current Angle  |   |
+ *  +--------+--------+--------+--------+   |
+ *  | State  | Faults |                    /
+ *  +--------+--------+
+ *
+ * First is the index of the first record in the packet (records are numbered oldest first) and
+ * Total the number of recorded control ticks; only the first Count records are valid (the others
+ * are 0). The records are as in flightRecord_t: angles in 0.01 degree, pressures in 0.1 psi, the
+ * time is the low 16 bits of millis() and the faults are TELPKT_FAULTS_* bits.
+ */
+
+#define MAGIC_DUMP 0xaffb // NOTE: THIS IS LITTLE ENDIAN - WE SEND 0xfbaf
+
+#define DUMPPKT_SIZE sizeof(dumpPacket_t)
+
+static_assert(sizeof(flightRecord_t) == 14, "The dump packet layout assumes 14 byte records");
+
+typedef struct {
+    uint16_t _magic;
+    uint16_t _checksum;
+    uint8_t first;
+    uint8_t count;
+    uint8_t total;
+    uint8_t _unused; // Should be set to 0 so checksumming works
+
+    flightRecord_t records[RecorderConfig::RECORDS_PER_DUMP_PACKET];
+} dumpPacket_t;
+
+typedef union {
+    dumpPacket_t data;
+    uint8_t bytes[DUMPPKT_SIZE];
+} dumpPacketU_t;
+
+/*
+ *  Event Packet Layout (sent as soon as the state changes or a fault latches, see
+ *  CommHandler::queueEvent()). The magic bytes are b'\xfb\xb0'.
+ *  0        8       16       24       32 (Bits)
+ *  +--------+--------+--------+--------+
+ *  |   Magic Bytes   |    Checksum     |
+ *  +--------+--------+--------+--------+
+ *  |  Type  |Old Stat|New Stat| Faults |
+ *  +--------+--------+--------+--------+
+ *  |           Timestamp (ms)          |
+ *  +--------+--------+--------+--------+
+ *  | Events Dropped  |     Unused      |
+ *  +--------+--------+--------+--------+
+ *
+ * Type is an EventType. Faults is the cause: all TELPKT_FAULTS_* bits set at a state change,
+ * or the newly latched bits for FAULT_LATCHED (whose old and new states are both the current
+ * state). The timestamp is millis() when the event happened, which may be before the packet is
+ * sent because event packets are rate limited (CommConfig::EVENT_MIN_INTERVAL_MS). Events
+ * Dropped counts the events lost since boot because too many were waiting (it wraps around).
+ */
+
+#define MAGIC_EVENT 0xb0fb // NOTE: THIS IS LITTLE ENDIAN - WE SEND 0xfbb0
+
+#define EVTPKT_SIZE sizeof(eventPacket_t)
+
+enum class EventType : uint8_t {
+    STATE_CHANGE,
+    FAULT_LATCHED
+};
+
+typedef struct {
+    uint16_t _magic;
+    uint16_t _checksum;
+    EventType type;
+    SystemStateEnum oldState;
+    SystemStateEnum newState;
+    uint8_t faults;
+
+    uint32_t timestampMs;
+    uint16_t eventsDropped;
+    uint16_t _unused; // Should be set to 0 so checksumming works
+} eventPacket_t;
+
+typedef union {
+    eventPacket_t data;
+    uint8_t bytes[EVTPKT_SIZE];
+} eventPacketU_t;
+
+#ifdef USE_INPUT_JOURNAL
+/*
+ *  Journal Packet Layout (only sent with the USE_INPUT_JOURNAL build flag, see input_journal.h).
+ *  The magic bytes are b'\xfb\xb1'.
+ *  0        8       16       24       32 (Bits)
+ *  +--------+--------+--------+--------+
+ *  |   Magic Bytes   |    Checksum     |
+ *  +--------+--------+--------+--------+
+ *  |    Sequence     | Length | Unused |
+ *  +--------+--------+--------+--------+
+ *  |          Journal (JournalConfig::CHUNK_SIZE bytes)          |
+ *  +--------+--------+--------+--------+
+ *
+ * Each packet carries the next chunk of the input journal; only the first Length bytes are
+ * valid (the others are 0). Sequence goes up by one for every chunk, sent or not, so the Pi can
+ * append the chunks into the journal file and tell where a chunk was lost (the journal can only
+ * be played back up to there).
+ */
+
+#define MAGIC_JOURNAL 0xb1fb // NOTE: THIS IS LITTLE ENDIAN - WE SEND 0xfbb1
+
+#define JRNPKT_SIZE sizeof(journalPacket_t)
+
+typedef struct {
+    uint16_t _magic;
+    uint16_t _checksum;
+    uint16_t sequence;
+    uint8_t length;
+    uint8_t _unused; // Should be set to 0 so checksumming works
+
+    uint8_t journal[JournalConfig::CHUNK_SIZE];
+} journalPacket_t;
+
+typedef union {
+    journalPacket_t data;
+    uint8_t bytes[JRNPKT_SIZE];
+} journalPacketU_t;
+#endif
+
+// Size of a packet as it is sent on the wire
+constexpr size_t txFrameSize(size_t packetSize) {
+#ifdef USE_COBS_FRAMING
+    return cobsFrameSize(packetSize + 1);
+#else
+    return packetSize;
+#endif
+}
+
+// 10 bits per byte on the wire (8N1)
+static_assert(CommConfig::TELEMETRY_RATE_HZ * txFrameSize(TX_TELPKT_SIZE) * 10 <= CommConfig::TELEMETRY_LINK_SHARE * CommConfig::BAUD_RATE,
+              "Telemetry rate too high for the link; use USE_COMPACT_TELEMETRY or lower TELEMETRY_RATE_HZ");
+
 /*
  *  Layout of Incoming Pressure Update Packet Layout
  *  0        8       16       24       32 (Bits)
  *  +--------+--------+--------+--------+
  *  |   Magic Bytes   |    Checksum     |
  *  +--------+--------+--------+--------+
- *  | State  | Flags  |     Unused      |
+ *  | State  | Flags  |    Sequence     |
+ *  +--------+--------+--------+--------+
+ *  |           Pi Timestamp            |
  *  +--------+--------+--------+--------+
  *  |            PT1 Reading            |
  *  +--------+--------+--------+--------+
@@ -88,6 +469,12 @@ typedef union {
  *  +--------+--------+--------+--------+
  * 
  * If the build flag USE_3_PTS is true, then we add an extra row at the end for the 3rd PT reading. 
+ *
+ * Sequence goes up by one for every new sample. A packet repeating the last sequence number (or
+ * a recent older one) is counted as a duplicate, and its contents are ignored.
+ *
+ * The Pi timestamp is the Pi's own clock (e.g. in us) when it took the sample. It is only
+ * echoed back in telemetry, so its unit and epoch are up to the Pi.
  */
 
 #define UPDTPKT_FLAGS_MPV_OPEN 0x1
@@ -99,7 +486,8 @@ typedef struct {
     uint16_t _checksum;
     SystemStateEnum otherState;
     uint8_t flags;
-    uint16_t _unused; // Should be set to 0 so checksumming works
+    uint16_t sequence;
+    uint32_t piTimestamp;
 
     float pt1Reading;
     float pt2Reading;
@@ -113,6 +501,106 @@ typedef union {
     uint8_t bytes[UPDTPKT_SIZE];
 } pressureUpdatePacketU_t;
 
+/*
+ *  Layout of Incoming Command Packet (sets a tunable parameter, see Tunables in state_machine.h).
+ *  The magic bytes are b'\xfb\xc0'.
+ *  0        8       16       24       32 (Bits)
+ *  +--------+--------+--------+--------+
+ *  |   Magic Bytes   |    Checksum     |
+ *  +--------+--------+--------+--------+
+ *  |  Type  | Unused |   Command Id    |
+ *  +--------+--------+--------+--------+
+ *  |               Value               |
+ *  +--------+--------+--------+--------+
+ *
+ * Type is a CommandType and Value the new value (a float, in the unit of the parameter). Every
+ * command with a valid checksum is answered by an ACK packet, echoing its Command Id (chosen by
+ * the Pi, e.g. a counter). Commands are only applied in BOOT_INIT and OPEN_LOOP_INIT, and values
+ * outside the CommandConfig bounds are rejected. All commands set a value, so a command whose
+ * ACK got lost can simply be sent again.
+ *
+ *  ACK Packet Layout (sent back for each command). The magic bytes are b'\xfb\xc1'.
+ *  0        8       16       24       32 (Bits)
+ *  +--------+--------+--------+--------+
+ *  |   Magic Bytes   |    Checksum     |
+ *  +--------+--------+--------+--------+
+ *  |  Type  | Status |   Command Id    |
+ *  +--------+--------+--------+--------+
+ *  |           Applied Value           |
+ *  +--------+--------+--------+--------+
+ *
+ * Status is a CommandStatus. If the command was applied, Applied Value is the value now in
+ * effect, which may differ from the requested one by the resolution of its representation
+ * (e.g. the fixed point gains on the AVR). Otherwise it is the requested value.
+ */
+
+#define MAGIC_COMMAND 0xc0fb // NOTE: THIS IS LITTLE ENDIAN - WE SHOULD BE RECEIVING 0xfbc0
+#define MAGIC_ACK 0xc1fb // NOTE: THIS IS LITTLE ENDIAN - WE SEND 0xfbc1
+
+#define CMDPKT_SIZE sizeof(commandPacket_t)
+#define ACKPKT_SIZE sizeof(ackPacket_t)
+
+enum class CommandType : uint8_t {
+    SET_KP = 1,
+    SET_KI,
+    SET_KD,
+    SET_TARGET_PRESSURE,        // psi
+    SET_REDBAND_UPPER,          // psi above the target
+    SET_REDBAND_LOWER,          // psi below the target
+    SET_MAX_ANGLE_CHANGE,       // Degrees per cycle
+    SET_MOVE_FILTER_SCALE
+};
+
+enum class CommandStatus : uint8_t {
+    APPLIED,
+    OUT_OF_BOUNDS,
+    UNSAFE_STATE,   // Not in BOOT_INIT or OPEN_LOOP_INIT
+    UNKNOWN_TYPE
+};
+
+typedef struct {
+    uint16_t _magic;
+    uint16_t _checksum;
+    CommandType type;
+    uint8_t _unused;
+    uint16_t commandId;
+    float value;
+} commandPacket_t;
+
+typedef union {
+    commandPacket_t data;
+    uint8_t bytes[CMDPKT_SIZE];
+} commandPacketU_t;
+
+typedef struct {
+    uint16_t _magic;
+    uint16_t _checksum;
+    CommandType type;
+    CommandStatus status;
+    uint16_t commandId;
+    float appliedValue;
+} ackPacket_t;
+
+typedef union {
+    ackPacket_t data;
+    uint8_t bytes[ACKPKT_SIZE];
+} ackPacketU_t;
+
+// Both incoming packets are received in the same buffer
+static_assert(CMDPKT_SIZE <= UPDTPKT_SIZE, "Command packet longer than the input buffer");
+
+/*
+ * A command the CommHandler accepts: values in [min, max] are passed to apply(), which returns
+ * the value now in effect. Command tables are placed in PROGMEM; the table of the controller's
+ * commands is tuningCommands (utilities.h).
+ */
+struct CommandSpec {
+    CommandType type;
+    float min;
+    float max;
+    float (*apply)(float value);
+};
+
 
 struct PressureData {
     float sensor1;
@@ -122,20 +610,35 @@ struct PressureData {
 #endif
     bool valid;
     
+#if USE_3_PTS
+    PressureData() : sensor1(0.0f), sensor2(0.0f), sensor3(0.0f), valid(false) {}
+#else
     PressureData() : sensor1(0.0f), sensor2(0.0f), valid(false) {}
+#endif
 };
 
 
+// TX hooks writing to Serial
+extern const TxHooks serialTxHooks;
+
 class CommHandler {
 public:
-    CommHandler();
+    explicit CommHandler(const TxHooks* txHooks = &serialTxHooks);
     
     // Communication-related
     void processIncomingNonBlocking();
     void flushInputBuffer();
+    // Continues sending the queued packets, as far as it does not block
+    void processOutgoingNonBlocking();
+    const TxStats& getTxStats() const { return m_txQueue.getStats(); }
     
     // Getters
     PressureData getPressureData() const { return m_pressureData; }
+    // True (once) if a new pressure sample arrived since the previous call
+    bool takeNewSample();
+    const LinkStats& getLinkStats() const { return m_link; }
+    // micros() when the current sample started to be received
+    unsigned long getSampleRxUs() const { return m_sampleRxUs; }
     SystemStateEnum getOtherCtrlerState() const { return m_otherCtrlerState; }
 
     // Check if communication is healthy
@@ -144,22 +647,104 @@ public:
     // Send telemetry data
     void sendTelemetry(SystemStateEnum state, float motorAngle, float deltaAngle, float pidIntegralError, const char* systemType, bool ifMpvOpen);
 
+    // Sends an event packet now, or as soon as the rate limit allows. Events beyond
+    // EVENT_QUEUE_SIZE waiting ones are dropped (and counted)
+    void queueEvent(EventType type, SystemStateEnum oldState, SystemStateEnum newState, uint8_t faults);
+    // Queues a FAULT_LATCHED event for the fault bits set since the previous call
+    void reportNewFaults(SystemStateEnum state);
+
+    // Queues the next dump packet of a frozen flight recorder, unless the previous one is still
+    // going out. Returns false once the whole recorder has been queued
+    bool sendFlightRecorderDump(FlightRecorder& recorder);
+
+    // Commands that are accepted (all others are answered with UNKNOWN_TYPE), a PROGMEM table
+    void setCommandTable(const CommandSpec* commands, uint8_t numCommands);
+
+    // TELPKT_FAULTS_* bits of the global fault flags
+    static uint8_t telemetryFaults();
+
+#ifdef USE_LOOP_PROFILER
+    // Send the loop profiler's, the scheduler's and the encoder sampler's stats as a diagnostics packet
+    void sendDiagnostics(const LoopProfiler& profiler, const TaskScheduler& scheduler, const EncoderSampler& encoder);
+#endif
+
+#ifdef USE_INPUT_JOURNAL
+    // Queues a chunk of the input journal as a journal packet. Returns false if it was dropped
+    // because the previous chunk is still going out
+    bool sendJournalChunk(const uint8_t* data, uint8_t length);
+#endif
+
 #ifdef PIO_UNIT_TESTING
     void processIncomingSerialByte(uint8_t c);
     bool parsePressureUpdatePacket();
+    CommandStatus dispatchCommand(const commandPacket_t& command, float& appliedValue);
+
+#ifdef USE_LOOP_PROFILER
+    void buildDiagnosticsPacket(diagnosticsPacketU_t& packet, const LoopProfiler& profiler, const TaskScheduler& scheduler,
+                                const EncoderSampler& encoder);
+#endif
 
     const pressureUpdatePacketU_t& getInputBuffer() const { return m_inputBuffer; };
     const bool getPressureUpdateSuccess() const { return m_pressureUpdateSuccess; };
 #endif
     
 private:
+    static constexpr uint8_t RX_BATCH_SIZE = 32; // Bytes taken from serialRxRing at a time
+    static constexpr uint8_t EVENT_QUEUE_SIZE = 4;
+    static constexpr uint16_t LATE_SEQUENCE_WINDOW = 16; // Further back, the Pi restarted its sequence
+
+    struct PendingEvent {
+        EventType type;
+        SystemStateEnum oldState;
+        SystemStateEnum newState;
+        uint8_t faults;
+        uint32_t timestampMs;
+    };
+
     pressureUpdatePacketU_t m_inputBuffer;
     unsigned int m_bufLen;
     bool m_pressureUpdateSuccess;
+    Crc16Xmodem m_rxCrc; // Of the bytes of m_inputBuffer received so far
 
-    telemetryPacketU_t m_outputBuffer;
+    LinkStats m_link;
+    bool m_newSample;
+    bool m_haveSequence;            // m_link.lastSequence is valid
+    bool m_inSync;                  // No bytes skipped since the last packet
+    unsigned long m_rxStartUs;      // micros() at the magic bytes (or frame start) of the packet being received
+    unsigned long m_sampleRxUs;     // m_rxStartUs of the current sample
+    uint32_t m_piTimestamp;         // Of the current sample
+    unsigned long m_lastArrivalUs;  // m_rxStartUs of the previous sample
+    unsigned long m_lastIntervalUs;
+    uint32_t m_jitterX16;           // Jitter estimate, times 16
 
-    CRC16 m_crc16;
+    TxQueue m_txQueue;
+    int8_t m_telemetrySlot;
+    uint16_t m_telemetrySequence;
+    uint8_t m_telemetryFrame[txFrameSize(TX_TELPKT_SIZE)];
+    int8_t m_dumpSlot;
+    uint8_t m_dumpFrame[txFrameSize(DUMPPKT_SIZE)];
+    int8_t m_eventSlot;
+    uint8_t m_eventFrame[txFrameSize(EVTPKT_SIZE)];
+    int8_t m_ackSlot;
+    uint8_t m_ackFrame[txFrameSize(ACKPKT_SIZE)];
+
+    PendingEvent m_events[EVENT_QUEUE_SIZE]; // Oldest first
+    uint8_t m_numEvents;
+    uint16_t m_eventsDropped;
+    bool m_eventSent;               // Whether m_lastEventMs is valid
+    unsigned long m_lastEventMs;    // When the last event packet was queued
+    uint8_t m_reportedFaults;
+    const CommandSpec* m_commands;
+    uint8_t m_numCommands;
+#ifdef USE_LOOP_PROFILER
+    int8_t m_diagnosticsSlot;
+    uint8_t m_diagnosticsFrame[txFrameSize(DIAGPKT_SIZE)];
+#endif
+#ifdef USE_INPUT_JOURNAL
+    int8_t m_journalSlot;
+    uint16_t m_journalSequence;
+    uint8_t m_journalFrame[txFrameSize(JRNPKT_SIZE)];
+#endif
 
     SystemStateEnum m_otherCtrlerState;
     PressureData m_pressureData;
@@ -169,9 +754,33 @@ private:
 #ifndef PIO_UNIT_TESTING
     void processIncomingSerialByte(uint8_t c);
     bool parsePressureUpdatePacket();
+    CommandStatus dispatchCommand(const commandPacket_t& command, float& appliedValue);
+#ifdef USE_LOOP_PROFILER
+    void buildDiagnosticsPacket(diagnosticsPacketU_t& packet, const LoopProfiler& profiler, const TaskScheduler& scheduler,
+                                const EncoderSampler& encoder);
+#endif
 #endif
 
+#ifdef USE_COBS_FRAMING
+    CobsDecoder m_cobsDecoder;
+    static constexpr uint8_t FRAME_DROPPED = 0xFF;
+    static_assert(UPDTPKT_SIZE < FRAME_DROPPED, "Pressure update packet too long for m_frameLen");
+    uint8_t m_frameLen;     // Decoded bytes of the current frame, version included, or FRAME_DROPPED
+    void processFrameByte(uint8_t c);
+#endif
+
+    void countResync();
+    bool isNewSequence(uint16_t sequence);
+    void updateJitter();
+    static uint8_t incomingPacketSize(uint16_t magic);
+    void storePacketByte(uint8_t c);
+    void completePacket();
+    void processCommandPacket();
+    void queuePacket(int8_t slot, const uint8_t* bytes, size_t length);
+    void sendPendingEvent();
+
     // Utility functions
+    uint8_t telemetryFlags(const char* systemType, bool ifMpvShdBeClosed);
     void updateNumConsecInvalidPUP(bool valid);
     bool isValidPressure(float p);
     uint16_t calcChecksum(const uint8_t *array, unsigned int length);
@@ -0,0 +1,29 @@
+#ifndef CONTROL_TASKS_H
+#define CONTROL_TASKS_H
+
+#include <stdint.h>
+
+#include <scheduler.h>
+
+/*
+ * The tasks of the controller, released by the task scheduler (see setup() in main.cpp): the
+ * comms, the global monitors (abort, MPV, comm watchdog, state sync) and the state machine
+ * with its state handlers. They only reach the hardware through utilities.h, so they also run
+ * in the native simulator.
+ */
+
+// Defined in main.cpp (or by whatever else runs the tasks)
+extern TaskScheduler scheduler;
+extern int8_t controlTaskId;
+
+void processComms();
+#ifdef USE_LOOP_PROFILER
+void sendDiagnostics();
+#endif
+void globalMonitors();
+void stateMachineUpdate();
+
+// Clears the tasks' own state (the redband and comm watchdog timers), e.g. between simulations
+void resetControlTasks();
+
+#endif // CONTROL_TASKS_H
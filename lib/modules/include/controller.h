@@ -1,68 +1,160 @@
-#ifndef CONTROLLER_H
-#define CONTROLLER_H
-
-#include "config.h"
-
-class Controller {
-public:
-    Controller(float kp, float ki, float kd);
-    void update(float error, float dt);
-    void reset();
-    float getError() const { return m_curError; }
-    float getIntegral() const { return m_integralError; }
-
-#ifdef USE_OSCILLATION_DETECTOR
-private: 
-    static constexpr uint8_t M_SIGN_CHG_BUF_SIZE_MULTIPLIER = 10;
-
-public: 
-
-    // Oscillation detection nested class
-    class OscillationDetector {
-    public:
-        OscillationDetector();
-        bool checkOscillation(float error, unsigned long now);
-        void reset();
-
-    #ifdef PIO_UNIT_TESTING
-        int getCurrentSign() const { return m_currentSign; }
-        int getLeftPtr() const { return m_lPtr; }
-        int getRightPtr() const { return m_rPtr; }
-        int getSignChgCnt() const { return m_signChgCnt; }
-        int getConsecErrorCnt() const { return m_consecErrorCnt; }
-
-        const unsigned long* getOscTimes() const { return m_oscTimes; }
-    #endif
-
-    private:
-        enum CurrentSign { UNINITIALIZED, POSITIVE, NEGATIVE };
-        CurrentSign m_currentSign; 
-
-        int m_lPtr, m_rPtr, m_signChgCnt, m_consecErrorCnt;
-        unsigned long m_oscTimes[FDIRConfig::MAX_SIGN_CHANGES * M_SIGN_CHG_BUF_SIZE_MULTIPLIER];
-        
-        bool m_tryAddErrorToCnt(float error);
-        void m_addSignChg(unsigned long timeToAdd);
-        void m_rmSignChg();
-        void m_incrementCirPtr(int& cirPtr);
-    };
-
-    OscillationDetector& getOscillationDetector() { return m_oscDetector; }
-#endif
-
-private:
-    float m_kp;
-    float m_ki;
-    float m_kd;
-    float m_curError;
-    float m_integralError;
-    float m_previousError;
-    bool m_firstCall;
-
-#ifdef USE_OSCILLATION_DETECTOR
-    OscillationDetector m_oscDetector;
-#endif
-    float clamp(float value, float min, float max);
-};
-
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include "config.h"
+#include "fixed_point.h"
+
+typedef Fixed<int16_t, int32_t, 4> PressureQ; // psi, +-2047.9 in 1/16 psi
+
+/*
+ * Types and arithmetic of the PID controller for each numeric type of the pressure error.
+ *
+ * The fixed point formats are chosen so that every multiply is 16 x 16 -> 32 bit on the AVR:
+ * the gains (and dt) have 12 fractional bits, so a gain times an error is exactly the 16
+ * fractional bits of the output, and the integral (clamped to I_MIN..I_MAX) is multiplied in
+ * 11 fractional bits.
+ */
+template <typename T>
+struct PidMath;
+
+template <>
+struct PidMath<float> {
+    typedef float Error;
+    typedef float Gain;
+    typedef float Time;
+    typedef float Integral;
+    typedef float Output;
+
+    static Integral integrate(Error error, Time dt) { return error * dt; }
+    static Output mulError(Gain gain, Error error) { return gain * error; }
+    static Output mulIntegral(Gain gain, Integral integral) { return gain * integral; }
+    static Error derivative(Error change, Time dt) { return change / dt; }
+};
+
+template <>
+struct PidMath<PressureQ> {
+    typedef PressureQ Error;
+    typedef Fixed<int16_t, int32_t, 12> Gain;       // +-7.99 in 1/4096
+    typedef Fixed<int16_t, int32_t, 12> Time;       // Seconds, up to 7.99 s
+    typedef Fixed<int32_t, int64_t, 16> Integral;   // psi s
+    typedef Fixed<int32_t, int64_t, 16> Output;     // Degrees
+
+    static Integral integrate(Error error, Time dt) {
+        return Integral::fromRaw((int32_t)error.raw() * dt.raw());
+    }
+    static Output mulError(Gain gain, Error error) {
+        return Output::fromRaw((int32_t)gain.raw() * error.raw());
+    }
+    static Output mulIntegral(Gain gain, Integral integral) {
+        int16_t integralQ11 = (int16_t)((integral.raw() + 16) >> 5);
+        return Output::fromRaw(((int32_t)gain.raw() * integralQ11 + 64) >> 7);
+    }
+    // Saturates at +-2047 psi/s
+    static Error derivative(Error change, Time dt) {
+        return Error::fromRaw(((int32_t)change.raw() << 12) / dt.raw());
+    }
+
+    static_assert(ControllerConfig::I_MAX < 16.0f && ControllerConfig::I_MIN > -16.0f,
+                  "The integral must fit in 16 bits with 11 fractional bits");
+};
+
+// Oscillation detection (on the raw pressure error, in psi)
+#ifdef USE_OSCILLATION_DETECTOR
+class OscillationDetector {
+public:
+    OscillationDetector();
+    bool checkOscillation(float error, unsigned long now);
+    void reset();
+
+#ifdef PIO_UNIT_TESTING
+    int getCurrentSign() const { return m_currentSign; }
+    int getLeftPtr() const { return m_lPtr; }
+    int getRightPtr() const { return m_rPtr; }
+    int getSignChgCnt() const { return m_signChgCnt; }
+    int getConsecErrorCnt() const { return m_consecErrorCnt; }
+
+    const unsigned long* getOscTimes() const { return m_oscTimes; }
+#endif
+
+private:
+    static constexpr uint8_t M_SIGN_CHG_BUF_SIZE_MULTIPLIER = 10;
+
+    enum CurrentSign { UNINITIALIZED, POSITIVE, NEGATIVE };
+    CurrentSign m_currentSign;
+
+    int m_lPtr, m_rPtr, m_signChgCnt, m_consecErrorCnt;
+    unsigned long m_oscTimes[FDIRConfig::MAX_SIGN_CHANGES * M_SIGN_CHG_BUF_SIZE_MULTIPLIER];
+
+    bool m_tryAddErrorToCnt(float error);
+    void m_addSignChg(unsigned long timeToAdd);
+    void m_rmSignChg();
+    void m_incrementCirPtr(int& cirPtr);
+};
+#endif
+
+/*
+ * PID controller over the numeric type T of the pressure error (float or PressureQ). The output
+ * (getError()) is the valve angle change in degrees. It is instantiated for both types in
+ * controller.cpp.
+ */
+template <typename T>
+class BasicController {
+public:
+    typedef PidMath<T> Math;
+    typedef typename Math::Error Error;
+    typedef typename Math::Gain Gain;
+    typedef typename Math::Time Time;
+    typedef typename Math::Integral Integral;
+    typedef typename Math::Output Output;
+
+    // Gains from ControllerConfig (converted at compile time)
+    BasicController();
+    BasicController(float kp, float ki, float kd);
+
+    void update(Error error, Time dt);
+    void reset();
+    Output getError() const { return m_curError; }
+    Integral getIntegral() const { return m_integralError; }
+
+    // Gains can be changed at run time (by command packets, see comm_handler.h)
+    void setKp(float kp) { m_kp = Gain(kp); }
+    void setKi(float ki) { m_ki = Gain(ki); }
+    void setKd(float kd) { m_kd = Gain(kd); }
+    Gain getKp() const { return m_kp; }
+    Gain getKi() const { return m_ki; }
+    Gain getKd() const { return m_kd; }
+
+#ifdef USE_OSCILLATION_DETECTOR
+    OscillationDetector& getOscillationDetector() { return m_oscDetector; }
+#endif
+
+private:
+    static constexpr Gain CONFIG_KP = Gain(ControllerConfig::KP);
+    static constexpr Gain CONFIG_KI = Gain(ControllerConfig::KI);
+    static constexpr Gain CONFIG_KD = Gain(ControllerConfig::KD);
+    static constexpr Integral I_MIN = Integral(ControllerConfig::I_MIN);
+    static constexpr Integral I_MAX = Integral(ControllerConfig::I_MAX);
+
+    Gain m_kp;
+    Gain m_ki;
+    Gain m_kd;
+    Output m_curError;
+    Integral m_integralError;
+    Error m_previousError;
+    bool m_firstCall;
+
+#ifdef USE_OSCILLATION_DETECTOR
+    OscillationDetector m_oscDetector;
+#endif
+    static Integral clamp(Integral value, Integral min, Integral max);
+};
+
+// The AVR has no FPU, so the controller runs in fixed point there (USE_FIXED_POINT_CONTROLLER is set
+// in env:uno, and in the native envs that run the firmware, so that they run the same controller)
+#ifdef USE_FIXED_POINT_CONTROLLER
+typedef BasicController<PressureQ> Controller;
+#else
+typedef BasicController<float> Controller;
+#endif
+
 #endif // CONTROLLER_H
\ No newline at end of file
@@ -0,0 +1,100 @@
+#ifndef CRC16_XMODEM_H
+#define CRC16_XMODEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "progmem_own.h"
+
+/*
+ * CRC16-XMODEM (polynomial 0x1021, initial value 0, no reflection, no final XOR), used for the
+ * checksums of all packets. Same result as robtillaart's CRC16 with the CRC16_XMODEM_* settings.
+ *
+ * The byte update is a lookup in a 256 entry table in flash (512 bytes), instead of 8 shift and
+ * XOR steps per byte. Building with CRC16_NIBBLE_TABLE uses a 16 entry table (32 bytes) and two
+ * lookups per byte instead, to save flash. Both tables are generated at compile time.
+ *
+ * crc16XmodemConstexpr() computes the checksum of a constant buffer at compile time (e.g. for
+ * static_asserts), and Crc16Xmodem accumulates it incrementally (byte by byte or in blocks).
+ */
+
+constexpr uint16_t XMODEM_POLY = 0x1021;
+constexpr uint16_t XMODEM_INIT = 0x0000;
+
+// Reference update, one bit at a time (used to generate the tables)
+constexpr uint16_t crc16XmodemBitwise(uint16_t crc, uint8_t byte) {
+    crc ^= (uint16_t)byte << 8;
+    for (uint8_t i = 0; i < 8; i++)
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ XMODEM_POLY) : (uint16_t)(crc << 1);
+    return crc;
+}
+
+constexpr uint16_t crc16XmodemConstexpr(const char* data, size_t length, uint16_t crc = XMODEM_INIT) {
+    for (size_t i = 0; i < length; i++)
+        crc = crc16XmodemBitwise(crc, (uint8_t)data[i]);
+    return crc;
+}
+
+static_assert(crc16XmodemConstexpr("123456789", 9) == 0x31C3, "CRC16-XMODEM check value");
+
+// Entry i is the CRC of the top byte (or nibble) i shifted out of a zero register
+struct Crc16ByteTable {
+    uint16_t entries[256];
+
+    constexpr Crc16ByteTable() : entries() {
+        for (uint16_t i = 0; i < 256; i++)
+            entries[i] = crc16XmodemBitwise(0, (uint8_t)i);
+    }
+};
+
+struct Crc16NibbleTable {
+    uint16_t entries[16];
+
+    constexpr Crc16NibbleTable() : entries() {
+        for (uint8_t i = 0; i < 16; i++) {
+            uint16_t crc = (uint16_t)i << 12;
+            for (uint8_t bit = 0; bit < 4; bit++)
+                crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ XMODEM_POLY) : (uint16_t)(crc << 1);
+            entries[i] = crc;
+        }
+    }
+};
+
+// Only the table that is used ends up in flash
+extern const Crc16ByteTable crc16XmodemByteTable;
+extern const Crc16NibbleTable crc16XmodemNibbleTable;
+
+inline uint16_t crc16XmodemByteUpdate(uint16_t crc, uint8_t byte) {
+    return (uint16_t)(crc << 8) ^ pgm_read_word(&crc16XmodemByteTable.entries[(uint8_t)(crc >> 8) ^ byte]);
+}
+
+inline uint16_t crc16XmodemNibbleUpdate(uint16_t crc, uint8_t byte) {
+    crc = (uint16_t)(crc << 4) ^ pgm_read_word(&crc16XmodemNibbleTable.entries[(crc >> 12) ^ (byte >> 4)]);
+    return (uint16_t)(crc << 4) ^ pgm_read_word(&crc16XmodemNibbleTable.entries[(crc >> 12) ^ (byte & 0x0f)]);
+}
+
+inline uint16_t crc16XmodemUpdate(uint16_t crc, uint8_t byte) {
+#ifdef CRC16_NIBBLE_TABLE
+    return crc16XmodemNibbleUpdate(crc, byte);
+#else
+    return crc16XmodemByteUpdate(crc, byte);
+#endif
+}
+
+// Continues the CRC crc over data (start from XMODEM_INIT)
+uint16_t crc16Xmodem(const uint8_t* data, size_t length, uint16_t crc = XMODEM_INIT);
+
+class Crc16Xmodem {
+public:
+    Crc16Xmodem() : m_crc(XMODEM_INIT) {}
+
+    void restart() { m_crc = XMODEM_INIT; }
+    void add(uint8_t byte) { m_crc = crc16XmodemUpdate(m_crc, byte); }
+    void add(const uint8_t* data, size_t length) { m_crc = crc16Xmodem(data, length, m_crc); }
+    uint16_t calc() const { return m_crc; }
+
+private:
+    uint16_t m_crc;
+};
+
+#endif // CRC16_XMODEM_H
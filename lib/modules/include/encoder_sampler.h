@@ -0,0 +1,49 @@
+#ifndef ENCODER_SAMPLER_H
+#define ENCODER_SAMPLER_H
+
+#include <stdint.h>
+
+#include "valve_angle.h"
+
+struct EncoderSample {
+    angle_t angle;          // Angle from fully closed (fails isAngleValid() if the read failed)
+    int32_t stepPosition;   // Step engine position when the sample was taken
+    unsigned long timeUs;   // micros() when the sample was taken
+};
+
+/*
+ * Per-tick encoder sampling service.
+ *
+ * Each encoder read is a multi-transaction SPI read (with retries), so within one pass of
+ * loop() the encoder is read at most once: the first get() after beginTick() takes a
+ * timestamped sample, and later get()s in the same tick return it. fresh() always reads, for
+ * consumers which need a sample taken after a move.
+ */
+class EncoderSampler {
+public:
+    typedef void (*ReadFn)(EncoderSample& sample);
+
+    explicit EncoderSampler(ReadFn read);
+
+    // Call at the start of every pass of loop()
+    void beginTick();
+
+    const EncoderSample& get();
+    const EncoderSample& fresh();
+
+    // Counters (sent in the diagnostics packet, see comm_handler.h)
+    uint32_t getReads() const { return m_reads; }
+    uint32_t getReadsSaved() const { return m_readsSaved; }
+    void resetCounters() { m_reads = m_readsSaved = 0; }
+    unsigned long getSampleAgeUs(unsigned long nowUs) const;
+
+private:
+    ReadFn m_read;
+    EncoderSample m_sample;
+    bool m_hasSample;
+    bool m_sampledThisTick;
+    uint32_t m_reads;
+    uint32_t m_readsSaved;
+};
+
+#endif // ENCODER_SAMPLER_H
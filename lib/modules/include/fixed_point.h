@@ -0,0 +1,97 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+/*
+ * Saturating fixed point number with FRAC_BITS fractional bits, stored in Storage and computed
+ * in Wide (which must be able to hold the sum or product of two Storage values). Used in place
+ * of float on the AVR, which has no FPU: with a 16-bit Storage, adds and compares are a few
+ * cycles and multiplies use the hardware 8x8 multiplier instead of the float emulation.
+ *
+ * Conversions from float are constexpr, so constants from config.h are converted at compile
+ * time. Results that do not fit in Storage saturate instead of wrapping around.
+ */
+template <typename Storage, typename Wide, uint8_t FRAC_BITS>
+class Fixed {
+public:
+    static constexpr Wide ONE = Wide(1) << FRAC_BITS;
+    static constexpr Wide RAW_MAX = (Wide(1) << (8 * sizeof(Storage) - 1)) - 1;
+    static constexpr Wide RAW_MIN = -RAW_MAX - 1;
+
+    constexpr Fixed() : m_raw(0) {}
+    constexpr explicit Fixed(float value) : m_raw(rawFromFloat(value * ONE)) {}
+
+    static constexpr Fixed fromRaw(Wide raw) { return Fixed(saturate(raw), RawTag()); }
+    static constexpr Fixed max() { return Fixed(RAW_MAX, RawTag()); }
+    static constexpr Fixed min() { return Fixed(RAW_MIN, RawTag()); }
+
+    constexpr Storage raw() const { return m_raw; }
+    constexpr float toFloat() const { return float(m_raw) / ONE; }
+
+    // Saturating arithmetic
+    constexpr Fixed operator+(Fixed other) const { return fromRaw(Wide(m_raw) + other.m_raw); }
+    constexpr Fixed operator-(Fixed other) const { return fromRaw(Wide(m_raw) - other.m_raw); }
+    constexpr Fixed operator-() const { return fromRaw(-Wide(m_raw)); }
+    constexpr Fixed operator*(Fixed other) const {
+        return fromRaw((Wide(m_raw) * other.m_raw + ONE / 2) >> FRAC_BITS);
+    }
+    Fixed& operator+=(Fixed other) { return *this = *this + other; }
+    Fixed& operator-=(Fixed other) { return *this = *this - other; }
+    Fixed& operator*=(Fixed other) { return *this = *this * other; }
+
+    constexpr bool operator==(Fixed other) const { return m_raw == other.m_raw; }
+    constexpr bool operator!=(Fixed other) const { return m_raw != other.m_raw; }
+    constexpr bool operator<(Fixed other) const { return m_raw < other.m_raw; }
+    constexpr bool operator<=(Fixed other) const { return m_raw <= other.m_raw; }
+    constexpr bool operator>(Fixed other) const { return m_raw > other.m_raw; }
+    constexpr bool operator>=(Fixed other) const { return m_raw >= other.m_raw; }
+
+private:
+    struct RawTag {};
+    constexpr Fixed(Storage raw, RawTag) : m_raw(raw) {}
+
+    static constexpr Storage saturate(Wide raw) {
+        return raw > RAW_MAX ? Storage(RAW_MAX) : (raw < RAW_MIN ? Storage(RAW_MIN) : Storage(raw));
+    }
+    static constexpr Storage rawFromFloat(float scaled) {
+        return scaled >= float(RAW_MAX) ? Storage(RAW_MAX) :
+               (scaled <= float(RAW_MIN) ? Storage(RAW_MIN) :
+               saturate(Wide(scaled + (scaled >= 0.0f ? 0.5f : -0.5f))));
+    }
+
+    Storage m_raw;
+};
+
+/*
+ * numericCast<To>(value) converts between fixed point formats and float, so that code can be
+ * written once for either representation. Fixed to fixed conversions only shift (rounding to
+ * nearest); the source value must fit in the Wide type of the destination.
+ */
+template <typename To>
+struct NumericCast {
+    static constexpr To from(float value) { return To(value); }
+    template <typename S, typename W, uint8_t F>
+    static constexpr To from(Fixed<S, W, F> value) { return To(value.toFloat()); }
+};
+
+template <typename S2, typename W2, uint8_t F2>
+struct NumericCast<Fixed<S2, W2, F2> > {
+    typedef Fixed<S2, W2, F2> To;
+    static constexpr To from(float value) { return To(value); }
+    template <typename S, typename W, uint8_t F>
+    static constexpr To from(Fixed<S, W, F> value) {
+        return F >= F2 ? To::fromRaw(W2((W(value.raw()) + ((W(1) << (F >= F2 ? F - F2 : 0)) >> 1)) >> (F >= F2 ? F - F2 : 0)))
+                       : To::fromRaw(W2(value.raw()) << (F2 > F ? F2 - F : 0));
+    }
+};
+
+template <typename To, typename From>
+constexpr To numericCast(From value) { return NumericCast<To>::from(value); }
+
+// Rounds value * scale to the nearest int16, saturating (e.g. to pack a float into a packet)
+constexpr int16_t scaleToInt16(float value, float scale) {
+    return Fixed<int16_t, int32_t, 0>(value * scale).raw();
+}
+
+#endif // FIXED_POINT_H
@@ -0,0 +1,65 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "state_machine.h"
+
+/*
+ * RAM flight recorder: keeps the last RecorderConfig::NUM_RECORDS control ticks, so that what
+ * led to a fault can be seen at the control rate and not only at the telemetry rate.
+ *
+ * Records are overwritten oldest first until freeze() (on the transition to FORCED_OPEN_LOOP or
+ * EMERGENCY_STOP). From then on the contents are kept, and are dumped to the Pi a few records at
+ * a time (see the dump packet in comm_handler.h) with takeDumpRecords(). rearm() clears the
+ * recorder and starts recording again.
+ */
+
+#define FLTREC_ANGLE_SCALE 100.0f   // 0.01 degree
+#define FLTREC_PRESSURE_SCALE 10.0f // 0.1 psi
+
+// One control tick, in fixed point (see the scales above)
+typedef struct {
+    uint16_t timeMs;        // Low 16 bits of millis()
+    int16_t pressure;       // Manifold pressure used by the controller
+    int16_t error;          // Pressure error
+    int16_t output;         // Controller output (delta angle)
+    int16_t targetAngle;
+    int16_t currentAngle;
+    SystemStateEnum state;
+    uint8_t faults;         // TELPKT_FAULTS_* bits
+} flightRecord_t;
+
+class FlightRecorder {
+public:
+    FlightRecorder();
+
+    static flightRecord_t pack(unsigned long timeMs, float pressure, float error, float output,
+                               float targetAngle, float currentAngle, SystemStateEnum state, uint8_t faults);
+
+    // Ignored while frozen
+    void record(const flightRecord_t& record);
+    void freeze();
+    void rearm();
+
+    bool isFrozen() const { return m_frozen; }
+    uint8_t size() const { return m_count; }
+    // i-th record, oldest first
+    const flightRecord_t& at(uint8_t i) const;
+
+    // Frozen with records not dumped yet
+    bool isDumpPending() const { return m_frozen && m_dumpNext < m_count; }
+    uint8_t getDumpPosition() const { return m_dumpNext; }
+    // Copies up to max of the next records to dump to out, returns the number copied
+    uint8_t takeDumpRecords(flightRecord_t* out, uint8_t max);
+
+private:
+    flightRecord_t m_records[RecorderConfig::NUM_RECORDS];
+    uint8_t m_next;         // Where the next record goes
+    uint8_t m_count;
+    uint8_t m_dumpNext;
+    bool m_frozen;
+};
+
+#endif // FLIGHT_RECORDER_H
@@ -0,0 +1,30 @@
+#ifndef HARDWARE_H
+#define HARDWARE_H
+
+#include "step_engine.h"
+
+/*
+ * The hardware of the firmware that is not reached through the Arduino API. Each platform
+ * provides these in its own library, chosen at link time (so there are no virtual calls):
+ * lib/modules_arduino on the Arduino, and the simulator (lib/sim) on native.
+ *
+ * The clock, the pins, the SPI bus (and with it the AMT22 encoder) and Serial are used through
+ * the Arduino API as usual, which ArduinoFake or the simulator provide on native.
+ */
+
+// Stepper driver
+void motorDriverBegin();    // Configures and enables the driver, after SPI.begin()
+void disableMotorDriver();
+extern const StepEngineHooks stepperDriverHooks; // Step timer and step pulses, for the step engine
+
+// Serial link: starts moving received bytes into serialRxRing (serial_rx.h). Call after
+// Serial.begin(); nothing else may call Serial.read() afterwards.
+void serialRxBegin();
+
+#ifdef USE_INPUT_JOURNAL
+// Input journal (input_journal.h): takes the recorded chunks of the journal away, to the Pi in
+// journal packets on the Arduino, to a file on native
+void journalWrite(const uint8_t* data, uint8_t length);
+#endif
+
+#endif // HARDWARE_H
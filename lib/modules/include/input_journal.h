@@ -0,0 +1,144 @@
+#ifndef INPUT_JOURNAL_H
+#define INPUT_JOURNAL_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "serial_rx.h"
+#include "step_engine.h"
+
+class AMT22;
+
+/*
+ * Journal of the nondeterministic inputs of the firmware, compiled in with the USE_INPUT_JOURNAL
+ * build flag, so that a run on the stand can be executed again, bit for bit, on native (by a
+ * build with the same flags, the fixed point controller included).
+ *
+ * What loop() does only depends on its state and on the values it reads from outside: the
+ * clocks, the pins, the encoder, the bytes received from the Pi, the step engine (moved by its
+ * ISR) and the room in the serial TX buffer. The firmware reads them through the input*()
+ * functions below. While recording, every value read is appended to the journal; while playing
+ * a journal back, the values come from it instead of from the sources, so that setup() and
+ * loop() take exactly the same path again (see lib/sim/include/journal_player.h). Without
+ * USE_INPUT_JOURNAL, the input*() functions are the plain reads.
+ *
+ * Each value read is a record: a header byte with the JournalTag in its top 3 bits and the value
+ * in the low 5 bits, or VARINT with the value following as a little endian base-128 varint. The
+ * clocks are recorded as the difference to their previous read and the step position as the
+ * (zigzag encoded) difference to the previous position, so that most records are one byte. A
+ * successful encoder read is followed by its 2 count bytes, and received bytes by the bytes.
+ * Records have no timestamp of their own: the clock reads are records too, so each input is
+ * timed by the clock records before it.
+ *
+ * The journal goes to a sink in chunks of up to JournalConfig::CHUNK_SIZE bytes: journal packets
+ * to the Pi on the Arduino (see CommHandler::sendJournalChunk()), a file on native (hardware.h).
+ * The link only keeps up with the journal because loop() skips the passes in which no task is
+ * due and the comms run at JournalConfig::COMMS_RATE_HZ (see main.cpp); a chunk that does not get
+ * through is counted in the journal packets' sequence, and the journal can only be played back
+ * up to there.
+ *
+ * Not journaled: the RX overflow count, which is only reported in the profiler's diagnostics,
+ * and the encoder library's own timing, whose effect is the recorded result of the read.
+ */
+
+enum class JournalTag : uint8_t {
+    MILLIS,
+    MICROS,
+    PIN,
+    ENCODER,        // 1 if the read succeeded, then the counts
+    STEP_POSITION,
+    STEP_BUSY,
+    TX_ROOM,        // Serial.availableForWrite()
+    RX_BYTES        // Count, then the bytes
+};
+
+class InputJournal {
+public:
+    typedef void (*SinkFn)(const uint8_t* data, uint8_t length);
+
+    InputJournal();
+
+    // Starts a new journal (the one being recorded is finished first). Does nothing while playing
+    // back, so that setup() can start recording either way
+    void startRecording(SinkFn sink);
+    // Plays back a journal of length bytes, which has to outlive the playback
+    void startPlayback(const uint8_t* journal, size_t length);
+    // Hands the rest of the recorded journal to the sink, or ends the playback
+    void stop();
+
+    bool isRecording() const { return m_mode == Mode::RECORDING; }
+    bool isPlaying() const { return m_mode == Mode::PLAYBACK; }
+    // A read found the journal used up, or not recording the input that was read (the firmware
+    // took another path than when it was recorded). The values read since are made up
+    bool hasEnded() const { return m_ended; }
+    bool hasDiverged() const { return m_diverged; }
+    size_t remaining() const { return m_length - m_position; }
+    // The last micros() recorded or played back
+    uint32_t getMicros() const { return m_lastMicros; }
+
+    // The input*() functions pass the value read from the source, which is recorded and returned
+    // (or ignored and replaced by the journal's while playing back)
+    uint32_t clock(JournalTag tag, uint32_t now);
+    uint8_t pin(uint8_t level);
+    bool encoder(bool ok, uint16_t& counts);
+    int32_t stepPosition(int32_t position);
+    bool stepBusy(bool busy);
+    int txRoom(int room);
+    uint8_t rxBytes(uint8_t* bytes, uint8_t count, uint8_t capacity); // Capacity of bytes
+
+private:
+    enum class Mode : uint8_t { OFF, RECORDING, PLAYBACK };
+
+    static constexpr uint8_t VARINT = 0x1f;
+
+    Mode m_mode;
+    SinkFn m_sink;
+    uint8_t m_chunk[JournalConfig::CHUNK_SIZE];
+    uint8_t m_chunkLength;
+
+    const uint8_t* m_journal;
+    size_t m_length;
+    size_t m_position;
+    bool m_ended;
+    bool m_diverged;
+
+    uint32_t m_lastMillis;
+    uint32_t m_lastMicros;
+    int32_t m_lastPosition;
+
+    void resetValues();
+    void putByte(uint8_t byte);
+    void putRecord(JournalTag tag, uint32_t value);
+    bool takeByte(uint8_t& byte);
+    bool takeRecord(JournalTag tag, uint32_t& value);
+};
+
+#ifdef USE_INPUT_JOURNAL
+
+extern InputJournal inputJournal;
+
+unsigned long inputMillis();
+unsigned long inputMicros();
+int inputDigitalRead(uint8_t pin);
+bool inputEncoderRead(AMT22& encoder, uint16_t& counts);
+int32_t inputStepPosition(const StepEngine& engine);
+bool inputStepBusy(const StepEngine& engine);
+int inputTxRoom();
+uint8_t inputRxBatch(uint8_t* out, uint8_t maxLength);
+
+#else
+
+inline unsigned long inputMillis() { return millis(); }
+inline unsigned long inputMicros() { return micros(); }
+inline int inputDigitalRead(uint8_t pin) { return digitalRead(pin); }
+bool inputEncoderRead(AMT22& encoder, uint16_t& counts);
+inline int32_t inputStepPosition(const StepEngine& engine) { return engine.getPosition(); }
+inline bool inputStepBusy(const StepEngine& engine) { return engine.isBusy(); }
+inline int inputTxRoom() { return Serial.availableForWrite(); }
+inline uint8_t inputRxBatch(uint8_t* out, uint8_t maxLength) { return serialRxRing.popBatch(out, maxLength); }
+
+#endif
+
+#endif // INPUT_JOURNAL_H
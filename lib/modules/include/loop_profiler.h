@@ -0,0 +1,75 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <stdint.h>
+
+/*
+ * Loop phase profiler, compiled in with the USE_LOOP_PROFILER build flag.
+ *
+ * PROFILE_PHASE(phase) at the top of a scope times the rest of that scope with micros() and
+ * accumulates min/max/mean and the number of runs over the phase's budget (ProfilerConfig) in
+ * a fixed table. The table is sent as a diagnostics packet (see CommHandler::sendDiagnostics())
+ * and reset every 1 / DIAG_RATE_HZ. Phases nest, e.g. ENCODER is also part of CONTROL.
+ *
+ * Without USE_LOOP_PROFILER, PROFILE_PHASE() expands to nothing and none of this is compiled,
+ * so it costs no flash, RAM or cycles.
+ */
+
+enum class LoopPhase : uint8_t {
+    LOOP,       // A whole pass of loop()
+    COMM,       // Incoming packet processing
+    MONITORS,   // globalMonitors()
+    CONTROL,    // The state machine
+    ENCODER,    // Encoder SPI reads
+    MOTOR,      // serviceMotor()
+    TELEMETRY,  // Building and queueing telemetry
+    COUNT
+};
+
+#ifdef USE_LOOP_PROFILER
+
+struct PhaseStats {
+    uint16_t minUs;     // Saturate at 0xffff
+    uint16_t maxUs;
+    uint32_t totalUs;
+    uint16_t count;
+    uint16_t overruns;  // Runs over the phase's budget
+};
+
+class LoopProfiler {
+public:
+    LoopProfiler();
+
+    void record(LoopPhase phase, unsigned long durationUs);
+    const PhaseStats& getStats(LoopPhase phase) const { return m_stats[(uint8_t)phase]; }
+    uint16_t getMeanUs(LoopPhase phase) const;
+    void reset();
+
+    static uint16_t getBudgetUs(LoopPhase phase);
+
+private:
+    PhaseStats m_stats[(uint8_t)LoopPhase::COUNT];
+};
+
+extern LoopProfiler loopProfiler;
+
+// Times its own lifetime into loopProfiler
+class PhaseProbe {
+public:
+    explicit PhaseProbe(LoopPhase phase);
+    ~PhaseProbe();
+
+private:
+    LoopPhase m_phase;
+    unsigned long m_startUs;
+};
+
+#define PROFILE_PHASE(phase) PhaseProbe phaseProbe_(phase)
+
+#else
+
+#define PROFILE_PHASE(phase) do {} while (0)
+
+#endif // USE_LOOP_PROFILER
+
+#endif // LOOP_PROFILER_H
@@ -0,0 +1,58 @@
+#ifndef MOTION_PLANNER_H
+#define MOTION_PLANNER_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "progmem_own.h"
+
+/*
+ * Trapezoidal step rate profile for valve moves.
+ *
+ * Each move starts at MotionConfig::START_STEP_PERIOD_US and accelerates at ACCEL_STEPS_PER_S2
+ * up to the cruise rate given by MIN_STEP_PERIOD_US. After k steps of the ramp the step rate is
+ * v_k = sqrt(v_0^2 + 2 * a * k), so the interval before the next step is 1 / v_k. Deceleration
+ * mirrors the ramp using the number of steps left, so short moves get a triangular profile and
+ * every move ends back at the start rate.
+ *
+ * The ramp intervals are computed at compile time into a table in flash, so the step ISR only
+ * does a table lookup (no float math per step on the AVR).
+ */
+
+constexpr double RAMP_START_RATE = 1e6 / MotionConfig::START_STEP_PERIOD_US;   // steps/s
+constexpr double RAMP_CRUISE_RATE = 1e6 / MotionConfig::MIN_STEP_PERIOD_US;    // steps/s
+constexpr double RAMP_LENGTH = (sqr(RAMP_CRUISE_RATE) - sqr(RAMP_START_RATE)) / (2.0 * MotionConfig::ACCEL_STEPS_PER_S2);
+
+// Number of steps taken below the cruise rate (at least 1 to keep the table non-empty)
+constexpr uint16_t RAMP_STEPS = RAMP_LENGTH < 1.0 ? 1 :
+    static_cast<uint16_t>(RAMP_LENGTH) + (RAMP_LENGTH > static_cast<uint16_t>(RAMP_LENGTH) ? 1 : 0);
+
+// Interval (us) before the next step once k steps of the ramp have been taken
+constexpr uint16_t rampStepIntervalUs(uint16_t k) {
+    return static_cast<uint16_t>(1e6 / constexprSqrt(sqr(RAMP_START_RATE) + 2.0 * MotionConfig::ACCEL_STEPS_PER_S2 * k,
+                                                     RAMP_START_RATE) + 0.5);
+}
+
+struct RampIntervalTable {
+    uint16_t us[RAMP_STEPS];
+
+    constexpr RampIntervalTable() : us() {
+        for (uint16_t k = 0; k < RAMP_STEPS; k++) {
+            uint16_t interval = rampStepIntervalUs(k);
+            us[k] = interval < MotionConfig::MIN_STEP_PERIOD_US ? MotionConfig::MIN_STEP_PERIOD_US : interval;
+        }
+    }
+};
+
+extern const RampIntervalTable rampIntervalsUs;
+
+static_assert(RAMP_STEPS <= 512, "Acceleration ramp table too large for flash; raise MotionConfig::ACCEL_STEPS_PER_S2");
+
+// Interval (us) before the next step, given the steps already taken in the move and the
+// steps left including the next one
+uint16_t plannedStepIntervalUs(uint16_t stepsDone, uint16_t stepsLeft);
+
+// Total time (us) that a move of the given number of steps takes
+uint32_t plannedMoveDurationUs(uint16_t steps);
+
+#endif // MOTION_PLANNER_H
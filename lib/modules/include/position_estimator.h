@@ -0,0 +1,51 @@
+#ifndef POSITION_ESTIMATOR_H
+#define POSITION_ESTIMATOR_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "valve_angle.h"
+
+/*
+ * Dead-reckoning valve angle estimator.
+ *
+ * The estimate is the angle of the last encoder sample (the anchor) plus the steps commanded
+ * since then times DEGREES_PER_STEP, so it is available continuously (also mid-move) without
+ * an SPI transaction. It is corrected against the encoder every ENCODER_SAMPLE_PERIOD_S,
+ * which re-anchors it and measures how far the encoder disagrees with the commanded steps.
+ */
+
+enum class EstimatorStatus : uint8_t {
+    OK,
+    NO_MOTION,          // Steps were commanded but the encoder did not move
+    ENCODER_MISMATCH    // The encoder disagrees with the commanded steps
+};
+
+class PositionEstimator {
+public:
+    PositionEstimator();
+
+    void reset(angle_t encoderAngle, int32_t stepPosition, unsigned long now);
+    bool isInitialized() const { return m_initialized; }
+
+    // Estimated angle given the step engine's current position
+    angle_t estimate(int32_t stepPosition) const;
+
+    bool isSampleDue(unsigned long now) const;
+
+    // Correct the estimate with an encoder sample
+    EstimatorStatus correct(angle_t encoderAngle, int32_t stepPosition, unsigned long now);
+
+    // Encoder angle minus the estimate at the last correction
+    angle_t getMismatch() const { return m_mismatch; }
+
+private:
+    bool m_initialized;
+    angle_t m_anchorAngle;
+    int32_t m_anchorPosition;
+    unsigned long m_lastSampleTime;
+    angle_t m_mismatch;
+    int m_consecNoMotion, m_consecMismatch;
+};
+
+#endif // POSITION_ESTIMATOR_H
@@ -31,9 +31,15 @@ public:
     void updateConsecInvalidity(bool* valid);
     
     void resetConsecutiveFaults();
+
+    // Consecutive invalid readings or differences before a fault, SensorConfig::CONSEC_BEFORE_ERR_THRESHOLD
+    // unless changed (e.g. by a parameter sweep in the simulator)
+    void setFaultThreshold(int threshold) { m_faultThreshold = threshold; }
+    int getFaultThreshold() const { return m_faultThreshold; }
     
 private:
     int m_consecutiveDifferenceFaults, m_consecutiveInvalid[SensorConfig::NUM_PTS];
+    int m_faultThreshold;
 };
 
 #endif // PRESSURE_SENSOR_H
\ No newline at end of file
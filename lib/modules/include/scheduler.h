@@ -0,0 +1,75 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/*
+ * Fixed-rate cooperative task scheduler.
+ *
+ * Each task is released every periodUs on a fixed grid based on micros(), instead of on every
+ * pass of loop(), so that e.g. the pressure controller runs at the CONTROL_PERIOD_HZ its gains
+ * were tuned for. runPending() is called from loop() and runs the released tasks in the order
+ * they were added. A task with a period of 0 runs on every pass.
+ *
+ * A release that could not run before the next one was due is an overrun: it is skipped (and
+ * counted) rather than run late, so the task stays on its grid. The latency between release and
+ * start (jitter) and the run time are recorded per task, and sent in the diagnostics packet with
+ * the USE_LOOP_PROFILER build flag (see comm_handler.h).
+ */
+
+// Saturate at 0xffff (they are reset with every diagnostics packet)
+struct SchedulerTaskStats {
+    uint16_t runs;
+    uint16_t overruns;          // Releases skipped because the task was still late
+    uint16_t maxLatencyUs;      // Start time minus release time
+    uint16_t maxRunUs;
+};
+
+class TaskScheduler {
+public:
+    typedef unsigned long (*ClockFn)();
+    typedef void (*TaskFn)();
+
+    static constexpr uint8_t MAX_TASKS = 6;
+
+    explicit TaskScheduler(ClockFn clock);
+
+    // Returns the task id, or -1 if the task table is full
+    int8_t addTask(TaskFn run, unsigned long periodUs);
+
+    // Releases every task now, then each on its own period
+    void start();
+    void runPending();
+
+    // Release time of the task's current (or last) run, i.e. the ideal start time
+    unsigned long getReleaseUs(int8_t id) const { return m_tasks[id].lastReleaseUs; }
+    uint8_t getNumTasks() const { return m_numTasks; }
+    const SchedulerTaskStats& getStats(int8_t id) const { return m_tasks[id].stats; }
+    // Earliest next release of the periodic tasks after now (or now if one is late), e.g. for
+    // the simulator to skip ahead. Tasks with a period of 0 are not considered. These take the
+    // time rather than reading the scheduler's clock, so that they are not inputs of the firmware
+    // (see input_journal.h)
+    unsigned long getNextReleaseUs(unsigned long now) const;
+    // Whether runPending() at now would run a task
+    bool isDue(unsigned long now) const;
+    void resetStats();
+
+private:
+    struct Task {
+        TaskFn run;
+        unsigned long periodUs;
+        unsigned long nextReleaseUs;
+        unsigned long lastReleaseUs;
+        SchedulerTaskStats stats;
+    };
+
+    ClockFn m_clock;
+    Task m_tasks[MAX_TASKS];
+    uint8_t m_numTasks;
+};
+
+constexpr unsigned long hzToPeriodUs(float hz) {
+    return (unsigned long)(1000000.0f / hz + 0.5f);
+}
+
+#endif // SCHEDULER_H
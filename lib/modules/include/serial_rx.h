@@ -0,0 +1,17 @@
+#ifndef SERIAL_RX_H
+#define SERIAL_RX_H
+
+#include "config.h"
+#include "spsc_ring.h"
+
+/*
+ * Receive buffer of the serial link to the Pi. At 115200 baud the Arduino core's own 64 byte RX
+ * buffer is full after about 5.5 ms, so on the Arduino a timer ISR (serialRxBegin(), hardware.h) moves the
+ * received bytes into this larger ring every CommConfig::RX_DRAIN_PERIOD_US, and CommHandler
+ * drains the ring in batches. On native the ring is filled by the tests.
+ */
+typedef SpscRing<CommConfig::RX_RING_SIZE> SerialRxRing;
+
+extern SerialRxRing serialRxRing;
+
+#endif // SERIAL_RX_H
@@ -0,0 +1,75 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+
+#include "atomic_own.h"
+
+/*
+ * Lock-free single producer / single consumer byte ring buffer, e.g. filled from an ISR and
+ * drained from loop(). SIZE must be a power of two up to 256, and the ring holds SIZE - 1 bytes.
+ *
+ * The head is only written by the producer and the tail only by the consumer. Both are single
+ * bytes (atomic on the AVR) and are published with release stores / acquire loads, so the data
+ * written before moving an index is visible to the other side once it sees the index (this is
+ * what makes it safe between threads on native too). Bytes pushed while the ring is full are
+ * dropped and counted.
+ */
+template <uint16_t SIZE>
+class SpscRing {
+public:
+    static_assert(SIZE >= 2 && SIZE <= 256 && (SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two up to 256");
+    static constexpr uint8_t CAPACITY = SIZE - 1;
+
+    SpscRing() : m_head(0), m_tail(0), m_overflows(0) {}
+
+    // Producer side
+    bool push(uint8_t byte) {
+        uint8_t head = m_head;
+        uint8_t next = (head + 1) & MASK;
+        if (next == __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE)) {
+            if (m_overflows != UINT16_MAX) m_overflows++;
+            return false;
+        }
+        m_buffer[head] = byte;
+        __atomic_store_n(&m_head, next, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Consumer side: copies up to maxLen bytes to out, returns the number copied
+    uint8_t popBatch(uint8_t* out, uint8_t maxLen) {
+        uint8_t tail = m_tail;
+        uint8_t count = (__atomic_load_n(&m_head, __ATOMIC_ACQUIRE) - tail) & MASK;
+        if (count > maxLen) count = maxLen;
+        for (uint8_t i = 0; i < count; i++)
+            out[i] = m_buffer[(tail + i) & MASK];
+        __atomic_store_n(&m_tail, (uint8_t)((tail + count) & MASK), __ATOMIC_RELEASE);
+        return count;
+    }
+
+    bool pop(uint8_t& byte) { return popBatch(&byte, 1) == 1; }
+
+    // Either side
+    uint8_t available() const {
+        return (__atomic_load_n(&m_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE)) & MASK;
+    }
+
+    // Bytes dropped because the ring was full (saturates)
+    uint16_t getOverflowCount() const {
+        uint16_t overflows;
+        ATOMIC_SECTION {
+            overflows = m_overflows;
+        }
+        return overflows;
+    }
+
+private:
+    static constexpr uint8_t MASK = SIZE - 1;
+
+    uint8_t m_buffer[SIZE];
+    uint8_t m_head;
+    uint8_t m_tail;
+    uint16_t m_overflows;   // Only written by the producer
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,69 @@
+#ifndef STEP_ENGINE_H
+#define STEP_ENGINE_H
+
+#include <stdint.h>
+
+/*
+ * Background step generator for the valve stepper.
+ *
+ * A move is started from the control loop with start(), after which every step is emitted
+ * from the compare interrupt of a hardware timer (see onTimerCompare()). This means that
+ * loop() keeps running (comms, monitors, telemetry) while the valve moves, instead of
+ * busy-waiting STEP_PERIOD_US per step. The interval between steps follows the acceleration
+ * profile in motion_planner.h.
+ *
+ * The hardware is reached through StepEngineHooks so that this class compiles on native:
+ * lib/modules_arduino provides hooks built on Timer1 and the HighPowerStepperDriver, and
+ * the native unit tests provide a fake timer which calls onTimerCompare() directly.
+ */
+
+struct StepEngineHooks {
+    void (*timerStart)(uint16_t periodUs);      // Start periodic compare interrupts
+    void (*timerSetPeriod)(uint16_t periodUs);  // Change the period (called from the ISR)
+    void (*timerStop)();                        // Stop the timer (no more compare interrupts)
+    void (*setIsrMasked)(bool masked);          // Hold off / release the compare interrupt
+    void (*setDirection)(bool reverse);
+    void (*pulse)();                            // Emit a single step
+};
+
+class StepEngine {
+public:
+    StepEngine();
+    void begin(const StepEngineHooks* hooks);
+
+    // Returns false if a move is already in progress (or there is nothing to do)
+    bool start(uint16_t steps, bool reverse);
+    void stop();
+
+    bool isBusy() const;
+    uint16_t stepsRemaining() const;
+
+    // Signed count of all steps emitted so far (reverse steps count negative)
+    int32_t getPosition() const;
+
+    // Called from the step timer's compare ISR
+    void onTimerCompare();
+
+    // The stepper driver and encoder share the SPI bus, so SPI users in the main loop must
+    // hold off the step ISR for the duration of their transaction
+    void setIsrMasked(bool masked);
+
+private:
+    const StepEngineHooks* m_hooks;
+    volatile uint16_t m_stepsRemaining;
+    volatile int32_t m_position;
+    uint16_t m_stepsDone; // Only accessed with the step ISR stopped, or from within it
+    bool m_reverse;       // Ditto
+};
+
+// Holds off the step ISR for the lifetime of the guard
+class StepIsrGuard {
+public:
+    explicit StepIsrGuard(StepEngine& engine) : m_engine(engine) { m_engine.setIsrMasked(true); }
+    ~StepIsrGuard() { m_engine.setIsrMasked(false); }
+
+private:
+    StepEngine& m_engine;
+};
+
+#endif // STEP_ENGINE_H
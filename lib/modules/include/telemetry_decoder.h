@@ -0,0 +1,55 @@
+#ifndef TELEMETRY_DECODER_H
+#define TELEMETRY_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "comm_handler.h"
+#include "state_machine.h"
+
+/*
+ * Decodes telemetry packets (the float one and the compact one, see comm_handler.h) back into
+ * engineering units, e.g. for host tools and tests. The packet is given as it was built, i.e.
+ * after the COBS framing (if any) has been removed, and it is read byte by byte as little
+ * endian so this does not depend on the host's struct layout.
+ *
+ * Compact packets come back quantised to their CTELPKT_*_SCALE steps; a saturated field decodes
+ * to the end of its range.
+ */
+
+enum class TelemetryDecodeResult : uint8_t {
+    OK,
+    TOO_SHORT,
+    BAD_MAGIC,
+    BAD_CHECKSUM
+};
+
+struct TelemetrySample {
+    bool compact;               // Decoded from a compact packet
+    uint32_t timestampMs;       // Only in compact packets, 0 otherwise
+    SystemStateEnum systemState;
+    uint8_t flags;
+    uint8_t faults;
+
+    float motorAngle;
+    float deltaAngle;
+    float intError;
+    float pt1Reading;
+    float pt2Reading;
+    float pt3Reading;           // 0 without USE_3_PTS
+
+    uint16_t txSent;
+    uint8_t txCoalesced;
+    uint8_t txDropped;
+
+    uint16_t sequence;
+    LinkStats link;             // Of the packets from the Pi
+
+    uint32_t piTimestampEcho;
+    uint32_t sampleRxUs;
+    uint32_t txUs;
+};
+
+TelemetryDecodeResult decodeTelemetryPacket(const uint8_t* packet, size_t length, TelemetrySample& sample);
+
+#endif // TELEMETRY_DECODER_H
@@ -0,0 +1,81 @@
+#ifndef TX_QUEUE_H
+#define TX_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Non-blocking transmit queue of whole frames.
+ *
+ * Each kind of frame (e.g. telemetry) has a slot holding at most one frame. pump() writes only as
+ * many bytes as the serial TX buffer has room for (availableForWrite()), so it never blocks
+ * loop(); a frame that does not fit is continued on the next pump(), and frames are never
+ * interleaved. Pending frames go out oldest first.
+ *
+ * When a new frame is queued in a slot whose previous frame has not been sent yet, the slot's
+ * policy decides: COALESCE replaces the stale frame with the new one (if it has not started
+ * going out), DROP_NEWEST keeps the old one and drops the new one.
+ *
+ * The serial port is reached through TxHooks so that this compiles and is tested on native.
+ */
+
+struct TxHooks {
+    int (*availableForWrite)();
+    size_t (*write)(const uint8_t* data, size_t length);
+};
+
+enum class TxPolicy : uint8_t {
+    COALESCE,       // Only the latest frame matters (e.g. telemetry)
+    DROP_NEWEST     // Every frame matters, keep the one already queued
+};
+
+struct TxStats {
+    uint16_t sent;          // All counters wrap around
+    uint16_t coalesced;     // Frames replaced by a newer one before being sent
+    uint16_t dropped;       // Frames not queued (slot busy)
+};
+
+class TxQueue {
+public:
+    static constexpr uint8_t MAX_SLOTS = 6;
+
+    explicit TxQueue(const TxHooks* hooks);
+
+    // Frames of the slot are built in buffer (capacity bytes). Returns the slot id, or -1 if the
+    // slot table is full
+    int8_t addSlot(uint8_t* buffer, uint8_t capacity, TxPolicy policy);
+
+    // Returns the slot's buffer to build a new frame in, or nullptr if the new frame is dropped.
+    // The frame is only queued by commit()
+    uint8_t* beginFrame(int8_t slot);
+    void commit(int8_t slot, uint8_t length);
+
+    // Writes pending frames as far as the TX buffer allows
+    void pump();
+
+    // The slot holds a frame that has not been sent completely
+    bool isPending(int8_t slot) const;
+    bool isIdle() const;
+    const TxStats& getStats() const { return m_stats; }
+
+private:
+    struct Slot {
+        uint8_t* buffer;
+        uint8_t capacity;
+        TxPolicy policy;
+        uint8_t length;     // 0 when empty
+        uint8_t queuedAt;   // m_queueCounter when queued, for the oldest first order
+    };
+
+    const TxHooks* m_hooks;
+    Slot m_slots[MAX_SLOTS];
+    uint8_t m_numSlots;
+    int8_t m_current;       // Slot being written out, or -1
+    uint8_t m_currentSent;  // Bytes of it written so far
+    uint8_t m_queueCounter;
+    TxStats m_stats;
+
+    int8_t oldestPending() const;
+};
+
+#endif // TX_QUEUE_H
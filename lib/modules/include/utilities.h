@@ -6,35 +6,55 @@
 #include "state_machine.h"
 #include <comm_handler.h>
 #include <controller.h>
+#include <encoder_sampler.h>
+#include <flight_recorder.h>
+#include <hardware.h>
+#include <position_estimator.h>
 #include <pressure_sensor.h>
+#include <step_engine.h>
+#include <valve_angle.h>
 
 // External hardware objects (declared in main.cpp)
 extern AMT22* encoder;
 extern Controller* controller;
 extern PressureSensor* pressureSensor;
 extern CommHandler* commHandler;
+extern StepEngine stepEngine;
+extern PositionEstimator positionEstimator;
+extern EncoderSampler encoderSampler;
 extern ChannelState channel;
 extern FaultFlags faults;
 extern SystemState systemState;
+extern FlightRecorder flightRecorder;
+extern Tunables tunables;
 
-// Encoder utility functions
-float getEncoderAngle();
-bool isAngleValid(float angle);
+// Commands setting the tunables and the controller gains (see CommHandler::setCommandTable())
+extern const CommandSpec tuningCommands[];
+extern const uint8_t NUM_TUNING_COMMANDS;
+
+// Encoder utility functions (see valve_angle.h for the angle helpers)
+bool readEncoderCounts(uint16_t& counts);
+angle_t getEncoderAngle();
+void sampleEncoder(EncoderSample& sample); // EncoderSampler::ReadFn for the encoder
+angle_t getValveAngle(bool freshSample = false);
 bool isEncoderHealthy();
 
+// Motor control functions
+void serviceMotor();
+void serviceSingleMotor(StepEngine& engine, angle_t currentAngle, angle_t targetAngle);
+
 // System utility functions
 SensorStatus readManifoldPressures(float& pressure);
 void setMPV(bool open); // This sets whether we should deactuate (close) MPV, as a signal sent to the Pi. We do not directly control MPV
 void setMPVState(bool state); // This sets whether we have detected MPV
 bool getMPVState();
 bool isManualAbortPressed();
-void applyMoveFilter(float& deltaAngle);
-float constrainAngle(float angle);
 void publishTelemetry();
+void recordControlTick();
+void sendStateChangeEvent(SystemStateEnum from, SystemStateEnum to); // StateChangeHook
 void resetSystemOnMpvCycle();
 bool isValidState(SystemStateEnum s);
-bool isAtStartAngle(float currentAngle);
 bool checkRedBand(float pressure);
-SystemStateEnum getSyncedState(SystemStateEnum currentState, SystemStateEnum otherControllerState, float currentAngle);
+SystemStateEnum getSyncedState(SystemStateEnum currentState, SystemStateEnum otherControllerState, angle_t currentAngle);
 
 #endif // UTILITIES_H
\ No newline at end of file
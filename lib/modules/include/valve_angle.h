@@ -0,0 +1,156 @@
+#ifndef VALVE_ANGLE_H
+#define VALVE_ANGLE_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "fixed_point.h"
+
+/*
+ * Valve angle representation.
+ *
+ * The Uno has no FPU, so valve angles are fixed point (AngleQ, 1/64 degree) all the way from
+ * the encoder counts through the estimator, state machine and motor step calculation, and are
+ * only converted to degrees for telemetry. Building with USE_FLOAT_ANGLES switches angle_t back
+ * to float degrees, e.g. to compare against on native.
+ *
+ * The angle helpers below are templates over the representation (with the conversions in
+ * AngleOps<>), so both can be tested and benchmarked side by side.
+ */
+
+typedef Fixed<int16_t, int32_t, 6> AngleQ; // 1/64 degree, range +-511.98 degrees
+
+#ifdef USE_FLOAT_ANGLES
+typedef float angle_t;
+#else
+typedef AngleQ angle_t;
+#endif
+
+// Move filter scale in Q8 (SCALE_Q8_ONE is 1), so that scaling an angle needs no float on the Uno.
+// Convert the float setting once, when it is set
+typedef uint16_t scale_q8_t;
+constexpr scale_q8_t SCALE_Q8_ONE = 256;
+constexpr scale_q8_t scaleToQ8(float factor) { return (scale_q8_t)(factor * SCALE_Q8_ONE + 0.5f); }
+constexpr float scaleFromQ8(scale_q8_t factor) { return (float)factor / SCALE_Q8_ONE; }
+
+// Encoder calibration constant (system-specific), in [0, 360)
+constexpr float FULLY_CLOSED_OFFSET = (HardwareConfig::FULLY_OPEN_OFFSET - 90.0f + 360.0f) >= 360.0f
+                                    ? HardwareConfig::FULLY_OPEN_OFFSET - 90.0f
+                                    : HardwareConfig::FULLY_OPEN_OFFSET - 90.0f + 360.0f;
+
+template <typename A>
+struct AngleOps;
+
+template <>
+struct AngleOps<float> {
+    static constexpr float fromDeg(float deg) { return deg; }
+    static float toDeg(float angle) { return angle; }
+    static float abs(float angle) { return fabsf(angle); }
+    static float scale(float angle, scale_q8_t factor) { return angle * scaleFromQ8(factor); }
+
+    // Encoder counts to angle from fully closed, in [0, 360)
+    static float fromCounts(uint16_t counts) {
+        float angle = ((float)counts / HardwareConfig::MAX_12_BIT_VAL) * 360.0f - FULLY_CLOSED_OFFSET;
+        if (angle < 0.0f) angle += 360.0f;
+        return angle;
+    }
+
+    static float fromSteps(int32_t steps) { return steps * HardwareConfig::DEGREES_PER_STEP; }
+    static long toSteps(float angle) { return lroundf(MotorControlConfig::KP_STEPS_PER_DEG * angle); }
+};
+
+template <>
+struct AngleOps<AngleQ> {
+    static constexpr AngleQ fromDeg(float deg) { return AngleQ(deg); }
+    static float toDeg(AngleQ angle) { return angle.toFloat(); }
+    static AngleQ abs(AngleQ angle) { return angle < AngleQ() ? -angle : angle; }
+
+    // Multiplies by factor, in integer arithmetic only
+    static AngleQ scale(AngleQ angle, scale_q8_t factor) {
+        return AngleQ::fromRaw(((int32_t)angle.raw() * factor + SCALE_Q8_ONE / 2) >> 8);
+    }
+
+    static AngleQ fromCounts(uint16_t counts) {
+        int32_t raw = ((int32_t)counts * COUNTS_TO_RAW_Q16 + 0x8000) >> 16;
+        raw -= CLOSED_OFFSET_RAW;
+        if (raw < 0) raw += FULL_TURN_RAW;
+        return AngleQ::fromRaw(raw);
+    }
+
+    // Only meant for step counts within a few turns (e.g. since the last encoder sample)
+    static AngleQ fromSteps(int32_t steps) {
+        return AngleQ::fromRaw((steps * DEG_PER_STEP_RAW_Q12 + 0x800) >> 12);
+    }
+
+    // Rounds half away from zero, like lroundf()
+    static long toSteps(AngleQ angle) {
+        int32_t steps = (int32_t)angle.raw() * STEPS_PER_RAW_Q16;
+        return steps >= 0 ? (steps + 0x8000) >> 16 : -((-steps + 0x8000) >> 16);
+    }
+
+    static constexpr int32_t FULL_TURN_RAW = 360 * AngleQ::ONE;
+    static constexpr int32_t COUNTS_TO_RAW_Q16 =
+        (int32_t)(360.0 * AngleQ::ONE * 65536.0 / HardwareConfig::MAX_12_BIT_VAL + 0.5);
+    static constexpr int32_t CLOSED_OFFSET_RAW = (int32_t)(FULLY_CLOSED_OFFSET * AngleQ::ONE + 0.5f);
+    static constexpr int32_t DEG_PER_STEP_RAW_Q12 =
+        (int32_t)(HardwareConfig::DEGREES_PER_STEP * AngleQ::ONE * 4096.0 + 0.5);
+    static constexpr int32_t STEPS_PER_RAW_Q16 =
+        (int32_t)(MotorControlConfig::KP_STEPS_PER_DEG / AngleQ::ONE * 65536.0 + 0.5);
+
+    // (int32_t)counts * COUNTS_TO_RAW_Q16 and angle.raw() * STEPS_PER_RAW_Q16 must not overflow
+    static_assert(HardwareConfig::MAX_12_BIT_VAL * COUNTS_TO_RAW_Q16 + 0x8000 < 2147483647.0, "Counts conversion overflows");
+    static_assert(AngleQ::RAW_MAX * STEPS_PER_RAW_Q16 + 0x8000 < 2147483647.0, "Steps conversion overflows");
+};
+
+// Conversions for the configured representation
+constexpr angle_t degToAngle(float deg) { return AngleOps<angle_t>::fromDeg(deg); }
+inline float angleToDeg(angle_t angle) { return AngleOps<angle_t>::toDeg(angle); }
+
+// Angle must be in [0, 360) and not error value
+template <typename A>
+bool isAngleValid(A angle) {
+    constexpr A lower = AngleOps<A>::fromDeg(0.0f);
+    constexpr A upper = AngleOps<A>::fromDeg(360.0f);
+    return angle >= lower && angle < upper;
+}
+
+// Scales the angle change and caps it to +-maxChange
+template <typename A>
+void applyMoveFilter(A& deltaAngle, A maxChange, scale_q8_t scale) {
+    if (scale != SCALE_Q8_ONE)
+        deltaAngle = AngleOps<A>::scale(deltaAngle, scale);
+
+    if (deltaAngle > maxChange) {
+        deltaAngle = maxChange;
+    } else if (deltaAngle < -maxChange) {
+        deltaAngle = -maxChange;
+    }
+}
+
+// With the limits from ValveConfig
+template <typename A>
+void applyMoveFilter(A& deltaAngle) {
+    constexpr A maxChange = AngleOps<A>::fromDeg(ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE);
+    applyMoveFilter(deltaAngle, maxChange, scaleToQ8(ValveConfig::MOVE_FILTER_SCALE));
+}
+
+template <typename A>
+A constrainAngle(A angle) {
+    constexpr A minAngle = AngleOps<A>::fromDeg(ValveConfig::MIN_VALVE_ANGLE);
+    constexpr A maxAngle = AngleOps<A>::fromDeg(ValveConfig::MAX_VALVE_ANGLE);
+    return angle < minAngle ? minAngle : (angle > maxAngle ? maxAngle : angle);
+}
+
+template <typename A>
+bool isAtAngle(A currentAngle, A targetAngle) {
+    constexpr A tolerance = AngleOps<A>::fromDeg(ValveConfig::ANGLE_TOLERANCE);
+    return AngleOps<A>::abs(currentAngle - targetAngle) <= tolerance;
+}
+
+template <typename A>
+bool isAtStartAngle(A currentAngle) {
+    return isAtAngle(currentAngle, AngleOps<A>::fromDeg(ValveConfig::START_ANGLE));
+}
+
+#endif // VALVE_ANGLE_H
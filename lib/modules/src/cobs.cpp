@@ -0,0 +1,63 @@
+#include "cobs.h"
+
+CobsEncoder::CobsEncoder(uint8_t* out) : m_out(out), m_len(2), m_codeIdx(1), m_code(1) {
+    // Leading delimiter, so that garbage before the frame does not corrupt it
+    m_out[0] = COBS_DELIMITER;
+}
+
+void CobsEncoder::add(uint8_t byte) {
+    if (byte != 0) {
+        m_out[m_len++] = byte;
+        m_code++;
+    }
+
+    // A zero (or a full block) closes the current block
+    if (byte == 0 || m_code == 0xFF) {
+        m_out[m_codeIdx] = m_code;
+        m_codeIdx = m_len++;
+        m_code = 1;
+    }
+}
+
+void CobsEncoder::add(const uint8_t* data, size_t length) {
+    while (length--)
+        add(*data++);
+}
+
+size_t CobsEncoder::finish() {
+    m_out[m_codeIdx] = m_code;
+    m_out[m_len++] = COBS_DELIMITER;
+    return m_len;
+}
+
+CobsDecoder::CobsDecoder() : m_blockLeft(0), m_zeroPending(false) {}
+
+void CobsDecoder::reset() {
+    m_blockLeft = 0;
+    m_zeroPending = false;
+}
+
+CobsEvent CobsDecoder::feed(uint8_t c, uint8_t& decoded) {
+    if (c == COBS_DELIMITER) {
+        // The zero implied by the last block is not part of the frame
+        CobsEvent event = m_blockLeft == 0 ? CobsEvent::FRAME_END : CobsEvent::FRAME_ERROR;
+        reset();
+        return event;
+    }
+
+    if (m_blockLeft > 0) {
+        m_blockLeft--;
+        decoded = c;
+        return CobsEvent::BYTE;
+    }
+
+    // Code byte: starts the next block, after the zero ending the previous one
+    bool zeroBefore = m_zeroPending;
+    m_blockLeft = c - 1;
+    m_zeroPending = c != 0xFF;
+    if (zeroBefore) {
+        decoded = 0;
+        return CobsEvent::BYTE;
+    }
+    return CobsEvent::NONE;
+}
@@ -1,62 +1,214 @@
 #include <Arduino.h>
-#include <CRC.h>
 #include <string.h>
 
 #include "assert_own.h"
 #include "comm_handler.h"
 #include "config.h"
+#include "fixed_point.h"
+#include "input_journal.h"
+#include "serial_rx.h"
 #include <utilities.h>
 
 extern bool MPV_STATE;
 
-CommHandler::CommHandler() : m_bufLen(0), m_pressureUpdateSuccess(false),
-                             m_crc16(CRC16_XMODEM_POLYNOME, CRC16_XMODEM_INITIAL, CRC16_XMODEM_XOR_OUT, CRC16_XMODEM_REV_IN, CRC16_XMODEM_REV_OUT),
-                             m_otherCtrlerState(SystemStateEnum::BOOT_INIT), m_numConsecInvalidPUP(0) {
-    m_lastCommTime = millis();
+static int serialAvailableForWrite() {
+    return inputTxRoom();
+}
+
+static size_t serialWrite(const uint8_t* data, size_t length) {
+    return Serial.write(data, length);
+}
+
+const TxHooks serialTxHooks = {
+    serialAvailableForWrite,
+    serialWrite
+};
+
+CommHandler::CommHandler(const TxHooks* txHooks) : m_bufLen(0), m_pressureUpdateSuccess(false), m_link(), m_newSample(false),
+                                                   m_haveSequence(false), m_inSync(true), m_rxStartUs(0), m_sampleRxUs(0),
+                                                   m_piTimestamp(0), m_lastArrivalUs(0), m_lastIntervalUs(0), m_jitterX16(0),
+                                                   m_txQueue(txHooks), m_telemetrySequence(0),
+                                                   m_numEvents(0), m_eventsDropped(0), m_eventSent(false), m_lastEventMs(0),
+                                                   m_reportedFaults(0), m_commands(nullptr), m_numCommands(0), m_otherCtrlerState(SystemStateEnum::BOOT_INIT), m_numConsecInvalidPUP(0) {
+#ifdef USE_COBS_FRAMING
+    m_frameLen = 0;
+#endif
+    // Only the latest telemetry matters, but every diagnostics packet covers its own interval
+    m_telemetrySlot = m_txQueue.addSlot(m_telemetryFrame, sizeof(m_telemetryFrame), TxPolicy::COALESCE);
+    m_dumpSlot = m_txQueue.addSlot(m_dumpFrame, sizeof(m_dumpFrame), TxPolicy::DROP_NEWEST);
+    m_eventSlot = m_txQueue.addSlot(m_eventFrame, sizeof(m_eventFrame), TxPolicy::DROP_NEWEST);
+    m_ackSlot = m_txQueue.addSlot(m_ackFrame, sizeof(m_ackFrame), TxPolicy::DROP_NEWEST);
+#ifdef USE_LOOP_PROFILER
+    m_diagnosticsSlot = m_txQueue.addSlot(m_diagnosticsFrame, sizeof(m_diagnosticsFrame), TxPolicy::DROP_NEWEST);
+#endif
+#ifdef USE_INPUT_JOURNAL
+    m_journalSlot = m_txQueue.addSlot(m_journalFrame, sizeof(m_journalFrame), TxPolicy::DROP_NEWEST);
+    m_journalSequence = 0;
+#endif
+    m_lastCommTime = inputMillis();
 }
 
 void CommHandler::processIncomingNonBlocking() {
-    while (Serial.available()) {
-        processIncomingSerialByte(Serial.read());
+    uint8_t batch[RX_BATCH_SIZE];
+    uint8_t count;
+    while ((count = inputRxBatch(batch, RX_BATCH_SIZE)) > 0) {
+        for (uint8_t i = 0; i < count; i++)
+            processIncomingSerialByte(batch[i]);
     }
 }
 
 void CommHandler::flushInputBuffer() {
     m_bufLen = 0;
+#ifdef USE_COBS_FRAMING
+    // Drops the current frame; the decoder is back in sync at the next delimiter
+    m_frameLen = FRAME_DROPPED;
+#endif
+}
+
+#ifdef USE_COBS_FRAMING
+void CommHandler::processIncomingSerialByte(uint8_t c) {
+    uint8_t decoded;
+    switch (m_cobsDecoder.feed(c, decoded)) {
+    case CobsEvent::BYTE:
+        processFrameByte(decoded);
+        break;
+    case CobsEvent::FRAME_END:
+        // The magic bytes are only valid once they have been received
+        if (m_frameLen > MAGIC_START_LEN && m_frameLen == incomingPacketSize(m_inputBuffer.data._magic) + 1)
+            completePacket();
+        else if (m_frameLen != 0) // Not the empty frame between two delimiters
+            countResync();
+        m_frameLen = 0;
+        m_bufLen = 0;
+        break;
+    case CobsEvent::FRAME_ERROR:
+        countResync();
+        m_frameLen = 0;
+        m_bufLen = 0;
+        break;
+    case CobsEvent::NONE:
+        break;
+    }
 }
 
+void CommHandler::processFrameByte(uint8_t c) {
+    if (m_frameLen == FRAME_DROPPED) return;
+
+    // Frames of another version or too long are ignored until the next delimiter
+    if (m_frameLen == 0) {
+        m_frameLen = c == COMM_PROTOCOL_VERSION ? 1 : FRAME_DROPPED;
+        m_rxCrc.restart();
+        m_rxStartUs = inputMicros();
+    } else if (m_frameLen > UPDTPKT_SIZE) {
+        m_frameLen = FRAME_DROPPED;
+    } else {
+        m_frameLen++;
+        storePacketByte(c);
+    }
+}
+#else
 void CommHandler::processIncomingSerialByte(uint8_t c) {
     // Magic byte detection
     if (m_bufLen < 2) { 
         if (m_bufLen == 0 && c == (MAGIC_START & 0xff)) {
             m_inputBuffer.bytes[m_bufLen++] = c;
-        } else if (m_bufLen == 1) {
-            if (c == MAGIC_START >> 8)
-                m_inputBuffer.bytes[m_bufLen++] = c;
-            else m_bufLen = 0;
+            m_rxCrc.restart();
+            m_rxStartUs = inputMicros();
+        } else if (m_bufLen == 1 && incomingPacketSize((MAGIC_START & 0xff) | c << 8) != 0) {
+            m_inputBuffer.bytes[m_bufLen++] = c;
+        } else {
+            m_bufLen = 0;
+            countResync();
         }
         return;
     }
 
-    m_inputBuffer.bytes[m_bufLen++] = c;
+    storePacketByte(c);
 
     // Packet fully received
-    if (m_bufLen == UPDTPKT_SIZE) {
-        m_pressureUpdateSuccess = parsePressureUpdatePacket();
-        updateNumConsecInvalidPUP(m_pressureUpdateSuccess);
-        if (m_numConsecInvalidPUP > CommConfig::MAX_NUM_CONSEC_INVALIDS)
-            m_pressureData.valid = false;
-        else
-            m_pressureData.valid = true;
+    if (m_bufLen == incomingPacketSize(m_inputBuffer.data._magic)) {
+        completePacket();
         m_bufLen = 0;
     }
 }
+#endif
+
+// Size of the incoming packet with these magic bytes, or 0 if there is no such packet. All
+// magic bytes start with the same byte
+uint8_t CommHandler::incomingPacketSize(uint16_t magic) {
+    static_assert((MAGIC_COMMAND & 0xff) == (MAGIC_START & 0xff), "Incoming magic bytes must share the first byte");
+    switch (magic) {
+    case MAGIC_START: return UPDTPKT_SIZE;
+    case MAGIC_COMMAND: return CMDPKT_SIZE;
+    default: return 0;
+    }
+}
+
+void CommHandler::storePacketByte(uint8_t c) {
+    // The checksum covers everything after the magic bytes and the checksum itself, and is
+    // updated as the bytes arrive so that completing a packet does not checksum all of it at once
+    if (m_bufLen >= 4) m_rxCrc.add(c);
+    m_inputBuffer.bytes[m_bufLen++] = c;
+}
+
+void CommHandler::countResync() {
+    // Once per run of skipped bytes
+    if (!m_inSync) return;
+    m_inSync = false;
+    m_link.resyncs++;
+}
+
+void CommHandler::completePacket() {
+    m_inSync = true;
+    if (m_inputBuffer.data._magic == MAGIC_COMMAND) {
+        processCommandPacket();
+        return;
+    }
+
+    m_pressureUpdateSuccess = parsePressureUpdatePacket();
+    updateNumConsecInvalidPUP(m_pressureUpdateSuccess);
+    if (m_numConsecInvalidPUP > CommConfig::MAX_NUM_CONSEC_INVALIDS)
+        m_pressureData.valid = false;
+    else
+        m_pressureData.valid = true;
+}
+
+void CommHandler::queuePacket(int8_t slot, const uint8_t* bytes, size_t length) {
+    uint8_t* frame = m_txQueue.beginFrame(slot);
+    if (frame == nullptr) return; // Counted by the queue
+
+#ifdef USE_COBS_FRAMING
+    CobsEncoder encoder(frame);
+    encoder.add(COMM_PROTOCOL_VERSION);
+    encoder.add(bytes, length);
+    m_txQueue.commit(slot, encoder.finish());
+#else
+    memcpy(frame, bytes, length);
+    m_txQueue.commit(slot, length);
+#endif
+    m_txQueue.pump();
+}
 
 /* See comm_handler.h for the structure of a Pressure Update Packet */
 bool CommHandler::parsePressureUpdatePacket() {
-    // Verify CRC16 checksum
-    if (calcChecksum(m_inputBuffer.bytes + 4, UPDTPKT_SIZE - 4) != m_inputBuffer.data._checksum)
+    // Verify CRC16 checksum (accumulated in processIncomingSerialByte)
+    if (m_rxCrc.calc() != m_inputBuffer.data._checksum) {
+        m_link.crcErrors++;
+        return false;
+    }
+    m_link.received++;
+
+    if (!isValidState(m_inputBuffer.data.otherState))
         return false;
+    m_lastCommTime = inputMillis();
+
+    // A repeated or late packet is valid, but there is nothing new in it
+    if (!isNewSequence(m_inputBuffer.data.sequence))
+        return true;
+    updateJitter();
+    m_newSample = true;
+    m_sampleRxUs = m_rxStartUs;
+    m_piTimestamp = m_inputBuffer.data.piTimestamp;
 
     // Update pressures
     m_pressureData.sensor1 = m_inputBuffer.data.pt1Reading;
@@ -69,56 +221,334 @@ bool CommHandler::parsePressureUpdatePacket() {
     MPV_STATE = (m_inputBuffer.data.flags & UPDTPKT_FLAGS_MPV_OPEN) != 0;
     
     // Update our record of the other controller's state
-    if (!isValidState(m_inputBuffer.data.otherState))
-        return false;
     m_otherCtrlerState = m_inputBuffer.data.otherState;
-    
-    m_lastCommTime = millis();
     return true;
 }
 
+void CommHandler::setCommandTable(const CommandSpec* commands, uint8_t numCommands) {
+    m_commands = commands;
+    m_numCommands = numCommands;
+}
+
+/* See comm_handler.h for the structure of a Command Packet and its ACK */
+void CommHandler::processCommandPacket() {
+    // Verify CRC16 checksum (accumulated in processIncomingSerialByte). A corrupted command is
+    // not answered, the Pi sends it again when the ACK does not come
+    if (m_rxCrc.calc() != m_inputBuffer.data._checksum) {
+        m_link.crcErrors++;
+        return;
+    }
+
+    commandPacketU_t command;
+    memcpy(command.bytes, m_inputBuffer.bytes, CMDPKT_SIZE);
+
+    ackPacketU_t ack; // Only on the stack until it is queued
+    ack.data._magic = MAGIC_ACK;
+    ack.data.type = command.data.type;
+    ack.data.commandId = command.data.commandId;
+    ack.data.status = dispatchCommand(command.data, ack.data.appliedValue);
+    ack.data._checksum = calcChecksum(ack.bytes + 4, ACKPKT_SIZE - 4);
+
+    queuePacket(m_ackSlot, ack.bytes, ACKPKT_SIZE);
+}
+
+CommandStatus CommHandler::dispatchCommand(const commandPacket_t& command, float& appliedValue) {
+    appliedValue = command.value;
+
+    CommandSpec spec;
+    uint8_t i = 0;
+    for (; i < m_numCommands; i++) {
+        memcpy_P(&spec, &m_commands[i], sizeof(CommandSpec));
+        if (spec.type == command.type) break;
+    }
+    if (i == m_numCommands)
+        return CommandStatus::UNKNOWN_TYPE;
+
+    // Tuning the loop while it is running (or after a fault) is not allowed
+    if (systemState.currentState != SystemStateEnum::BOOT_INIT &&
+        systemState.currentState != SystemStateEnum::OPEN_LOOP_INIT)
+        return CommandStatus::UNSAFE_STATE;
+
+    // Also rejects NaN
+    if (!(command.value >= spec.min && command.value <= spec.max))
+        return CommandStatus::OUT_OF_BOUNDS;
+
+    appliedValue = spec.apply(command.value);
+    return CommandStatus::APPLIED;
+}
+
+bool CommHandler::isNewSequence(uint16_t sequence) {
+    uint16_t ahead = sequence - m_link.lastSequence;
+    if (m_haveSequence) {
+        uint16_t behind = m_link.lastSequence - sequence;
+        if (ahead == 0 || behind <= LATE_SEQUENCE_WINDOW) {
+            m_link.duplicates++;
+            return false;
+        }
+        // Far behind, the Pi restarted its sequence: nothing lost
+        if (ahead < 0x8000) m_link.lost += ahead - 1;
+    }
+    m_link.lastSequence = sequence;
+    m_haveSequence = true;
+    return true;
+}
+
+// Inter-arrival jitter as in RFC 3550: J += (|D| - J) / 16, where D is the difference between
+// two consecutive inter-arrival times
+void CommHandler::updateJitter() {
+    unsigned long now = m_rxStartUs;
+    unsigned long interval = now - m_lastArrivalUs;
+    if (m_lastArrivalUs != 0 && m_lastIntervalUs != 0) {
+        unsigned long d = interval > m_lastIntervalUs ? interval - m_lastIntervalUs : m_lastIntervalUs - interval;
+        m_jitterX16 += d - ((m_jitterX16 + 8) >> 4);
+        uint32_t jitterUs = m_jitterX16 >> 4;
+        m_link.jitterUs = jitterUs > UINT16_MAX ? UINT16_MAX : (uint16_t)jitterUs;
+    }
+    m_lastIntervalUs = m_lastArrivalUs != 0 ? interval : 0;
+    m_lastArrivalUs = now;
+}
+
+bool CommHandler::takeNewSample() {
+    bool newSample = m_newSample;
+    m_newSample = false;
+    return newSample;
+}
+
 bool CommHandler::isCommHealthy() const {
-    return (millis() - m_lastCommTime) < (TimingConfig::COMM_TIMEOUT_S / 2 * 1000);
+    return (inputMillis() - m_lastCommTime) < (TimingConfig::COMM_TIMEOUT_S / 2 * 1000);
 }
 
-/* See comm_handler.h for the structure of a Telemetry Packet */
-void CommHandler::sendTelemetry(SystemStateEnum state, float motorAngle, float deltaAngle, float pidIntegralError, const char* systemType, bool ifMpvShdBeClosed) {    
-    m_outputBuffer.data._magic = MAGIC_START;
-    m_outputBuffer.data.systemState = state;
-
-    m_outputBuffer.data.flags = 0;
-    if (MPV_STATE) m_outputBuffer.data.flags |= TELPKT_FLAGS_MPV_OPEN_DETECTED;
-    if (ifMpvShdBeClosed) m_outputBuffer.data.flags |= TELPKT_FLAGS_MPV_SHD_BE_CLOSED;
-    if (strcmp(systemType, "FUEL") == 0) m_outputBuffer.data.flags |= TELPKT_FLAGS_SYSTEM_TYPE;
-
-    m_outputBuffer.data.faults = 0;
-    if (faults.manualAbort) m_outputBuffer.data.faults |= TELPKT_FAULTS_MANUAL_ABORT;
-    if (faults.commTimeout) m_outputBuffer.data.faults |= TELPKT_FAULTS_COMM_TIMEOUT;
-    if (faults.encoderMismatch) m_outputBuffer.data.faults |= TELPKT_FAULTS_ENCODER_ERROR;
-    if (faults.noMotion) m_outputBuffer.data.faults |= TELPKT_FAULTS_NO_MOTION;
-    if (faults.sensorFault) m_outputBuffer.data.faults |= TELPKT_FAULTS_SENSOR_FAULT;
-    if (faults.redBandFault) m_outputBuffer.data.faults |= TELPKT_FAULTS_REDBAND_FAULT;
+uint8_t CommHandler::telemetryFlags(const char* systemType, bool ifMpvShdBeClosed) {
+    uint8_t flags = 0;
+    if (MPV_STATE) flags |= TELPKT_FLAGS_MPV_OPEN_DETECTED;
+    if (ifMpvShdBeClosed) flags |= TELPKT_FLAGS_MPV_SHD_BE_CLOSED;
+    if (strcmp(systemType, "FUEL") == 0) flags |= TELPKT_FLAGS_SYSTEM_TYPE;
+    return flags;
+}
+
+uint8_t CommHandler::telemetryFaults() {
+    uint8_t faultBits = 0;
+    if (faults.manualAbort) faultBits |= TELPKT_FAULTS_MANUAL_ABORT;
+    if (faults.commTimeout) faultBits |= TELPKT_FAULTS_COMM_TIMEOUT;
+    if (faults.encoderMismatch) faultBits |= TELPKT_FAULTS_ENCODER_ERROR;
+    if (faults.noMotion) faultBits |= TELPKT_FAULTS_NO_MOTION;
+    if (faults.sensorFault) faultBits |= TELPKT_FAULTS_SENSOR_FAULT;
+    if (faults.redBandFault) faultBits |= TELPKT_FAULTS_REDBAND_FAULT;
 #ifdef USE_OSCILLATION_DETECTOR
-    if (faults.oscillationDetected) m_outputBuffer.data.faults |= TELPKT_FAULTS_OSCILLATION_DETECTED;
+    if (faults.oscillationDetected) faultBits |= TELPKT_FAULTS_OSCILLATION_DETECTED;
 #endif
+    return faultBits;
+}
 
-    m_outputBuffer.data._unused = 0;
+#ifndef USE_COMPACT_TELEMETRY
+/* See comm_handler.h for the structure of a Telemetry Packet */
+void CommHandler::sendTelemetry(SystemStateEnum state, float motorAngle, float deltaAngle, float pidIntegralError, const char* systemType, bool ifMpvShdBeClosed) {    
+    telemetryPacketU_t packet; // Only on the stack until it is queued
+    packet.data._magic = MAGIC_START;
+    packet.data.systemState = state;
+    packet.data.flags = telemetryFlags(systemType, ifMpvShdBeClosed);
+    packet.data.faults = telemetryFaults();
+    packet.data._unused = 0;
 
-    m_outputBuffer.data.curMotorAngle = motorAngle;
-    m_outputBuffer.data.curDeltaAngle = deltaAngle;
-    m_outputBuffer.data.curIntError = pidIntegralError;
-    m_outputBuffer.data.pt1Reading = m_pressureData.sensor1;
-    m_outputBuffer.data.pt2Reading = m_pressureData.sensor2;
+    packet.data.curMotorAngle = motorAngle;
+    packet.data.curDeltaAngle = deltaAngle;
+    packet.data.curIntError = pidIntegralError;
+    packet.data.pt1Reading = m_pressureData.sensor1;
+    packet.data.pt2Reading = m_pressureData.sensor2;
 #if USE_3_PTS
-    m_outputBuffer.data.pt3Reading = m_pressureData.sensor3;
+    packet.data.pt3Reading = m_pressureData.sensor3;
 #endif
 
+    const TxStats& txStats = m_txQueue.getStats();
+    packet.data.txSent = txStats.sent;
+    packet.data.txCoalesced = (uint8_t)txStats.coalesced;
+    packet.data.txDropped = (uint8_t)txStats.dropped;
+    packet.data.sequence = m_telemetrySequence++;
+    packet.data.link = m_link;
+    packet.data.piTimestampEcho = m_piTimestamp;
+    packet.data.sampleRxUs = m_sampleRxUs;
+    packet.data.txUs = inputMicros();
+
     // Calculate CRC16 checksum
-    m_outputBuffer.data._checksum = calcChecksum(m_outputBuffer.bytes + 4, TELPKT_SIZE - 4);
+    packet.data._checksum = calcChecksum(packet.bytes + 4, TELPKT_SIZE - 4);
+
+    queuePacket(m_telemetrySlot, packet.bytes, TELPKT_SIZE);
+}
+#else
+/* See comm_handler.h for the structure of a Compact Telemetry Packet */
+void CommHandler::sendTelemetry(SystemStateEnum state, float motorAngle, float deltaAngle, float pidIntegralError, const char* systemType, bool ifMpvShdBeClosed) {
+    compactTelemetryPacketU_t packet; // Only on the stack until it is queued
+    packet.data._magic = MAGIC_COMPACT;
+    packet.data.systemState = state;
+    packet.data.flags = telemetryFlags(systemType, ifMpvShdBeClosed);
+    packet.data.faults = telemetryFaults();
+    packet.data._unused = 0;
+
+    packet.data.timestampMs = inputMillis();
+    packet.data.curMotorAngle = scaleToInt16(motorAngle, CTELPKT_ANGLE_SCALE);
+    packet.data.curDeltaAngle = scaleToInt16(deltaAngle, CTELPKT_ANGLE_SCALE);
+    packet.data.curIntError = scaleToInt16(pidIntegralError, CTELPKT_INTEGRAL_SCALE);
+    packet.data.pt1Reading = scaleToInt16(m_pressureData.sensor1, CTELPKT_PRESSURE_SCALE);
+    packet.data.pt2Reading = scaleToInt16(m_pressureData.sensor2, CTELPKT_PRESSURE_SCALE);
+#if USE_3_PTS
+    packet.data.pt3Reading = scaleToInt16(m_pressureData.sensor3, CTELPKT_PRESSURE_SCALE);
+#else
+    packet.data.pt3Reading = 0;
+#endif
+
+    const TxStats& txStats = m_txQueue.getStats();
+    packet.data.txSent = txStats.sent;
+    packet.data.txCoalesced = (uint8_t)txStats.coalesced;
+    packet.data.txDropped = (uint8_t)txStats.dropped;
+    packet.data.sequence = m_telemetrySequence++;
+    packet.data.link = m_link;
+    packet.data.piTimestampEcho = m_piTimestamp;
+    packet.data.sampleRxUs = m_sampleRxUs;
+    packet.data.txUs = inputMicros();
+
+    packet.data._checksum = calcChecksum(packet.bytes + 4, CTELPKT_SIZE - 4);
+
+    queuePacket(m_telemetrySlot, packet.bytes, CTELPKT_SIZE);
+}
+#endif
+
+void CommHandler::processOutgoingNonBlocking() {
+    sendPendingEvent();
+    m_txQueue.pump();
+}
+
+void CommHandler::queueEvent(EventType type, SystemStateEnum oldState, SystemStateEnum newState, uint8_t faults) {
+    if (m_numEvents >= EVENT_QUEUE_SIZE) {
+        m_eventsDropped++;
+        return;
+    }
+
+    PendingEvent& event = m_events[m_numEvents++];
+    event.type = type;
+    event.oldState = oldState;
+    event.newState = newState;
+    event.faults = faults;
+    event.timestampMs = inputMillis();
+    sendPendingEvent();
+}
+
+void CommHandler::reportNewFaults(SystemStateEnum state) {
+    uint8_t faultBits = telemetryFaults();
+    uint8_t latched = faultBits & ~m_reportedFaults;
+    m_reportedFaults = faultBits;
+    if (latched != 0)
+        queueEvent(EventType::FAULT_LATCHED, state, state, latched);
+}
+
+/* See comm_handler.h for the structure of an Event Packet */
+void CommHandler::sendPendingEvent() {
+    if (m_numEvents == 0 || m_txQueue.isPending(m_eventSlot)) return;
+    unsigned long now = inputMillis();
+    if (m_eventSent && now - m_lastEventMs < CommConfig::EVENT_MIN_INTERVAL_MS) return;
+
+    const PendingEvent& event = m_events[0];
+    eventPacketU_t packet; // Only on the stack until it is queued
+    packet.data._magic = MAGIC_EVENT;
+    packet.data.type = event.type;
+    packet.data.oldState = event.oldState;
+    packet.data.newState = event.newState;
+    packet.data.faults = event.faults;
+    packet.data.timestampMs = event.timestampMs;
+    packet.data.eventsDropped = m_eventsDropped;
+    packet.data._unused = 0;
+    packet.data._checksum = calcChecksum(packet.bytes + 4, EVTPKT_SIZE - 4);
 
-    Serial.write(m_outputBuffer.bytes, TELPKT_SIZE);
+    m_numEvents--;
+    memmove(m_events, m_events + 1, m_numEvents * sizeof(PendingEvent));
+    m_eventSent = true;
+    m_lastEventMs = now;
+
+    queuePacket(m_eventSlot, packet.bytes, EVTPKT_SIZE);
+}
+
+/* See comm_handler.h for the structure of a Flight Recorder Dump Packet */
+bool CommHandler::sendFlightRecorderDump(FlightRecorder& recorder) {
+    if (!recorder.isDumpPending()) return false;
+    if (m_txQueue.isPending(m_dumpSlot)) return true; // Every record matters, wait for room
+
+    dumpPacketU_t packet = {}; // Only on the stack until it is queued
+    packet.data._magic = MAGIC_DUMP;
+    packet.data.first = recorder.getDumpPosition();
+    packet.data.total = recorder.size();
+    packet.data.count = recorder.takeDumpRecords(packet.data.records, RecorderConfig::RECORDS_PER_DUMP_PACKET);
+    packet.data._checksum = calcChecksum(packet.bytes + 4, DUMPPKT_SIZE - 4);
+
+    queuePacket(m_dumpSlot, packet.bytes, DUMPPKT_SIZE);
+    return recorder.isDumpPending();
+}
+
+#ifdef USE_LOOP_PROFILER
+static uint16_t saturate16(unsigned long value) {
+    return value > 0xffff ? 0xffff : (uint16_t)value;
 }
 
+/* See comm_handler.h for the structure of a Diagnostics Packet */
+void CommHandler::buildDiagnosticsPacket(diagnosticsPacketU_t& packet, const LoopProfiler& profiler, const TaskScheduler& scheduler,
+                                         const EncoderSampler& encoder) {
+    packet.data._magic = MAGIC_DIAG;
+    packet.data.numPhases = (uint8_t)LoopPhase::COUNT;
+    packet.data.numTasks = scheduler.getNumTasks();
+    packet.data.rxOverflows = serialRxRing.getOverflowCount();
+
+    for (uint8_t i = 0; i < (uint8_t)LoopPhase::COUNT; i++) {
+        const PhaseStats& stats = profiler.getStats((LoopPhase)i);
+        diagnosticsPhase_t& phase = packet.data.phases[i];
+        phase.minUs = stats.count == 0 ? 0 : stats.minUs;
+        phase.maxUs = stats.maxUs;
+        phase.meanUs = profiler.getMeanUs((LoopPhase)i);
+        phase.count = stats.count;
+        phase.overruns = stats.overruns;
+        phase._unused = 0;
+    }
+
+    for (uint8_t i = 0; i < TaskScheduler::MAX_TASKS; i++) {
+        diagnosticsTask_t& task = packet.data.tasks[i];
+        if (i < scheduler.getNumTasks()) {
+            const SchedulerTaskStats& stats = scheduler.getStats(i);
+            task.runs = stats.runs;
+            task.overruns = stats.overruns;
+            task.maxLatencyUs = stats.maxLatencyUs;
+            task.maxRunUs = stats.maxRunUs;
+        } else {
+            task = diagnosticsTask_t();
+        }
+    }
+    packet.data.encoderReads = saturate16(encoder.getReads());
+    packet.data.encoderReadsSaved = saturate16(encoder.getReadsSaved());
+
+    packet.data._checksum = calcChecksum(packet.bytes + 4, DIAGPKT_SIZE - 4);
+}
+
+void CommHandler::sendDiagnostics(const LoopProfiler& profiler, const TaskScheduler& scheduler, const EncoderSampler& encoder) {
+    diagnosticsPacketU_t packet; // Only on the stack until it is queued
+    buildDiagnosticsPacket(packet, profiler, scheduler, encoder);
+    queuePacket(m_diagnosticsSlot, packet.bytes, DIAGPKT_SIZE);
+}
+#endif
+
+#ifdef USE_INPUT_JOURNAL
+/* See comm_handler.h for the structure of a Journal Packet */
+bool CommHandler::sendJournalChunk(const uint8_t* data, uint8_t length) {
+    assert(length <= JournalConfig::CHUNK_SIZE);
+    bool dropped = m_txQueue.isPending(m_journalSlot); // Then queuePacket() drops it, and counts that
+
+    journalPacketU_t packet = {}; // Only on the stack until it is queued
+    packet.data._magic = MAGIC_JOURNAL;
+    packet.data.sequence = m_journalSequence++;
+    packet.data.length = length;
+    memcpy(packet.data.journal, data, length);
+    packet.data._checksum = calcChecksum(packet.bytes + 4, JRNPKT_SIZE - 4);
+
+    queuePacket(m_journalSlot, packet.bytes, JRNPKT_SIZE);
+    return !dropped;
+}
+#endif
+
 void CommHandler::updateNumConsecInvalidPUP(bool valid) {
     if (valid)
         m_numConsecInvalidPUP = 0;
@@ -127,8 +557,5 @@ void CommHandler::updateNumConsecInvalidPUP(bool valid) {
 }
 
 uint16_t CommHandler::calcChecksum(const uint8_t *array, unsigned int length) {
-    m_crc16.add(array, length);
-    uint16_t checksum = m_crc16.calc();
-    m_crc16.restart();
-    return checksum;
+    return crc16Xmodem(array, length);
 }
\ No newline at end of file
@@ -0,0 +1,363 @@
+#include <Arduino.h>
+#include <math.h>
+
+#include "config.h"
+#include "control_tasks.h"
+#include "input_journal.h"
+#include "loop_profiler.h"
+#include "state_machine.h"
+#include "utilities.h"
+
+static bool redBandCheck = false;
+static unsigned long commLostTime = 0;
+
+static void bootInit();
+static void openLoopInit();
+static void closedLoop();
+static void forcedOpenLoop();
+static void emergencyStop();
+
+void resetControlTasks() {
+    redBandCheck = false;
+    commLostTime = 0;
+}
+
+void processComms() {
+    PROFILE_PHASE(LoopPhase::COMM);
+    commHandler->processIncomingNonBlocking();
+    commHandler->reportNewFaults(systemState.currentState);
+    commHandler->sendFlightRecorderDump(flightRecorder);
+    commHandler->processOutgoingNonBlocking();
+}
+
+#ifdef USE_LOOP_PROFILER
+void sendDiagnostics() {
+    commHandler->sendDiagnostics(loopProfiler, scheduler, encoderSampler);
+    loopProfiler.reset();
+    scheduler.resetStats();
+    encoderSampler.resetCounters();
+}
+#endif
+
+void globalMonitors() {
+    PROFILE_PHASE(LoopPhase::MONITORS);
+
+#ifndef NO_MANUAL_ABORT
+    // Manual abort check
+    if (isManualAbortPressed()) {
+        faults.manualAbort = true;
+        setMPV(false);
+        systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+        return;
+    }
+#endif
+    
+    // If system was running and MPV gets turned off, transition to open loop init and reset
+    if (!getMPVState() && (systemState.currentState == SystemStateEnum::CLOSED_LOOP || systemState.currentState == SystemStateEnum::FORCED_OPEN_LOOP)) {
+        setMPV(false);
+        resetSystemOnMpvCycle(); 
+        return;
+    }
+
+    // Communication watchdog
+    if (!commHandler->isCommHealthy()) {
+        faults.commTimeout = true;
+        if (commLostTime == 0) commLostTime = inputMillis();
+        // If comm not reestablished in COMM_TIMEOUT_S, go to open loop
+        if (inputMillis() - commLostTime > (TimingConfig::COMM_TIMEOUT_S / 2 * 1000)) {
+            if (systemState.currentState == SystemStateEnum::CLOSED_LOOP) {
+                systemState.changeStateTo(SystemStateEnum::FORCED_OPEN_LOOP);
+            }
+        }
+    } else {
+        // Reset commLostTime if comm is healthy
+        faults.commTimeout = false;
+        commLostTime = 0;
+    }
+
+    // State Sync Check with other controller
+    if (commHandler->isCommHealthy()) {        
+        // Get current angle for position-based sync rules
+        angle_t currentAngle = getValveAngle();
+        if (!isAngleValid(currentAngle)) {
+            faults.encoderMismatch = true;
+            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+            return;
+        }
+        
+        // Apply state synchronization rules
+        SystemStateEnum syncedState = getSyncedState(systemState.currentState, commHandler->getOtherCtrlerState(), currentAngle);
+        
+        // Only change state if sync rules determine a different state is needed
+        if (syncedState != systemState.currentState) {
+            systemState.changeStateTo(syncedState);
+        }
+    }
+}
+
+void stateMachineUpdate() {
+    PROFILE_PHASE(LoopPhase::CONTROL);
+
+    switch (systemState.currentState) {
+        case SystemStateEnum::BOOT_INIT:
+            bootInit();
+            break;
+            
+        case SystemStateEnum::OPEN_LOOP_INIT:
+            openLoopInit();
+            break;
+            
+        case SystemStateEnum::CLOSED_LOOP:
+            closedLoop();
+            break;
+            
+        case SystemStateEnum::FORCED_OPEN_LOOP:
+            forcedOpenLoop();
+            break;
+            
+        case SystemStateEnum::EMERGENCY_STOP:
+            emergencyStop();
+            break;
+            
+        default:
+            // Invalid state, go to emergency stop
+            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+            break;
+    }
+
+    recordControlTick();
+}
+
+static void bootInit() {
+    if (!systemState.systemInitialized) {
+        faults.clear();
+        channel.targetAngle = degToAngle(ValveConfig::START_ANGLE);
+        const EncoderSample& sample = encoderSampler.fresh();
+        angle_t encAngle = sample.angle;
+        if (!isAngleValid(encAngle)) {
+            faults.encoderMismatch = true;
+            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+            return;
+        }
+        channel.currentAngle = encAngle;
+        positionEstimator.reset(encAngle, sample.stepPosition, inputMillis());
+        controller->reset();
+        
+        systemState.systemInitialized = true;
+        systemState.preClosedLoopTimer = inputMillis();
+    }
+
+    systemState.changeStateTo(SystemStateEnum::OPEN_LOOP_INIT);
+}
+
+// Drive valve to starting position for closed-loop operation
+static void openLoopInit() {
+    // Reset redBandCheck
+    redBandCheck = false;
+
+    angle_t currentAngle = getValveAngle();
+    if (!isAngleValid(currentAngle)) {
+        faults.encoderMismatch = true;
+        systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+        return;
+    }
+    // Update current angle for telemetry
+    channel.currentAngle = currentAngle;
+    
+    bool atTarget = isAtStartAngle(currentAngle);
+    // Move valve if not at target
+    if (!atTarget) {
+        angle_t deltaAngle = degToAngle(ValveConfig::START_ANGLE) - currentAngle;
+        applyMoveFilter(deltaAngle, tunables.maxAngleChange, tunables.moveFilterScale);
+
+        channel.targetAngle = currentAngle + deltaAngle;
+
+        serviceMotor();
+        
+        // Check for encoder issues
+        angle_t newAngle = getValveAngle();
+        if (!isAngleValid(newAngle)) {
+            faults.encoderMismatch = true;
+            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+            return;
+        }
+        // Update current angle after movement
+        channel.currentAngle = newAngle;
+    }
+    
+    // If valve at starting position, check if MPV is open, then after the pre closed loop timer elapses go into closed loop
+    if (atTarget) {
+        if (getMPVState()) {
+            if (!systemState.mpvWasOpen) {
+                systemState.mpvWasOpen = true;
+                setMPV(true);
+                systemState.preClosedLoopTimer = inputMillis();
+            }
+            if (inputMillis() - systemState.preClosedLoopTimer >= (TimingConfig::SAFE_TIMER_S * 1000UL)) {
+#if OPEN_LOOP_MODE
+                systemState.changeStateTo(SystemStateEnum::FORCED_OPEN_LOOP);
+#else
+                systemState.changeStateTo(SystemStateEnum::CLOSED_LOOP);
+                systemState.enterClosedLoopTime = inputMillis();
+                systemState.lastControlTime = inputMicros(); // Reset timing for dt calculation
+#endif
+            }
+        } else {
+            systemState.mpvWasOpen = false;
+            setMPV(false);
+        }
+    }
+}
+
+static void closedLoop() {
+#ifdef USE_SAMPLE_TIME_DT
+    // Calculate time step for this control loop iteration, from when the samples arrived, so
+    // that the integral and derivative follow the samples' own (possibly jittery) spacing
+    unsigned long now = commHandler->getSampleRxUs();
+#else
+    // Calculate time step for this control loop iteration, from the scheduled release times
+    // (so it is a whole number of control periods, independent of jitter)
+    unsigned long now = scheduler.getReleaseUs(controlTaskId);
+#endif
+    // On every tick, so that the controller never integrates the ticks it skipped (in tolerance,
+    // or waiting for a move) as one long step
+    float dt = (long)(now - systemState.lastControlTime) / 1000000.0f;
+    systemState.lastControlTime = now;
+    if (dt <= 0.0f || dt > 10.0f) { // Minimum dt to avoid division by zero or unrealistic values
+        dt = TimingConfig::CONTROL_PERIOD_S; // Fallback
+    }
+
+    // Validate and act only on a new sample: the same one again would only count towards the
+    // sensors' consecutive faults (the comm watchdog takes care of samples that stop coming)
+    if (!commHandler->takeNewSample()) return;
+
+    // Read pressure sensors for this manifold
+    float pressure;
+    switch (readManifoldPressures(pressure)) {
+    #if USE_3_PTS
+        case SensorStatus::THREE_ILLOGICAL:
+    #else
+        case SensorStatus::TWO_ILLOGICAL:
+    #endif
+            faults.sensorFault = true;
+            systemState.changeStateTo(SystemStateEnum::FORCED_OPEN_LOOP);
+            return;
+        case SensorStatus::PENDING_FAULT:
+            return;
+        default: break;
+    }
+    
+    // Redband check (occurs if we are past the redband timeout)
+    if (redBandCheck || (inputMillis() - systemState.enterClosedLoopTime) > TimingConfig::REDBAND_TIMEOUT * 1000UL){
+        redBandCheck = true;
+        if (!checkRedBand(pressure)){
+            faults.redBandFault = true;
+            systemState.changeStateTo(SystemStateEnum::FORCED_OPEN_LOOP);
+            return;
+        }
+    }
+    
+    float error = tunables.targetPressurePsi - pressure;
+    channel.pressure = pressure;
+    channel.error = error;
+    bool inTolerance = fabs(error) <= SensorConfig::PRESSURE_TOLERANCE;
+
+    // VALVE CONTROL
+    // Let the previous move finish stepping in the background before commanding the next one
+    if (!inTolerance && !inputStepBusy(stepEngine)) {
+        // Update controller
+        controller->update(Controller::Error(error), Controller::Time(dt));
+        angle_t deltaAngle = numericCast<angle_t>(controller->getError());
+        
+        // Apply move filtering (5-degree cap by default)
+        applyMoveFilter(deltaAngle, tunables.maxAngleChange, tunables.moveFilterScale);
+        
+        // Calculate new target angle
+        angle_t newTargetAngle = channel.targetAngle + deltaAngle;
+        newTargetAngle = constrainAngle(newTargetAngle);
+        
+        // Command stepper motor
+        angle_t angleBeforeMove = getValveAngle();
+        if (!isAngleValid(angleBeforeMove)) {
+            faults.encoderMismatch = true;
+            setMPV(false);
+            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+            return;
+        }
+        channel.targetAngle = newTargetAngle;
+        serviceMotor();
+        // Verify encoder response (checked against the commanded steps by the position estimator)
+        angle_t angleAfterMove = getValveAngle();
+        if (!isAngleValid(angleAfterMove)) {
+            faults.encoderMismatch = true;
+            setMPV(false);
+            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+            return;
+        }
+        channel.currentAngle = angleAfterMove;
+
+#ifdef USE_OSCILLATION_DETECTOR
+        // Check for oscillations
+        if (controller->getOscillationDetector().checkOscillation(error, inputMillis())) {
+            faults.oscillationDetected = true;
+            systemState.changeStateTo(SystemStateEnum::FORCED_OPEN_LOOP);
+            return;
+        }
+#endif
+    }
+
+}
+
+// Safe fallback mode - move valve to open loop target angle
+static void forcedOpenLoop() {
+    angle_t currentAngle = getValveAngle();
+    if (!isAngleValid(currentAngle)) {
+        faults.encoderMismatch = true;
+        systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+        return;
+    }
+    // Update current angle for telemetry
+    channel.currentAngle = currentAngle;
+    
+    // Move valve to open loop target angle if not already there
+    if (!isAtAngle(currentAngle, degToAngle(ValveConfig::OPENLOOP_TARGET_ANGLE))) {
+        angle_t deltaAngle = degToAngle(ValveConfig::OPENLOOP_TARGET_ANGLE) - currentAngle;
+        applyMoveFilter(deltaAngle, tunables.maxAngleChange, tunables.moveFilterScale);
+        channel.targetAngle = currentAngle + deltaAngle;
+        serviceMotor();
+
+        angle_t angleAfterMove = getValveAngle();
+        if (!isAngleValid(angleAfterMove)) {
+            faults.encoderMismatch = true;
+            setMPV(false);
+            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+            return;
+        }
+        // Update current angle after movement
+        channel.currentAngle = angleAfterMove;
+    }
+
+    // // Check for recovery conditions
+    // if (commHandler->isCommHealthy() && !faults.manualAbort) {
+    //     float pressure;
+    //     if (readManifoldPressures(pressure)) {
+    //         // Clear transient faults and attempt recovery
+    //         if (millis() - stateEntryTime > (TimingConfig::RECOVERY_DWELL_S * 1000)) {
+    //             faults.clear();
+    //             controller->reset();
+    //             currentState = SystemStateEnum::CLOSED_LOOP;
+    //             stateEntryTime = millis();
+    //             lastControlTime = millis();
+    //         }
+    //     }
+    // }
+}
+
+static void emergencyStop() {
+    // Terminal safe state
+    setMPV(false);
+    stepEngine.stop();
+    disableMotorDriver();
+    
+    // System remains in emergency stop until power cycle or manual reset
+}
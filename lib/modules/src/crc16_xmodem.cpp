@@ -0,0 +1,10 @@
+#include "crc16_xmodem.h"
+
+const Crc16ByteTable crc16XmodemByteTable PROGMEM = Crc16ByteTable();
+const Crc16NibbleTable crc16XmodemNibbleTable PROGMEM = Crc16NibbleTable();
+
+uint16_t crc16Xmodem(const uint8_t* data, size_t length, uint16_t crc) {
+    while (length--)
+        crc = crc16XmodemUpdate(crc, *data++);
+    return crc;
+}
@@ -0,0 +1,31 @@
+#include "assert_own.h"
+#include "encoder_sampler.h"
+
+EncoderSampler::EncoderSampler(ReadFn read)
+    : m_read(read), m_sample{degToAngle(-1.0f), 0, 0}, m_hasSample(false), m_sampledThisTick(false),
+      m_reads(0), m_readsSaved(0) {}
+
+void EncoderSampler::beginTick() {
+    m_sampledThisTick = false;
+}
+
+const EncoderSample& EncoderSampler::get() {
+    if (m_sampledThisTick) {
+        m_readsSaved++;
+        return m_sample;
+    }
+    return fresh();
+}
+
+const EncoderSample& EncoderSampler::fresh() {
+    assert(m_read != nullptr);
+    m_read(m_sample);
+    m_reads++;
+    m_hasSample = true;
+    m_sampledThisTick = true;
+    return m_sample;
+}
+
+unsigned long EncoderSampler::getSampleAgeUs(unsigned long nowUs) const {
+    return m_hasSample ? nowUs - m_sample.timeUs : 0;
+}
@@ -0,0 +1,56 @@
+#include "assert_own.h"
+#include "fixed_point.h"
+#include "flight_recorder.h"
+
+FlightRecorder::FlightRecorder() : m_records(), m_next(0), m_count(0), m_dumpNext(0), m_frozen(false) {}
+
+flightRecord_t FlightRecorder::pack(unsigned long timeMs, float pressure, float error, float output,
+                                    float targetAngle, float currentAngle, SystemStateEnum state, uint8_t faults) {
+    flightRecord_t record;
+    record.timeMs = (uint16_t)timeMs;
+    record.pressure = scaleToInt16(pressure, FLTREC_PRESSURE_SCALE);
+    record.error = scaleToInt16(error, FLTREC_PRESSURE_SCALE);
+    record.output = scaleToInt16(output, FLTREC_ANGLE_SCALE);
+    record.targetAngle = scaleToInt16(targetAngle, FLTREC_ANGLE_SCALE);
+    record.currentAngle = scaleToInt16(currentAngle, FLTREC_ANGLE_SCALE);
+    record.state = state;
+    record.faults = faults;
+    return record;
+}
+
+void FlightRecorder::record(const flightRecord_t& record) {
+    if (m_frozen) return;
+
+    m_records[m_next] = record;
+    m_next = (m_next + 1) % RecorderConfig::NUM_RECORDS;
+    if (m_count < RecorderConfig::NUM_RECORDS) m_count++;
+}
+
+void FlightRecorder::freeze() {
+    if (m_frozen) return;
+    m_frozen = true;
+    m_dumpNext = 0;
+}
+
+void FlightRecorder::rearm() {
+    m_next = 0;
+    m_count = 0;
+    m_dumpNext = 0;
+    m_frozen = false;
+}
+
+const flightRecord_t& FlightRecorder::at(uint8_t i) const {
+    assert(i < m_count);
+    // The oldest record is at m_next once the ring has wrapped around
+    uint8_t oldest = m_count < RecorderConfig::NUM_RECORDS ? 0 : m_next;
+    return m_records[(oldest + i) % RecorderConfig::NUM_RECORDS];
+}
+
+uint8_t FlightRecorder::takeDumpRecords(flightRecord_t* out, uint8_t max) {
+    if (!m_frozen) return 0;
+
+    uint8_t n = 0;
+    while (n < max && m_dumpNext < m_count)
+        out[n++] = at(m_dumpNext++);
+    return n;
+}
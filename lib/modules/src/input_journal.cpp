@@ -0,0 +1,245 @@
+#include <AMT22_lib.h>
+
+#include "assert_own.h"
+#include "input_journal.h"
+
+/* See input_journal.h for the format of the journal */
+
+InputJournal::InputJournal() : m_mode(Mode::OFF), m_sink(nullptr), m_chunk(), m_chunkLength(0), m_journal(nullptr),
+                               m_length(0), m_position(0), m_ended(false), m_diverged(false) {
+    resetValues();
+}
+
+void InputJournal::resetValues() {
+    m_lastMillis = 0;
+    m_lastMicros = 0;
+    m_lastPosition = 0;
+}
+
+void InputJournal::startRecording(SinkFn sink) {
+    assert(sink != nullptr);
+    if (m_mode == Mode::PLAYBACK) return;
+    stop();
+
+    m_mode = Mode::RECORDING;
+    m_sink = sink;
+    m_chunkLength = 0;
+    resetValues();
+}
+
+void InputJournal::startPlayback(const uint8_t* journal, size_t length) {
+    stop();
+
+    m_mode = Mode::PLAYBACK;
+    m_journal = journal;
+    m_length = length;
+    m_position = 0;
+    m_ended = false;
+    m_diverged = false;
+    resetValues();
+}
+
+void InputJournal::stop() {
+    if (m_mode == Mode::RECORDING && m_chunkLength > 0)
+        m_sink(m_chunk, m_chunkLength);
+    m_chunkLength = 0;
+    m_mode = Mode::OFF;
+}
+
+void InputJournal::putByte(uint8_t byte) {
+    m_chunk[m_chunkLength++] = byte;
+    if (m_chunkLength == sizeof(m_chunk)) {
+        m_sink(m_chunk, m_chunkLength);
+        m_chunkLength = 0;
+    }
+}
+
+void InputJournal::putRecord(JournalTag tag, uint32_t value) {
+    if (value < VARINT) {
+        putByte((uint8_t)((uint8_t)tag << 5 | value));
+        return;
+    }
+    putByte((uint8_t)((uint8_t)tag << 5 | VARINT));
+    while (value >= 0x80) {
+        putByte((uint8_t)value | 0x80);
+        value >>= 7;
+    }
+    putByte((uint8_t)value);
+}
+
+bool InputJournal::takeByte(uint8_t& byte) {
+    if (m_position >= m_length) {
+        m_ended = true;
+        return false;
+    }
+    byte = m_journal[m_position++];
+    return true;
+}
+
+bool InputJournal::takeRecord(JournalTag tag, uint32_t& value) {
+    value = 0;
+    if (m_ended) return false;
+    if (m_position >= m_length) {
+        m_ended = true;
+        return false;
+    }
+    // A record of another input is left in place: the playback has diverged
+    uint8_t header = m_journal[m_position];
+    if (header >> 5 != (uint8_t)tag) {
+        m_ended = true;
+        m_diverged = true;
+        return false;
+    }
+    m_position++;
+
+    value = header & VARINT;
+    if (value < VARINT) return true;
+    value = 0;
+    uint8_t byte;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (!takeByte(byte)) return false;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    m_ended = true; // Malformed varint
+    m_diverged = true;
+    return false;
+}
+
+uint32_t InputJournal::clock(JournalTag tag, uint32_t now) {
+    uint32_t& last = tag == JournalTag::MILLIS ? m_lastMillis : m_lastMicros;
+    if (m_mode == Mode::RECORDING) {
+        putRecord(tag, now - last); // Wraps around with the clock
+        last = now;
+    } else if (m_mode == Mode::PLAYBACK) {
+        uint32_t delta;
+        if (takeRecord(tag, delta)) last += delta; // Stands still at the end
+        now = last;
+    }
+    return now;
+}
+
+uint8_t InputJournal::pin(uint8_t level) {
+    if (m_mode == Mode::RECORDING) {
+        putRecord(JournalTag::PIN, level);
+    } else if (m_mode == Mode::PLAYBACK) {
+        uint32_t value;
+        level = takeRecord(JournalTag::PIN, value) ? (uint8_t)value : HIGH;
+    }
+    return level;
+}
+
+bool InputJournal::encoder(bool ok, uint16_t& counts) {
+    if (m_mode == Mode::RECORDING) {
+        putRecord(JournalTag::ENCODER, ok ? 1 : 0);
+        if (ok) {
+            putByte((uint8_t)counts);
+            putByte((uint8_t)(counts >> 8));
+        }
+    } else if (m_mode == Mode::PLAYBACK) {
+        uint32_t value;
+        uint8_t low, high;
+        ok = takeRecord(JournalTag::ENCODER, value) && value == 1 && takeByte(low) && takeByte(high);
+        if (ok) counts = (uint16_t)(low | high << 8);
+    }
+    return ok;
+}
+
+int32_t InputJournal::stepPosition(int32_t position) {
+    if (m_mode == Mode::RECORDING) {
+        uint32_t delta = (uint32_t)position - (uint32_t)m_lastPosition;
+        putRecord(JournalTag::STEP_POSITION, delta << 1 ^ (uint32_t)((int32_t)delta >> 31)); // Zigzag
+        m_lastPosition = position;
+    } else if (m_mode == Mode::PLAYBACK) {
+        uint32_t zigzag;
+        if (takeRecord(JournalTag::STEP_POSITION, zigzag))
+            m_lastPosition = (int32_t)((uint32_t)m_lastPosition + (zigzag >> 1 ^ (0 - (zigzag & 1))));
+        position = m_lastPosition;
+    }
+    return position;
+}
+
+bool InputJournal::stepBusy(bool busy) {
+    if (m_mode == Mode::RECORDING) {
+        putRecord(JournalTag::STEP_BUSY, busy ? 1 : 0);
+    } else if (m_mode == Mode::PLAYBACK) {
+        uint32_t value;
+        busy = takeRecord(JournalTag::STEP_BUSY, value) && value == 1;
+    }
+    return busy;
+}
+
+int InputJournal::txRoom(int room) {
+    if (m_mode == Mode::RECORDING) {
+        putRecord(JournalTag::TX_ROOM, room > 0 ? (uint32_t)room : 0);
+    } else if (m_mode == Mode::PLAYBACK) {
+        uint32_t value;
+        room = takeRecord(JournalTag::TX_ROOM, value) ? (int)value : 0;
+    }
+    return room;
+}
+
+uint8_t InputJournal::rxBytes(uint8_t* bytes, uint8_t count, uint8_t capacity) {
+    if (m_mode == Mode::RECORDING) {
+        putRecord(JournalTag::RX_BYTES, count);
+        for (uint8_t i = 0; i < count; i++)
+            putByte(bytes[i]);
+    } else if (m_mode == Mode::PLAYBACK) {
+        uint32_t value;
+        count = 0;
+        if (takeRecord(JournalTag::RX_BYTES, value)) {
+            if (value > capacity) {
+                m_ended = true;
+                m_diverged = true;
+                return 0;
+            }
+            for (uint8_t i = 0; i < value && takeByte(bytes[i]); i++)
+                count++;
+        }
+    }
+    return count;
+}
+
+#ifdef USE_INPUT_JOURNAL
+
+InputJournal inputJournal;
+
+unsigned long inputMillis() {
+    return inputJournal.clock(JournalTag::MILLIS, inputJournal.isPlaying() ? 0 : millis());
+}
+
+unsigned long inputMicros() {
+    return inputJournal.clock(JournalTag::MICROS, inputJournal.isPlaying() ? 0 : micros());
+}
+
+int inputDigitalRead(uint8_t pin) {
+    return inputJournal.pin(inputJournal.isPlaying() ? 0 : digitalRead(pin));
+}
+
+bool inputEncoderRead(AMT22& encoder, uint16_t& counts) {
+    return inputJournal.encoder(inputJournal.isPlaying() ? false : encoder.readPositionRaw(counts), counts);
+}
+
+int32_t inputStepPosition(const StepEngine& engine) {
+    return inputJournal.stepPosition(inputJournal.isPlaying() ? 0 : engine.getPosition());
+}
+
+bool inputStepBusy(const StepEngine& engine) {
+    return inputJournal.stepBusy(inputJournal.isPlaying() ? false : engine.isBusy());
+}
+
+int inputTxRoom() {
+    return inputJournal.txRoom(inputJournal.isPlaying() ? 0 : Serial.availableForWrite());
+}
+
+uint8_t inputRxBatch(uint8_t* out, uint8_t maxLength) {
+    return inputJournal.rxBytes(out, inputJournal.isPlaying() ? 0 : serialRxRing.popBatch(out, maxLength), maxLength);
+}
+
+#else
+
+bool inputEncoderRead(AMT22& encoder, uint16_t& counts) {
+    return encoder.readPositionRaw(counts);
+}
+
+#endif
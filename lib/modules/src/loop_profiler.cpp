@@ -0,0 +1,61 @@
+#include "loop_profiler.h"
+
+#ifdef USE_LOOP_PROFILER
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "input_journal.h"
+
+LoopProfiler loopProfiler;
+
+LoopProfiler::LoopProfiler() {
+    reset();
+}
+
+void LoopProfiler::record(LoopPhase phase, unsigned long durationUs) {
+    PhaseStats& stats = m_stats[(uint8_t)phase];
+    uint16_t us = durationUs > 0xffff ? 0xffff : (uint16_t)durationUs;
+
+    if (us < stats.minUs) stats.minUs = us;
+    if (us > stats.maxUs) stats.maxUs = us;
+    stats.totalUs += us;
+    if (stats.count < 0xffff) stats.count++;
+    if (us > getBudgetUs(phase) && stats.overruns < 0xffff) stats.overruns++;
+}
+
+uint16_t LoopProfiler::getMeanUs(LoopPhase phase) const {
+    const PhaseStats& stats = getStats(phase);
+    return stats.count == 0 ? 0 : (uint16_t)(stats.totalUs / stats.count);
+}
+
+void LoopProfiler::reset() {
+    for (uint8_t i = 0; i < (uint8_t)LoopPhase::COUNT; i++) {
+        m_stats[i].minUs = 0xffff;
+        m_stats[i].maxUs = 0;
+        m_stats[i].totalUs = 0;
+        m_stats[i].count = 0;
+        m_stats[i].overruns = 0;
+    }
+}
+
+uint16_t LoopProfiler::getBudgetUs(LoopPhase phase) {
+    switch (phase) {
+        case LoopPhase::LOOP: return ProfilerConfig::LOOP_BUDGET_US;
+        case LoopPhase::COMM: return ProfilerConfig::COMM_BUDGET_US;
+        case LoopPhase::MONITORS: return ProfilerConfig::MONITORS_BUDGET_US;
+        case LoopPhase::CONTROL: return ProfilerConfig::CONTROL_BUDGET_US;
+        case LoopPhase::ENCODER: return ProfilerConfig::ENCODER_BUDGET_US;
+        case LoopPhase::MOTOR: return ProfilerConfig::MOTOR_BUDGET_US;
+        case LoopPhase::TELEMETRY: return ProfilerConfig::TELEMETRY_BUDGET_US;
+        default: return 0xffff;
+    }
+}
+
+PhaseProbe::PhaseProbe(LoopPhase phase) : m_phase(phase), m_startUs(inputMicros()) {}
+
+PhaseProbe::~PhaseProbe() {
+    loopProfiler.record(m_phase, inputMicros() - m_startUs);
+}
+
+#endif // USE_LOOP_PROFILER
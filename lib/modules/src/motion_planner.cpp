@@ -0,0 +1,19 @@
+#include "motion_planner.h"
+
+const RampIntervalTable rampIntervalsUs PROGMEM = RampIntervalTable();
+
+uint16_t plannedStepIntervalUs(uint16_t stepsDone, uint16_t stepsLeft) {
+    if (stepsLeft == 0) return MotionConfig::START_STEP_PERIOD_US;
+
+    // Accelerate from the start of the move, decelerate into the end of it
+    uint16_t k = stepsDone < stepsLeft - 1 ? stepsDone : stepsLeft - 1;
+    if (k >= RAMP_STEPS) return MotionConfig::MIN_STEP_PERIOD_US;
+    return pgm_read_word(&rampIntervalsUs.us[k]);
+}
+
+uint32_t plannedMoveDurationUs(uint16_t steps) {
+    uint32_t duration = 0;
+    for (uint16_t done = 0; done < steps; done++)
+        duration += plannedStepIntervalUs(done, steps - done);
+    return duration;
+}
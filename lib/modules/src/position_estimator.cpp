@@ -0,0 +1,61 @@
+#include "config.h"
+#include "position_estimator.h"
+
+typedef AngleOps<angle_t> Ops;
+
+PositionEstimator::PositionEstimator()
+    : m_initialized(false), m_anchorAngle(), m_anchorPosition(0), m_lastSampleTime(0),
+      m_mismatch(), m_consecNoMotion(0), m_consecMismatch(0) {}
+
+void PositionEstimator::reset(angle_t encoderAngle, int32_t stepPosition, unsigned long now) {
+    m_initialized = true;
+    m_anchorAngle = encoderAngle;
+    m_anchorPosition = stepPosition;
+    m_lastSampleTime = now;
+    m_mismatch = angle_t();
+    m_consecNoMotion = 0;
+    m_consecMismatch = 0;
+}
+
+angle_t PositionEstimator::estimate(int32_t stepPosition) const {
+    return m_anchorAngle + Ops::fromSteps(stepPosition - m_anchorPosition);
+}
+
+bool PositionEstimator::isSampleDue(unsigned long now) const {
+    return !m_initialized || now - m_lastSampleTime >= (unsigned long)(TimingConfig::ENCODER_SAMPLE_PERIOD_S * 1000);
+}
+
+EstimatorStatus PositionEstimator::correct(angle_t encoderAngle, int32_t stepPosition, unsigned long now) {
+    if (!m_initialized) {
+        reset(encoderAngle, stepPosition, now);
+        return EstimatorStatus::OK;
+    }
+
+    constexpr angle_t motionExpected = Ops::fromDeg(FDIRConfig::MOTION_EXPECTED_ANGLE_THRESHOLD);
+    constexpr angle_t motionDetected = Ops::fromDeg(FDIRConfig::MOTION_DETECTED_ANGLE_THRESHOLD);
+    constexpr angle_t mismatchThreshold = Ops::fromDeg(FDIRConfig::ENCODER_MISMATCH_THRESHOLD);
+
+    angle_t commanded = Ops::fromSteps(stepPosition - m_anchorPosition);
+    angle_t observed = encoderAngle - m_anchorAngle;
+    m_mismatch = observed - commanded;
+
+    // No motion check (only meaningful if we stepped far enough to see it on the encoder)
+    if (Ops::abs(commanded) >= motionExpected) {
+        if (Ops::abs(observed) <= motionDetected) m_consecNoMotion++;
+        else m_consecNoMotion = 0;
+    }
+
+    if (Ops::abs(m_mismatch) > mismatchThreshold) m_consecMismatch++;
+    else m_consecMismatch = 0;
+
+    // The encoder is the reference, so re-anchor on it
+    m_anchorAngle = encoderAngle;
+    m_anchorPosition = stepPosition;
+    m_lastSampleTime = now;
+
+    if (m_consecNoMotion >= FDIRConfig::CONSEC_NO_MOTION_THRESHOLD)
+        return EstimatorStatus::NO_MOTION;
+    if (m_consecMismatch >= FDIRConfig::CONSEC_MISMATCH_THRESHOLD)
+        return EstimatorStatus::ENCODER_MISMATCH;
+    return EstimatorStatus::OK;
+}
@@ -4,7 +4,8 @@
 #include <math.h>
 
 PressureSensor::PressureSensor() 
-    : m_consecutiveDifferenceFaults(0), m_consecutiveInvalid{0} {}
+    : m_consecutiveDifferenceFaults(0), m_consecutiveInvalid{0},
+      m_faultThreshold(SensorConfig::CONSEC_BEFORE_ERR_THRESHOLD) {}
 
 #if USE_3_PTS
 
@@ -13,9 +14,9 @@ SensorStatus PressureSensor::validateThreeSensors(float P1, float P2, float P3,
     updateConsecInvalidity(valid);
 
     if (m_consecutiveInvalid[0] > 0 && m_consecutiveInvalid[1] > 0 && m_consecutiveInvalid[2] > 0 &&
-            (m_consecutiveInvalid[0] < SensorConfig::CONSEC_BEFORE_ERR_THRESHOLD ||
-             m_consecutiveInvalid[1] < SensorConfig::CONSEC_BEFORE_ERR_THRESHOLD || 
-             m_consecutiveInvalid[2] < SensorConfig::CONSEC_BEFORE_ERR_THRESHOLD))
+            (m_consecutiveInvalid[0] < m_faultThreshold ||
+             m_consecutiveInvalid[1] < m_faultThreshold || 
+             m_consecutiveInvalid[2] < m_faultThreshold))
         return SensorStatus::PENDING_FAULT;
 
     uint8_t ok = valid[0] + (valid[1] << 1) + (valid[2] << 2);
@@ -62,7 +63,7 @@ SensorStatus PressureSensor::validateThreeSensors(float P1, float P2, float P3,
 
                     // We return THREE_ILLOGICAL even though it is ambiguous, so that we go into an error
                     // state. 
-                    return m_consecutiveDifferenceFaults >= SensorConfig::CONSEC_BEFORE_ERR_THRESHOLD ? 
+                    return m_consecutiveDifferenceFaults >= m_faultThreshold ? 
                         SensorStatus::THREE_ILLOGICAL : SensorStatus::PENDING_FAULT;
                 }
             }
@@ -108,8 +109,8 @@ SensorStatus PressureSensor::validateTwoSensors(float P1, float P2, float& chose
     updateConsecInvalidity(valid);
     
     if (m_consecutiveInvalid[0] > 0 && m_consecutiveInvalid[1] > 0 && 
-            (m_consecutiveInvalid[0] < SensorConfig::CONSEC_BEFORE_ERR_THRESHOLD ||
-             m_consecutiveInvalid[1] < SensorConfig::CONSEC_BEFORE_ERR_THRESHOLD))
+            (m_consecutiveInvalid[0] < m_faultThreshold ||
+             m_consecutiveInvalid[1] < m_faultThreshold))
         return SensorStatus::PENDING_FAULT;
 
     bool ok1 = m_consecutiveInvalid[0] == 0, ok2 = m_consecutiveInvalid[1] == 0;
@@ -138,7 +139,7 @@ SensorStatus PressureSensor::processTwoValidSensors(float P1, float P2, float& c
         m_consecutiveDifferenceFaults++;
         
         // Only trigger fault after consecutive threshold is reached
-        if (m_consecutiveDifferenceFaults >= SensorConfig::CONSEC_BEFORE_ERR_THRESHOLD)
+        if (m_consecutiveDifferenceFaults >= m_faultThreshold)
             return SensorStatus::TWO_ILLOGICAL;
         else
             return SensorStatus::PENDING_FAULT;
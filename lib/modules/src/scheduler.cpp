@@ -0,0 +1,90 @@
+#include "assert_own.h"
+#include "scheduler.h"
+
+static void saturatingAdd(uint16_t& counter, unsigned long value) {
+    counter = value >= 0xffffUL - counter ? 0xffff : counter + value;
+}
+
+static void keepMax(uint16_t& max, unsigned long value) {
+    if (value > max) max = value > 0xffff ? 0xffff : (uint16_t)value;
+}
+
+TaskScheduler::TaskScheduler(ClockFn clock) : m_clock(clock), m_tasks(), m_numTasks(0) {}
+
+int8_t TaskScheduler::addTask(TaskFn run, unsigned long periodUs) {
+    assert(run != nullptr);
+    if (m_numTasks >= MAX_TASKS)
+        return -1;
+
+    Task& task = m_tasks[m_numTasks];
+    task.run = run;
+    task.periodUs = periodUs;
+    task.nextReleaseUs = 0;
+    task.lastReleaseUs = 0;
+    task.stats = SchedulerTaskStats();
+    return m_numTasks++;
+}
+
+void TaskScheduler::start() {
+    unsigned long now = m_clock();
+    for (uint8_t i = 0; i < m_numTasks; i++) {
+        m_tasks[i].nextReleaseUs = now;
+        m_tasks[i].lastReleaseUs = now;
+    }
+}
+
+void TaskScheduler::runPending() {
+    for (uint8_t i = 0; i < m_numTasks; i++) {
+        Task& task = m_tasks[i];
+        unsigned long start = m_clock();
+
+        if (task.periodUs == 0) {
+            task.lastReleaseUs = start;
+        } else {
+            // Signed difference, so that this keeps working when micros() wraps around
+            if ((long)(start - task.nextReleaseUs) < 0)
+                continue;
+
+            task.lastReleaseUs = task.nextReleaseUs;
+            task.nextReleaseUs += task.periodUs;
+
+            // Skip (and count) the releases we are too late for
+            if ((long)(start - task.nextReleaseUs) >= 0) {
+                unsigned long missed = (start - task.nextReleaseUs) / task.periodUs + 1;
+                saturatingAdd(task.stats.overruns, missed);
+                task.lastReleaseUs += missed * task.periodUs;
+                task.nextReleaseUs += missed * task.periodUs;
+            }
+
+            keepMax(task.stats.maxLatencyUs, start - task.lastReleaseUs);
+        }
+
+        task.run();
+        saturatingAdd(task.stats.runs, 1);
+        keepMax(task.stats.maxRunUs, m_clock() - start);
+    }
+}
+
+unsigned long TaskScheduler::getNextReleaseUs(unsigned long now) const {
+    unsigned long wait = (unsigned long)-1 >> 1; // No periodic task
+    for (uint8_t i = 0; i < m_numTasks; i++) {
+        if (m_tasks[i].periodUs == 0) continue;
+        long until = (long)(m_tasks[i].nextReleaseUs - now);
+        if (until <= 0) return now;
+        if ((unsigned long)until < wait) wait = until;
+    }
+    return now + wait;
+}
+
+bool TaskScheduler::isDue(unsigned long now) const {
+    for (uint8_t i = 0; i < m_numTasks; i++) {
+        if (m_tasks[i].periodUs == 0 || (long)(now - m_tasks[i].nextReleaseUs) >= 0)
+            return true;
+    }
+    return false;
+}
+
+void TaskScheduler::resetStats() {
+    for (uint8_t i = 0; i < m_numTasks; i++)
+        m_tasks[i].stats = SchedulerTaskStats();
+}
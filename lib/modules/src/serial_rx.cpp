@@ -0,0 +1,3 @@
+#include "serial_rx.h"
+
+SerialRxRing serialRxRing;
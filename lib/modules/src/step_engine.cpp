@@ -0,0 +1,75 @@
+#include "assert_own.h"
+#include "atomic_own.h"
+#include "config.h"
+#include "motion_planner.h"
+#include "step_engine.h"
+
+StepEngine::StepEngine() : m_hooks(nullptr), m_stepsRemaining(0), m_position(0), m_stepsDone(0), m_reverse(false) {}
+
+void StepEngine::begin(const StepEngineHooks* hooks) {
+    m_hooks = hooks;
+}
+
+bool StepEngine::start(uint16_t steps, bool reverse) {
+    assert(m_hooks != nullptr);
+    if (m_hooks == nullptr || steps == 0 || isBusy())
+        return false;
+
+    m_hooks->setDirection(reverse);
+    ATOMIC_SECTION {
+        m_stepsRemaining = steps;
+        m_stepsDone = 0;
+        m_reverse = reverse;
+    }
+    m_hooks->timerStart(plannedStepIntervalUs(0, steps));
+    return true;
+}
+
+void StepEngine::stop() {
+    if (m_hooks != nullptr)
+        m_hooks->timerStop();
+    ATOMIC_SECTION {
+        m_stepsRemaining = 0;
+    }
+}
+
+bool StepEngine::isBusy() const {
+    return stepsRemaining() != 0;
+}
+
+uint16_t StepEngine::stepsRemaining() const {
+    uint16_t remaining;
+    ATOMIC_SECTION {
+        remaining = m_stepsRemaining;
+    }
+    return remaining;
+}
+
+int32_t StepEngine::getPosition() const {
+    int32_t position;
+    ATOMIC_SECTION {
+        position = m_position;
+    }
+    return position;
+}
+
+void StepEngine::onTimerCompare() {
+    // Interrupts are already disabled in the ISR, so the shared members can be accessed directly
+    if (m_stepsRemaining == 0) {
+        m_hooks->timerStop();
+        return;
+    }
+
+    m_hooks->pulse();
+    m_position += m_reverse ? -1 : 1;
+    m_stepsDone++;
+    if (--m_stepsRemaining == 0)
+        m_hooks->timerStop();
+    else
+        m_hooks->timerSetPeriod(plannedStepIntervalUs(m_stepsDone, m_stepsRemaining));
+}
+
+void StepEngine::setIsrMasked(bool masked) {
+    if (m_hooks != nullptr)
+        m_hooks->setIsrMasked(masked);
+}
@@ -0,0 +1,95 @@
+#include <string.h>
+
+#include "comm_handler.h"
+#include "crc16_xmodem.h"
+#include "telemetry_decoder.h"
+
+// The offsets below assume packets without padding
+static_assert(TELPKT_SIZE == 8 + 4 * (5 + USE_3_PTS) + 4 + 16 + 12, "Unexpected telemetry packet layout");
+static_assert(CTELPKT_SIZE == 8 + 4 + 2 * 6 + 4 + 16 + 12, "Unexpected compact telemetry packet layout");
+
+static uint16_t readU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t readU32(const uint8_t* p) {
+    return (uint32_t)readU16(p) | ((uint32_t)readU16(p + 2) << 16);
+}
+
+static float readFloat(const uint8_t* p) {
+    uint32_t bits = readU32(p);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static float readScaled(const uint8_t* p, float scale) {
+    return (int16_t)readU16(p) / scale;
+}
+
+TelemetryDecodeResult decodeTelemetryPacket(const uint8_t* packet, size_t length, TelemetrySample& sample) {
+    if (length < 4)
+        return TelemetryDecodeResult::TOO_SHORT;
+
+    uint16_t magic = readU16(packet);
+    size_t size;
+    if (magic == MAGIC_START) size = TELPKT_SIZE;
+    else if (magic == MAGIC_COMPACT) size = CTELPKT_SIZE;
+    else return TelemetryDecodeResult::BAD_MAGIC;
+
+    if (length < size)
+        return TelemetryDecodeResult::TOO_SHORT;
+    if (readU16(packet + 2) != crc16Xmodem(packet + 4, size - 4))
+        return TelemetryDecodeResult::BAD_CHECKSUM;
+
+    sample.compact = magic == MAGIC_COMPACT;
+    sample.systemState = (SystemStateEnum)packet[4];
+    sample.flags = packet[5];
+    sample.faults = packet[6];
+
+    const uint8_t* p = packet + 8;
+    if (sample.compact) {
+        sample.timestampMs = readU32(p);
+        sample.motorAngle = readScaled(p + 4, CTELPKT_ANGLE_SCALE);
+        sample.deltaAngle = readScaled(p + 6, CTELPKT_ANGLE_SCALE);
+        sample.intError = readScaled(p + 8, CTELPKT_INTEGRAL_SCALE);
+        sample.pt1Reading = readScaled(p + 10, CTELPKT_PRESSURE_SCALE);
+        sample.pt2Reading = readScaled(p + 12, CTELPKT_PRESSURE_SCALE);
+        sample.pt3Reading = readScaled(p + 14, CTELPKT_PRESSURE_SCALE);
+        p += 16;
+    } else {
+        sample.timestampMs = 0;
+        sample.motorAngle = readFloat(p);
+        sample.deltaAngle = readFloat(p + 4);
+        sample.intError = readFloat(p + 8);
+        sample.pt1Reading = readFloat(p + 12);
+        sample.pt2Reading = readFloat(p + 16);
+        p += 20;
+#if USE_3_PTS
+        sample.pt3Reading = readFloat(p);
+        p += 4;
+#else
+        sample.pt3Reading = 0.0f;
+#endif
+    }
+
+    sample.txSent = readU16(p);
+    sample.txCoalesced = p[2];
+    sample.txDropped = p[3];
+    sample.sequence = readU16(p + 4);
+
+    p += 6;
+    sample.link.received = readU16(p);
+    sample.link.lastSequence = readU16(p + 2);
+    sample.link.lost = readU16(p + 4);
+    sample.link.duplicates = readU16(p + 6);
+    sample.link.crcErrors = readU16(p + 8);
+    sample.link.resyncs = readU16(p + 10);
+    sample.link.jitterUs = readU16(p + 12);
+
+    p += 14;
+    sample.piTimestampEcho = readU32(p);
+    sample.sampleRxUs = readU32(p + 4);
+    sample.txUs = readU32(p + 8);
+    return TelemetryDecodeResult::OK;
+}
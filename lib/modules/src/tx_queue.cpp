@@ -0,0 +1,85 @@
+#include "assert_own.h"
+#include "tx_queue.h"
+
+TxQueue::TxQueue(const TxHooks* hooks) : m_hooks(hooks), m_slots(), m_numSlots(0), m_current(-1),
+                                         m_currentSent(0), m_queueCounter(0), m_stats() {}
+
+int8_t TxQueue::addSlot(uint8_t* buffer, uint8_t capacity, TxPolicy policy) {
+    assert(buffer != nullptr);
+    if (m_numSlots >= MAX_SLOTS)
+        return -1;
+
+    Slot& slot = m_slots[m_numSlots];
+    slot.buffer = buffer;
+    slot.capacity = capacity;
+    slot.policy = policy;
+    slot.length = 0;
+    slot.queuedAt = 0;
+    return m_numSlots++;
+}
+
+uint8_t* TxQueue::beginFrame(int8_t id) {
+    assert(id >= 0 && id < m_numSlots);
+    Slot& slot = m_slots[id];
+    if (slot.length == 0)
+        return slot.buffer;
+
+    // The slot still holds an unsent frame, which cannot be replaced once it is going out
+    if (slot.policy == TxPolicy::COALESCE && (id != m_current || m_currentSent == 0)) {
+        slot.length = 0;
+        m_stats.coalesced++;
+        return slot.buffer;
+    }
+    m_stats.dropped++;
+    return nullptr;
+}
+
+void TxQueue::commit(int8_t id, uint8_t length) {
+    assert(id >= 0 && id < m_numSlots && length <= m_slots[id].capacity);
+    Slot& slot = m_slots[id];
+    slot.length = length;
+    slot.queuedAt = m_queueCounter++;
+}
+
+int8_t TxQueue::oldestPending() const {
+    int8_t oldest = -1;
+    for (uint8_t i = 0; i < m_numSlots; i++) {
+        if (m_slots[i].length == 0) continue;
+        // Age relative to the counter, so that this keeps working when it wraps around
+        if (oldest < 0 || (uint8_t)(m_queueCounter - m_slots[i].queuedAt) > (uint8_t)(m_queueCounter - m_slots[oldest].queuedAt))
+            oldest = i;
+    }
+    return oldest;
+}
+
+void TxQueue::pump() {
+    while (true) {
+        if (m_current < 0) {
+            m_current = oldestPending();
+            m_currentSent = 0;
+            if (m_current < 0) return;
+        }
+
+        Slot& slot = m_slots[m_current];
+        int room = m_hooks->availableForWrite();
+        if (room <= 0) return;
+
+        uint8_t chunk = slot.length - m_currentSent;
+        if (room < chunk) chunk = (uint8_t)room;
+        m_currentSent += m_hooks->write(slot.buffer + m_currentSent, chunk);
+        if (m_currentSent < slot.length) return;
+
+        slot.length = 0;
+        m_current = -1;
+        m_stats.sent++;
+    }
+}
+
+bool TxQueue::isPending(int8_t id) const {
+    assert(id >= 0 && id < m_numSlots);
+    return m_slots[id].length != 0;
+}
+
+bool TxQueue::isIdle() const {
+    return m_current < 0 && oldestPending() < 0;
+}
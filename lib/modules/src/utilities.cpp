@@ -2,11 +2,10 @@
 #include <math.h>
 
 #include "config.h"
+#include "input_journal.h"
+#include "loop_profiler.h"
 #include "utilities.h"
 
-// Encoder calibration constant (system-specific)
-const float FULLY_CLOSED_OFFSET = fmod((HardwareConfig::FULLY_OPEN_OFFSET - 90.0f + 360.0f), 360.0f); 
-
 /* IMPORTANT: 
  * - MPV_CONTROL informs the bunker whether we should close MPV manually
  * - MPV_STATE is the state of MPV told to the motor controller by the Pi
@@ -15,36 +14,104 @@ bool MPV_CONTROL = false;
 bool MPV_STATE = false;
 
 // Encoder utility functions
-float getEncoderAngle() {
-    uint16_t encoderVal;
-    uint8_t attempts = 0;
+bool readEncoderCounts(uint16_t& counts) {
+    PROFILE_PHASE(LoopPhase::ENCODER);
 
-    do {
-        encoderVal = encoder->getPositionSPI();
-        delayMicroseconds(40); // Ensure time between reads
-    } while (encoderVal == 0xFFFF && ++attempts < 3);
+    // The encoder waits out the minimum time between reads itself, so retries need no extra delay
+    for (uint8_t attempts = 0; attempts < 3; attempts++) {
+        StepIsrGuard guard(stepEngine); // The stepper driver shares the SPI bus
+        if (inputEncoderRead(*encoder, counts))
+            return true;
+    }
+    return false;
+}
+
+angle_t getEncoderAngle() {
+    uint16_t encoderVal;
 
-    if (encoderVal == 0xFFFF) {
-        Serial.println("Encoder error: Invalid data after 3 attempts.");
+    // Reported by the STATE_CHANGE event and faults.encoderMismatch (set by the callers). Nothing is
+    // written to Serial directly, as that would block loop() and land inside the frames of the TX queue
+    if (!readEncoderCounts(encoderVal)) {
         systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-        return -1; // Fails isAngleValid check
+        return degToAngle(-1.0f); // Fails isAngleValid check
         // while (1); // Halt execution here for debugging purposes
     }
 
-    // Convert raw encoder value to degrees
-    float rawAngle = ((float)encoderVal / HardwareConfig::MAX_12_BIT_VAL) * 360.0f;
-    float adjustedAngle = rawAngle - FULLY_CLOSED_OFFSET;
+    // Convert raw encoder value to an angle from fully closed
+    return AngleOps<angle_t>::fromCounts(encoderVal);
+}
+
+void sampleEncoder(EncoderSample& sample) {
+    sample.stepPosition = inputStepPosition(stepEngine);
+    sample.angle = getEncoderAngle();
+    sample.timeUs = inputMicros();
+}
 
-    if (adjustedAngle < 0.0f) {
-        adjustedAngle += 360.0f;
+/*
+ * Estimated valve angle from the step count (see position_estimator.h). The estimate is only
+ * corrected against the encoder when a correction is due, using this tick's encoder sample, or
+ * always with a fresh sample if freshSample is set (e.g. after a move). Like getEncoderAngle(),
+ * this returns an angle which fails isAngleValid() if the encoder read fails or disagrees with
+ * the commanded steps.
+ */
+angle_t getValveAngle(bool freshSample) {
+    unsigned long now = inputMillis();
+    if (freshSample || positionEstimator.isSampleDue(now)) {
+        const EncoderSample& sample = freshSample ? encoderSampler.fresh() : encoderSampler.get();
+        if (!isAngleValid(sample.angle))
+            return sample.angle;
+
+        switch (positionEstimator.correct(sample.angle, sample.stepPosition, now)) {
+            case EstimatorStatus::NO_MOTION:
+                faults.noMotion = true;
+                setMPV(false);
+                systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+                break;
+            case EstimatorStatus::ENCODER_MISMATCH:
+                setMPV(false);
+                systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
+                return degToAngle(-1.0f); // Fails isAngleValid check, so the caller flags faults.encoderMismatch
+            default: break;
+        }
     }
 
-    return adjustedAngle;
+    return positionEstimator.estimate(inputStepPosition(stepEngine));
+}
+
+// Motor control functions
+
+/*
+ * Non-blocking: starts a move towards targetAngle on the step engine and returns
+ * immediately. While the previous move is still stepping, this does nothing. Motion is
+ * verified against the encoder by the position estimator (see getValveAngle()).
+ */
+void serviceSingleMotor(StepEngine& engine,
+                               angle_t currentAngle,
+                               angle_t targetAngle) {
+    constexpr angle_t deadband = degToAngle(MotorControlConfig::ANGLE_DEADBAND_DEG);
+    if (inputStepBusy(engine)) return;
+
+    angle_t err = targetAngle - currentAngle;
+    if (AngleOps<angle_t>::abs(err) <= deadband) return;
+
+    // Proportional steps
+    long steps = AngleOps<angle_t>::toSteps(err);
+    if (steps == 0) return;
+
+    // Direction and stepping (the steps themselves are emitted from the step timer ISR)
+    engine.start((uint16_t)labs(steps), steps < 0);
 }
 
-bool isAngleValid(float angle) {
-    // Angle must be in [0, 360) and not error value
-    return (angle >= 0.0f && angle < 360.0f);
+void serviceMotor() {
+    PROFILE_PHASE(LoopPhase::MOTOR);
+    if (inputStepBusy(stepEngine) || systemState.currentState == SystemStateEnum::EMERGENCY_STOP) return;
+
+    // Plan the next move from a sample taken after the previous one completed
+    angle_t cur = getValveAngle(true);
+    if (!isAngleValid(cur)) return;
+
+    angle_t tgt = channel.targetAngle;
+    serviceSingleMotor(stepEngine, cur, tgt);
 }
 
 // System utility functions
@@ -62,22 +129,7 @@ SensorStatus readManifoldPressures(float& pressure) {
 }
 
 bool isManualAbortPressed() {
-    return digitalRead(HardwareConfig::MANUAL_ABORT_PIN) == LOW;
-}
-
-void applyMoveFilter(float& deltaAngle) {
-    // Apply move filter scale and angle cap
-    deltaAngle *= ValveConfig::MOVE_FILTER_SCALE;
-    
-    if (deltaAngle > ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE) {
-        deltaAngle = ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE;
-    } else if (deltaAngle < -ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE) {
-        deltaAngle = -ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE;
-    }
-}
-
-float constrainAngle(float angle) {
-    return constrain(angle, ValveConfig::MIN_VALVE_ANGLE, ValveConfig::MAX_VALVE_ANGLE);
+    return inputDigitalRead(HardwareConfig::MANUAL_ABORT_PIN) == LOW;
 }
 
 /* 
@@ -97,23 +149,90 @@ bool getMPVState() {
     return MPV_STATE;
 }
 
+// Released at TELEMETRY_RATE_HZ by the task scheduler (see main.cpp)
 void publishTelemetry() {
-    static unsigned long lastTelemetryTime = 0;
-    
-    if (millis() - lastTelemetryTime > (1000.0f / CommConfig::TELEMETRY_RATE_HZ)) {
-        // if closeMPV is true, close MPV
-        bool closeMPV = !MPV_CONTROL;
-
-        // Send telemetry for single system: "T,state,angle,pid_error,system_type,close_mpv"
-        // Note: We modify the telemetry format to indicate which system this is
-        commHandler->sendTelemetry(systemState.currentState,
-                                  channel.currentAngle,
-                                  controller->getError(),
-                                  controller->getIntegral(),
-                                  HardwareConfig::SYSTEM_NAME,
-                                  closeMPV);
-
-        lastTelemetryTime = millis();
+    PROFILE_PHASE(LoopPhase::TELEMETRY);
+
+    // if closeMPV is true, close MPV
+    bool closeMPV = !MPV_CONTROL;
+
+    // Send telemetry for single system: "T,state,angle,pid_error,system_type,close_mpv"
+    // Note: We modify the telemetry format to indicate which system this is
+    commHandler->sendTelemetry(systemState.currentState,
+                              angleToDeg(channel.currentAngle),
+                              numericCast<float>(controller->getError()),
+                              numericCast<float>(controller->getIntegral()),
+                              HardwareConfig::SYSTEM_NAME,
+                              closeMPV);
+}
+
+void sendStateChangeEvent(SystemStateEnum from, SystemStateEnum to) {
+    commHandler->queueEvent(EventType::STATE_CHANGE, from, to, CommHandler::telemetryFaults());
+}
+
+// Runtime commands (see comm_handler.h). Each returns the value now in effect
+static float setKp(float kp) {
+    controller->setKp(kp);
+    return numericCast<float>(controller->getKp());
+}
+
+static float setKi(float ki) {
+    controller->setKi(ki);
+    return numericCast<float>(controller->getKi());
+}
+
+static float setKd(float kd) {
+    controller->setKd(kd);
+    return numericCast<float>(controller->getKd());
+}
+
+static float setTargetPressure(float psi) {
+    tunables.targetPressurePsi = psi;
+    return psi;
+}
+
+static float setRedbandUpper(float psi) {
+    tunables.redbandUpperPsi = psi;
+    return psi;
+}
+
+static float setRedbandLower(float psi) {
+    tunables.redbandLowerPsi = psi;
+    return psi;
+}
+
+static float setMaxAngleChange(float deg) {
+    tunables.maxAngleChange = degToAngle(deg);
+    return angleToDeg(tunables.maxAngleChange);
+}
+
+static float setMoveFilterScale(float scale) {
+    tunables.moveFilterScale = scaleToQ8(scale);
+    return scaleFromQ8(tunables.moveFilterScale);
+}
+
+const CommandSpec tuningCommands[] PROGMEM = {
+    { CommandType::SET_KP, CommandConfig::GAIN_MIN, CommandConfig::GAIN_MAX, setKp },
+    { CommandType::SET_KI, CommandConfig::GAIN_MIN, CommandConfig::GAIN_MAX, setKi },
+    { CommandType::SET_KD, CommandConfig::GAIN_MIN, CommandConfig::GAIN_MAX, setKd },
+    { CommandType::SET_TARGET_PRESSURE, CommandConfig::TARGET_PRESSURE_MIN_PSI, CommandConfig::TARGET_PRESSURE_MAX_PSI, setTargetPressure },
+    { CommandType::SET_REDBAND_UPPER, CommandConfig::REDBAND_MIN_PSI, CommandConfig::REDBAND_MAX_PSI, setRedbandUpper },
+    { CommandType::SET_REDBAND_LOWER, CommandConfig::REDBAND_MIN_PSI, CommandConfig::REDBAND_MAX_PSI, setRedbandLower },
+    { CommandType::SET_MAX_ANGLE_CHANGE, CommandConfig::MAX_ANGLE_CHANGE_MIN, CommandConfig::MAX_ANGLE_CHANGE_MAX, setMaxAngleChange },
+    { CommandType::SET_MOVE_FILTER_SCALE, CommandConfig::MOVE_FILTER_SCALE_MIN, CommandConfig::MOVE_FILTER_SCALE_MAX, setMoveFilterScale }
+};
+const uint8_t NUM_TUNING_COMMANDS = sizeof(tuningCommands) / sizeof(tuningCommands[0]);
+
+// Records the control tick that just ran, and freezes the recorder on entering a fault state
+void recordControlTick() {
+    flightRecorder.record(FlightRecorder::pack(inputMillis(), channel.pressure, channel.error,
+                                               numericCast<float>(controller->getError()),
+                                               angleToDeg(channel.targetAngle), angleToDeg(channel.currentAngle),
+                                               systemState.currentState, CommHandler::telemetryFaults()));
+
+    if (systemState.currentState == SystemStateEnum::FORCED_OPEN_LOOP ||
+        systemState.currentState == SystemStateEnum::EMERGENCY_STOP) {
+        flightRecorder.freeze();
     }
 }
 
@@ -146,6 +265,9 @@ void resetSystemOnMpvCycle() {
     faults.noMotion = preserveMotionFault;
     faults.manualAbort = preserveManualAbort;
     
+    // Record the next run (a dump of the last fault is long sent by the time the MPV cycles)
+    flightRecorder.rearm();
+
     // Transition to OPEN_LOOP_INIT state to restart
     systemState.changeStateTo(SystemStateEnum::OPEN_LOOP_INIT);
 }
@@ -161,23 +283,19 @@ bool isValidState(SystemStateEnum s) {
     return false;
 }
 
-bool isAtStartAngle(float currentAngle) {
-    return fabs(currentAngle - ValveConfig::START_ANGLE) <= ValveConfig::ANGLE_TOLERANCE;
-}
-
 bool checkRedBand(float pressure) {    
-    if (pressure > ControllerConfig::TARGET_PRESSURE_PSI + MotorControlConfig::REDBAND_PRESSURE_UPPER) {
+    if (pressure > tunables.targetPressurePsi + tunables.redbandUpperPsi) {
         return false;
     }
     
-    if (pressure < ControllerConfig::TARGET_PRESSURE_PSI - MotorControlConfig::REDBAND_PRESSURE_LOWER) {
+    if (pressure < tunables.targetPressurePsi - tunables.redbandLowerPsi) {
         return false;
     }
     
     return true;
 }
 
-SystemStateEnum getSyncedState(SystemStateEnum currentState, SystemStateEnum otherControllerState, float currentAngle) {
+SystemStateEnum getSyncedState(SystemStateEnum currentState, SystemStateEnum otherControllerState, angle_t currentAngle) {
     // Priority order: STOP > OPENF > CLOSED > OPENI
     
     // EMERGENCY_STOP is a terminal state - cannot transition out automatically
@@ -196,7 +314,7 @@ SystemStateEnum getSyncedState(SystemStateEnum currentState, SystemStateEnum oth
         if (currentState == SystemStateEnum::CLOSED_LOOP) {
             return SystemStateEnum::FORCED_OPEN_LOOP;
         }
-        if (currentState == SystemStateEnum::OPEN_LOOP_INIT && isAtStartAngle(currentAngle) && (millis() - systemState.preClosedLoopTimer >= (TimingConfig::SAFE_TIMER_S * 1000UL))) {
+        if (currentState == SystemStateEnum::OPEN_LOOP_INIT && isAtStartAngle(currentAngle) && (inputMillis() - systemState.preClosedLoopTimer >= (TimingConfig::SAFE_TIMER_S * 1000UL))) {
             return SystemStateEnum::FORCED_OPEN_LOOP;
         }
     }
@@ -204,7 +322,7 @@ SystemStateEnum getSyncedState(SystemStateEnum currentState, SystemStateEnum oth
     // Rule 3: If other controller is in CLOSED and current is in OPENI, move to CLOSED
     // But only if OPENI is at start angle
     if (otherControllerState == SystemStateEnum::CLOSED_LOOP) {
-        if (currentState == SystemStateEnum::OPEN_LOOP_INIT && isAtStartAngle(currentAngle) && (millis() - systemState.preClosedLoopTimer >= (TimingConfig::SAFE_TIMER_S * 1000UL))) {
+        if (currentState == SystemStateEnum::OPEN_LOOP_INIT && isAtStartAngle(currentAngle) && (inputMillis() - systemState.preClosedLoopTimer >= (TimingConfig::SAFE_TIMER_S * 1000UL))) {
             return SystemStateEnum::CLOSED_LOOP;
         }
     }
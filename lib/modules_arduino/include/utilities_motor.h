@@ -3,10 +3,7 @@
 
 #include <HighPowerStepperDriver.h>
 
+// The stepper driver behind the motor driver functions of hardware.h
 extern HighPowerStepperDriver stepperDriver;
 
-// Motor control functions
-void serviceMotor();
-void serviceSingleMotor(HighPowerStepperDriver& drv, float currentAngleDeg, float targetAngleDeg);
-
-#endif // UTILITIES_MOTOR_H
\ No newline at end of file
+#endif // UTILITIES_MOTOR_H
@@ -0,0 +1,13 @@
+#include "hardware.h"
+
+#ifdef USE_INPUT_JOURNAL
+
+#include "utilities.h"
+
+// The journal starts before commHandler exists, but its first chunk only fills up later
+void journalWrite(const uint8_t* data, uint8_t length) {
+    if (commHandler != nullptr)
+        commHandler->sendJournalChunk(data, length);
+}
+
+#endif
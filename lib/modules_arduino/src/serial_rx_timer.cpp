@@ -0,0 +1,30 @@
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#include "config.h"
+#include "hardware.h"
+#include "serial_rx.h"
+
+// The core owns the USART RX vector, so its buffer is drained from Timer2 instead (which
+// the firmware does not otherwise use). Timer2 runs at clk/64, i.e. 4 us per tick on the Uno
+static constexpr uint32_t TIMER2_DRAIN_TICKS = (uint32_t)CommConfig::RX_DRAIN_PERIOD_US * (F_CPU / 1000000UL) / 64;
+static_assert(TIMER2_DRAIN_TICKS >= 1 && TIMER2_DRAIN_TICKS <= 256, "RX drain period out of range for Timer2 at clk/64");
+
+void serialRxBegin() {
+    TCCR2A = _BV(WGM21);                // CTC mode on OCR2A
+    TCCR2B = 0;
+    TCNT2 = 0;
+    OCR2A = TIMER2_DRAIN_TICKS - 1;
+    TIFR2 = _BV(OCF2A);
+    TIMSK2 |= _BV(OCIE2A);
+    TCCR2B = _BV(CS22);                 // clk/64
+}
+
+ISR(TIMER2_COMPA_vect) {
+    // Interrupts are disabled here, so this does not race with the consumer of Serial's buffer
+    // (there is none besides this ISR) and Serial.read() never blocks
+    int c;
+    while ((c = Serial.read()) >= 0)
+        serialRxRing.push((uint8_t)c);
+}
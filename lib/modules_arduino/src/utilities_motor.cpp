@@ -1,62 +1,75 @@
-#include <math.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
 
 #include "config.h"
+#include "loop_profiler.h"
 #include "utilities_motor.h"
 #include "utilities.h"
 
-extern CommHandler* commHandler;
-
-// Motor control functions
-void serviceSingleMotor(HighPowerStepperDriver& drv,
-                               float currentAngleDeg,
-                               float targetAngleDeg) {
-    float errDeg = targetAngleDeg - currentAngleDeg;
-    static int noMotionCount = 0;
-
-    while (fabs(errDeg) > MotorControlConfig::ANGLE_DEADBAND_DEG){
-        // Proportional steps
-        float desiredSteps = MotorControlConfig::KP_STEPS_PER_DEG * errDeg;
-        long steps = lroundf(desiredSteps);
-        float angleBeforeMove = getEncoderAngle();
-
-        // Direction and stepping
-        if (steps == 0) return;
-        drv.setDirection(steps > 0 ? 0 : 1);
-        long n = labs(steps);
-
-        // Move motor
-        for (long i = 0; i < n; ++i) {
-            drv.step();
-            delayMicroseconds(HardwareConfig::STEP_PERIOD_US);
-        }
-
-        // No motion check
-        bool motionDetected = fabs(getEncoderAngle() - angleBeforeMove) > FDIRConfig::MOTION_DETECTED_ANGLE_THRESHOLD;
-
-        if (!motionDetected) {
-            noMotionCount++;
-            if (noMotionCount >= 3){
-                faults.noMotion = true;
-                setMPV(false);
-                systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-                return;
-            }
-        } else {
-            noMotionCount = 0;
-        }
-
-        errDeg = targetAngleDeg - getEncoderAngle();
-    }
-
-#ifndef PIO_UNIT_TESTING
-    // Discard half-received PT update packet (if any)
-    commHandler->flushInputBuffer();
-#endif
-}
-
-void serviceMotor() {
-    float cur = getEncoderAngle();
-
-    float tgt = channel.targetAngle;
-    serviceSingleMotor(stepperDriver, cur, tgt);
-}
\ No newline at end of file
+HighPowerStepperDriver stepperDriver;
+
+// Timer1 runs at clk/8, i.e. 2 ticks per microsecond on the 16 MHz Uno
+static constexpr uint16_t TIMER1_TICKS_PER_US = F_CPU / 8 / 1000000UL;
+
+// Step engine hooks
+static void timer1Start(uint16_t periodUs) {
+    TCCR1A = 0;
+    TCCR1B = 0;
+    TCNT1 = 0;
+    OCR1A = periodUs * TIMER1_TICKS_PER_US - 1;
+    TIFR1 = _BV(OCF1A);                 // Clear any stale compare match
+    TCCR1B = _BV(WGM12) | _BV(CS11);    // CTC mode on OCR1A, clk/8
+    TIMSK1 |= _BV(OCIE1A);
+}
+
+static void timer1SetPeriod(uint16_t periodUs) {
+    // Called right after a compare match (TCNT1 has just been cleared), so this takes
+    // effect from the next step onwards
+    OCR1A = periodUs * TIMER1_TICKS_PER_US - 1;
+}
+
+static void timer1Stop() {
+    TIMSK1 &= ~_BV(OCIE1A);
+    TCCR1B = 0;
+}
+
+static void timer1SetIsrMasked(bool masked) {
+    // A compare match while masked leaves OCF1A set, so the step is only delayed, not lost
+    if (masked) TIMSK1 &= ~_BV(OCIE1A);
+    else if (TCCR1B != 0) TIMSK1 |= _BV(OCIE1A);
+}
+
+static void driverSetDirection(bool reverse) {
+    stepperDriver.setDirection(reverse);
+}
+
+static void driverPulse() {
+    stepperDriver.step();
+}
+
+const StepEngineHooks stepperDriverHooks = {
+    timer1Start,
+    timer1SetPeriod,
+    timer1Stop,
+    timer1SetIsrMasked,
+    driverSetDirection,
+    driverPulse
+};
+
+ISR(TIMER1_COMPA_vect) {
+    stepEngine.onTimerCompare();
+}
+
+void motorDriverBegin() {
+    stepperDriver.setChipSelectPin(HardwareConfig::MOTOR_CS_PIN);
+    stepperDriver.resetSettings();
+    stepperDriver.clearStatus();
+    stepperDriver.setDecayMode(HPSDDecayMode::AutoMixed);
+    stepperDriver.setCurrentMilliamps36v4(HardwareConfig::MOTOR_CURRENT_MA);
+    stepperDriver.setStepMode(HPSDStepMode::MicroStep1);
+    stepperDriver.enableDriver();
+}
+
+void disableMotorDriver() {
+    stepperDriver.disableDriver();
+}
@@ -0,0 +1,71 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The part of the Arduino API that the firmware uses, for the simulator (env:sim). The clock is
+ * virtual (see SimClock in sim_hardware.h): it only moves when the simulator advances it, or by
+ * the delays the firmware itself waits. The pins, SPI and Serial reach the simulated hardware.
+ */
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define PIN_SPI_MOSI 11
+#define PIN_SPI_MISO 12
+#define PIN_SPI_SCK 13
+
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+// The serial link to the Pi. Transmitted bytes go out at CommConfig::BAUD_RATE through a TX
+// buffer of the same size as the Arduino core's; received bytes are put straight into
+// serialRxRing by the simulated Pi, so read() never returns anything. There is no print(): the
+// firmware only sends packets, through CommHandler's TX queue
+class SimSerial {
+public:
+    static constexpr int TX_BUFFER_SIZE = 64;
+
+    SimSerial();
+    void begin(unsigned long baud);
+    void reset();
+
+    int available() { return 0; }
+    int read() { return -1; }
+
+    int availableForWrite();
+    size_t write(uint8_t byte);
+    size_t write(const uint8_t* data, size_t length);
+
+    // When the bytes written so far have all gone out
+    unsigned long txIdleAtUs() const { return m_txIdleAtUs; }
+    uint32_t txBytes() const { return m_txBytes; }
+    // FNV-1a hash of the bytes written, e.g. to check that two runs sent the same
+    uint32_t txHash() const { return m_txHash; }
+
+private:
+    unsigned long m_txIdleAtUs;
+    uint32_t m_txBytes;
+    uint32_t m_txHash;
+};
+
+extern SimSerial Serial;
+
+#endif // SIM_ARDUINO_H
@@ -0,0 +1,59 @@
+#ifndef JOURNAL_PLAYER_H
+#define JOURNAL_PLAYER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "sim_world.h"
+
+/*
+ * Plays an input journal (see input_journal.h) back through the firmware, with the
+ * USE_INPUT_JOURNAL build flag: boots it and runs passes of loop() until the journal is used
+ * up, every input being taken from the journal. The simulator's clock follows the journal's, so
+ * anything timestamped with micros() between the passes sees the recorded times.
+ *
+ * The journal has to come from a build with the same build flags and config.h. Otherwise the
+ * firmware soon reads another input than was recorded, and the playback stops there as diverged.
+ * The controller type (USE_FIXED_POINT_CONTROLLER) is the exception: the float and fixed point
+ * controllers read the same inputs, so playing back with the other one does not diverge, it just
+ * computes other valve angles. env:journal and env:sim_journal build the fixed point one, as env:uno.
+ */
+class JournalPlayer {
+public:
+    // Reads the whole file (e.g. a journal written by the simulator, or the journal packets of a
+    // run on the stand appended in sequence)
+    bool load(FILE* in);
+    void add(const uint8_t* data, size_t length) { m_journal.insert(m_journal.end(), data, data + length); }
+    size_t size() const { return m_journal.size(); }
+
+    typedef void (*PassFn)();
+
+    // Starts playing the journal back: resets the simulated hardware and boots the firmware
+    void boot();
+    // Runs passes of loop() until the journal is used up, or at most maxPasses of them (then the
+    // next play() goes on from there). afterPass, if any, is called after each pass, at the
+    // recorded time of the pass's last clock read (e.g. DecisionRecorder::observe()). Returns the
+    // number of passes run
+    uint32_t play(PassFn afterPass = nullptr, uint32_t maxPasses = UINT32_MAX);
+    bool isDone() const { return m_done; }
+
+    // The last pass read past the end of the journal, so its inputs were made up (e.g. a journal
+    // from the stand, which ends wherever the last chunk did)
+    bool isTruncated() const { return m_truncated; }
+    bool hasDiverged() const { return m_diverged; }
+    // Bytes of the journal played back
+    size_t getPlayed() const { return m_played; }
+
+private:
+    std::vector<uint8_t> m_journal;
+    bool m_done = true;
+    bool m_truncated = false;
+    bool m_diverged = false;
+    size_t m_played = 0;
+
+    void finishIfUsedUp();
+};
+
+#endif // JOURNAL_PLAYER_H
@@ -0,0 +1,102 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "state_machine.h"
+
+/*
+ * Replay of recorded test data (waterflows, coldflows, hotfires) through the firmware in the
+ * simulator: the simulated Pi sends the recorded samples instead of sampling the plant (see
+ * SimWorld::setReplay()), so the control path runs open loop against the recording while the
+ * valve, encoder and clock are simulated as usual.
+ *
+ * A recording is a CSV file with one line per pressure sample, as logged on the Pi:
+ *
+ *     time_s,pt1,pt2,pt3,mpv_open,other_state
+ *
+ * with the time from the start of the recording, the PT readings in psi, mpv_open 0 or 1 and
+ * other_state the other controller's state (a SystemStateEnum value). Lines that do not start
+ * with a number (the header, comments) are skipped.
+ */
+
+struct ReplaySample {
+    unsigned long timeUs;
+    float pt[3];
+    bool mpvOpen;
+    SystemStateEnum otherState;
+};
+
+class ReplayLog {
+public:
+    // Returns false on a malformed line (see getErrorLine()) or samples out of time order
+    bool load(FILE* in);
+    bool addCsvLine(const char* line);
+    void add(const ReplaySample& sample) { m_samples.push_back(sample); }
+    void clear() { m_samples.clear(); }
+
+    size_t size() const { return m_samples.size(); }
+    const ReplaySample& operator[](size_t i) const { return m_samples[i]; }
+    double durationS() const { return m_samples.empty() ? 0.0 : m_samples.back().timeUs / 1e6; }
+    unsigned long getErrorLine() const { return m_errorLine; }
+
+private:
+    std::vector<ReplaySample> m_samples;
+    unsigned long m_errorLine = 0;
+};
+
+/*
+ * The decisions of the firmware, checked after every pass of loop(): state changes, newly
+ * latched faults (TELPKT_FAULTS_* bits) and changes of the commanded valve angle. They are
+ * written either as CSV lines
+ *
+ *     time_us,kind,from,to,value
+ *
+ * or as packed DecisionRecords (little endian, as on the host), which is what a regression
+ * check should compare.
+ */
+
+enum class DecisionKind : uint8_t {
+    STATE_CHANGE,   // from and to are the states
+    FAULT_LATCHED,  // from is the fault bits before, to the newly set ones
+    TARGET_ANGLE    // value is the new commanded angle (degrees from fully closed)
+};
+
+struct __attribute__((packed)) DecisionRecord {
+    uint32_t timeUs;
+    DecisionKind kind;
+    uint8_t from;
+    uint8_t to;
+    uint8_t _unused;
+    float value;
+};
+
+static_assert(sizeof(DecisionRecord) == 12, "DecisionRecord layout changed");
+
+class DecisionRecorder {
+public:
+    enum class Format : uint8_t { CSV, BINARY };
+
+    explicit DecisionRecorder(FILE* out = nullptr, Format format = Format::CSV);
+
+    // Takes the firmware's current state as the starting point (e.g. after simBootFirmware())
+    void reset();
+    void observe();
+
+    uint32_t getCount(DecisionKind kind) const { return m_counts[(uint8_t)kind]; }
+
+private:
+    FILE* m_out;
+    Format m_format;
+    SystemStateEnum m_state;
+    uint8_t m_faults;
+    float m_targetDeg;
+    uint32_t m_counts[3];
+
+    void write(DecisionKind kind, uint8_t from, uint8_t to, float value);
+};
+
+#endif // REPLAY_H
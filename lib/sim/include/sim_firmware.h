@@ -0,0 +1,25 @@
+#ifndef SIM_FIRMWARE_H
+#define SIM_FIRMWARE_H
+
+#include <stdio.h>
+
+/*
+ * The firmware of src/main.cpp, as run by the simulator (src/ has to be built in, e.g. with
+ * test_build_src in env:sim).
+ */
+
+void setup();
+void loop();
+
+// Boots the firmware afresh, like a power cycle: clears its globals, then runs setup(). Reset
+// the SimWorld first, so that setup() runs against fresh hardware
+void simBootFirmware();
+
+#ifdef USE_INPUT_JOURNAL
+// Where the input journal of the firmware goes (input_journal.h), nullptr to drop it. The rest
+// of the journal being recorded goes to the previous file first. Each boot starts a new journal,
+// so set a new file before each boot that should be played back on its own
+void simSetJournalFile(FILE* file);
+#endif
+
+#endif // SIM_FIRMWARE_H
@@ -0,0 +1,98 @@
+#ifndef SIM_HARDWARE_H
+#define SIM_HARDWARE_H
+
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ * Simulated hardware of the valve: the virtual clock with the step timer (Timer1 on the
+ * Arduino), the stepper driven valve with its AMT22 encoder, and the input pins. The firmware
+ * reaches them through the Arduino API of the simulator (Arduino.h, SPI.h) and hardware.h,
+ * exactly as it reaches the real ones.
+ */
+
+class SimClock {
+public:
+    static constexpr unsigned long NO_EVENT = (unsigned long)-1;
+
+    // timerIsr is run on the step timer's compare matches
+    explicit SimClock(void (*timerIsr)());
+    void reset();
+
+    unsigned long nowUs() const { return m_nowUs; }
+
+    // Moves the time forward, running the step timer ISR whenever it is due (unless masked)
+    void advanceTo(unsigned long timeUs);
+    void advanceBy(unsigned long us) { advanceTo(m_nowUs + us); }
+
+    // Step timer: a periodic compare interrupt like Timer1 in CTC mode
+    void startTimer(uint16_t periodUs);
+    void setTimerPeriod(uint16_t periodUs); // Takes effect from the next compare match
+    void stopTimer();
+    void setTimerMasked(bool masked);       // A match while masked runs the ISR when unmasked
+    unsigned long nextTimerUs() const;      // NO_EVENT if the timer does not run
+
+private:
+    unsigned long m_nowUs;
+    void (*m_isr)();
+    bool m_timerRunning;
+    bool m_timerMasked;
+    bool m_timerPending;
+    uint16_t m_timerPeriodUs;
+    unsigned long m_timerNextUs;
+};
+
+class SimValve {
+public:
+    SimValve();
+    void reset(float angleDeg);
+    bool isEnabled() const { return m_enabled; }
+
+    // Stepper driver
+    void setDirection(bool reverse) { m_reverse = reverse; }
+    void pulse();
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+
+    // A stuck valve ignores the steps (e.g. a seized valve or a slipping coupling)
+    void setStuck(bool stuck) { m_stuck = stuck; }
+
+    // Angle from fully closed, as in the firmware
+    float angleDeg() const { return m_startDeg + m_steps * HardwareConfig::DEGREES_PER_STEP; }
+
+    // AMT22 encoder on the SPI bus: a position transfer is two bytes within one chip select
+    void select(bool selected);
+    uint8_t transfer(uint8_t data);
+    // 12-bit response (position and checkbits) of the encoder at angleDeg
+    static uint16_t encoderResponse(float angleDeg);
+
+private:
+    float m_startDeg;
+    int32_t m_steps;        // Steps the valve actually moved
+    bool m_reverse;
+    bool m_enabled;
+    bool m_stuck;
+
+    uint16_t m_response;    // Latched at chip select
+    uint8_t m_byteIndex;
+};
+
+// Levels read by digitalRead(). All pins read HIGH (e.g. the manual abort is not pressed) until set
+class SimPins {
+public:
+    static constexpr uint8_t NUM_PINS = 20;
+
+    SimPins() { reset(); }
+    void reset();
+    void set(uint8_t pin, uint8_t level) { if (pin < NUM_PINS) m_levels[pin] = level; }
+    uint8_t get(uint8_t pin) const { return pin < NUM_PINS ? m_levels[pin] : 1; }
+
+private:
+    uint8_t m_levels[NUM_PINS];
+};
+
+extern SimClock simClock;
+extern SimValve simValve;
+extern SimPins simPins;
+
+#endif // SIM_HARDWARE_H
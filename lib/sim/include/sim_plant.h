@@ -0,0 +1,50 @@
+#ifndef SIM_PLANT_H
+#define SIM_PLANT_H
+
+/*
+ * Lumped model of the feed line between the valve and the injector: a regulated tank feeding the
+ * manifold through the valve (whose Cv grows with the opening, linearly by default), and the
+ * manifold draining through the injector. The line volume is stiffened by the liquid's bulk
+ * modulus, so the manifold pressure follows the valve with a first order lag of
+ *
+ *     tau ~ lineVolume / (bulkModulus * dQ/dP)
+ *
+ * Flows are Q = Cv * sqrt(dP / SG) (gpm, psi), the usual liquid valve sizing equation. The
+ * model is integrated with explicit Euler steps of at most STEP_S.
+ */
+
+struct PlantParams {
+    float tankPressurePsi = 500.0f;
+    float tankBlowdownPsiPerGal = 0.0f;  // Drop of the tank pressure per gallon delivered
+    float valveCvMax = 4.0f;             // At ValveConfig::MAX_VALVE_ANGLE (0 at MIN_VALVE_ANGLE)
+    float valveCvExponent = 1.0f;        // Cv ~ opening^exponent: 1 linear, above 1 towards equal percentage
+    float injectorCv = 1.0f;
+    float specificGravity = 1.0f;
+    float lineVolumeGal = 0.1f;          // Between the valve and the injector
+    float bulkModulusPsi = 3000.0f;      // Effective, including the compliance of the line
+};
+
+class ManifoldPlant {
+public:
+    static constexpr float STEP_S = 100e-6f;
+
+    explicit ManifoldPlant(const PlantParams& params = PlantParams());
+    void reset();
+
+    // Integrates up to timeS with the valve at angleDeg (from fully closed). The main propellant
+    // valve is upstream of the valve, so with it closed the manifold only drains
+    void advanceTo(double timeS, float angleDeg, bool mpvOpen);
+
+    float manifoldPressurePsi() const { return m_manifoldPsi; }
+    float tankPressurePsi() const { return m_tankPsi; }
+    void setTankPressurePsi(float psi) { m_tankPsi = psi; }
+    float valveCv(float angleDeg) const;
+
+private:
+    PlantParams m_params;
+    double m_timeS;
+    float m_manifoldPsi;
+    float m_tankPsi;
+};
+
+#endif // SIM_PLANT_H
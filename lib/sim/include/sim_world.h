@@ -0,0 +1,125 @@
+#ifndef SIM_WORLD_H
+#define SIM_WORLD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "replay.h"
+#include "sim_plant.h"
+#include "state_machine.h"
+
+/*
+ * Closed loop simulation of the firmware against the simulated valve (sim_hardware.h), the feed
+ * line (sim_plant.h) and the Pi, in virtual time.
+ *
+ * The simulated Pi samples the manifold pressure with three noisy PTs at piRateHz and sends the
+ * samples as pressure update packets, which land in serialRxRing after the transport delay. It
+ * reports the state of the other controller as this controller's own state (a second controller
+ * that follows along), and the MPV as open from mpvOpenAtS on, until the firmware asks for it to
+ * be closed.
+ *
+ * run() does not tick the clock: it runs one pass of loop(), then jumps the clock straight to
+ * the next thing that can happen (a task release, a packet, the TX buffer draining), advancing
+ * the plant on the way. The step timer ISR runs inside the jumps, and the firmware's own delays
+ * (e.g. the encoder's) take virtual time, so a simulated second only costs the passes of loop()
+ * the firmware would make in it.
+ *
+ * With a replay log (setReplay()), the Pi sends the recorded samples at their times instead,
+ * with the recorded MPV and other controller states, and stops at the end of the recording.
+ *
+ * Times are in seconds since the last reset(); scenario times below 0 never happen.
+ */
+
+struct SimScenario {
+    double mpvOpenAtS = 1.0;
+    double commLossAtS = -1.0;      // The Pi stops sending
+    double valveStuckAtS = -1.0;    // The valve stops following the steps
+    double tankStepAtS = -1.0;      // The tank pressure changes by tankStepPsi
+    float tankStepPsi = 0.0f;
+};
+
+struct SimParams {
+    PlantParams plant;
+    SimScenario scenario;
+    float piRateHz = 100.0f;
+    float sensorNoisePsi = 1.0f;    // Standard deviation, independent for each PT
+    double transportDelayS = 0.002f;
+    uint32_t seed = 1;
+};
+
+struct SimStats {
+    double timeInStateS[5];         // By SystemStateEnum
+    double closedLoopAtS;           // When CLOSED_LOOP was first entered, or -1
+    double settledAtS;              // Since when the pressure is within the tolerance (in CLOSED_LOOP), or -1
+    float maxOvershootPsi;          // Above the target in CLOSED_LOOP, after first reaching it
+    float rmsErrorPsi;              // Over the time in CLOSED_LOOP
+    double itaePsiS2;               // Integral of the time since closing the loop times the absolute error, in CLOSED_LOOP
+    uint32_t loopPasses;
+    uint32_t packetsSent;           // Pressure update packets
+};
+
+typedef void (*LoopFn)();
+
+class SimWorld {
+public:
+    explicit SimWorld(const SimParams& params = SimParams());
+
+    // Resets the clock, the hardware, the plant and the Pi (not the firmware itself)
+    void reset();
+
+    // Replays log (nullptr to go back to the plant); it must outlive the runs. Call before reset().
+    // The plant still runs, so the pressure stats are of the plant, not of the recording
+    void setReplay(const ReplayLog* log) { m_replay = log; }
+
+    // Runs loopFn for durationS of virtual time. With a trace, writes a CSV line at most every TRACE_PERIOD_US
+    void run(LoopFn loopFn, double durationS, FILE* trace = nullptr);
+
+    double timeS() const;
+    const SimStats& getStats() const;
+    const ManifoldPlant& getPlant() const { return m_plant; }
+
+private:
+    static constexpr unsigned long MAX_STEP_US = 1000;  // Longest plant step between events
+    static constexpr unsigned long MIN_STEP_US = 10;    // When nothing is pending, e.g. a task overran
+    static constexpr unsigned long TRACE_PERIOD_US = 1000;
+    static constexpr uint8_t MAX_IN_FLIGHT = 8;         // Packets between the Pi and serialRxRing
+
+    struct InFlight {
+        unsigned long deliverAtUs;
+        uint8_t length;
+        uint8_t frame[64];
+    };
+
+    SimParams m_params;
+    const ReplayLog* m_replay;
+    size_t m_replayNext;            // Next sample of the replay log to send
+    ManifoldPlant m_plant;
+    SimStats m_stats;
+    double m_errorSquaredS;
+
+    uint32_t m_rng;
+    uint16_t m_sequence;
+    bool m_mpvOpen;
+    bool m_mpvControlSeen;          // The firmware let the MPV open (MPV_CONTROL)
+    bool m_mpvClosedByFirmware;
+    bool m_stuck;
+    bool m_tankStepped;
+    bool m_reachedTarget;
+    unsigned long m_nextPacketUs;   // NO_EVENT once the replay log has been sent
+    unsigned long m_packetPeriodUs;
+    unsigned long m_nextTraceUs;
+    InFlight m_inFlight[MAX_IN_FLIGHT];
+    uint8_t m_numInFlight;
+
+    unsigned long usOf(double timeS) const;
+    float gaussian();
+    void sendPressureUpdate(unsigned long nowUs, const float pt[3], SystemStateEnum otherState);
+    void sendPressureUpdates(unsigned long nowUs);
+    void deliverPackets(unsigned long nowUs);
+    void updateScenario(unsigned long nowUs);
+    unsigned long nextEventUs(unsigned long nowUs, unsigned long endUs) const;
+    void advanceTo(unsigned long timeUs);
+    void traceLine(FILE* trace);
+};
+
+#endif // SIM_WORLD_H
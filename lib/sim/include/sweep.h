@@ -0,0 +1,111 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "sim_world.h"
+
+/*
+ * Monte Carlo sweep of the firmware's tuning over the closed loop simulation: each configuration
+ * of the gains and thresholds below is run against many plants drawn from the uncertainties
+ * (tank pressure, valve Cv curve, transport delay, PT noise), and its runs are summarised as
+ * settling time, overshoot, ITAE and false abort rate (see tools/sweep/sweep_main.cpp). The gains
+ * are tuned on the fixed point controller that runs on the Uno (USE_FIXED_POINT_CONTROLLER in
+ * env:sim and env:sweep).
+ *
+ * A run is the nominal scenario: nothing fails, so any abort (FORCED_OPEN_LOOP or
+ * EMERGENCY_STOP) is a false one. Everything a run draws comes from its seed, so a sweep gives
+ * the same results whatever the number of workers.
+ *
+ * The firmware lives in globals, so the runs of a sweep are spread across worker processes
+ * rather than threads (runParallel()).
+ */
+
+// Firmware parameters of a configuration. The gains, the redband and the move filter are the run
+// time tunables (as set by command packets); the others keep their config.h values
+struct SweepConfig {
+    float kp = ControllerConfig::KP;
+    float ki = ControllerConfig::KI;
+    float maxAngleChangeDeg = ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE;
+    float redbandUpperPsi = MotorControlConfig::REDBAND_PRESSURE_UPPER;
+    float redbandLowerPsi = MotorControlConfig::REDBAND_PRESSURE_LOWER;
+    int faultThreshold = SensorConfig::CONSEC_BEFORE_ERR_THRESHOLD;
+};
+
+// Values of one parameter: points evenly spaced from min to max in a grid (a single point is
+// min), or drawn uniformly between them
+struct SweepAxis {
+    float min;
+    float max;
+    uint16_t points;
+
+    SweepAxis(float value = 0.0f) : min(value), max(value), points(1) {}
+    SweepAxis(float from, float to, uint16_t numPoints = 1) : min(from), max(to), points(numPoints) {}
+    float at(uint16_t point) const { return points > 1 ? min + (max - min) * point / (points - 1) : min; }
+    float draw(float uniform) const { return min + (max - min) * uniform; }
+};
+
+struct SweepSpace {
+    SweepConfig base;   // The parameters not swept
+    SweepAxis kp = base.kp;
+    SweepAxis ki = base.ki;
+    SweepAxis maxAngleChangeDeg = base.maxAngleChangeDeg;
+    SweepAxis redbandUpperPsi = base.redbandUpperPsi;
+    SweepAxis redbandLowerPsi = base.redbandLowerPsi;
+    SweepAxis faultThreshold = (float)base.faultThreshold;
+
+    size_t gridSize() const;
+    SweepConfig gridPoint(size_t index) const;          // index < gridSize(), the last axis fastest
+    SweepConfig randomPoint(uint32_t seed) const;
+};
+
+// Uncertain plant, drawn uniformly for each run
+struct SweepUncertainty {
+    SimParams base;                                 // Scenario and the plant parameters not drawn
+    SweepAxis tankPressurePsi = SweepAxis(450.0f, 550.0f);
+    SweepAxis valveCvScale = SweepAxis(0.9f, 1.1f);      // Of base.plant.valveCvMax
+    SweepAxis valveCvExponent = SweepAxis(1.0f, 1.5f);
+    SweepAxis transportDelayS = SweepAxis(0.001f, 0.010f);
+    SweepAxis sensorNoisePsi = SweepAxis(0.5f, 2.0f);
+
+    SimParams draw(uint32_t seed) const;
+};
+
+struct SweepOutcome {
+    float settlingS;        // From closing the loop to settling for good, or -1 if it never did
+    float overshootPsi;
+    float itaePsiS2;
+    uint8_t finalState;     // SystemStateEnum
+    bool aborted;
+};
+
+// Boots the firmware with config in a fresh world of params, and runs it for durationS
+SweepOutcome runSweepSample(const SweepConfig& config, const SimParams& params, double durationS);
+
+struct SweepSummary {
+    uint32_t runs;
+    uint32_t settled;
+    float meanSettlingS;    // Of the runs that settled
+    float p95SettlingS;
+    float meanOvershootPsi;
+    float maxOvershootPsi;
+    float meanItaePsiS2;
+    float falseAbortRate;
+};
+
+SweepSummary summarize(const SweepOutcome* outcomes, size_t count);
+
+// Seed of a run, or of a configuration drawn at random, from the seed of the sweep
+uint32_t sweepSeed(uint32_t seed, uint64_t index);
+
+// Runs work(index, result) for every index below count, on jobs worker processes which claim the
+// next index from a shared counter whenever they are free (so that the slow runs, e.g. of an
+// oscillating controller, do not hold up a fixed share of the others). The results, resultSize
+// bytes each, land in results[index]. With one job, or where there is no fork(), the work runs
+// in this process. Returns false if a worker failed
+typedef void (*SweepWorkFn)(size_t index, void* result, const void* context);
+bool runParallel(size_t count, void* results, size_t resultSize, unsigned jobs, SweepWorkFn work, const void* context);
+
+#endif // SWEEP_H
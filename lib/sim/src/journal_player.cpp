@@ -0,0 +1,56 @@
+#include "journal_player.h"
+
+#ifdef USE_INPUT_JOURNAL
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "input_journal.h"
+#include "sim_firmware.h"
+#include "sim_hardware.h"
+
+bool JournalPlayer::load(FILE* in) {
+    m_journal.clear();
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        add(buffer, length);
+    return !ferror(in);
+}
+
+void JournalPlayer::boot() {
+    // Fresh hardware, as for a recording in the simulator (SimWorld::reset())
+    simClock.reset();
+    simValve.reset(ValveConfig::START_ANGLE);
+    simPins.reset();
+    Serial.reset();
+
+    inputJournal.startPlayback(m_journal.data(), m_journal.size());
+    m_done = false;
+    simBootFirmware();
+    finishIfUsedUp();
+}
+
+uint32_t JournalPlayer::play(PassFn afterPass, uint32_t maxPasses) {
+    uint32_t passes = 0;
+    while (!m_done && passes < maxPasses) {
+        loop();
+        passes++;
+        if (inputJournal.getMicros() > simClock.nowUs())
+            simClock.advanceTo(inputJournal.getMicros());
+        if (afterPass != nullptr) afterPass();
+        finishIfUsedUp();
+    }
+    return passes;
+}
+
+void JournalPlayer::finishIfUsedUp() {
+    m_played = m_journal.size() - inputJournal.remaining();
+    if (inputJournal.remaining() > 0 && !inputJournal.hasEnded()) return;
+    m_diverged = inputJournal.hasDiverged();
+    m_truncated = inputJournal.hasEnded() && !m_diverged;
+    inputJournal.stop();
+    m_done = true;
+}
+
+#endif
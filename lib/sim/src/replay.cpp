@@ -0,0 +1,88 @@
+#include <Arduino.h>
+#include <stdlib.h>
+
+#include "comm_handler.h"
+#include "replay.h"
+#include "utilities.h"
+
+bool ReplayLog::load(FILE* in) {
+    char line[256];
+    unsigned long lineNumber = 0;
+    while (fgets(line, sizeof(line), in) != nullptr) {
+        lineNumber++;
+        if (!addCsvLine(line)) {
+            m_errorLine = lineNumber;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ReplayLog::addCsvLine(const char* line) {
+    while (*line == ' ' || *line == '\t') line++;
+    if (!(*line >= '0' && *line <= '9') && *line != '.') return true; // Header, comment or blank
+
+    double fields[6];
+    char* end;
+    for (uint8_t i = 0; i < 6; i++) {
+        fields[i] = strtod(line, &end);
+        if (end == line) return false;
+        line = end;
+        while (*line == ' ' || *line == '\t') line++;
+        if (i < 5 && *line++ != ',') return false;
+    }
+    if (fields[0] < 0.0 || fields[5] < 0.0 || fields[5] > (double)SystemStateEnum::EMERGENCY_STOP) return false;
+
+    ReplaySample sample;
+    sample.timeUs = (unsigned long)llround(fields[0] * 1e6);
+    for (uint8_t i = 0; i < 3; i++) sample.pt[i] = (float)fields[i + 1];
+    sample.mpvOpen = fields[4] != 0.0;
+    sample.otherState = (SystemStateEnum)(uint8_t)fields[5];
+    if (!m_samples.empty() && sample.timeUs < m_samples.back().timeUs) return false;
+    m_samples.push_back(sample);
+    return true;
+}
+
+DecisionRecorder::DecisionRecorder(FILE* out, Format format) : m_out(out), m_format(format) {
+    reset();
+}
+
+void DecisionRecorder::reset() {
+    m_state = systemState.currentState;
+    m_faults = CommHandler::telemetryFaults();
+    m_targetDeg = angleToDeg(channel.targetAngle);
+    for (uint32_t& count : m_counts) count = 0;
+    if (m_out != nullptr && m_format == Format::CSV)
+        fprintf(m_out, "time_us,kind,from,to,value\n");
+}
+
+void DecisionRecorder::observe() {
+    if (systemState.currentState != m_state) {
+        write(DecisionKind::STATE_CHANGE, (uint8_t)m_state, (uint8_t)systemState.currentState, 0.0f);
+        m_state = systemState.currentState;
+    }
+
+    uint8_t faultBits = CommHandler::telemetryFaults();
+    uint8_t latched = faultBits & ~m_faults;
+    if (latched != 0)
+        write(DecisionKind::FAULT_LATCHED, m_faults, latched, 0.0f);
+    m_faults = faultBits;
+
+    float targetDeg = angleToDeg(channel.targetAngle);
+    if (targetDeg != m_targetDeg) {
+        write(DecisionKind::TARGET_ANGLE, 0, 0, targetDeg);
+        m_targetDeg = targetDeg;
+    }
+}
+
+void DecisionRecorder::write(DecisionKind kind, uint8_t from, uint8_t to, float value) {
+    m_counts[(uint8_t)kind]++;
+    if (m_out == nullptr) return;
+
+    if (m_format == Format::CSV) {
+        fprintf(m_out, "%lu,%u,%u,%u,%.3f\n", micros(), (unsigned)kind, (unsigned)from, (unsigned)to, value);
+        return;
+    }
+    DecisionRecord record = { (uint32_t)micros(), kind, from, to, 0, value };
+    fwrite(&record, sizeof(record), 1, m_out);
+}
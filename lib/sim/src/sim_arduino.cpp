@@ -0,0 +1,83 @@
+#include <Arduino.h>
+#include <SPI.h>
+
+#include "config.h"
+#include "sim_hardware.h"
+
+SimSerial Serial;
+SPIClass SPI;
+
+// 10 bits per byte on the wire (8N1)
+static constexpr unsigned long BYTE_US = (10 * 1000000UL + CommConfig::BAUD_RATE - 1) / CommConfig::BAUD_RATE;
+
+unsigned long millis() {
+    return simClock.nowUs() / 1000;
+}
+
+unsigned long micros() {
+    return simClock.nowUs();
+}
+
+void delay(unsigned long ms) {
+    simClock.advanceBy(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    simClock.advanceBy(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    // Chip select is active low
+    if (pin == HardwareConfig::ENCODER_CS_PIN)
+        simValve.select(value == LOW);
+}
+
+int digitalRead(uint8_t pin) {
+    return simPins.get(pin);
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+    return simValve.transfer(data);
+}
+
+static constexpr uint32_t FNV_OFFSET_BASIS = 2166136261UL;
+static constexpr uint32_t FNV_PRIME = 16777619UL;
+
+SimSerial::SimSerial() : m_txIdleAtUs(0), m_txBytes(0), m_txHash(FNV_OFFSET_BASIS) {}
+
+void SimSerial::begin(unsigned long baud) {
+    (void)baud;
+}
+
+void SimSerial::reset() {
+    m_txIdleAtUs = 0;
+    m_txBytes = 0;
+    m_txHash = FNV_OFFSET_BASIS;
+}
+
+int SimSerial::availableForWrite() {
+    unsigned long now = simClock.nowUs();
+    if (m_txIdleAtUs <= now) return TX_BUFFER_SIZE - 1;
+    int queued = (int)((m_txIdleAtUs - now + BYTE_US - 1) / BYTE_US);
+    return queued >= TX_BUFFER_SIZE - 1 ? 0 : TX_BUFFER_SIZE - 1 - queued;
+}
+
+size_t SimSerial::write(uint8_t byte) {
+    return write(&byte, 1);
+}
+
+size_t SimSerial::write(const uint8_t* data, size_t length) {
+    // Nobody listens on the Pi side (the simulator reads the firmware's state directly)
+    for (size_t i = 0; i < length; i++)
+        m_txHash = (m_txHash ^ data[i]) * FNV_PRIME;
+    unsigned long now = simClock.nowUs();
+    if (m_txIdleAtUs < now) m_txIdleAtUs = now;
+    m_txIdleAtUs += length * BYTE_US;
+    m_txBytes += length;
+    return length;
+}
@@ -0,0 +1,55 @@
+#include <Arduino.h>
+
+#include "control_tasks.h"
+#include "hardware.h"
+#include "input_journal.h"
+#include "serial_rx.h"
+#include "sim_firmware.h"
+#include "utilities.h"
+
+extern bool MPV_CONTROL;    // utilities.cpp
+extern bool MPV_STATE;
+
+#ifdef USE_INPUT_JOURNAL
+static FILE* journalFile = nullptr;
+
+void journalWrite(const uint8_t* data, uint8_t length) {
+    if (journalFile != nullptr)
+        fwrite(data, 1, length, journalFile);
+}
+
+void simSetJournalFile(FILE* file) {
+    if (inputJournal.isRecording())
+        inputJournal.stop();
+    journalFile = file;
+}
+#endif
+
+void simBootFirmware() {
+    delete encoder;
+    delete controller;
+    delete pressureSensor;
+    if (commHandler != nullptr) commHandler->~CommHandler(); // In static storage (src/main.cpp)
+    encoder = nullptr;
+    controller = nullptr;
+    pressureSensor = nullptr;
+    commHandler = nullptr;
+
+    uint8_t drained;
+    while (serialRxRing.pop(drained)) {}
+    systemState = SystemState();
+    channel = ChannelState();
+    faults.clear();
+    tunables = Tunables();
+    positionEstimator = PositionEstimator();
+    flightRecorder = FlightRecorder();
+    MPV_CONTROL = false;
+    MPV_STATE = false;
+    resetControlTasks();
+
+    stepEngine.stop();
+    encoderSampler = EncoderSampler(sampleEncoder);
+    scheduler = TaskScheduler(inputMicros);
+
+    setup();
+}
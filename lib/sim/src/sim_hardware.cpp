@@ -0,0 +1,154 @@
+#include <math.h>
+
+#include "hardware.h"
+#include "sim_hardware.h"
+#include "utilities.h"
+#include "valve_angle.h"
+
+// The step timer ISR (TIMER1_COMPA_vect on the Arduino)
+static void simStepTimerIsr() {
+    stepEngine.onTimerCompare();
+}
+
+SimClock simClock(simStepTimerIsr);
+SimValve simValve;
+SimPins simPins;
+
+SimClock::SimClock(void (*timerIsr)()) : m_isr(timerIsr) {
+    reset();
+}
+
+void SimClock::reset() {
+    m_nowUs = 0;
+    m_timerRunning = false;
+    m_timerMasked = false;
+    m_timerPending = false;
+    m_timerPeriodUs = 0;
+    m_timerNextUs = 0;
+}
+
+void SimClock::advanceTo(unsigned long timeUs) {
+    while (m_timerRunning && m_timerNextUs <= timeUs) {
+        m_nowUs = m_timerNextUs;
+        if (m_timerMasked) {
+            // The compare flag stays set, further matches are lost
+            m_timerPending = true;
+            m_timerNextUs += m_timerPeriodUs;
+            continue;
+        }
+        // The ISR may change the period (for the match after the next) or stop the timer
+        m_timerNextUs += m_timerPeriodUs;
+        m_isr();
+    }
+    if (timeUs > m_nowUs) m_nowUs = timeUs;
+}
+
+void SimClock::startTimer(uint16_t periodUs) {
+    m_timerRunning = true;
+    m_timerPending = false;
+    m_timerPeriodUs = periodUs;
+    m_timerNextUs = m_nowUs + periodUs;
+}
+
+void SimClock::setTimerPeriod(uint16_t periodUs) {
+    // Called from the ISR, right after the match that already scheduled the next one
+    m_timerNextUs += (long)periodUs - m_timerPeriodUs;
+    m_timerPeriodUs = periodUs;
+}
+
+void SimClock::stopTimer() {
+    m_timerRunning = false;
+    m_timerPending = false;
+}
+
+void SimClock::setTimerMasked(bool masked) {
+    m_timerMasked = masked;
+    if (!masked && m_timerPending) {
+        m_timerPending = false;
+        if (m_timerRunning) m_isr();
+    }
+}
+
+unsigned long SimClock::nextTimerUs() const {
+    return m_timerRunning ? m_timerNextUs : NO_EVENT;
+}
+
+SimValve::SimValve() {
+    reset(ValveConfig::START_ANGLE);
+}
+
+void SimValve::reset(float angleDeg) {
+    m_startDeg = angleDeg;
+    m_steps = 0;
+    m_reverse = false;
+    m_enabled = true;
+    m_stuck = false;
+    m_response = 0;
+    m_byteIndex = 0;
+}
+
+void SimValve::pulse() {
+    if (!m_enabled || m_stuck) return;
+    m_steps += m_reverse ? -1 : 1;
+}
+
+void SimValve::select(bool selected) {
+    if (!selected) return;
+    m_response = encoderResponse(angleDeg());
+    m_byteIndex = 0;
+}
+
+uint8_t SimValve::transfer(uint8_t data) {
+    (void)data;
+    return m_byteIndex++ == 0 ? m_response >> 8 : m_response & 0xff;
+}
+
+uint16_t SimValve::encoderResponse(float angleDeg) {
+    // Inverse of AngleOps<>::fromCounts()
+    float shaftDeg = fmodf(angleDeg + FULLY_CLOSED_OFFSET, 360.0f);
+    if (shaftDeg < 0.0f) shaftDeg += 360.0f;
+    uint16_t counts = (uint16_t)lroundf(shaftDeg / 360.0f * HardwareConfig::MAX_12_BIT_VAL);
+    uint16_t response = (counts << 2) & 0x3fff;
+
+    // Odd parity over the even (K0, bit 14) and the odd (K1, bit 15) bits
+    uint8_t evenParity = 0, oddParity = 0;
+    for (uint8_t bit = 0; bit < 14; bit += 2) {
+        evenParity ^= (response >> bit) & 1;
+        oddParity ^= (response >> (bit + 1)) & 1;
+    }
+    if (!evenParity) response |= 1 << 14;
+    if (!oddParity) response |= 1 << 15;
+    return response;
+}
+
+void SimPins::reset() {
+    for (uint8_t& level : m_levels) level = 1;
+}
+
+// Hardware of the firmware (see hardware.h)
+void motorDriverBegin() {
+    simValve.setEnabled(true);
+}
+
+static void simTimerStart(uint16_t periodUs) { simClock.startTimer(periodUs); }
+static void simTimerSetPeriod(uint16_t periodUs) { simClock.setTimerPeriod(periodUs); }
+static void simTimerStop() { simClock.stopTimer(); }
+static void simTimerSetIsrMasked(bool masked) { simClock.setTimerMasked(masked); }
+static void simSetDirection(bool reverse) { simValve.setDirection(reverse); }
+static void simPulse() { simValve.pulse(); }
+
+const StepEngineHooks stepperDriverHooks = {
+    simTimerStart,
+    simTimerSetPeriod,
+    simTimerStop,
+    simTimerSetIsrMasked,
+    simSetDirection,
+    simPulse
+};
+
+void disableMotorDriver() {
+    simValve.setEnabled(false);
+}
+
+// The simulated Pi puts its bytes straight into serialRxRing
+void serialRxBegin() {}
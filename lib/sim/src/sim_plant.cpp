@@ -0,0 +1,48 @@
+#include <math.h>
+
+#include "config.h"
+#include "sim_plant.h"
+
+// Flow through a restriction, signed so that it goes from high to low pressure
+static float flowGpm(float cv, float upstreamPsi, float downstreamPsi, float specificGravity) {
+    float dp = upstreamPsi - downstreamPsi;
+    float q = cv * sqrtf(fabsf(dp) / specificGravity);
+    return dp >= 0.0f ? q : -q;
+}
+
+ManifoldPlant::ManifoldPlant(const PlantParams& params) : m_params(params) {
+    reset();
+}
+
+void ManifoldPlant::reset() {
+    m_timeS = 0.0;
+    m_manifoldPsi = 0.0f;
+    m_tankPsi = m_params.tankPressurePsi;
+}
+
+float ManifoldPlant::valveCv(float angleDeg) const {
+    float opening = (angleDeg - ValveConfig::MIN_VALVE_ANGLE) / (ValveConfig::MAX_VALVE_ANGLE - ValveConfig::MIN_VALVE_ANGLE);
+    if (opening < 0.0f) opening = 0.0f;
+    if (opening > 1.0f) opening = 1.0f;
+    if (m_params.valveCvExponent != 1.0f) opening = powf(opening, m_params.valveCvExponent);
+    return opening * m_params.valveCvMax;
+}
+
+void ManifoldPlant::advanceTo(double timeS, float angleDeg, bool mpvOpen) {
+    float cv = mpvOpen ? valveCv(angleDeg) : 0.0f;
+    float stiffness = m_params.bulkModulusPsi / m_params.lineVolumeGal; // psi per gallon
+
+    while (m_timeS < timeS) {
+        float dt = (float)(timeS - m_timeS);
+        if (dt > STEP_S) dt = STEP_S;
+
+        // gpm to gallons per second
+        float inflow = flowGpm(cv, m_tankPsi, m_manifoldPsi, m_params.specificGravity) / 60.0f;
+        float outflow = flowGpm(m_params.injectorCv, m_manifoldPsi, 0.0f, m_params.specificGravity) / 60.0f;
+
+        m_manifoldPsi += (inflow - outflow) * stiffness * dt;
+        if (m_manifoldPsi < 0.0f) m_manifoldPsi = 0.0f;
+        m_tankPsi -= inflow * m_params.tankBlowdownPsiPerGal * dt;
+        m_timeS += dt;
+    }
+}
@@ -0,0 +1,228 @@
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+
+#include "comm_handler.h"
+#include "config.h"
+#include "crc16_xmodem.h"
+#include "scheduler.h"
+#include "serial_rx.h"
+#include "sim_hardware.h"
+#include "sim_world.h"
+#include "utilities.h"
+
+extern bool MPV_CONTROL;           // utilities.cpp
+extern TaskScheduler scheduler;    // Defined with the other firmware globals
+
+SimWorld::SimWorld(const SimParams& params) : m_params(params), m_replay(nullptr), m_plant(params.plant) {
+    reset();
+}
+
+void SimWorld::reset() {
+    simClock.reset();
+    simValve.reset(ValveConfig::START_ANGLE);
+    simPins.reset();
+    Serial.reset();
+    m_plant = ManifoldPlant(m_params.plant);
+
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.closedLoopAtS = -1.0;
+    m_stats.settledAtS = -1.0;
+    m_errorSquaredS = 0.0;
+
+    m_rng = m_params.seed ? m_params.seed : 1;
+    m_sequence = 0;
+    m_mpvOpen = false;
+    m_mpvControlSeen = false;
+    m_mpvClosedByFirmware = false;
+    m_stuck = false;
+    m_tankStepped = false;
+    m_reachedTarget = false;
+    m_replayNext = 0;
+    m_nextPacketUs = m_replay != nullptr && m_replay->size() == 0 ? SimClock::NO_EVENT : 0;
+    m_packetPeriodUs = (unsigned long)lroundf(1e6f / m_params.piRateHz);
+    m_nextTraceUs = 0;
+    m_numInFlight = 0;
+}
+
+double SimWorld::timeS() const {
+    return simClock.nowUs() / 1e6;
+}
+
+const SimStats& SimWorld::getStats() const {
+    return m_stats;
+}
+
+unsigned long SimWorld::usOf(double timeS) const {
+    return timeS < 0.0 ? SimClock::NO_EVENT : (unsigned long)llround(timeS * 1e6);
+}
+
+// Box-Muller on a xorshift32 generator, so that runs are repeatable for a given seed
+float SimWorld::gaussian() {
+    float u[2];
+    for (float& v : u) {
+        m_rng ^= m_rng << 13;
+        m_rng ^= m_rng >> 17;
+        m_rng ^= m_rng << 5;
+        v = (m_rng >> 8) * (1.0f / 16777216.0f);
+    }
+    if (u[0] < 1e-7f) u[0] = 1e-7f;
+    return sqrtf(-2.0f * logf(u[0])) * cosf(2.0f * (float)M_PI * u[1]);
+}
+
+void SimWorld::sendPressureUpdates(unsigned long nowUs) {
+    if (nowUs < m_nextPacketUs) return;
+    bool commLost = nowUs >= usOf(m_params.scenario.commLossAtS);
+
+    if (m_replay == nullptr) {
+        float pressure = m_plant.manifoldPressurePsi();
+        float pt[3];
+        for (float& reading : pt) reading = pressure + m_params.sensorNoisePsi * gaussian();
+        // The other controller follows along
+        if (!commLost) sendPressureUpdate(nowUs, pt, systemState.currentState);
+        m_nextPacketUs += m_packetPeriodUs;
+        return;
+    }
+
+    const ReplayLog& log = *m_replay;
+    while (m_replayNext < log.size() && log[m_replayNext].timeUs <= nowUs) {
+        const ReplaySample& sample = log[m_replayNext++];
+        m_mpvOpen = sample.mpvOpen;
+        if (!commLost) sendPressureUpdate(nowUs, sample.pt, sample.otherState);
+    }
+    m_nextPacketUs = m_replayNext < log.size() ? log[m_replayNext].timeUs : SimClock::NO_EVENT;
+}
+
+void SimWorld::sendPressureUpdate(unsigned long nowUs, const float pt[3], SystemStateEnum otherState) {
+    static_assert(cobsFrameSize(UPDTPKT_SIZE + 1) <= sizeof(InFlight::frame), "Pressure update frame too long");
+    m_stats.packetsSent++;
+    if (m_numInFlight == MAX_IN_FLIGHT) return; // Lost on the way
+
+    pressureUpdatePacketU_t packet;
+    memset(packet.bytes, 0, UPDTPKT_SIZE);
+    packet.data._magic = MAGIC_START;
+    packet.data.otherState = otherState;
+    packet.data.flags = m_mpvOpen ? UPDTPKT_FLAGS_MPV_OPEN : 0;
+    packet.data.sequence = m_sequence++;
+    packet.data.piTimestamp = nowUs;
+
+    packet.data.pt1Reading = pt[0];
+    packet.data.pt2Reading = pt[1];
+#if USE_3_PTS
+    packet.data.pt3Reading = pt[2];
+#endif
+    packet.data._checksum = crc16Xmodem(packet.bytes + 4, UPDTPKT_SIZE - 4);
+
+    InFlight& inFlight = m_inFlight[m_numInFlight++];
+    inFlight.deliverAtUs = nowUs + usOf(m_params.transportDelayS);
+#ifdef USE_COBS_FRAMING
+    CobsEncoder encoder(inFlight.frame);
+    encoder.add(COMM_PROTOCOL_VERSION);
+    encoder.add(packet.bytes, UPDTPKT_SIZE);
+    inFlight.length = encoder.finish();
+#else
+    memcpy(inFlight.frame, packet.bytes, UPDTPKT_SIZE);
+    inFlight.length = UPDTPKT_SIZE;
+#endif
+}
+
+// Packets are sent in order and all have the same delay, so the first one arrives first
+void SimWorld::deliverPackets(unsigned long nowUs) {
+    while (m_numInFlight > 0 && m_inFlight[0].deliverAtUs <= nowUs) {
+        for (uint8_t i = 0; i < m_inFlight[0].length; i++)
+            serialRxRing.push(m_inFlight[0].frame[i]);
+        m_numInFlight--;
+        memmove(m_inFlight, m_inFlight + 1, m_numInFlight * sizeof(InFlight));
+    }
+}
+
+void SimWorld::updateScenario(unsigned long nowUs) {
+    const SimScenario& scenario = m_params.scenario;
+
+    // The MPV closes (for good) once the firmware asks for it, after having let it open
+    if (MPV_CONTROL) m_mpvControlSeen = true;
+    else if (m_mpvControlSeen) m_mpvClosedByFirmware = true;
+    if (m_replay == nullptr)
+        m_mpvOpen = nowUs >= usOf(scenario.mpvOpenAtS) && !m_mpvClosedByFirmware;
+
+    if (!m_stuck && nowUs >= usOf(scenario.valveStuckAtS)) {
+        m_stuck = true;
+        simValve.setStuck(true);
+    }
+    if (!m_tankStepped && nowUs >= usOf(scenario.tankStepAtS)) {
+        m_tankStepped = true;
+        m_plant.setTankPressurePsi(m_plant.tankPressurePsi() + scenario.tankStepPsi);
+    }
+}
+
+unsigned long SimWorld::nextEventUs(unsigned long nowUs, unsigned long endUs) const {
+    unsigned long next = endUs;
+    unsigned long releaseUs = scheduler.getNextReleaseUs(nowUs);
+    if (releaseUs < next) next = releaseUs;
+    if (m_nextPacketUs < next) next = m_nextPacketUs;
+    if (m_numInFlight > 0 && m_inFlight[0].deliverAtUs < next) next = m_inFlight[0].deliverAtUs;
+    if (Serial.txIdleAtUs() > nowUs && Serial.txIdleAtUs() < next) next = Serial.txIdleAtUs();
+
+    if (next <= nowUs) next = nowUs + MIN_STEP_US;
+    return next;
+}
+
+// Moves the clock (and the step timer ISR) and the plant forward together
+void SimWorld::advanceTo(unsigned long timeUs) {
+    while (simClock.nowUs() < timeUs) {
+        unsigned long fromUs = simClock.nowUs();
+        unsigned long toUs = timeUs - fromUs > MAX_STEP_US ? fromUs + MAX_STEP_US : timeUs;
+        simClock.advanceTo(toUs);
+        m_plant.advanceTo(toUs / 1e6, simValve.angleDeg(), m_mpvOpen);
+
+        // Statistics, with the state and pressure held over the step
+        double dt = (toUs - fromUs) / 1e6;
+        m_stats.timeInStateS[(uint8_t)systemState.currentState] += dt;
+        if (systemState.currentState == SystemStateEnum::CLOSED_LOOP) {
+            double nowS = toUs / 1e6;
+            float error = m_plant.manifoldPressurePsi() - tunables.targetPressurePsi;
+            if (m_stats.closedLoopAtS < 0.0) m_stats.closedLoopAtS = nowS;
+            m_errorSquaredS += (double)error * error * dt;
+            m_stats.itaePsiS2 += (nowS - m_stats.closedLoopAtS) * fabsf(error) * dt;
+            if (error >= 0.0f) m_reachedTarget = true;
+            if (m_reachedTarget && error > m_stats.maxOvershootPsi) m_stats.maxOvershootPsi = error;
+            if (fabsf(error) > SensorConfig::PRESSURE_TOLERANCE) m_stats.settledAtS = -1.0;
+            else if (m_stats.settledAtS < 0.0) m_stats.settledAtS = nowS;
+        }
+    }
+}
+
+void SimWorld::traceLine(FILE* trace) {
+    fprintf(trace, "%.3f,%u,%.2f,%.3f,%.3f,%d,%d\n", timeS(), (unsigned)systemState.currentState,
+            m_plant.manifoldPressurePsi(), simValve.angleDeg(), angleToDeg(channel.targetAngle),
+            m_mpvOpen ? 1 : 0, MPV_CONTROL ? 1 : 0);
+}
+
+void SimWorld::run(LoopFn loopFn, double durationS, FILE* trace) {
+    const unsigned long endUs = simClock.nowUs() + usOf(durationS);
+
+    if (trace != nullptr && m_nextTraceUs == 0) {
+        fprintf(trace, "time_s,state,manifold_psi,valve_deg,target_deg,mpv_open,mpv_control\n");
+        m_nextTraceUs = simClock.nowUs();
+    }
+
+    while (simClock.nowUs() < endUs) {
+        unsigned long nowUs = simClock.nowUs();
+        updateScenario(nowUs);
+        sendPressureUpdates(nowUs);
+        deliverPackets(nowUs);
+
+        loopFn();
+        m_stats.loopPasses++;
+
+        advanceTo(nextEventUs(simClock.nowUs(), endUs));
+
+        if (trace != nullptr && m_nextTraceUs <= simClock.nowUs()) {
+            traceLine(trace);
+            m_nextTraceUs = simClock.nowUs() + TRACE_PERIOD_US;
+        }
+    }
+
+    double closedLoopS = m_stats.timeInStateS[(uint8_t)SystemStateEnum::CLOSED_LOOP];
+    m_stats.rmsErrorPsi = closedLoopS > 0.0 ? (float)sqrt(m_errorSquaredS / closedLoopS) : 0.0f;
+}
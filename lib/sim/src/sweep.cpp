@@ -0,0 +1,194 @@
+#include <Arduino.h>
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <new>
+#include <string.h>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/mman.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+    #define SWEEP_HAS_FORK 1
+#endif
+
+#include "sim_firmware.h"
+#include "sweep.h"
+#include "utilities.h"
+
+uint32_t sweepSeed(uint32_t seed, uint64_t index) {
+    // splitmix64 finaliser, so that neighbouring indices get unrelated seeds
+    uint64_t z = ((uint64_t)seed << 32 | seed) + (index + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    uint32_t result = (uint32_t)(z ^ (z >> 31));
+    return result != 0 ? result : 1; // xorshift32 (SimWorld) gets stuck at 0
+}
+
+// Uniform in [0, 1), from a xorshift32 state
+static float uniform(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+size_t SweepSpace::gridSize() const {
+    return (size_t)kp.points * ki.points * maxAngleChangeDeg.points * redbandUpperPsi.points *
+           redbandLowerPsi.points * faultThreshold.points;
+}
+
+SweepConfig SweepSpace::gridPoint(size_t index) const {
+    SweepConfig config = base;
+    const SweepAxis* axes[] = { &faultThreshold, &redbandLowerPsi, &redbandUpperPsi, &maxAngleChangeDeg, &ki, &kp };
+    float values[6];
+    for (uint8_t i = 0; i < 6; i++) {
+        values[i] = axes[i]->at((uint16_t)(index % axes[i]->points));
+        index /= axes[i]->points;
+    }
+    config.faultThreshold = (int)lroundf(values[0]);
+    config.redbandLowerPsi = values[1];
+    config.redbandUpperPsi = values[2];
+    config.maxAngleChangeDeg = values[3];
+    config.ki = values[4];
+    config.kp = values[5];
+    return config;
+}
+
+SweepConfig SweepSpace::randomPoint(uint32_t seed) const {
+    SweepConfig config = base;
+    config.kp = kp.draw(uniform(seed));
+    config.ki = ki.draw(uniform(seed));
+    config.maxAngleChangeDeg = maxAngleChangeDeg.draw(uniform(seed));
+    config.redbandUpperPsi = redbandUpperPsi.draw(uniform(seed));
+    config.redbandLowerPsi = redbandLowerPsi.draw(uniform(seed));
+    // Each whole threshold from min to max equally likely
+    config.faultThreshold = (int)floorf(SweepAxis(faultThreshold.min, faultThreshold.max + 1.0f).draw(uniform(seed)));
+    if (config.faultThreshold > faultThreshold.max) config.faultThreshold = (int)faultThreshold.max;
+    return config;
+}
+
+SimParams SweepUncertainty::draw(uint32_t seed) const {
+    SimParams params = base;
+    params.seed = seed;
+    params.plant.tankPressurePsi = tankPressurePsi.draw(uniform(seed));
+    params.plant.valveCvMax = base.plant.valveCvMax * valveCvScale.draw(uniform(seed));
+    params.plant.valveCvExponent = valveCvExponent.draw(uniform(seed));
+    params.transportDelayS = transportDelayS.draw(uniform(seed));
+    params.sensorNoisePsi = sensorNoisePsi.draw(uniform(seed));
+    return params;
+}
+
+SweepOutcome runSweepSample(const SweepConfig& config, const SimParams& params, double durationS) {
+    SimWorld world(params);
+    simBootFirmware();
+
+    // As the command packets would set them, before the MPV opens
+    controller->setKp(config.kp);
+    controller->setKi(config.ki);
+    tunables.maxAngleChange = degToAngle(config.maxAngleChangeDeg);
+    tunables.redbandUpperPsi = config.redbandUpperPsi;
+    tunables.redbandLowerPsi = config.redbandLowerPsi;
+    pressureSensor->setFaultThreshold(config.faultThreshold);
+
+    world.run(loop, durationS);
+
+    const SimStats& stats = world.getStats();
+    SweepOutcome outcome;
+    outcome.aborted = stats.timeInStateS[(uint8_t)SystemStateEnum::FORCED_OPEN_LOOP] > 0.0 ||
+                      stats.timeInStateS[(uint8_t)SystemStateEnum::EMERGENCY_STOP] > 0.0;
+    outcome.settlingS = stats.settledAtS >= 0.0 && !outcome.aborted ? (float)(stats.settledAtS - stats.closedLoopAtS) : -1.0f;
+    outcome.overshootPsi = stats.maxOvershootPsi;
+    outcome.itaePsiS2 = (float)stats.itaePsiS2;
+    outcome.finalState = (uint8_t)systemState.currentState;
+    return outcome;
+}
+
+SweepSummary summarize(const SweepOutcome* outcomes, size_t count) {
+    SweepSummary summary;
+    memset(&summary, 0, sizeof(summary));
+    summary.runs = (uint32_t)count;
+    if (count == 0) return summary;
+
+    std::vector<float> settling;
+    double overshootSum = 0.0, itaeSum = 0.0;
+    uint32_t aborts = 0;
+    for (size_t i = 0; i < count; i++) {
+        const SweepOutcome& outcome = outcomes[i];
+        if (outcome.settlingS >= 0.0f) settling.push_back(outcome.settlingS);
+        overshootSum += outcome.overshootPsi;
+        summary.maxOvershootPsi = std::max(summary.maxOvershootPsi, outcome.overshootPsi);
+        itaeSum += outcome.itaePsiS2;
+        if (outcome.aborted) aborts++;
+    }
+
+    summary.settled = (uint32_t)settling.size();
+    if (!settling.empty()) {
+        double settlingSum = 0.0;
+        for (float s : settling) settlingSum += s;
+        summary.meanSettlingS = (float)(settlingSum / settling.size());
+        size_t p95 = (settling.size() * 95 + 99) / 100 - 1; // Nearest rank
+        std::nth_element(settling.begin(), settling.begin() + p95, settling.end());
+        summary.p95SettlingS = settling[p95];
+    } else {
+        summary.meanSettlingS = summary.p95SettlingS = -1.0f;
+    }
+    summary.meanOvershootPsi = (float)(overshootSum / count);
+    summary.meanItaePsiS2 = (float)(itaeSum / count);
+    summary.falseAbortRate = (float)aborts / count;
+    return summary;
+}
+
+static void runInProcess(size_t count, uint8_t* results, size_t resultSize, SweepWorkFn work, const void* context) {
+    for (size_t i = 0; i < count; i++)
+        work(i, results + i * resultSize, context);
+}
+
+bool runParallel(size_t count, void* results, size_t resultSize, unsigned jobs, SweepWorkFn work, const void* context) {
+#ifdef SWEEP_HAS_FORK
+    if (jobs > count) jobs = (unsigned)count;
+    if (jobs > 1) {
+        typedef std::atomic<size_t> Counter;
+        static_assert(Counter::is_always_lock_free, "The counter is shared between processes");
+        constexpr size_t RESULTS_OFFSET = 64; // The counter on its own cache line
+
+        size_t bytes = RESULTS_OFFSET + count * resultSize;
+        void* shared = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (shared != MAP_FAILED) {
+            Counter* next = new (shared) Counter(0);
+            uint8_t* sharedResults = (uint8_t*)shared + RESULTS_OFFSET;
+
+            fflush(nullptr); // Or the workers would write out what is buffered again
+            std::vector<pid_t> workers;
+            while (workers.size() < jobs) {
+                pid_t pid = fork();
+                if (pid < 0) break;
+                if (pid == 0) {
+                    for (size_t i; (i = next->fetch_add(1, std::memory_order_relaxed)) < count;)
+                        work(i, sharedResults + i * resultSize, context);
+                    _exit(0);
+                }
+                workers.push_back(pid);
+            }
+
+            // Whatever workers started take all of the work between them
+            bool ok = true;
+            for (pid_t pid : workers) {
+                int status;
+                if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = false;
+            }
+            if (!workers.empty()) {
+                if (ok) memcpy(results, sharedResults, count * resultSize);
+                munmap(shared, bytes);
+                return ok;
+            }
+            munmap(shared, bytes);
+        }
+    }
+#else
+    (void)jobs;
+#endif
+    runInProcess(count, (uint8_t*)results, resultSize, work, context);
+    return true;
+}
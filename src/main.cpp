@@ -4,45 +4,69 @@
 
 #include <SPI.h>
 #include <AMT22_lib.h>
-#include <HighPowerStepperDriver.h>
 #include <math.h>
+#include <new>
 
 #include "config.h"
 #include "state_machine.h"
 #include <controller.h>
 #include <pressure_sensor.h>
 #include <comm_handler.h>
-#include <utilities_motor.h>
+#include <control_tasks.h>
+#include <hardware.h>
+#include <input_journal.h>
+#include <loop_profiler.h>
+#include <scheduler.h>
+#include <serial_rx.h>
 #include <utilities.h>
 
 // Hardware objects for single valve system
-HighPowerStepperDriver stepperDriver;
+StepEngine stepEngine;
 AMT22* encoder;
 Controller* controller;
 PressureSensor* pressureSensor;
 CommHandler* commHandler;
+PositionEstimator positionEstimator;
+FlightRecorder flightRecorder;
+EncoderSampler encoderSampler(sampleEncoder);
+TaskScheduler scheduler(inputMicros);
+int8_t controlTaskId;
 
 // System state variables
 SystemState systemState;
 ChannelState channel;
 FaultFlags faults;
-
-extern bool MPV_CONTROL;
-
-bool redBandCheck = false;
-
-// Function declarations
-void stateMachineUpdate();
-void globalMonitors();
-void bootInit();
-void openLoopInit();
-void closedLoop();
-void forcedOpenLoop();
-void emergencyStop();
-void resetSystemOnMpvCycle();
+Tunables tunables;
+
+// CommHandler (with the frames of its TX queue) is the largest object, so it is constructed in
+// static storage rather than on the heap, where avr-size would not see it
+alignas(CommHandler) static uint8_t commHandlerStorage[sizeof(CommHandler)];
+
+#ifdef __AVR__
+// The sizes are only those of the target on the AVR. The small heap objects come with 2 bytes of
+// malloc bookkeeping each
+constexpr size_t GLOBALS_BYTES = sizeof(stepEngine) + sizeof(positionEstimator) + sizeof(flightRecorder) +
+                                 sizeof(encoderSampler) + sizeof(scheduler) + sizeof(systemState) + sizeof(channel) +
+                                 sizeof(faults) + sizeof(tunables) + sizeof(serialRxRing) + sizeof(commHandlerStorage) +
+                                 sizeof(AMT22) + sizeof(Controller) + sizeof(PressureSensor) + 3 * 2
+#ifdef USE_LOOP_PROFILER
+                                 + sizeof(loopProfiler)
+#endif
+#ifdef USE_INPUT_JOURNAL
+                                 + sizeof(inputJournal)
+#endif
+                                 ;
+static_assert(GLOBALS_BYTES + MemoryConfig::CORE_BYTES + MemoryConfig::STACK_BYTES <= MemoryConfig::SRAM_BYTES,
+              "Not enough SRAM left for the stack; lower RecorderConfig::NUM_RECORDS or CommConfig::RX_RING_SIZE");
+#endif
 
 void setup() {
+#ifdef USE_INPUT_JOURNAL
+    // Before the first input is read (unless a journal is being played back)
+    inputJournal.startRecording(journalWrite);
+#endif
     Serial.begin(CommConfig::BAUD_RATE);
+    serialRxBegin();
     
     // Initialize SPI and pins
     SPI.begin();
@@ -52,13 +76,8 @@ void setup() {
 #endif
 
     // Configure stepper driver
-    stepperDriver.setChipSelectPin(HardwareConfig::MOTOR_CS_PIN);
-    stepperDriver.resetSettings();
-    stepperDriver.clearStatus();
-    stepperDriver.setDecayMode(HPSDDecayMode::AutoMixed);
-    stepperDriver.setCurrentMilliamps36v4(HardwareConfig::MOTOR_CURRENT_MA);
-    stepperDriver.setStepMode(HPSDStepMode::MicroStep1);
-    stepperDriver.enableDriver();
+    motorDriverBegin();
+    stepEngine.begin(&stepperDriverHooks);
     delay(20);
     
     // Configure encoder (Arduino-defined constants)
@@ -72,327 +91,43 @@ void setup() {
     delay(20);
 
     // Initialize global objects
-    controller = new Controller(ControllerConfig::KP, ControllerConfig::KI, ControllerConfig::KD);
+    controller = new Controller();
     pressureSensor = new PressureSensor();
-    commHandler = new CommHandler();
+    commHandler = new (commHandlerStorage) CommHandler();
+    commHandler->setCommandTable(tuningCommands, NUM_TUNING_COMMANDS);
     
     // Initialize timers
     systemState.initTimers();
+    systemState.onStateChange = sendStateChangeEvent;
     
     // Initialize MPV to closed state
     setMPV(false);
-}
-
-void loop() {
-    // Process incoming communications
-    commHandler->processIncomingNonBlocking();
-    
-    // Run global monitors
-    globalMonitors();
-    
-    // Run state machine
-    stateMachineUpdate();
-    
-    // Periodic telemetry (rate limited internally)
-    publishTelemetry();
-}
-
-void globalMonitors() {
-
-#ifndef NO_MANUAL_ABORT
-    // Manual abort check
-    if (isManualAbortPressed()) {
-        faults.manualAbort = true;
-        setMPV(false);
-        systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-        return;
-    }
-#endif
-    
-    // If system was running and MPV gets turned off, transition to open loop init and reset
-    if (!getMPVState() && (systemState.currentState == SystemStateEnum::CLOSED_LOOP || systemState.currentState == SystemStateEnum::FORCED_OPEN_LOOP)) {
-        setMPV(false);
-        resetSystemOnMpvCycle(); 
-        return;
-    }
-
-    // Communication watchdog
-    static unsigned long commLostTime = 0;
-    if (!commHandler->isCommHealthy()) {
-        faults.commTimeout = true;
-        if (commLostTime == 0) commLostTime = millis();
-        // If comm not reestablished in COMM_TIMEOUT_S, go to open loop
-        if (millis() - commLostTime > (TimingConfig::COMM_TIMEOUT_S / 2 * 1000)) {
-            if (systemState.currentState == SystemStateEnum::CLOSED_LOOP) {
-                systemState.changeStateTo(SystemStateEnum::FORCED_OPEN_LOOP);
-            }
-        }
-    } else {
-        // Reset commLostTime if comm is healthy
-        faults.commTimeout = false;
-        commLostTime = 0;
-    }
-
-    // State Sync Check with other controller
-    if (commHandler->isCommHealthy()) {        
-        // Get current angle for position-based sync rules
-        float currentAngle = getEncoderAngle();
-        if (!isAngleValid(currentAngle)) {
-            faults.encoderMismatch = true;
-            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-            return;
-        }
-        
-        // Apply state synchronization rules
-        SystemStateEnum syncedState = getSyncedState(systemState.currentState, commHandler->getOtherCtrlerState(), currentAngle);
-        
-        // Only change state if sync rules determine a different state is needed
-        if (syncedState != systemState.currentState) {
-            systemState.changeStateTo(syncedState);
-        }
-    }
-}
-
-void stateMachineUpdate() {
-    switch (systemState.currentState) {
-        case SystemStateEnum::BOOT_INIT:
-            bootInit();
-            break;
-            
-        case SystemStateEnum::OPEN_LOOP_INIT:
-            openLoopInit();
-            break;
-            
-        case SystemStateEnum::CLOSED_LOOP:
-            closedLoop();
-            break;
-            
-        case SystemStateEnum::FORCED_OPEN_LOOP:
-            forcedOpenLoop();
-            break;
-            
-        case SystemStateEnum::EMERGENCY_STOP:
-            emergencyStop();
-            break;
-            
-        default:
-            // Invalid state, go to emergency stop
-            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-            break;
-    }
-}
-
-void bootInit() {
-    if (!systemState.systemInitialized) {
-        faults.clear();
-        channel.targetAngle = ValveConfig::START_ANGLE;
-        float encAngle = getEncoderAngle();
-        if (!isAngleValid(encAngle)) {
-            faults.encoderMismatch = true;
-            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-            return;
-        }
-        channel.currentAngle = encAngle;
-        controller->reset();
-        
-        systemState.systemInitialized = true;
-        systemState.preClosedLoopTimer = millis();
-    }
-
-    systemState.changeStateTo(SystemStateEnum::OPEN_LOOP_INIT);
-}
-
-// Drive valve to starting position for closed-loop operation
-void openLoopInit() {
-    // Reset redBandCheck
-    redBandCheck = false;
-
-    float currentAngle = getEncoderAngle();
-    if (!isAngleValid(currentAngle)) {
-        faults.encoderMismatch = true;
-        systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-        return;
-    }
-    // Update current angle for telemetry
-    channel.currentAngle = currentAngle;
-    
-    bool atTarget = isAtStartAngle(currentAngle);
-    // Move valve if not at target
-    if (!atTarget) {
-        float deltaAngle = ValveConfig::START_ANGLE - currentAngle;
-        applyMoveFilter(deltaAngle);
-
-        channel.targetAngle = currentAngle + deltaAngle;
 
-        serviceMotor();
-        
-        // Check for encoder issues
-        float newAngle = getEncoderAngle();
-        if (!isAngleValid(newAngle)) {
-            faults.encoderMismatch = true;
-            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-            return;
-        }
-        // Update current angle after movement
-        channel.currentAngle = newAngle;
-    }
-    
-    // If valve at starting position, check if MPV is open, then after the pre closed loop timer elapses go into closed loop
-    if (atTarget) {
-        if (getMPVState()) {
-            if (!systemState.mpvWasOpen) {
-                systemState.mpvWasOpen = true;
-                setMPV(true);
-                systemState.preClosedLoopTimer = millis();
-            }
-            if (millis() - systemState.preClosedLoopTimer >= (TimingConfig::SAFE_TIMER_S * 1000UL)) {
-#if OPEN_LOOP_MODE
-                systemState.changeStateTo(SystemStateEnum::FORCED_OPEN_LOOP);
+    // Rate-grouped tasks, run in this order whenever they are due
+#ifdef USE_INPUT_JOURNAL
+    scheduler.addTask(processComms, hzToPeriodUs(JournalConfig::COMMS_RATE_HZ));
 #else
-                systemState.changeStateTo(SystemStateEnum::CLOSED_LOOP);
-                systemState.enterClosedLoopTime = millis();
-                systemState.lastControlTime = millis(); // Reset timing for dt calculation
+    scheduler.addTask(processComms, 0); // Every pass, so the serial RX buffer does not overflow
 #endif
-            }
-        } else {
-            systemState.mpvWasOpen = false;
-            setMPV(false);
-        }
-    }
-}
-
-void closedLoop() {
-    // Calculate time step for this control loop iteration
-    unsigned long now = millis();
-    float dt = (now - systemState.lastControlTime) / 1000.0f; 
-    systemState.lastControlTime = now;
-    if (dt <= 0.0f || dt > 10.0f) { // Minimum dt to avoid division by zero or unrealistic values
-        dt = TimingConfig::CONTROL_PERIOD_S; // Fallback
-    }
-    
-    // Read pressure sensors for this manifold
-    float pressure;
-    switch (readManifoldPressures(pressure)) {
-    #if USE_3_PTS
-        case SensorStatus::THREE_ILLOGICAL:
-    #else
-        case SensorStatus::TWO_ILLOGICAL:
-    #endif
-            faults.sensorFault = true;
-            systemState.changeStateTo(SystemStateEnum::FORCED_OPEN_LOOP);
-            return;
-        case SensorStatus::PENDING_FAULT:
-            return;
-        default: break;
-    }
-    
-    // Redband check (occurs if we are past the redband timeout)
-    if (redBandCheck || (millis() - systemState.enterClosedLoopTime) > TimingConfig::REDBAND_TIMEOUT * 1000UL){
-        redBandCheck = true;
-        if (!checkRedBand(pressure)){
-            faults.redBandFault = true;
-            systemState.changeStateTo(SystemStateEnum::FORCED_OPEN_LOOP);
-            return;
-        }
-    }
-    
-    float error = ControllerConfig::TARGET_PRESSURE_PSI - pressure;
-    bool inTolerance = fabs(error) <= SensorConfig::PRESSURE_TOLERANCE;
-
-    // VALVE CONTROL
-    if (!inTolerance) {
-        // Update controller
-        controller->update(error, dt);
-        float deltaAngle = controller->getError();
-        
-        // Apply move filtering (5-degree cap)
-        applyMoveFilter(deltaAngle);
-        
-        // Calculate new target angle
-        float newTargetAngle = channel.targetAngle + deltaAngle;
-        newTargetAngle = constrainAngle(newTargetAngle);
-        
-        // Command stepper motor
-        float angleBeforeMove = getEncoderAngle();
-        if (!isAngleValid(angleBeforeMove)) {
-            faults.encoderMismatch = true;
-            setMPV(false);
-            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-            return;
-        }
-        channel.targetAngle = newTargetAngle;
-        serviceMotor();
-        // Verify encoder response
-        float angleAfterMove = getEncoderAngle();
-        if (!isAngleValid(angleAfterMove)) {
-            faults.encoderMismatch = true;
-            setMPV(false);
-            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-            return;
-        }
-        channel.currentAngle = angleAfterMove;
-
-#ifdef USE_OSCILLATION_DETECTOR
-        // Check for oscillations
-        if (controller->getOscillationDetector().checkOscillation(error, millis())) {
-            faults.oscillationDetected = true;
-            systemState.changeStateTo(SystemStateEnum::FORCED_OPEN_LOOP);
-            return;
-        }
+    scheduler.addTask(globalMonitors, hzToPeriodUs(TimingConfig::MONITOR_RATE_HZ));
+    controlTaskId = scheduler.addTask(stateMachineUpdate, hzToPeriodUs(TimingConfig::CONTROL_PERIOD_HZ));
+    scheduler.addTask(publishTelemetry, hzToPeriodUs(CommConfig::TELEMETRY_RATE_HZ));
+#ifdef USE_LOOP_PROFILER
+    scheduler.addTask(sendDiagnostics, hzToPeriodUs(ProfilerConfig::DIAG_RATE_HZ));
 #endif
-    }
-
+    scheduler.start();
 }
 
-// Safe fallback mode - move valve to open loop target angle
-void forcedOpenLoop() {
-    float currentAngle = getEncoderAngle();
-    if (!isAngleValid(currentAngle)) {
-        faults.encoderMismatch = true;
-        systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-        return;
-    }
-    // Update current angle for telemetry
-    channel.currentAngle = currentAngle;
-    
-    // Move valve to open loop target angle if not already there
-    if (fabs(currentAngle - ValveConfig::OPENLOOP_TARGET_ANGLE) > ValveConfig::ANGLE_TOLERANCE) {
-        float deltaAngle = ValveConfig::OPENLOOP_TARGET_ANGLE - currentAngle;
-        applyMoveFilter(deltaAngle);
-        channel.targetAngle = currentAngle + deltaAngle;
-        serviceMotor();
+void loop() {
+#ifdef USE_INPUT_JOURNAL
+    // A pass with no task due changes nothing, but would fill the journal with clock reads, so
+    // it is skipped on the raw clock. A journal played back only holds the passes that ran
+    if (!inputJournal.isPlaying() && !scheduler.isDue(micros())) return;
+#endif
+    PROFILE_PHASE(LoopPhase::LOOP);
 
-        float angleAfterMove = getEncoderAngle();
-        if (!isAngleValid(angleAfterMove)) {
-            faults.encoderMismatch = true;
-            setMPV(false);
-            systemState.changeStateTo(SystemStateEnum::EMERGENCY_STOP);
-            return;
-        }
-        // Update current angle after movement
-        channel.currentAngle = angleAfterMove;
-    }
+    // The encoder is sampled at most once per pass (unless a fresh sample is requested)
+    encoderSampler.beginTick();
 
-    // // Check for recovery conditions
-    // if (commHandler->isCommHealthy() && !faults.manualAbort) {
-    //     float pressure;
-    //     if (readManifoldPressures(pressure)) {
-    //         // Clear transient faults and attempt recovery
-    //         if (millis() - stateEntryTime > (TimingConfig::RECOVERY_DWELL_S * 1000)) {
-    //             faults.clear();
-    //             controller->reset();
-    //             currentState = SystemStateEnum::CLOSED_LOOP;
-    //             stateEntryTime = millis();
-    //             lastControlTime = millis();
-    //         }
-    //     }
-    // }
+    scheduler.runPending();
 }
-
-void emergencyStop() {
-    // Terminal safe state
-    setMPV(false);
-    stepperDriver.disableDriver();
-    
-    // System remains in emergency stop until power cycle or manual reset
-}
\ No newline at end of file
@@ -0,0 +1,53 @@
+/*
+ * On-target benchmark of the angle math of one control tick, float VS fixed point (AngleQ).
+ * The Uno has no FPU, so this is where the fixed point pipeline pays off. Run with
+ * `pio test -e uno -f embedded/test_bench_angle -v` to see the cycle counts.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <stdio.h>
+
+#include "config.h"
+#include <valve_angle.h>
+#include "../../test_common/angle_tick.h"
+
+constexpr uint16_t BENCH_TICKS = 1024;
+
+volatile long benchSink;
+
+template <typename A>
+unsigned long cyclesPerTick() {
+    long acc = 0;
+    unsigned long start = micros();
+    for (uint16_t i = 0; i < BENCH_TICKS; i++)
+        acc += angleControlTick<A>(i * 4, (int32_t)(i & 0xFF) - 128);
+    unsigned long elapsedUs = micros() - start;
+    benchSink = acc;
+    return elapsedUs * (F_CPU / 1000000UL) / BENCH_TICKS;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_bench_angle_control_tick() {
+    unsigned long floatCycles = cyclesPerTick<float>();
+    unsigned long fixedCycles = cyclesPerTick<AngleQ>();
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "[BENCH] Angle pipeline per tick: float %lu cycles, AngleQ %lu cycles",
+             floatCycles, fixedCycles);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_LESS_THAN(floatCycles, fixedCycles);
+}
+
+void setup() {
+    delay(2000); // Wait for the serial monitor
+
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_angle_control_tick);
+    UNITY_END();
+}
+
+void loop() {}
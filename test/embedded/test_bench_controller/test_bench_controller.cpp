@@ -0,0 +1,71 @@
+/*
+ * On-target benchmark of one PID update, float VS fixed point (PressureQ). Run with
+ * `pio test -e uno -f embedded/test_bench_controller -v` to see the cycle counts.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <stdio.h>
+
+#include "config.h"
+#include <controller.h>
+
+constexpr uint16_t BENCH_UPDATES = 1024;
+
+volatile float benchSink;
+
+template <typename T>
+unsigned long cyclesPerUpdate(float kd) {
+    typedef typename BasicController<T>::Error Error;
+    typedef typename BasicController<T>::Time Time;
+    BasicController<T> controller(ControllerConfig::KP, ControllerConfig::KI, kd);
+
+    // Inputs are precomputed so that only the update itself is timed
+    Error errors[32];
+    for (int i = 0; i < 32; i++) errors[i] = Error((float)(i - 16) * 3.7f);
+    const Time dt(TimingConfig::CONTROL_PERIOD_S);
+
+    unsigned long start = micros();
+    for (uint16_t i = 0; i < BENCH_UPDATES; i++)
+        controller.update(errors[i & 31], dt);
+    unsigned long elapsedUs = micros() - start;
+    benchSink = numericCast<float>(controller.getError());
+    return elapsedUs * (F_CPU / 1000000UL) / BENCH_UPDATES;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void reportCycles(const char* name, unsigned long floatCycles, unsigned long fixedCycles) {
+    char msg[96];
+    snprintf(msg, sizeof(msg), "[BENCH] %s: float %lu cycles, PressureQ %lu cycles",
+             name, floatCycles, fixedCycles);
+    TEST_MESSAGE(msg);
+}
+
+void test_bench_controller_update() {
+    unsigned long floatCycles = cyclesPerUpdate<float>(ControllerConfig::KD);
+    unsigned long fixedCycles = cyclesPerUpdate<PressureQ>(ControllerConfig::KD);
+    reportCycles("PID update", floatCycles, fixedCycles);
+    TEST_ASSERT_LESS_THAN(floatCycles, fixedCycles);
+}
+
+void test_bench_controller_update_with_derivative() {
+    unsigned long floatCycles = cyclesPerUpdate<float>(0.02f);
+    unsigned long fixedCycles = cyclesPerUpdate<PressureQ>(0.02f);
+    reportCycles("PID update with derivative", floatCycles, fixedCycles);
+
+    // Both pay for a (32 bit integer or float) division here, so only report the numbers
+    TEST_PASS();
+}
+
+void setup() {
+    delay(2000); // Wait for the serial monitor
+
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_controller_update);
+    RUN_TEST(test_bench_controller_update_with_derivative);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,64 @@
+/*
+ * On-target benchmark of the packet checksum per byte, the CRC16 library VS the lookup tables.
+ * Run with `pio test -e uno -f embedded/test_bench_crc16 -v` to see the cycle counts.
+ */
+
+#include <Arduino.h>
+#include <CRC.h>
+#include <unity.h>
+#include <stdio.h>
+
+#include <crc16_xmodem.h>
+
+constexpr uint16_t BENCH_BYTES = 512;
+constexpr uint8_t BENCH_PASSES = 8;
+
+volatile uint16_t benchSink;
+uint8_t benchData[64];
+
+template <typename F>
+unsigned long cyclesPerByte(F update) {
+    uint16_t crc = XMODEM_INIT;
+    unsigned long start = micros();
+    for (uint8_t pass = 0; pass < BENCH_PASSES; pass++)
+        for (uint16_t i = 0; i < BENCH_BYTES; i++)
+            crc = update(crc, benchData[i & 63]);
+    unsigned long elapsedUs = micros() - start;
+    benchSink = crc;
+    return elapsedUs * (F_CPU / 1000000UL) / ((unsigned long)BENCH_BYTES * BENCH_PASSES);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_bench_crc16_per_byte() {
+    for (uint8_t i = 0; i < sizeof(benchData); i++) benchData[i] = (uint8_t)(i * 37 + 11);
+
+    CRC16 library(CRC16_XMODEM_POLYNOME, CRC16_XMODEM_INITIAL, CRC16_XMODEM_XOR_OUT, CRC16_XMODEM_REV_IN, CRC16_XMODEM_REV_OUT);
+    unsigned long start = micros();
+    for (uint8_t pass = 0; pass < BENCH_PASSES; pass++)
+        for (uint16_t i = 0; i < BENCH_BYTES; i++)
+            library.add(benchData[i & 63]);
+    unsigned long libraryCycles = (micros() - start) * (F_CPU / 1000000UL) / ((unsigned long)BENCH_BYTES * BENCH_PASSES);
+    benchSink = library.calc();
+
+    unsigned long nibbleCycles = cyclesPerByte(crc16XmodemNibbleUpdate);
+    unsigned long byteCycles = cyclesPerByte(crc16XmodemByteUpdate);
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "[BENCH] CRC16-XMODEM per byte: library %lu, nibble table %lu, byte table %lu cycles",
+             libraryCycles, nibbleCycles, byteCycles);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_LESS_THAN(libraryCycles, byteCycles);
+}
+
+void setup() {
+    delay(2000); // Wait for the serial monitor
+
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_crc16_per_byte);
+    UNITY_END();
+}
+
+void loop() {}
@@ -3,15 +3,15 @@
 
 #include <SPI.h>
 #include <AMT22_lib.h>
-#include <HighPowerStepperDriver.h>
 #include "config.h"
 #include <utilities.h>
-#include <utilities_motor.h>
 
-HighPowerStepperDriver stepperDriver;
+StepEngine stepEngine;
+PositionEstimator positionEstimator;
+EncoderSampler encoderSampler(sampleEncoder);
 AMT22* encoder;
 
-// Because we extern some symbols which are accessible to utilities.h and utilities_motor.h
+// Because we extern some symbols which are accessible to utilities.h
 #include <comm_handler.h>
 #include "state_machine.h"
 CommHandler* commHandler;
@@ -21,28 +21,37 @@ FaultFlags faults;
 void setUp(void) {}
 void tearDown(void) {}
 
+// serviceSingleMotor() only starts moves, so keep servicing it until the valve settles
+void moveToAngle(angle_t targetAngle) {
+    for (int i = 0; i < 100; i++) {
+        serviceSingleMotor(stepEngine, getEncoderAngle(), targetAngle);
+        if (!stepEngine.isBusy()) break;
+        while (stepEngine.isBusy()) {}
+    }
+}
+
 void test_encoder_valid_angle() {
-    float curAngle = getEncoderAngle();
+    angle_t curAngle = getEncoderAngle();
     TEST_ASSERT_TRUE(isAngleValid(curAngle));
 }
 
 void test_motor_move_fwd_ninety() {
-    float oldAngle = getEncoderAngle();
+    angle_t oldAngle = getEncoderAngle();
     TEST_ASSERT_TRUE(isAngleValid(oldAngle));
 
-    float targetAngle = oldAngle > 270.0f ? oldAngle - 270.0f : oldAngle + 90.0f;
-    serviceSingleMotor(stepperDriver, oldAngle, targetAngle);
-    float errDeg = fabs(getEncoderAngle() - targetAngle);
+    angle_t targetAngle = oldAngle > degToAngle(270.0f) ? oldAngle - degToAngle(270.0f) : oldAngle + degToAngle(90.0f);
+    moveToAngle(targetAngle);
+    float errDeg = fabs(angleToDeg(getEncoderAngle() - targetAngle));
     TEST_ASSERT_LESS_THAN_FLOAT(MotorControlConfig::ANGLE_DEADBAND_DEG, errDeg);
 }
 
 void test_motor_move_bck_ninety() {
-    float oldAngle = getEncoderAngle();
+    angle_t oldAngle = getEncoderAngle();
     TEST_ASSERT_TRUE(isAngleValid(oldAngle));
 
-    float targetAngle = oldAngle < 90.0f ? oldAngle + 270.0f : oldAngle - 90.0f;
-    serviceSingleMotor(stepperDriver, oldAngle, targetAngle);
-    float errDeg = fabs(getEncoderAngle() - targetAngle);
+    angle_t targetAngle = oldAngle < degToAngle(90.0f) ? oldAngle + degToAngle(270.0f) : oldAngle - degToAngle(90.0f);
+    moveToAngle(targetAngle);
+    float errDeg = fabs(angleToDeg(getEncoderAngle() - targetAngle));
     TEST_ASSERT_LESS_THAN_FLOAT(MotorControlConfig::ANGLE_DEADBAND_DEG, errDeg);
 }
 
@@ -50,13 +59,8 @@ void setup() {
     SPI.begin(); 
 
     // Configure stepper driver
-    stepperDriver.setChipSelectPin(HardwareConfig::MOTOR_CS_PIN);
-    stepperDriver.resetSettings();
-    stepperDriver.clearStatus();
-    stepperDriver.setDecayMode(HPSDDecayMode::AutoMixed);
-    stepperDriver.setCurrentMilliamps36v4(HardwareConfig::MOTOR_CURRENT_MA);
-    stepperDriver.setStepMode(HPSDStepMode::MicroStep1);
-    stepperDriver.enableDriver();
+    motorDriverBegin();
+    stepEngine.begin(&stepperDriverHooks);
 
     // Initialize encoder
     pinMode(HardwareConfig::ENCODER_CS_PIN, OUTPUT);
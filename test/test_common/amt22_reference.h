@@ -0,0 +1,29 @@
+/* 
+ * The original AMT22 response decoder (bit array checksum), kept as the reference that the
+ * library's decoder is tested and benchmarked against
+ */
+
+#ifndef AMT22_REFERENCE_H
+#define AMT22_REFERENCE_H
+
+#include <AMT22_lib.h>
+
+uint16_t referenceDecodeAMT22(uint16_t currentPosition, uint8_t resolution) {
+    bool binaryArray[16];           //after receiving the position we will populate this array and use it for calculating the checksum
+
+    //run through the 16 bits of position and put each bit into a slot in the array so we can do the checksum calculation
+    for(int i = 0; i < 16; i++) binaryArray[i] = (0x01) & (currentPosition >> (i));
+
+    //using the equation on the datasheet we can calculate the checksums and then make sure they match what the encoder sent
+    if ((binaryArray[15] == !(binaryArray[13] ^ binaryArray[11] ^ binaryArray[9] ^ binaryArray[7] ^ binaryArray[5] ^ binaryArray[3] ^ binaryArray[1])) && (binaryArray[14] == !(binaryArray[12] ^ binaryArray[10] ^ binaryArray[8] ^ binaryArray[6] ^ binaryArray[4] ^ binaryArray[2] ^ binaryArray[0])))
+        currentPosition &= 0x3FFF; //we got back a good position, so just mask away the checkbits
+    else
+        currentPosition = 0xFFFF; //bad position
+
+    //If the resolution is 12-bits, and wasn't 0xFFFF, then shift position, otherwise do nothing
+    if ((resolution == RES12) && (currentPosition != 0xFFFF)) currentPosition = currentPosition >> 2;
+
+    return currentPosition;
+}
+
+#endif // AMT22_REFERENCE_H
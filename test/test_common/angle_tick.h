@@ -0,0 +1,33 @@
+#ifndef ANGLE_TICK_H
+#define ANGLE_TICK_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include <valve_angle.h>
+
+/*
+ * The angle math of one control tick (encoder conversion, dead reckoning, checks, move filter,
+ * target limits and the motor step calculation), for either angle representation. Shared by
+ * the native and the on-target benchmarks.
+ */
+template <typename A>
+long angleControlTick(uint16_t counts, int32_t stepsSinceSample) {
+    typedef AngleOps<A> Ops;
+    constexpr A deadband = Ops::fromDeg(MotorControlConfig::ANGLE_DEADBAND_DEG);
+
+    A current = Ops::fromCounts(counts) + Ops::fromSteps(stepsSinceSample);
+    if (!isAngleValid(current) || isAtStartAngle(current))
+        return 0;
+
+    A delta = Ops::fromDeg(ValveConfig::START_ANGLE) - current;
+    applyMoveFilter(delta);
+    A target = constrainAngle(current + delta);
+
+    A err = target - current;
+    if (Ops::abs(err) <= deadband)
+        return 0;
+    return Ops::toSteps(err);
+}
+
+#endif // ANGLE_TICK_H
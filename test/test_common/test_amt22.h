@@ -0,0 +1,43 @@
+#ifndef TEST_AMT22_H
+#define TEST_AMT22_H
+
+#include <unity.h>
+
+#include <AMT22_lib.h>
+#include "amt22_reference.h"
+
+void test_amt22_decoder_matches_reference() {
+    // Exhaustively over every possible 16-bit response, for both resolutions
+    for (uint32_t response = 0; response <= 0xFFFF; response++) {
+        TEST_ASSERT_EQUAL_HEX16(referenceDecodeAMT22(response, RES12), AMT22::decodeResponse(response, RES12));
+        TEST_ASSERT_EQUAL_HEX16(referenceDecodeAMT22(response, 14), AMT22::decodeResponse(response, 14));
+    }
+}
+
+void test_amt22_checkbits() {
+    // Position 0 has both checkbits set (odd parity over zero data bits)
+    TEST_ASSERT_TRUE(AMT22::checkbitsValid(0xC000));
+    TEST_ASSERT_EQUAL_HEX16(0x0000, AMT22::decodeResponse(0xC000, RES12));
+    TEST_ASSERT_FALSE(AMT22::checkbitsValid(0x0000));
+    TEST_ASSERT_FALSE(AMT22::checkbitsValid(0x4000));
+    TEST_ASSERT_FALSE(AMT22::checkbitsValid(0x8000));
+
+    // A floating MISO line reads as all ones, which is rejected
+    TEST_ASSERT_FALSE(AMT22::checkbitsValid(0xFFFF));
+    TEST_ASSERT_EQUAL_HEX16(0xFFFF, AMT22::decodeResponse(0xFFFF, RES12));
+
+    // Flipping any single bit of a valid response invalidates it
+    const uint16_t valid = 0x61AB;
+    TEST_ASSERT_TRUE(AMT22::checkbitsValid(valid));
+    for (int bit = 0; bit < 16; bit++)
+        TEST_ASSERT_FALSE(AMT22::checkbitsValid(valid ^ (1 << bit)));
+    TEST_ASSERT_EQUAL_HEX16((valid & 0x3FFF) >> 2, AMT22::decodeResponse(valid, RES12));
+}
+
+void run_all_amt22_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_amt22_decoder_matches_reference);
+    RUN_TEST(test_amt22_checkbits);
+}
+
+#endif // TEST_AMT22_H
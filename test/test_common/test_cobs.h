@@ -0,0 +1,75 @@
+#ifndef TEST_COBS_H
+#define TEST_COBS_H
+
+#include <string.h>
+#include <unity.h>
+
+#include <cobs.h>
+
+// Decodes one frame from wire, returns the decoded length or -1 if the frame was malformed
+int decodeCobsFrame(const uint8_t* wire, size_t wireLen, uint8_t* out) {
+    CobsDecoder decoder;
+    int len = 0;
+    for (size_t i = 0; i < wireLen; i++) {
+        uint8_t decoded;
+        switch (decoder.feed(wire[i], decoded)) {
+        case CobsEvent::BYTE: out[len++] = decoded; break;
+        case CobsEvent::FRAME_END: if (len > 0) return len; break;
+        case CobsEvent::FRAME_ERROR: return -1;
+        case CobsEvent::NONE: break;
+        }
+    }
+    return -1;
+}
+
+void test_cobs_round_trip() {
+    static uint8_t data[600], wire[cobsFrameSize(600)], decoded[600];
+    uint32_t seed = 1;
+
+    // Random data with few, many, or no zeros, including blocks longer than 254 bytes
+    for (size_t length = 1; length <= sizeof(data); length += 7) {
+        for (uint8_t zeroEvery = 0; zeroEvery < 3; zeroEvery++) {
+            for (size_t i = 0; i < length; i++) {
+                seed = seed * 1103515245UL + 12345UL;
+                uint8_t byte = (uint8_t)(seed >> 16);
+                data[i] = zeroEvery == 0 ? (byte | 1) : (byte % (zeroEvery * 8) == 0 ? 0 : byte);
+            }
+
+            CobsEncoder encoder(wire);
+            encoder.add(data, length);
+            size_t wireLen = encoder.finish();
+
+            TEST_ASSERT_LESS_OR_EQUAL(cobsFrameSize(length), wireLen);
+            TEST_ASSERT_EQUAL_HEX8(COBS_DELIMITER, wire[0]);
+            TEST_ASSERT_EQUAL_HEX8(COBS_DELIMITER, wire[wireLen - 1]);
+            TEST_ASSERT_NULL(memchr(wire + 1, COBS_DELIMITER, wireLen - 2));
+
+            TEST_ASSERT_EQUAL_INT((int)length, decodeCobsFrame(wire, wireLen, decoded));
+            TEST_ASSERT_EQUAL_MEMORY(data, decoded, length);
+        }
+    }
+}
+
+void test_cobs_truncated_frame() {
+    const uint8_t data[] = {0x11, 0x00, 0x22, 0x33, 0x00};
+    uint8_t wire[cobsFrameSize(sizeof(data))], decoded[sizeof(data)];
+    CobsEncoder encoder(wire);
+    encoder.add(data, sizeof(data));
+    size_t wireLen = encoder.finish();
+
+    // A delimiter in the middle of a block is reported, and the decoder starts over after it
+    uint8_t truncated[6];
+    memcpy(truncated, wire, 5);
+    truncated[5] = COBS_DELIMITER;
+    TEST_ASSERT_EQUAL_INT(-1, decodeCobsFrame(truncated, sizeof(truncated), decoded));
+    TEST_ASSERT_EQUAL_INT((int)sizeof(data), decodeCobsFrame(wire, wireLen, decoded));
+    TEST_ASSERT_EQUAL_MEMORY(data, decoded, sizeof(data));
+}
+
+void run_all_cobs_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_cobs_round_trip);
+    RUN_TEST(test_cobs_truncated_frame);
+}
+
+#endif // TEST_COBS_H
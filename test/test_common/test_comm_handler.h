@@ -7,24 +7,41 @@
 // #include "debug.h"
 #include "config.h"
 #include <comm_handler.h>
+#include <serial_rx.h>
+#include <telemetry_decoder.h>
+#include "test_tx_queue.h" // Fake TX hooks
+
+#ifdef BUILD_NATIVE
+    #include <ArduinoFake.h>
+    using namespace fakeit;
+#endif
 
 extern bool MPV_STATE;
 
 // Because we extern some symbols which are accessible to utilities.h
 #include <AMT22_lib.h>
 #include <controller.h>
+#include <encoder_sampler.h>
+#include <position_estimator.h>
 #include <pressure_sensor.h>
+#include <step_engine.h>
 #include <utilities.h>
 #include "state_machine.h"
 AMT22* encoder;
+StepEngine stepEngine;
+PositionEstimator positionEstimator;
+EncoderSampler encoderSampler(sampleEncoder);
 CommHandler* commHandler;
 Controller* controller;
 PressureSensor* pressureSensor;
 SystemState systemState;
 ChannelState channel;
 FaultFlags faults;
+FlightRecorder flightRecorder;
+Tunables tunables;
 
 pressureUpdatePacketU_t testPUP;
+uint16_t testPUPSequence = 0; // Every populated packet is a new sample
 constexpr float defaultPt1Reading = (SensorConfig::P_MIN + SensorConfig::P_MAX) / 2;
 constexpr float defaultPt2Reading = SensorConfig::P_MIN + (SensorConfig::P_MAX - SensorConfig::P_MIN) / 3;
 
@@ -35,6 +52,7 @@ void populatePUP(uint16_t _magic, bool calcChecksum, uint16_t _checksum, SystemS
     
     testPUP.data._magic = _magic;
     testPUP.data.otherState = otherState;
+    testPUP.data.sequence = testPUPSequence++;
 
     testPUP.data.flags = 0;
     if (ifMpvOpen) testPUP.data.flags |= UPDTPKT_FLAGS_MPV_OPEN;
@@ -51,6 +69,27 @@ void populatePUP(uint16_t _magic, bool calcChecksum, uint16_t _checksum, SystemS
     else testPUP.data._checksum = _checksum;
 }
 
+// Writes testPUP to wire as it is sent (in a COBS frame with USE_COBS_FRAMING), returns its length
+unsigned int wireTestPUP(uint8_t* wire) {
+#ifdef USE_COBS_FRAMING
+    CobsEncoder encoder(wire);
+    encoder.add(COMM_PROTOCOL_VERSION);
+    encoder.add(testPUP.bytes, UPDTPKT_SIZE);
+    return encoder.finish();
+#else
+    memcpy(wire, testPUP.bytes, UPDTPKT_SIZE);
+    return UPDTPKT_SIZE;
+#endif
+}
+
+// Sends bytes [first, last) of testPUP as it is sent on the wire
+void sendTestPUP(CommHandler& commHandler, unsigned int first = 0, unsigned int last = 0xffff) {
+    uint8_t wire[cobsFrameSize(UPDTPKT_SIZE + 1)];
+    unsigned int wireLen = wireTestPUP(wire);
+    for (unsigned int i=first; i<wireLen && i<last; i++)
+        commHandler.processIncomingSerialByte(wire[i]);
+}
+
 void assembleDefaultValidPUP() {
     populatePUP(MAGIC_START, true, 0x0, SystemStateEnum::CLOSED_LOOP, true, 
                 defaultPt1Reading, defaultPt2Reading);
@@ -61,8 +100,7 @@ void test_comm_handler_receive_valid_packet() {
     assembleDefaultValidPUP();
 
     // Send packet
-    for (unsigned int i=0; i<UPDTPKT_SIZE; i++)
-        commHandler.processIncomingSerialByte(testPUP.bytes[i]);
+    sendTestPUP(commHandler);
         
     TEST_ASSERT_EQUAL(SystemStateEnum::CLOSED_LOOP, commHandler.getOtherCtrlerState());
     TEST_ASSERT_TRUE(MPV_STATE);
@@ -80,8 +118,7 @@ void test_comm_handler_receive_valid_packet_in_between_bytes() {
     for (int i=0; i<=0xff; i++) commHandler.processIncomingSerialByte(uint8_t(i));
 
     // Send packet
-    for (unsigned int i=0; i<UPDTPKT_SIZE; i++)
-        commHandler.processIncomingSerialByte(testPUP.bytes[i]);
+    sendTestPUP(commHandler);
 
     // Send some more junk bytes
     for (int i=0xff; i>=0; i--) commHandler.processIncomingSerialByte(uint8_t(i));
@@ -99,17 +136,364 @@ void test_comm_handler_invalid_checksum() {
     assembleDefaultValidPUP();
     testPUP.data._checksum = calcCRC16(testPUP.bytes + 4, UPDTPKT_SIZE - 4) - 1;
 
-    for (unsigned int i=0; i<UPDTPKT_SIZE; i++)
-        commHandler.processIncomingSerialByte(testPUP.bytes[i]);
+    sendTestPUP(commHandler);
     
     TEST_ASSERT_FALSE(commHandler.getPressureUpdateSuccess());
+    TEST_ASSERT_EQUAL(1, commHandler.getLinkStats().crcErrors);
+}
+
+void test_comm_handler_back_to_back_packets() {
+    CommHandler commHandler;
+
+    // The checksum of each packet must start over, whatever came before it
+    populatePUP(MAGIC_START, true, 0x0, SystemStateEnum::OPEN_LOOP_INIT, false, defaultPt2Reading, defaultPt1Reading);
+    sendTestPUP(commHandler);
+    TEST_ASSERT_TRUE(commHandler.getPressureUpdateSuccess());
+    TEST_ASSERT_EQUAL_FLOAT(defaultPt2Reading, commHandler.getPressureData().sensor1);
+
+    assembleDefaultValidPUP();
+    sendTestPUP(commHandler);
+    TEST_ASSERT_TRUE(commHandler.getPressureUpdateSuccess());
+    TEST_ASSERT_EQUAL(SystemStateEnum::CLOSED_LOOP, commHandler.getOtherCtrlerState());
+    TEST_ASSERT_EQUAL_FLOAT(defaultPt1Reading, commHandler.getPressureData().sensor1);
+}
+
+void test_comm_handler_packet_after_flush() {
+    CommHandler commHandler;
+    assembleDefaultValidPUP();
+
+    // Half a packet, then the input is flushed (as after a motor move)
+    sendTestPUP(commHandler, 0, UPDTPKT_SIZE / 2);
+    commHandler.flushInputBuffer();
+
+    sendTestPUP(commHandler);
+
+    TEST_ASSERT_TRUE(commHandler.getPressureUpdateSuccess());
+    TEST_ASSERT_EQUAL_FLOAT(defaultPt2Reading, commHandler.getPressureData().sensor2);
+}
+
+void test_comm_handler_drains_rx_ring() {
+    CommHandler commHandler;
+    assembleDefaultValidPUP();
+
+    // More than one batch of junk, then the packet, as the RX ISR would leave them
+    uint8_t wire[cobsFrameSize(UPDTPKT_SIZE + 1)];
+    unsigned int wireLen = wireTestPUP(wire);
+    for (int i=0; i<64; i++) serialRxRing.push(0x55);
+    for (unsigned int i=0; i<wireLen; i++) serialRxRing.push(wire[i]);
+    TEST_ASSERT_EQUAL(64 + wireLen, serialRxRing.available()); // Nothing dropped
+
+    commHandler.processIncomingNonBlocking();
+
+    TEST_ASSERT_EQUAL(0, serialRxRing.available());
+    TEST_ASSERT_TRUE(commHandler.getPressureUpdateSuccess());
+    TEST_ASSERT_EQUAL(SystemStateEnum::CLOSED_LOOP, commHandler.getOtherCtrlerState());
+    TEST_ASSERT_EQUAL(1, commHandler.getLinkStats().resyncs); // Once for the whole run of junk
+}
+
+// Sends the default packet with the given sequence number, returns whether it was a new sample
+bool sendTestPUPWithSequence(CommHandler& commHandler, uint16_t sequence, float pt1Reading) {
+    populatePUP(MAGIC_START, false, 0x0, SystemStateEnum::CLOSED_LOOP, true, pt1Reading, defaultPt2Reading);
+    testPUP.data.sequence = sequence;
+    testPUP.data._checksum = crc16Xmodem(testPUP.bytes + 4, UPDTPKT_SIZE - 4);
+    sendTestPUP(commHandler);
+    TEST_ASSERT_TRUE(commHandler.getPressureUpdateSuccess());
+    return commHandler.takeNewSample();
+}
+
+void test_comm_handler_sequence_tracking() {
+    CommHandler commHandler;
+    TEST_ASSERT_FALSE(commHandler.takeNewSample());
+
+    TEST_ASSERT_TRUE(sendTestPUPWithSequence(commHandler, 10, 100.0f));
+    TEST_ASSERT_FALSE(commHandler.takeNewSample()); // Only once per sample
+    TEST_ASSERT_TRUE(sendTestPUPWithSequence(commHandler, 11, 101.0f));
+
+    // Repeated and late packets are ignored
+    TEST_ASSERT_FALSE(sendTestPUPWithSequence(commHandler, 11, 200.0f));
+    TEST_ASSERT_TRUE(sendTestPUPWithSequence(commHandler, 14, 104.0f));
+    TEST_ASSERT_FALSE(sendTestPUPWithSequence(commHandler, 12, 200.0f));
+    TEST_ASSERT_EQUAL_FLOAT(104.0f, commHandler.getPressureData().sensor1);
+
+    // Far behind: the Pi restarted, nothing lost
+    TEST_ASSERT_TRUE(sendTestPUPWithSequence(commHandler, 1000, 105.0f));
+    TEST_ASSERT_TRUE(sendTestPUPWithSequence(commHandler, 0, 106.0f));
+    TEST_ASSERT_TRUE(sendTestPUPWithSequence(commHandler, 1, 107.0f));
+
+    const LinkStats& link = commHandler.getLinkStats();
+    TEST_ASSERT_EQUAL(8, link.received);
+    TEST_ASSERT_EQUAL(1, link.lastSequence);
+    TEST_ASSERT_EQUAL(2 + 985, link.lost); // 12, 13 and 15 to 999
+    TEST_ASSERT_EQUAL(2, link.duplicates);
+    TEST_ASSERT_EQUAL(0, link.crcErrors);
+}
+
+#ifdef BUILD_NATIVE
+void test_comm_handler_jitter() {
+    CommHandler commHandler;
+    const unsigned long arrivalsUs[] = { 1000, 2000, 3000, 4500 };
+    for (uint16_t i = 0; i < 4; i++) {
+        When(Method(ArduinoFake(), micros)).AlwaysReturn(arrivalsUs[i]);
+        sendTestPUPWithSequence(commHandler, i, 100.0f);
+    }
+    // Steady until one packet 500 us late: J = 500 / 16
+    TEST_ASSERT_EQUAL(500 / 16, commHandler.getLinkStats().jitterUs);
+    When(Method(ArduinoFake(), micros)).AlwaysReturn();
+}
+#endif
+
+#ifdef BUILD_NATIVE
+void test_comm_handler_timestamp_echo() {
+    CommHandler commHandler(&fakeTxHooks);
+    populatePUP(MAGIC_START, false, 0x0, SystemStateEnum::CLOSED_LOOP, true, defaultPt1Reading, defaultPt2Reading);
+    testPUP.data.piTimestamp = 123456789;
+    testPUP.data._checksum = crc16Xmodem(testPUP.bytes + 4, UPDTPKT_SIZE - 4);
+
+    // The reception time is when the packet starts, not when it is complete
+    When(Method(ArduinoFake(), micros)).AlwaysReturn(5000);
+    sendTestPUP(commHandler, 0, 4);
+    When(Method(ArduinoFake(), micros)).AlwaysReturn(6000);
+    sendTestPUP(commHandler, 4);
+    TEST_ASSERT_TRUE(commHandler.getPressureUpdateSuccess());
+    TEST_ASSERT_EQUAL(5000, commHandler.getSampleRxUs());
+
+    When(Method(ArduinoFake(), micros)).AlwaysReturn(9000);
+    resetFakeTx(sizeof(txWritten));
+    commHandler.sendTelemetry(SystemStateEnum::CLOSED_LOOP, 0.0f, 0.0f, 0.0f, "FUEL", false);
+#ifndef USE_COBS_FRAMING
+    TelemetrySample sent;
+    TEST_ASSERT_EQUAL(TelemetryDecodeResult::OK, decodeTelemetryPacket(txWritten, TX_TELPKT_SIZE, sent));
+    TEST_ASSERT_EQUAL(123456789, sent.piTimestampEcho);
+    TEST_ASSERT_EQUAL(5000, sent.sampleRxUs);
+    TEST_ASSERT_EQUAL(9000, sent.txUs);
+#endif
+    When(Method(ArduinoFake(), micros)).AlwaysReturn();
+}
+#endif
+
+void test_comm_handler_telemetry_link_stats() {
+    CommHandler commHandler(&fakeTxHooks);
+    sendTestPUPWithSequence(commHandler, 5, 100.0f);
+    sendTestPUPWithSequence(commHandler, 7, 100.0f);
+
+    resetFakeTx(sizeof(txWritten));
+    commHandler.sendTelemetry(SystemStateEnum::CLOSED_LOOP, 0.0f, 0.0f, 0.0f, "FUEL", false);
+    commHandler.sendTelemetry(SystemStateEnum::CLOSED_LOOP, 0.0f, 0.0f, 0.0f, "FUEL", false);
+#ifndef USE_COBS_FRAMING
+    TelemetrySample sent;
+    TEST_ASSERT_EQUAL(TelemetryDecodeResult::OK, decodeTelemetryPacket(txWritten + TX_TELPKT_SIZE, TX_TELPKT_SIZE, sent));
+    TEST_ASSERT_EQUAL(1, sent.sequence);
+    TEST_ASSERT_EQUAL(2, sent.link.received);
+    TEST_ASSERT_EQUAL(7, sent.link.lastSequence);
+    TEST_ASSERT_EQUAL(1, sent.link.lost);
+#endif
+}
+
+void test_comm_handler_telemetry_does_not_block() {
+    CommHandler commHandler(&fakeTxHooks);
+    resetFakeTx(0);
+
+    // TX buffer full: telemetry is queued, and a newer packet replaces the stale one
+    commHandler.sendTelemetry(SystemStateEnum::CLOSED_LOOP, 10.0f, 0.5f, 0.1f, "FUEL", false);
+    commHandler.sendTelemetry(SystemStateEnum::CLOSED_LOOP, 20.0f, 0.5f, 0.1f, "FUEL", false);
+    TEST_ASSERT_EQUAL(0, txWrittenLen);
+    TEST_ASSERT_EQUAL(1, commHandler.getTxStats().coalesced);
+
+    txRoom = txFrameSize(TX_TELPKT_SIZE);
+    commHandler.processOutgoingNonBlocking();
+    TEST_ASSERT_EQUAL(txFrameSize(TX_TELPKT_SIZE), txWrittenLen);
+    TEST_ASSERT_EQUAL(1, commHandler.getTxStats().sent);
+
+    // The counters go out with the next telemetry packet
+    txRoom = txFrameSize(TX_TELPKT_SIZE);
+    commHandler.sendTelemetry(SystemStateEnum::CLOSED_LOOP, 30.0f, 0.5f, 0.1f, "FUEL", false);
+    TEST_ASSERT_EQUAL(2 * txFrameSize(TX_TELPKT_SIZE), txWrittenLen);
+#ifndef USE_COBS_FRAMING
+    TelemetrySample sent;
+    TEST_ASSERT_EQUAL(TelemetryDecodeResult::OK, decodeTelemetryPacket(txWritten + TX_TELPKT_SIZE, TX_TELPKT_SIZE, sent));
+    TEST_ASSERT_EQUAL_FLOAT(30.0f, sent.motorAngle);
+    TEST_ASSERT_EQUAL(1, sent.txSent);
+    TEST_ASSERT_EQUAL(1, sent.txCoalesced);
+    TEST_ASSERT_EQUAL(0, sent.txDropped);
+#endif
+}
+
+// Number of event packets written to the fake TX so far
+size_t numEventsSent() {
+    return txWrittenLen / txFrameSize(EVTPKT_SIZE);
+}
+
+void test_comm_handler_event_sent_immediately() {
+    CommHandler commHandler(&fakeTxHooks);
+    resetFakeTx(sizeof(txWritten));
+
+    commHandler.queueEvent(EventType::STATE_CHANGE, SystemStateEnum::CLOSED_LOOP, SystemStateEnum::EMERGENCY_STOP,
+                           TELPKT_FAULTS_ENCODER_ERROR);
+    TEST_ASSERT_EQUAL(txFrameSize(EVTPKT_SIZE), txWrittenLen);
+#ifndef USE_COBS_FRAMING
+    eventPacketU_t sent;
+    memcpy(sent.bytes, txWritten, EVTPKT_SIZE);
+    TEST_ASSERT_EQUAL_HEX16(MAGIC_EVENT, sent.data._magic);
+    TEST_ASSERT_EQUAL_HEX16(crc16Xmodem(sent.bytes + 4, EVTPKT_SIZE - 4), sent.data._checksum);
+    TEST_ASSERT_EQUAL(EventType::STATE_CHANGE, sent.data.type);
+    TEST_ASSERT_EQUAL(SystemStateEnum::CLOSED_LOOP, sent.data.oldState);
+    TEST_ASSERT_EQUAL(SystemStateEnum::EMERGENCY_STOP, sent.data.newState);
+    TEST_ASSERT_EQUAL_HEX8(TELPKT_FAULTS_ENCODER_ERROR, sent.data.faults);
+    TEST_ASSERT_EQUAL(0, sent.data.eventsDropped);
+#endif
+}
+
+void test_comm_handler_state_change_hook() {
+    static int numChanges;
+    static SystemStateEnum lastFrom, lastTo;
+    numChanges = 0;
+
+    SystemState state;
+    state.onStateChange = [](SystemStateEnum from, SystemStateEnum to) { numChanges++; lastFrom = from; lastTo = to; };
+    state.changeStateTo(SystemStateEnum::BOOT_INIT); // No change
+    TEST_ASSERT_EQUAL(0, numChanges);
+    state.changeStateTo(SystemStateEnum::OPEN_LOOP_INIT);
+    TEST_ASSERT_EQUAL(1, numChanges);
+    TEST_ASSERT_EQUAL(SystemStateEnum::BOOT_INIT, lastFrom);
+    TEST_ASSERT_EQUAL(SystemStateEnum::OPEN_LOOP_INIT, lastTo);
+}
+
+#ifdef BUILD_NATIVE
+void test_comm_handler_events_rate_limited() {
+    When(Method(ArduinoFake(), millis)).AlwaysReturn(1000);
+    CommHandler commHandler(&fakeTxHooks);
+    resetFakeTx(sizeof(txWritten));
+
+    // A burst: the first goes out, the next ones wait, and those beyond the queue are dropped
+    for (int i = 0; i < 7; i++)
+        commHandler.queueEvent(EventType::STATE_CHANGE, SystemStateEnum::CLOSED_LOOP, SystemStateEnum::FORCED_OPEN_LOOP, 0);
+    TEST_ASSERT_EQUAL(1, numEventsSent());
+
+    When(Method(ArduinoFake(), millis)).AlwaysReturn(1000 + CommConfig::EVENT_MIN_INTERVAL_MS - 1);
+    commHandler.processOutgoingNonBlocking();
+    TEST_ASSERT_EQUAL(1, numEventsSent());
+
+    for (unsigned long i = 1; i <= 5; i++) {
+        When(Method(ArduinoFake(), millis)).AlwaysReturn(1000 + i * CommConfig::EVENT_MIN_INTERVAL_MS);
+        commHandler.processOutgoingNonBlocking();
+    }
+    TEST_ASSERT_EQUAL(5, numEventsSent());
+#ifndef USE_COBS_FRAMING
+    // The held back events keep their own timestamps
+    eventPacketU_t last;
+    memcpy(last.bytes, txWritten + 4 * EVTPKT_SIZE, EVTPKT_SIZE);
+    TEST_ASSERT_EQUAL(1000, last.data.timestampMs);
+    TEST_ASSERT_EQUAL(2, last.data.eventsDropped);
+#endif
+    When(Method(ArduinoFake(), millis)).AlwaysReturn();
+}
+
+void test_comm_handler_reports_new_faults() {
+    When(Method(ArduinoFake(), millis)).AlwaysReturn(1000);
+    CommHandler commHandler(&fakeTxHooks);
+    resetFakeTx(sizeof(txWritten));
+    faults.clear();
+
+    commHandler.reportNewFaults(SystemStateEnum::CLOSED_LOOP);
+    TEST_ASSERT_EQUAL(0, numEventsSent());
+
+    faults.sensorFault = true;
+    commHandler.reportNewFaults(SystemStateEnum::CLOSED_LOOP);
+    commHandler.reportNewFaults(SystemStateEnum::CLOSED_LOOP); // Still set, not new
+    TEST_ASSERT_EQUAL(1, numEventsSent());
+
+    When(Method(ArduinoFake(), millis)).AlwaysReturn(2000);
+    faults.redBandFault = true;
+    commHandler.reportNewFaults(SystemStateEnum::FORCED_OPEN_LOOP);
+    TEST_ASSERT_EQUAL(2, numEventsSent());
+#ifndef USE_COBS_FRAMING
+    eventPacketU_t sent;
+    memcpy(sent.bytes, txWritten + EVTPKT_SIZE, EVTPKT_SIZE);
+    TEST_ASSERT_EQUAL(EventType::FAULT_LATCHED, sent.data.type);
+    TEST_ASSERT_EQUAL(SystemStateEnum::FORCED_OPEN_LOOP, sent.data.newState);
+    TEST_ASSERT_EQUAL_HEX8(TELPKT_FAULTS_REDBAND_FAULT, sent.data.faults);
+#endif
+
+    faults.clear();
+    When(Method(ArduinoFake(), millis)).AlwaysReturn();
+}
+#endif
+
+#ifdef USE_COBS_FRAMING
+void test_comm_handler_cobs_magic_in_payload() {
+    CommHandler commHandler;
+
+    // Readings whose bytes contain zeros and the magic bytes
+    float pt1Reading, pt2Reading;
+    const uint8_t pt1Bytes[4] = {0xfb, 0xad, 0x00, 0x42};
+    const uint8_t pt2Bytes[4] = {0x00, 0x00, 0xfb, 0x41};
+    memcpy(&pt1Reading, pt1Bytes, 4);
+    memcpy(&pt2Reading, pt2Bytes, 4);
+    populatePUP(MAGIC_START, true, 0x0, SystemStateEnum::CLOSED_LOOP, true, pt1Reading, pt2Reading);
+    sendTestPUP(commHandler);
+
+    TEST_ASSERT_TRUE(commHandler.getPressureUpdateSuccess());
+    TEST_ASSERT_EQUAL_FLOAT(pt1Reading, commHandler.getPressureData().sensor1);
+    TEST_ASSERT_EQUAL_FLOAT(pt2Reading, commHandler.getPressureData().sensor2);
+}
+
+void test_comm_handler_cobs_resync_after_truncated_frame() {
+    CommHandler commHandler;
+
+    // A frame cut off in the middle, directly followed by a complete one: only the first is lost
+    populatePUP(MAGIC_START, true, 0x0, SystemStateEnum::OPEN_LOOP_INIT, false, defaultPt2Reading, defaultPt2Reading);
+    sendTestPUP(commHandler, 0, UPDTPKT_SIZE / 2);
+    assembleDefaultValidPUP();
+    sendTestPUP(commHandler);
+
+    TEST_ASSERT_TRUE(commHandler.getPressureUpdateSuccess());
+    TEST_ASSERT_EQUAL(SystemStateEnum::CLOSED_LOOP, commHandler.getOtherCtrlerState());
+    TEST_ASSERT_EQUAL_FLOAT(defaultPt1Reading, commHandler.getPressureData().sensor1);
+}
+
+void test_comm_handler_cobs_other_version_dropped() {
+    CommHandler commHandler;
+    assembleDefaultValidPUP();
+
+    uint8_t wire[cobsFrameSize(UPDTPKT_SIZE + 1)];
+    CobsEncoder encoder(wire);
+    encoder.add(COMM_PROTOCOL_VERSION + 1);
+    encoder.add(testPUP.bytes, UPDTPKT_SIZE);
+    size_t wireLen = encoder.finish();
+    for (size_t i = 0; i < wireLen; i++)
+        commHandler.processIncomingSerialByte(wire[i]);
+
+    TEST_ASSERT_FALSE(commHandler.getPressureUpdateSuccess());
+    TEST_ASSERT_EQUAL(SystemStateEnum::BOOT_INIT, commHandler.getOtherCtrlerState());
 }
+#endif
 
 void run_all_comm_handler_tests() {
     UnitySetTestFile(__FILE__);
     RUN_TEST(test_comm_handler_receive_valid_packet);
     RUN_TEST(test_comm_handler_receive_valid_packet_in_between_bytes);
     RUN_TEST(test_comm_handler_invalid_checksum);
+    RUN_TEST(test_comm_handler_back_to_back_packets);
+    RUN_TEST(test_comm_handler_packet_after_flush);
+    RUN_TEST(test_comm_handler_drains_rx_ring);
+    RUN_TEST(test_comm_handler_sequence_tracking);
+    RUN_TEST(test_comm_handler_telemetry_link_stats);
+#ifdef BUILD_NATIVE
+    RUN_TEST(test_comm_handler_jitter);
+    RUN_TEST(test_comm_handler_timestamp_echo);
+#endif
+    RUN_TEST(test_comm_handler_telemetry_does_not_block);
+    RUN_TEST(test_comm_handler_event_sent_immediately);
+    RUN_TEST(test_comm_handler_state_change_hook);
+#ifdef BUILD_NATIVE
+    RUN_TEST(test_comm_handler_events_rate_limited);
+    RUN_TEST(test_comm_handler_reports_new_faults);
+#endif
+#ifdef USE_COBS_FRAMING
+    RUN_TEST(test_comm_handler_cobs_magic_in_payload);
+    RUN_TEST(test_comm_handler_cobs_resync_after_truncated_frame);
+    RUN_TEST(test_comm_handler_cobs_other_version_dropped);
+#endif
 }
 
 #endif // TEST_COMM_HANDLER_H
\ No newline at end of file
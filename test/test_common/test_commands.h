@@ -0,0 +1,230 @@
+#ifndef TEST_COMMANDS_H
+#define TEST_COMMANDS_H
+
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+
+#include <comm_handler.h>
+#include <utilities.h>
+#include "test_comm_handler.h" // Globals and the pressure update packet helpers
+#include "test_tx_queue.h" // Fake TX hooks
+
+float fakeCommandValue = 0.0f;
+
+// Applies the value rounded, so that the ACK shows the value in effect
+float applyFakeCommand(float value) {
+    fakeCommandValue = roundf(value);
+    return fakeCommandValue;
+}
+
+const CommandSpec fakeCommands[] PROGMEM = {
+    { CommandType::SET_TARGET_PRESSURE, 100.0f, 500.0f, applyFakeCommand }
+};
+
+// Sends a command packet (as it is sent on the wire), with a checksum off by checksumError
+void sendTestCommand(CommHandler& commHandler, CommandType type, uint16_t commandId, float value, uint16_t checksumError = 0) {
+    commandPacketU_t command;
+    command.data._magic = MAGIC_COMMAND;
+    command.data.type = type;
+    command.data._unused = 0;
+    command.data.commandId = commandId;
+    command.data.value = value;
+    command.data._checksum = crc16Xmodem(command.bytes + 4, CMDPKT_SIZE - 4) + checksumError;
+
+    uint8_t wire[cobsFrameSize(CMDPKT_SIZE + 1)];
+#ifdef USE_COBS_FRAMING
+    CobsEncoder encoder(wire);
+    encoder.add(COMM_PROTOCOL_VERSION);
+    encoder.add(command.bytes, CMDPKT_SIZE);
+    size_t wireLen = encoder.finish();
+#else
+    memcpy(wire, command.bytes, CMDPKT_SIZE);
+    size_t wireLen = CMDPKT_SIZE;
+#endif
+    for (size_t i = 0; i < wireLen; i++)
+        commHandler.processIncomingSerialByte(wire[i]);
+}
+
+// Takes the ACK packets written to the fake TX, returns how many there were
+size_t takeAcks(ackPacketU_t* acks, size_t maxAcks) {
+    TEST_ASSERT_EQUAL(0, txWrittenLen % txFrameSize(ACKPKT_SIZE));
+    size_t numAcks = txWrittenLen / txFrameSize(ACKPKT_SIZE);
+    TEST_ASSERT_TRUE(numAcks <= maxAcks);
+
+    for (size_t n = 0; n < numAcks; n++) {
+        const uint8_t* frame = txWritten + n * txFrameSize(ACKPKT_SIZE);
+#ifdef USE_COBS_FRAMING
+        uint8_t packet[ACKPKT_SIZE + 1];
+        size_t length = 0;
+        CobsDecoder decoder;
+        uint8_t decoded;
+        for (size_t i = 1; i < txFrameSize(ACKPKT_SIZE); i++) {
+            if (decoder.feed(frame[i], decoded) == CobsEvent::BYTE) {
+                TEST_ASSERT_TRUE(length < sizeof(packet));
+                packet[length++] = decoded;
+            }
+        }
+        TEST_ASSERT_EQUAL(ACKPKT_SIZE + 1, length);
+        TEST_ASSERT_EQUAL(COMM_PROTOCOL_VERSION, packet[0]);
+        memcpy(acks[n].bytes, packet + 1, ACKPKT_SIZE);
+#else
+        memcpy(acks[n].bytes, frame, ACKPKT_SIZE);
+#endif
+        TEST_ASSERT_EQUAL_HEX16(MAGIC_ACK, acks[n].data._magic);
+        TEST_ASSERT_EQUAL_HEX16(crc16Xmodem(acks[n].bytes + 4, ACKPKT_SIZE - 4), acks[n].data._checksum);
+    }
+    resetFakeTx(sizeof(txWritten));
+    return numAcks;
+}
+
+void test_commands_applied_and_acked() {
+    CommHandler commHandler(&fakeTxHooks);
+    commHandler.setCommandTable(fakeCommands, 1);
+    resetFakeTx(sizeof(txWritten));
+    systemState.currentState = SystemStateEnum::BOOT_INIT;
+
+    sendTestCommand(commHandler, CommandType::SET_TARGET_PRESSURE, 42, 250.4f);
+    TEST_ASSERT_EQUAL_FLOAT(250.0f, fakeCommandValue);
+
+    ackPacketU_t ack;
+    TEST_ASSERT_EQUAL(1, takeAcks(&ack, 1));
+    TEST_ASSERT_EQUAL(CommandType::SET_TARGET_PRESSURE, ack.data.type);
+    TEST_ASSERT_EQUAL(CommandStatus::APPLIED, ack.data.status);
+    TEST_ASSERT_EQUAL(42, ack.data.commandId);
+    TEST_ASSERT_EQUAL_FLOAT(250.0f, ack.data.appliedValue);
+}
+
+void test_commands_only_in_safe_states() {
+    CommHandler commHandler(&fakeTxHooks);
+    commHandler.setCommandTable(fakeCommands, 1);
+    resetFakeTx(sizeof(txWritten));
+    fakeCommandValue = 0.0f;
+
+    const SystemStateEnum unsafeStates[] = { SystemStateEnum::CLOSED_LOOP, SystemStateEnum::FORCED_OPEN_LOOP,
+                                             SystemStateEnum::EMERGENCY_STOP };
+    ackPacketU_t ack;
+    for (SystemStateEnum state : unsafeStates) {
+        systemState.currentState = state;
+        sendTestCommand(commHandler, CommandType::SET_TARGET_PRESSURE, 1, 200.0f);
+        TEST_ASSERT_EQUAL(1, takeAcks(&ack, 1));
+        TEST_ASSERT_EQUAL(CommandStatus::UNSAFE_STATE, ack.data.status);
+        TEST_ASSERT_EQUAL_FLOAT(200.0f, ack.data.appliedValue);
+        TEST_ASSERT_EQUAL_FLOAT(0.0f, fakeCommandValue);
+    }
+
+    systemState.currentState = SystemStateEnum::OPEN_LOOP_INIT;
+    sendTestCommand(commHandler, CommandType::SET_TARGET_PRESSURE, 2, 200.0f);
+    TEST_ASSERT_EQUAL(1, takeAcks(&ack, 1));
+    TEST_ASSERT_EQUAL(CommandStatus::APPLIED, ack.data.status);
+    TEST_ASSERT_EQUAL_FLOAT(200.0f, fakeCommandValue);
+    systemState.currentState = SystemStateEnum::BOOT_INIT;
+}
+
+void test_commands_rejected() {
+    CommHandler commHandler(&fakeTxHooks);
+    commHandler.setCommandTable(fakeCommands, 1);
+    resetFakeTx(sizeof(txWritten));
+    systemState.currentState = SystemStateEnum::BOOT_INIT;
+    fakeCommandValue = 0.0f;
+
+    // Out of bounds (NaN included), and a type missing from the table
+    sendTestCommand(commHandler, CommandType::SET_TARGET_PRESSURE, 1, 99.0f);
+    sendTestCommand(commHandler, CommandType::SET_TARGET_PRESSURE, 2, 501.0f);
+    sendTestCommand(commHandler, CommandType::SET_TARGET_PRESSURE, 3, NAN);
+    sendTestCommand(commHandler, CommandType::SET_KP, 4, 0.1f);
+    sendTestCommand(commHandler, (CommandType)0xee, 5, 0.1f);
+
+    ackPacketU_t acks[5];
+    TEST_ASSERT_EQUAL(5, takeAcks(acks, 5));
+    const CommandStatus expected[] = { CommandStatus::OUT_OF_BOUNDS, CommandStatus::OUT_OF_BOUNDS, CommandStatus::OUT_OF_BOUNDS,
+                                       CommandStatus::UNKNOWN_TYPE, CommandStatus::UNKNOWN_TYPE };
+    for (uint8_t i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(i + 1, acks[i].data.commandId);
+        TEST_ASSERT_EQUAL(expected[i], acks[i].data.status);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(501.0f, acks[1].data.appliedValue);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, fakeCommandValue);
+
+    // A corrupted command is not answered
+    sendTestCommand(commHandler, CommandType::SET_TARGET_PRESSURE, 6, 200.0f, 1);
+    TEST_ASSERT_EQUAL(0, txWrittenLen);
+    TEST_ASSERT_EQUAL(1, commHandler.getLinkStats().crcErrors);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, fakeCommandValue);
+}
+
+void test_commands_between_pressure_updates() {
+    CommHandler commHandler(&fakeTxHooks);
+    commHandler.setCommandTable(fakeCommands, 1);
+    resetFakeTx(sizeof(txWritten));
+    systemState.currentState = SystemStateEnum::BOOT_INIT;
+
+    TEST_ASSERT_TRUE(sendTestPUPWithSequence(commHandler, 1, 100.0f));
+    sendTestCommand(commHandler, CommandType::SET_TARGET_PRESSURE, 7, 300.0f);
+    TEST_ASSERT_TRUE(sendTestPUPWithSequence(commHandler, 2, 200.0f));
+
+    ackPacketU_t ack;
+    TEST_ASSERT_EQUAL(1, takeAcks(&ack, 1));
+    TEST_ASSERT_EQUAL(CommandStatus::APPLIED, ack.data.status);
+    TEST_ASSERT_EQUAL_FLOAT(200.0f, commHandler.getPressureData().sensor1);
+    TEST_ASSERT_EQUAL(2, commHandler.getLinkStats().received);
+    TEST_ASSERT_EQUAL(0, commHandler.getLinkStats().lost);
+}
+
+void test_commands_tuning_table() {
+    CommHandler commHandler(&fakeTxHooks);
+    commHandler.setCommandTable(tuningCommands, NUM_TUNING_COMMANDS);
+    resetFakeTx(sizeof(txWritten));
+    systemState.currentState = SystemStateEnum::BOOT_INIT;
+    Controller testController;
+    controller = &testController;
+
+    sendTestCommand(commHandler, CommandType::SET_KP, 1, 0.5f);
+    sendTestCommand(commHandler, CommandType::SET_KI, 2, 0.25f);
+    sendTestCommand(commHandler, CommandType::SET_TARGET_PRESSURE, 3, 400.0f);
+    sendTestCommand(commHandler, CommandType::SET_REDBAND_UPPER, 4, 10.0f);
+    sendTestCommand(commHandler, CommandType::SET_MAX_ANGLE_CHANGE, 5, 2.0f);
+
+    ackPacketU_t acks[5];
+    TEST_ASSERT_EQUAL(5, takeAcks(acks, 5));
+    for (uint8_t i = 0; i < 5; i++)
+        TEST_ASSERT_EQUAL(CommandStatus::APPLIED, acks[i].data.status);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, numericCast<float>(testController.getKp()));
+    TEST_ASSERT_EQUAL_FLOAT(numericCast<float>(testController.getKp()), acks[0].data.appliedValue);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.25f, numericCast<float>(testController.getKi()));
+    TEST_ASSERT_EQUAL_FLOAT(400.0f, tunables.targetPressurePsi);
+
+    // The redband follows the new target and limit
+    TEST_ASSERT_TRUE(checkRedBand(409.0f));
+    TEST_ASSERT_FALSE(checkRedBand(411.0f));
+
+    // The move filter caps at the new limit
+    angle_t delta = degToAngle(3.0f);
+    applyMoveFilter(delta, tunables.maxAngleChange, tunables.moveFilterScale);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 2.0f, angleToDeg(delta));
+
+    // The gains are bounded too
+    sendTestCommand(commHandler, CommandType::SET_KD, 6, -0.1f);
+    TEST_ASSERT_EQUAL(1, takeAcks(acks, 1));
+    TEST_ASSERT_EQUAL(CommandStatus::OUT_OF_BOUNDS, acks[0].data.status);
+
+    // The move filter scale is kept in Q8, and the ack has the value in effect
+    sendTestCommand(commHandler, CommandType::SET_MOVE_FILTER_SCALE, 7, 0.3f);
+    TEST_ASSERT_EQUAL(1, takeAcks(acks, 1));
+    TEST_ASSERT_EQUAL(CommandStatus::APPLIED, acks[0].data.status);
+    TEST_ASSERT_EQUAL(77, tunables.moveFilterScale);
+    TEST_ASSERT_EQUAL_FLOAT(77.0f / 256, acks[0].data.appliedValue);
+
+    tunables = Tunables();
+    controller = nullptr;
+}
+
+void run_all_command_tests() {
+    RUN_TEST(test_commands_applied_and_acked);
+    RUN_TEST(test_commands_only_in_safe_states);
+    RUN_TEST(test_commands_rejected);
+    RUN_TEST(test_commands_between_pressure_updates);
+    RUN_TEST(test_commands_tuning_table);
+}
+
+#endif // TEST_COMMANDS_H
@@ -1,9 +1,28 @@
+#include "test_amt22.h"
+#include "test_cobs.h"
+#include "test_commands.h"
+#include "test_control_tasks.h"
 #include "test_comm_handler.h"
+#include "test_crc16.h"
+#include "test_encoder_sampler.h"
+#include "test_flight_recorder.h"
+#include "test_input_journal.h"
 #include "test_controller.h"
 #include "test_pressure_sensor.h"
+#include "test_step_engine.h"
+#include "test_motion_planner.h"
+#include "test_position_estimator.h"
+#include "test_scheduler.h"
+#include "test_spsc_ring.h"
+#include "test_telemetry_decoder.h"
+#include "test_tx_queue.h"
+#include "test_valve_angle.h"
 #ifdef USE_OSCILLATION_DETECTOR
     #include "test_oscillation_detection.h"
 #endif
+#ifdef USE_LOOP_PROFILER
+    #include "test_loop_profiler.h"
+#endif
 
 #include <unity.h>
 
@@ -18,14 +37,34 @@ void tearDown(void) {}
 int main(int argc, char **argv) {
 #ifdef BUILD_NATIVE
     When(Method(ArduinoFake(), millis)).AlwaysReturn();
+    When(Method(ArduinoFake(), micros)).AlwaysReturn();
 #endif
 
     UNITY_BEGIN();
+    run_all_amt22_tests();
     run_all_pressure_sensor_tests();
     run_all_controller_tests();
+    run_all_cobs_tests();
     run_all_comm_handler_tests();
+    run_all_command_tests();
+    run_all_control_tasks_tests();
+    run_all_crc16_tests();
+    run_all_step_engine_tests();
+    run_all_motion_planner_tests();
+    run_all_position_estimator_tests();
+    run_all_encoder_sampler_tests();
+    run_all_flight_recorder_tests();
+    run_all_input_journal_tests();
+    run_all_valve_angle_tests();
+    run_all_scheduler_tests();
+    run_all_spsc_ring_tests();
+    run_all_telemetry_decoder_tests();
+    run_all_tx_queue_tests();
 #ifdef USE_OSCILLATION_DETECTOR
     run_all_oscillation_detection_tests();
+#endif
+#ifdef USE_LOOP_PROFILER
+    run_all_loop_profiler_tests();
 #endif
     return UNITY_END();
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef TEST_CONTROL_TASKS_H
+#define TEST_CONTROL_TASKS_H
+
+#include <unity.h>
+
+#include "config.h"
+#include <control_tasks.h>
+#include <hardware.h>
+#include <utilities.h>
+#include "state_machine.h"
+#include "test_comm_handler.h" // Globals
+#include "test_step_engine.h" // Fake step timer
+#include "test_tx_queue.h" // Fake TX hooks
+
+#ifdef BUILD_NATIVE
+    #include <ArduinoFake.h>
+    using namespace fakeit;
+#endif
+
+extern bool MPV_CONTROL;
+
+// Defined in main.cpp on the target
+TaskScheduler scheduler(micros);
+int8_t controlTaskId;
+
+// Fake hardware (hardware.h), which lib/modules_arduino provides on the target
+bool fakeMotorDriverEnabled = false;
+void motorDriverBegin() { fakeMotorDriverEnabled = true; }
+void disableMotorDriver() { fakeMotorDriverEnabled = false; }
+const StepEngineHooks stepperDriverHooks = fakeStepEngineHooks;
+void serialRxBegin() {}
+
+// Runs task with the firmware's objects in place, starting in state
+void runControlTask(void (*task)(), SystemStateEnum state) {
+    CommHandler testCommHandler(&fakeTxHooks);
+    Controller testController;
+    PressureSensor testPressureSensor;
+    commHandler = &testCommHandler;
+    controller = &testController;
+    pressureSensor = &testPressureSensor;
+    resetFakeTx(sizeof(txWritten));
+
+    systemState = SystemState();
+    systemState.currentState = state;
+    task();
+
+    commHandler = nullptr;
+    controller = nullptr;
+    pressureSensor = nullptr;
+}
+
+void test_control_tasks_emergency_stop() {
+    fakeStepTimer.reset();
+    stepEngine.begin(&fakeStepEngineHooks);
+    motorDriverBegin();
+    setMPV(true);
+
+    runControlTask(stateMachineUpdate, SystemStateEnum::EMERGENCY_STOP);
+    TEST_ASSERT_EQUAL(SystemStateEnum::EMERGENCY_STOP, systemState.currentState);
+    TEST_ASSERT_FALSE(MPV_CONTROL);
+    TEST_ASSERT_FALSE(fakeMotorDriverEnabled);
+    TEST_ASSERT_TRUE(flightRecorder.isFrozen());
+    flightRecorder = FlightRecorder();
+}
+
+void test_control_tasks_invalid_state() {
+    runControlTask(stateMachineUpdate, (SystemStateEnum)0x42);
+    TEST_ASSERT_EQUAL(SystemStateEnum::EMERGENCY_STOP, systemState.currentState);
+    flightRecorder = FlightRecorder();
+}
+
+// Losing the MPV in closed loop restarts from OPEN_LOOP_INIT
+void test_control_tasks_mpv_closed() {
+#ifdef BUILD_NATIVE
+    When(Method(ArduinoFake(), digitalRead)).AlwaysReturn(HIGH);
+#endif
+    setMPVState(false);
+    faults.redBandFault = true;
+
+    runControlTask(globalMonitors, SystemStateEnum::CLOSED_LOOP);
+    TEST_ASSERT_EQUAL(SystemStateEnum::OPEN_LOOP_INIT, systemState.currentState);
+    TEST_ASSERT_FALSE(faults.redBandFault);
+    TEST_ASSERT_FALSE(MPV_CONTROL);
+}
+
+#ifndef NO_MANUAL_ABORT
+void test_control_tasks_manual_abort() {
+#ifdef BUILD_NATIVE
+    When(Method(ArduinoFake(), digitalRead)).AlwaysReturn(LOW);
+#endif
+    setMPV(true);
+
+    runControlTask(globalMonitors, SystemStateEnum::CLOSED_LOOP);
+    TEST_ASSERT_EQUAL(SystemStateEnum::EMERGENCY_STOP, systemState.currentState);
+    TEST_ASSERT_TRUE(faults.manualAbort);
+    TEST_ASSERT_FALSE(MPV_CONTROL);
+
+    faults.clear();
+#ifdef BUILD_NATIVE
+    When(Method(ArduinoFake(), digitalRead)).AlwaysReturn(HIGH);
+#endif
+}
+#endif
+
+void run_all_control_tasks_tests() {
+    RUN_TEST(test_control_tasks_emergency_stop);
+    RUN_TEST(test_control_tasks_invalid_state);
+    RUN_TEST(test_control_tasks_mpv_closed);
+#ifndef NO_MANUAL_ABORT
+    RUN_TEST(test_control_tasks_manual_abort);
+#endif
+}
+
+#endif // TEST_CONTROL_TASKS_H
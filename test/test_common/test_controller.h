@@ -41,10 +41,84 @@ void test_controller_integral_error_clamping() {
     TEST_ASSERT_EQUAL_FLOAT(ControllerConfig::I_MIN, controller.getIntegral());
 }
 
+// Small deterministic PRNG (so the sequences are the same on every platform)
+uint32_t controllerTestRandState = 12345;
+float controllerTestRand(float lo, float hi) {
+    controllerTestRandState = controllerTestRandState * 1664525UL + 1013904223UL;
+    return lo + (hi - lo) * (controllerTestRandState >> 8) / 16777216.0f;
+}
+
+/*
+ * Drives the float and fixed point controllers with the same random walk of pressure errors
+ * and control periods, and returns the largest difference between their outputs (degrees).
+ */
+float maxFixedControllerDeviation(float kp, float ki, float kd, float maxError, unsigned long updates) {
+    BasicController<float> ref(kp, ki, kd);
+    BasicController<PressureQ> fixed(kp, ki, kd);
+    typedef BasicController<PressureQ>::Error Error;
+    typedef BasicController<PressureQ>::Time Time;
+
+    float maxDeviation = 0.0f;
+    float error = 0.0f;
+    for (unsigned long i = 0; i < updates; i++) {
+        error += controllerTestRand(-5.0f, 5.0f);
+        if (error > maxError) error = maxError;
+        if (error < -maxError) error = -maxError;
+        float dt = controllerTestRand(0.03f, 0.07f);
+
+        // Both see the same (representable) inputs, so only the arithmetic differs
+        Error fixedError(error);
+        Time fixedDt(dt);
+        ref.update(fixedError.toFloat(), fixedDt.toFloat());
+        fixed.update(fixedError, fixedDt);
+
+        float deviation = fabs(ref.getError() - fixed.getError().toFloat());
+        if (deviation > maxDeviation) maxDeviation = deviation;
+
+        // Occasionally reset, like an MPV cycle does
+        if (i % 5000 == 4999) {
+            ref.reset();
+            fixed.reset();
+        }
+    }
+    return maxDeviation;
+}
+
+// Over long random error sequences, the fixed point controller stays within this many degrees of float
+constexpr float FIXED_CONTROLLER_TOLERANCE_DEG = 0.05f;
+
+void test_fixed_controller_matches_float() {
+    // The gains are quantised to 1/4096, which dominates the difference at large errors
+    float deviation = maxFixedControllerDeviation(ControllerConfig::KP, ControllerConfig::KI, ControllerConfig::KD, 200.0f, 20000);
+    TEST_ASSERT_LESS_THAN_FLOAT(FIXED_CONTROLLER_TOLERANCE_DEG, deviation);
+
+    deviation = maxFixedControllerDeviation(0.08f, 0.05f, 0.02f, 200.0f, 20000);
+    TEST_ASSERT_LESS_THAN_FLOAT(FIXED_CONTROLLER_TOLERANCE_DEG, deviation);
+}
+
+void test_fixed_controller_integral_error_clamping() {
+    BasicController<PressureQ> controller;
+    typedef BasicController<PressureQ>::Error Error;
+    typedef BasicController<PressureQ>::Time Time;
+
+    controller.update(Error(abs(ControllerConfig::I_MAX)), Time(1.5f));
+    TEST_ASSERT_EQUAL_FLOAT(ControllerConfig::I_MAX, controller.getIntegral().toFloat());
+
+    controller.update(Error(-abs(ControllerConfig::I_MIN)), Time(3.0f));
+    TEST_ASSERT_EQUAL_FLOAT(ControllerConfig::I_MIN, controller.getIntegral().toFloat());
+
+    // Errors beyond the fixed point range saturate instead of wrapping around
+    controller.reset();
+    controller.update(Error(5000.0f), Time(0.05f));
+    TEST_ASSERT_TRUE(controller.getError().toFloat() > 0.0f);
+}
+
 void run_all_controller_tests() {
     UnitySetTestFile(__FILE__);
     RUN_TEST(test_controller);
     RUN_TEST(test_controller_integral_error_clamping);
+    RUN_TEST(test_fixed_controller_matches_float);
+    RUN_TEST(test_fixed_controller_integral_error_clamping);
 }
 
 #endif // TEST_CONTROLLER_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+#ifndef TEST_CRC16_H
+#define TEST_CRC16_H
+
+#include <CRC.h>
+#include <unity.h>
+
+#include <crc16_xmodem.h>
+
+// The CRC16 library configured as the packets used to be checksummed
+uint16_t libraryXmodem(const uint8_t* data, uint16_t length) {
+    CRC16 crc(CRC16_XMODEM_POLYNOME, CRC16_XMODEM_INITIAL, CRC16_XMODEM_XOR_OUT, CRC16_XMODEM_REV_IN, CRC16_XMODEM_REV_OUT);
+    crc.add(data, length);
+    return crc.calc();
+}
+
+// Deterministic pseudo random bytes (LCG), so failures are reproducible
+void fillCrcTestBytes(uint8_t* data, uint16_t length, uint32_t seed) {
+    for (uint16_t i = 0; i < length; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+void test_crc16_check_value() {
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    TEST_ASSERT_EQUAL_HEX16(0x31C3, crc16Xmodem(check, sizeof(check)));
+    TEST_ASSERT_EQUAL_HEX16(0x31C3, libraryXmodem(check, sizeof(check)));
+    TEST_ASSERT_EQUAL_HEX16(XMODEM_INIT, crc16Xmodem(check, 0));
+}
+
+void test_crc16_tables_match_bitwise() {
+    for (uint16_t crc = 0; crc < 0x100; crc++) {
+        uint16_t reg = (uint16_t)(crc * 0x0101 ^ 0x5a3c);
+        for (uint16_t byte = 0; byte <= 0xff; byte++) {
+            uint16_t expected = crc16XmodemBitwise(reg, (uint8_t)byte);
+            TEST_ASSERT_EQUAL_HEX16(expected, crc16XmodemByteUpdate(reg, (uint8_t)byte));
+            TEST_ASSERT_EQUAL_HEX16(expected, crc16XmodemNibbleUpdate(reg, (uint8_t)byte));
+        }
+    }
+}
+
+void test_crc16_matches_library() {
+    uint8_t data[64];
+    for (uint16_t length = 0; length <= sizeof(data); length++) {
+        fillCrcTestBytes(data, length, length + 1);
+        TEST_ASSERT_EQUAL_HEX16(libraryXmodem(data, length), crc16Xmodem(data, length));
+    }
+}
+
+void test_crc16_incremental() {
+    uint8_t data[48];
+    fillCrcTestBytes(data, sizeof(data), 7);
+    const uint16_t expected = libraryXmodem(data, sizeof(data));
+
+    Crc16Xmodem crc;
+    for (uint8_t i = 0; i < sizeof(data); i++) crc.add(data[i]);
+    TEST_ASSERT_EQUAL_HEX16(expected, crc.calc());
+
+    // Blocks of uneven size continue from the previous value
+    crc.restart();
+    crc.add(data, 5);
+    crc.add(data + 5, 30);
+    crc.add(data + 35, sizeof(data) - 35);
+    TEST_ASSERT_EQUAL_HEX16(expected, crc.calc());
+
+    crc.restart();
+    TEST_ASSERT_EQUAL_HEX16(XMODEM_INIT, crc.calc());
+}
+
+void run_all_crc16_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_crc16_check_value);
+    RUN_TEST(test_crc16_tables_match_bitwise);
+    RUN_TEST(test_crc16_matches_library);
+    RUN_TEST(test_crc16_incremental);
+}
+
+#endif // TEST_CRC16_H
@@ -0,0 +1,71 @@
+#ifndef TEST_ENCODER_SAMPLER_H
+#define TEST_ENCODER_SAMPLER_H
+
+#include <unity.h>
+
+#include <encoder_sampler.h>
+
+// Fake encoder which returns a new angle (and time) on every read
+int fakeEncoderReads = 0;
+
+void fakeSampleEncoder(EncoderSample& sample) {
+    fakeEncoderReads++;
+    sample.angle = degToAngle(40.0f + fakeEncoderReads);
+    sample.stepPosition = 10 * fakeEncoderReads;
+    sample.timeUs = 1000UL * fakeEncoderReads;
+}
+
+void test_encoder_sampler_one_read_per_tick() {
+    EncoderSampler sampler(fakeSampleEncoder);
+    fakeEncoderReads = 0;
+
+    // Several consumers in the same tick share one read
+    sampler.beginTick();
+    TEST_ASSERT_EQUAL_FLOAT(41.0f, angleToDeg(sampler.get().angle));
+    TEST_ASSERT_EQUAL_FLOAT(41.0f, angleToDeg(sampler.get().angle));
+    TEST_ASSERT_EQUAL_INT32(10, sampler.get().stepPosition);
+    TEST_ASSERT_EQUAL(1, fakeEncoderReads);
+    TEST_ASSERT_EQUAL_UINT32(1, sampler.getReads());
+    TEST_ASSERT_EQUAL_UINT32(2, sampler.getReadsSaved());
+
+    // The next tick takes a new sample
+    sampler.beginTick();
+    TEST_ASSERT_EQUAL_FLOAT(42.0f, angleToDeg(sampler.get().angle));
+    TEST_ASSERT_EQUAL(2, fakeEncoderReads);
+
+    // Ticks where nobody asks for the angle do not read the encoder
+    sampler.beginTick();
+    sampler.beginTick();
+    TEST_ASSERT_EQUAL(2, fakeEncoderReads);
+}
+
+void test_encoder_sampler_fresh_and_age() {
+    EncoderSampler sampler(fakeSampleEncoder);
+    fakeEncoderReads = 0;
+    TEST_ASSERT_EQUAL(0, sampler.getSampleAgeUs(5000));
+
+    sampler.beginTick();
+    sampler.get();
+
+    // A fresh sample (e.g. after a move) always reads, and becomes the cached sample of the tick
+    TEST_ASSERT_EQUAL_FLOAT(42.0f, angleToDeg(sampler.fresh().angle));
+    TEST_ASSERT_EQUAL_FLOAT(42.0f, angleToDeg(sampler.get().angle));
+    TEST_ASSERT_EQUAL_UINT32(2, sampler.getReads());
+    TEST_ASSERT_EQUAL_UINT32(1, sampler.getReadsSaved());
+
+    TEST_ASSERT_EQUAL(3000, sampler.getSampleAgeUs(5000));
+
+    // The counters restart (at every diagnostics packet), the sample is kept
+    sampler.resetCounters();
+    TEST_ASSERT_EQUAL_UINT32(0, sampler.getReads());
+    TEST_ASSERT_EQUAL_UINT32(0, sampler.getReadsSaved());
+    TEST_ASSERT_EQUAL(3000, sampler.getSampleAgeUs(5000));
+}
+
+void run_all_encoder_sampler_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_encoder_sampler_one_read_per_tick);
+    RUN_TEST(test_encoder_sampler_fresh_and_age);
+}
+
+#endif // TEST_ENCODER_SAMPLER_H
@@ -0,0 +1,118 @@
+#ifndef TEST_FLIGHT_RECORDER_H
+#define TEST_FLIGHT_RECORDER_H
+
+#include <string.h>
+#include <unity.h>
+
+#include <comm_handler.h>
+#include <flight_recorder.h>
+#include "test_tx_queue.h" // Fake TX hooks
+
+// Record whose time is i, so that the order can be checked
+flightRecord_t testRecord(uint16_t i) {
+    return FlightRecorder::pack(i, 300.0f, 1.0f, 0.5f, 45.0f, 44.5f, SystemStateEnum::CLOSED_LOOP, 0);
+}
+
+void test_flight_recorder_keeps_last_records() {
+    FlightRecorder recorder;
+    const uint16_t n = RecorderConfig::NUM_RECORDS;
+    for (uint16_t i = 0; i < n + 5; i++)
+        recorder.record(testRecord(i));
+
+    // Oldest first, the first 5 overwritten
+    TEST_ASSERT_EQUAL(n, recorder.size());
+    for (uint8_t i = 0; i < n; i++)
+        TEST_ASSERT_EQUAL(i + 5, recorder.at(i).timeMs);
+}
+
+void test_flight_recorder_pack() {
+    flightRecord_t record = FlightRecorder::pack(70000, 512.34f, -12.34f, 1.234f, 45.678f, 400.0f,
+                                                 SystemStateEnum::FORCED_OPEN_LOOP, TELPKT_FAULTS_REDBAND_FAULT);
+    TEST_ASSERT_EQUAL(70000 & 0xffff, record.timeMs);
+    TEST_ASSERT_EQUAL(5123, record.pressure);
+    TEST_ASSERT_EQUAL(-123, record.error);
+    TEST_ASSERT_EQUAL(123, record.output);
+    TEST_ASSERT_EQUAL(4568, record.targetAngle);
+    TEST_ASSERT_EQUAL(INT16_MAX, record.currentAngle); // Saturated
+    TEST_ASSERT_EQUAL(SystemStateEnum::FORCED_OPEN_LOOP, record.state);
+    TEST_ASSERT_EQUAL_HEX8(TELPKT_FAULTS_REDBAND_FAULT, record.faults);
+}
+
+void test_flight_recorder_freeze_and_rearm() {
+    FlightRecorder recorder;
+    for (uint16_t i = 0; i < 10; i++)
+        recorder.record(testRecord(i));
+    TEST_ASSERT_FALSE(recorder.isDumpPending());
+
+    // Frozen: the records up to the fault are kept
+    recorder.freeze();
+    recorder.record(testRecord(100));
+    TEST_ASSERT_EQUAL(10, recorder.size());
+    TEST_ASSERT_EQUAL(9, recorder.at(9).timeMs);
+
+    flightRecord_t out[4];
+    uint8_t dumped = 0;
+    while (recorder.isDumpPending()) {
+        uint8_t count = recorder.takeDumpRecords(out, 4);
+        for (uint8_t i = 0; i < count; i++)
+            TEST_ASSERT_EQUAL(dumped++, out[i].timeMs);
+    }
+    TEST_ASSERT_EQUAL(10, dumped);
+
+    recorder.rearm();
+    TEST_ASSERT_FALSE(recorder.isFrozen());
+    TEST_ASSERT_EQUAL(0, recorder.size());
+    recorder.record(testRecord(200));
+    TEST_ASSERT_EQUAL(200, recorder.at(0).timeMs);
+}
+
+void test_flight_recorder_dump_packets() {
+    CommHandler commHandler(&fakeTxHooks);
+    FlightRecorder recorder;
+    const uint8_t n = 10;
+    for (uint16_t i = 0; i < n; i++)
+        recorder.record(testRecord(i));
+    resetFakeTx(0);
+
+    // Nothing to dump until frozen
+    TEST_ASSERT_FALSE(commHandler.sendFlightRecorderDump(recorder));
+    recorder.freeze();
+
+    // The next packet is only built once the previous one went out
+    TEST_ASSERT_TRUE(commHandler.sendFlightRecorderDump(recorder));
+    TEST_ASSERT_TRUE(commHandler.sendFlightRecorderDump(recorder));
+    TEST_ASSERT_EQUAL(RecorderConfig::RECORDS_PER_DUMP_PACKET, recorder.getDumpPosition());
+    TEST_ASSERT_EQUAL(0, commHandler.getTxStats().dropped);
+
+    txRoom = sizeof(txWritten);
+    do {
+        commHandler.processOutgoingNonBlocking();
+    } while (commHandler.sendFlightRecorderDump(recorder));
+
+    const uint8_t numPackets = (n + RecorderConfig::RECORDS_PER_DUMP_PACKET - 1) / RecorderConfig::RECORDS_PER_DUMP_PACKET;
+    TEST_ASSERT_EQUAL(numPackets * txFrameSize(DUMPPKT_SIZE), txWrittenLen);
+#ifndef USE_COBS_FRAMING
+    uint8_t received = 0;
+    for (uint8_t p = 0; p < numPackets; p++) {
+        dumpPacketU_t packet;
+        memcpy(packet.bytes, txWritten + p * DUMPPKT_SIZE, DUMPPKT_SIZE);
+        TEST_ASSERT_EQUAL_HEX16(MAGIC_DUMP, packet.data._magic);
+        TEST_ASSERT_EQUAL_HEX16(crc16Xmodem(packet.bytes + 4, DUMPPKT_SIZE - 4), packet.data._checksum);
+        TEST_ASSERT_EQUAL(received, packet.data.first);
+        TEST_ASSERT_EQUAL(n, packet.data.total);
+        for (uint8_t i = 0; i < packet.data.count; i++)
+            TEST_ASSERT_EQUAL(received++, packet.data.records[i].timeMs);
+    }
+    TEST_ASSERT_EQUAL(n, received);
+#endif
+}
+
+void run_all_flight_recorder_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_flight_recorder_keeps_last_records);
+    RUN_TEST(test_flight_recorder_pack);
+    RUN_TEST(test_flight_recorder_freeze_and_rearm);
+    RUN_TEST(test_flight_recorder_dump_packets);
+}
+
+#endif // TEST_FLIGHT_RECORDER_H
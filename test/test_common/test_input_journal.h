@@ -0,0 +1,180 @@
+#ifndef TEST_INPUT_JOURNAL_H
+#define TEST_INPUT_JOURNAL_H
+
+#include <string.h>
+#include <unity.h>
+
+#include <input_journal.h>
+
+namespace {
+    // Journal handed to the sink by the journal under test
+    uint8_t journalSinkBytes[512];
+    size_t journalSinkLength = 0;
+    uint8_t journalSinkChunks = 0;
+
+    void journalSink(const uint8_t* data, uint8_t length) {
+        TEST_ASSERT_TRUE(length <= JournalConfig::CHUNK_SIZE);
+        TEST_ASSERT_TRUE(journalSinkLength + length <= sizeof(journalSinkBytes));
+        memcpy(journalSinkBytes + journalSinkLength, data, length);
+        journalSinkLength += length;
+        journalSinkChunks++;
+    }
+
+    void resetJournalSink() {
+        journalSinkLength = 0;
+        journalSinkChunks = 0;
+    }
+}
+
+void test_input_journal_round_trip() {
+    resetJournalSink();
+    InputJournal journal;
+    journal.startRecording(journalSink);
+    TEST_ASSERT_TRUE(journal.isRecording());
+
+    uint16_t counts = 0x0abc;
+    uint8_t rx[4] = {0x3b, 0xff, 0x00, 0x11};
+    TEST_ASSERT_EQUAL_UINT32(1000, journal.clock(JournalTag::MILLIS, 1000));
+    TEST_ASSERT_EQUAL_UINT32(0xfffffff0, journal.clock(JournalTag::MICROS, 0xfffffff0));
+    TEST_ASSERT_EQUAL_UINT32(0x10, journal.clock(JournalTag::MICROS, 0x10)); // Wrapped around
+    TEST_ASSERT_EQUAL(LOW, journal.pin(LOW));
+    TEST_ASSERT_TRUE(journal.encoder(true, counts));
+    TEST_ASSERT_FALSE(journal.encoder(false, counts));
+    TEST_ASSERT_EQUAL_INT32(-300, journal.stepPosition(-300));
+    TEST_ASSERT_EQUAL_INT32(5000, journal.stepPosition(5000));
+    TEST_ASSERT_TRUE(journal.stepBusy(true));
+    TEST_ASSERT_EQUAL(-1, journal.txRoom(-1)); // Recorded as no room
+    TEST_ASSERT_EQUAL(63, journal.txRoom(63));
+    TEST_ASSERT_EQUAL(4, journal.rxBytes(rx, 4, sizeof(rx)));
+    TEST_ASSERT_EQUAL(0, journal.rxBytes(rx, 0, sizeof(rx)));
+    journal.stop();
+    TEST_ASSERT_FALSE(journal.isRecording());
+    TEST_ASSERT_TRUE(journalSinkLength > 0);
+
+    // The values given while playing back are ignored
+    journal.startPlayback(journalSinkBytes, journalSinkLength);
+    TEST_ASSERT_TRUE(journal.isPlaying());
+    counts = 0;
+    memset(rx, 0, sizeof(rx));
+    TEST_ASSERT_EQUAL_UINT32(1000, journal.clock(JournalTag::MILLIS, 0));
+    TEST_ASSERT_EQUAL_UINT32(0xfffffff0, journal.clock(JournalTag::MICROS, 0));
+    TEST_ASSERT_EQUAL_UINT32(0x10, journal.clock(JournalTag::MICROS, 0));
+    TEST_ASSERT_EQUAL_UINT32(0x10, journal.getMicros());
+    TEST_ASSERT_EQUAL(LOW, journal.pin(HIGH));
+    TEST_ASSERT_TRUE(journal.encoder(false, counts));
+    TEST_ASSERT_EQUAL_HEX16(0x0abc, counts);
+    TEST_ASSERT_FALSE(journal.encoder(true, counts));
+    TEST_ASSERT_EQUAL_INT32(-300, journal.stepPosition(0));
+    TEST_ASSERT_EQUAL_INT32(5000, journal.stepPosition(0));
+    TEST_ASSERT_TRUE(journal.stepBusy(false));
+    TEST_ASSERT_EQUAL(0, journal.txRoom(10));
+    TEST_ASSERT_EQUAL(63, journal.txRoom(0));
+    TEST_ASSERT_EQUAL(4, journal.rxBytes(rx, 0, sizeof(rx)));
+    TEST_ASSERT_EQUAL_HEX8(0x3b, rx[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xff, rx[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, rx[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x11, rx[3]);
+    TEST_ASSERT_EQUAL(0, journal.rxBytes(rx, 0, sizeof(rx)));
+
+    TEST_ASSERT_EQUAL(0, journal.remaining());
+    TEST_ASSERT_FALSE(journal.hasEnded());
+    TEST_ASSERT_FALSE(journal.hasDiverged());
+}
+
+void test_input_journal_compact() {
+    resetJournalSink();
+    InputJournal journal;
+    journal.startRecording(journalSink);
+
+    // A pass of an idle loop: small clock steps, the pins and the same step position
+    for (uint32_t i = 1; i <= 10; i++) {
+        journal.clock(JournalTag::MICROS, i * 20);
+        journal.pin(HIGH);
+        journal.stepPosition(1234);
+    }
+    journal.stop();
+    // One byte per record, apart from the first step position
+    TEST_ASSERT_EQUAL(30 + 2, journalSinkLength);
+}
+
+void test_input_journal_chunks() {
+    resetJournalSink();
+    InputJournal journal;
+    journal.startRecording(journalSink);
+    for (uint8_t i = 0; i < 2 * JournalConfig::CHUNK_SIZE + 3; i++)
+        journal.pin(HIGH);
+    TEST_ASSERT_EQUAL(2, journalSinkChunks);
+    TEST_ASSERT_EQUAL(2 * JournalConfig::CHUNK_SIZE, journalSinkLength);
+
+    // Starting over hands the rest to the sink first
+    journal.startRecording(journalSink);
+    TEST_ASSERT_EQUAL(3, journalSinkChunks);
+    TEST_ASSERT_EQUAL(2 * JournalConfig::CHUNK_SIZE + 3, journalSinkLength);
+    journal.stop();
+    TEST_ASSERT_EQUAL(3, journalSinkChunks);
+}
+
+void test_input_journal_end_and_divergence() {
+    resetJournalSink();
+    InputJournal journal;
+    journal.startRecording(journalSink);
+    journal.clock(JournalTag::MILLIS, 500);
+    journal.pin(LOW);
+    journal.stop();
+
+    // Used up: the clock stands still and the pins read HIGH
+    journal.startPlayback(journalSinkBytes, journalSinkLength);
+    TEST_ASSERT_EQUAL_UINT32(500, journal.clock(JournalTag::MILLIS, 0));
+    TEST_ASSERT_EQUAL(LOW, journal.pin(HIGH));
+    TEST_ASSERT_FALSE(journal.hasEnded());
+    TEST_ASSERT_EQUAL_UINT32(500, journal.clock(JournalTag::MILLIS, 9999));
+    TEST_ASSERT_EQUAL(HIGH, journal.pin(LOW));
+    TEST_ASSERT_TRUE(journal.hasEnded());
+    TEST_ASSERT_FALSE(journal.hasDiverged());
+
+    // Reading another input than the one recorded: the record is left in place
+    journal.startPlayback(journalSinkBytes, journalSinkLength);
+    TEST_ASSERT_FALSE(journal.stepBusy(true));
+    TEST_ASSERT_TRUE(journal.hasEnded());
+    TEST_ASSERT_TRUE(journal.hasDiverged());
+    TEST_ASSERT_EQUAL(journalSinkLength, journal.remaining());
+    TEST_ASSERT_EQUAL_UINT32(0, journal.clock(JournalTag::MILLIS, 0));
+
+    // More received bytes than fit where they are read to
+    uint8_t rx[8] = {};
+    resetJournalSink();
+    journal.stop();
+    journal.startRecording(journalSink);
+    journal.rxBytes(rx, sizeof(rx), sizeof(rx));
+    journal.stop();
+    journal.startPlayback(journalSinkBytes, journalSinkLength);
+    TEST_ASSERT_EQUAL(0, journal.rxBytes(rx, 0, 4));
+    TEST_ASSERT_TRUE(journal.hasDiverged());
+}
+
+void test_input_journal_record_ignored_while_playing() {
+    resetJournalSink();
+    InputJournal journal;
+    journal.startRecording(journalSink);
+    journal.clock(JournalTag::MICROS, 100);
+    journal.stop();
+    size_t length = journalSinkLength;
+
+    // As setup() does when it runs in a playback
+    journal.startPlayback(journalSinkBytes, length);
+    journal.startRecording(journalSink);
+    TEST_ASSERT_TRUE(journal.isPlaying());
+    TEST_ASSERT_EQUAL_UINT32(100, journal.clock(JournalTag::MICROS, 0));
+    journal.stop();
+    TEST_ASSERT_EQUAL(length, journalSinkLength);
+}
+
+void run_all_input_journal_tests() {
+    RUN_TEST(test_input_journal_round_trip);
+    RUN_TEST(test_input_journal_compact);
+    RUN_TEST(test_input_journal_chunks);
+    RUN_TEST(test_input_journal_end_and_divergence);
+    RUN_TEST(test_input_journal_record_ignored_while_playing);
+}
+
+#endif // TEST_INPUT_JOURNAL_H
@@ -0,0 +1,109 @@
+#ifndef TEST_LOOP_PROFILER_H
+#define TEST_LOOP_PROFILER_H
+
+#include <CRC.h>
+#include <unity.h>
+
+#include "config.h"
+#include <comm_handler.h>
+#include <encoder_sampler.h>
+#include <loop_profiler.h>
+#include <scheduler.h>
+#include <serial_rx.h>
+
+unsigned long diagClockUs = 0;
+unsigned long diagClock() { return diagClockUs; }
+void diagTask() { diagClockUs += 300; }
+void diagSampleEncoder(EncoderSample& sample) { sample = EncoderSample{ degToAngle(45.0f), 0, diagClockUs }; }
+
+void test_loop_profiler_stats() {
+    LoopProfiler profiler;
+    TEST_ASSERT_EQUAL(0, profiler.getStats(LoopPhase::COMM).count);
+    TEST_ASSERT_EQUAL(0, profiler.getMeanUs(LoopPhase::COMM));
+
+    profiler.record(LoopPhase::COMM, 100);
+    profiler.record(LoopPhase::COMM, 300);
+    profiler.record(LoopPhase::COMM, ProfilerConfig::COMM_BUDGET_US + 1);
+    profiler.record(LoopPhase::ENCODER, 100000); // Saturates
+
+    const PhaseStats& comm = profiler.getStats(LoopPhase::COMM);
+    TEST_ASSERT_EQUAL(100, comm.minUs);
+    TEST_ASSERT_EQUAL(ProfilerConfig::COMM_BUDGET_US + 1, comm.maxUs);
+    TEST_ASSERT_EQUAL(3, comm.count);
+    TEST_ASSERT_EQUAL(1, comm.overruns);
+    TEST_ASSERT_EQUAL((400 + ProfilerConfig::COMM_BUDGET_US + 1) / 3, profiler.getMeanUs(LoopPhase::COMM));
+
+    TEST_ASSERT_EQUAL(0xffff, profiler.getStats(LoopPhase::ENCODER).maxUs);
+    TEST_ASSERT_EQUAL(1, profiler.getStats(LoopPhase::ENCODER).overruns);
+    TEST_ASSERT_EQUAL(0, profiler.getStats(LoopPhase::MOTOR).count);
+
+    profiler.reset();
+    TEST_ASSERT_EQUAL(0, profiler.getStats(LoopPhase::COMM).count);
+    TEST_ASSERT_EQUAL(0, profiler.getStats(LoopPhase::COMM).maxUs);
+}
+
+void test_loop_profiler_diagnostics_packet() {
+    LoopProfiler profiler;
+    profiler.record(LoopPhase::CONTROL, 1200);
+    profiler.record(LoopPhase::CONTROL, 800);
+
+    // A task released on time, then late enough to skip a release
+    diagClockUs = 0;
+    TaskScheduler scheduler(diagClock);
+    scheduler.addTask(diagTask, 1000);
+    scheduler.start();
+    scheduler.runPending();
+    diagClockUs = 2500;
+    scheduler.runPending();
+
+    // One encoder read, shared twice
+    EncoderSampler encoder(diagSampleEncoder);
+    encoder.beginTick();
+    for (uint8_t i = 0; i < 3; i++) encoder.get();
+
+    CommHandler commHandler;
+    diagnosticsPacketU_t packet;
+    memset(packet.bytes, 0xff, DIAGPKT_SIZE);
+    commHandler.buildDiagnosticsPacket(packet, profiler, scheduler, encoder);
+
+    TEST_ASSERT_EQUAL(4 + 4 + 12 * (uint8_t)LoopPhase::COUNT + 8 * TaskScheduler::MAX_TASKS + 4, DIAGPKT_SIZE);
+    TEST_ASSERT_EQUAL_UINT8(0xfb, packet.bytes[0]);
+    TEST_ASSERT_EQUAL_UINT8(0xae, packet.bytes[1]);
+    TEST_ASSERT_EQUAL((uint8_t)LoopPhase::COUNT, packet.data.numPhases);
+    TEST_ASSERT_EQUAL(1, packet.data.numTasks);
+    TEST_ASSERT_EQUAL(serialRxRing.getOverflowCount(), packet.data.rxOverflows);
+
+    const diagnosticsPhase_t& control = packet.data.phases[(uint8_t)LoopPhase::CONTROL];
+    TEST_ASSERT_EQUAL(800, control.minUs);
+    TEST_ASSERT_EQUAL(1200, control.maxUs);
+    TEST_ASSERT_EQUAL(1000, control.meanUs);
+    TEST_ASSERT_EQUAL(2, control.count);
+    TEST_ASSERT_EQUAL(0, control.overruns);
+
+    // Phases that did not run are all zeros
+    const diagnosticsPhase_t& motor = packet.data.phases[(uint8_t)LoopPhase::MOTOR];
+    TEST_ASSERT_EQUAL(0, motor.minUs);
+    TEST_ASSERT_EQUAL(0, motor.count);
+
+    const diagnosticsTask_t& task = packet.data.tasks[0];
+    TEST_ASSERT_EQUAL(2, task.runs);
+    TEST_ASSERT_EQUAL(1, task.overruns);
+    TEST_ASSERT_EQUAL(500, task.maxLatencyUs);
+    TEST_ASSERT_EQUAL(300, task.maxRunUs);
+    TEST_ASSERT_EQUAL(0, packet.data.tasks[1].runs); // Unused slots are all zeros
+    TEST_ASSERT_EQUAL(0, packet.data.tasks[TaskScheduler::MAX_TASKS - 1].maxLatencyUs);
+    TEST_ASSERT_EQUAL(1, packet.data.encoderReads);
+    TEST_ASSERT_EQUAL(2, packet.data.encoderReadsSaved);
+
+    CRC16 crc(CRC16_XMODEM_POLYNOME, CRC16_XMODEM_INITIAL, CRC16_XMODEM_XOR_OUT, CRC16_XMODEM_REV_IN, CRC16_XMODEM_REV_OUT);
+    crc.add(packet.bytes + 4, DIAGPKT_SIZE - 4);
+    TEST_ASSERT_EQUAL_UINT16(crc.calc(), packet.data._checksum);
+}
+
+void run_all_loop_profiler_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_loop_profiler_stats);
+    RUN_TEST(test_loop_profiler_diagnostics_packet);
+}
+
+#endif // TEST_LOOP_PROFILER_H
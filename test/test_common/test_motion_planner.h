@@ -0,0 +1,98 @@
+#ifndef TEST_MOTION_PLANNER_H
+#define TEST_MOTION_PLANNER_H
+
+#include <math.h>
+#include <unity.h>
+
+#include "config.h"
+#include <motion_planner.h>
+#include <step_engine.h>
+#include "test_step_engine.h"
+
+// Record the interval before every step of a move driven through the fake step timer
+unsigned int recordStepIntervals(uint16_t steps, uint16_t* intervals, unsigned int maxIntervals) {
+    StepEngine engine;
+    engine.begin(&fakeStepEngineHooks);
+    fakeStepTimer.reset();
+
+    unsigned int n = 0;
+    unsigned long lastPulseUs = 0;
+    engine.start(steps, false);
+    while (fakeTimerRun(engine, 1) == 1 && n < maxIntervals) {
+        intervals[n++] = (uint16_t)(fakeStepTimer.lastPulseUs - lastPulseUs);
+        lastPulseUs = fakeStepTimer.lastPulseUs;
+    }
+    return n;
+}
+
+void test_motion_planner_ramp_table() {
+    // The ramp starts at the start rate and never drops below the cruise interval
+    TEST_ASSERT_EQUAL_UINT16(MotionConfig::START_STEP_PERIOD_US, rampIntervalsUs.us[0]);
+    for (uint16_t k = 1; k < RAMP_STEPS; k++) {
+        TEST_ASSERT_LESS_OR_EQUAL(rampIntervalsUs.us[k - 1], rampIntervalsUs.us[k]);
+        TEST_ASSERT_GREATER_OR_EQUAL(MotionConfig::MIN_STEP_PERIOD_US, rampIntervalsUs.us[k]);
+
+    }
+
+    // v_k = sqrt(v_0^2 + 2ak), i.e. constant acceleration (within the 1us rounding of the intervals)
+    for (uint16_t k = 0; k < RAMP_STEPS; k++) {
+        float rate = sqrtf(sqr(1e6f / MotionConfig::START_STEP_PERIOD_US) + 2.0f * MotionConfig::ACCEL_STEPS_PER_S2 * k);
+        float expectedUs = fmaxf(1e6f / rate, MotionConfig::MIN_STEP_PERIOD_US);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, expectedUs, rampIntervalsUs.us[k]);
+    }
+
+    // The step after the ramp is at (or past) the cruise rate
+    float lastRampRate = sqrtf(sqr(1e6f / MotionConfig::START_STEP_PERIOD_US) + 2.0f * MotionConfig::ACCEL_STEPS_PER_S2 * RAMP_STEPS);
+    TEST_ASSERT_GREATER_OR_EQUAL(1e6f / MotionConfig::MIN_STEP_PERIOD_US - 1.0f, lastRampRate);
+}
+
+void test_motion_planner_trapezoid_sequence() {
+    const uint16_t steps = 2 * RAMP_STEPS + 100;
+    static uint16_t intervals[2 * RAMP_STEPS + 100];
+    TEST_ASSERT_EQUAL(steps, recordStepIntervals(steps, intervals, steps));
+    TEST_ASSERT_EQUAL(steps, fakeStepTimer.pulses);
+
+    for (uint16_t i = 0; i < steps; i++) {
+        // Acceleration, cruise, then deceleration mirroring the acceleration
+        if (i < RAMP_STEPS) TEST_ASSERT_EQUAL_UINT16(rampIntervalsUs.us[i], intervals[i]);
+        else if (i < steps - RAMP_STEPS) TEST_ASSERT_EQUAL_UINT16(MotionConfig::MIN_STEP_PERIOD_US, intervals[i]);
+        TEST_ASSERT_EQUAL_UINT16(intervals[i], intervals[steps - 1 - i]);
+    }
+
+    // The move ends back at the start rate
+    TEST_ASSERT_EQUAL_UINT16(MotionConfig::START_STEP_PERIOD_US, intervals[steps - 1]);
+    TEST_ASSERT_EQUAL(plannedMoveDurationUs(steps), fakeStepTimer.lastPulseUs);
+}
+
+void test_motion_planner_triangle_sequence() {
+    // A move too short to reach the cruise rate peaks in the middle
+    const uint16_t steps = RAMP_STEPS;
+    static uint16_t intervals[RAMP_STEPS];
+    TEST_ASSERT_EQUAL(steps, recordStepIntervals(steps, intervals, steps));
+
+    for (uint16_t i = 0; i < steps; i++) {
+        TEST_ASSERT_GREATER_THAN(MotionConfig::MIN_STEP_PERIOD_US, intervals[i]);
+        TEST_ASSERT_EQUAL_UINT16(intervals[i], intervals[steps - 1 - i]);
+    }
+    for (uint16_t i = 1; i < steps / 2; i++)
+        TEST_ASSERT_LESS_OR_EQUAL(intervals[i - 1], intervals[i]);
+
+    // Single step moves run at the start rate
+    TEST_ASSERT_EQUAL_UINT16(MotionConfig::START_STEP_PERIOD_US, plannedStepIntervalUs(0, 1));
+}
+
+void test_motion_planner_faster_than_constant_rate() {
+    // A full 5 degree move should be quicker than stepping at the start rate throughout
+    const uint16_t steps = (uint16_t)lroundf(ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE / HardwareConfig::DEGREES_PER_STEP);
+    TEST_ASSERT_LESS_THAN((uint32_t)steps * MotionConfig::START_STEP_PERIOD_US, plannedMoveDurationUs(steps));
+}
+
+void run_all_motion_planner_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_motion_planner_ramp_table);
+    RUN_TEST(test_motion_planner_trapezoid_sequence);
+    RUN_TEST(test_motion_planner_triangle_sequence);
+    RUN_TEST(test_motion_planner_faster_than_constant_rate);
+}
+
+#endif // TEST_MOTION_PLANNER_H
@@ -0,0 +1,111 @@
+#ifndef TEST_POSITION_ESTIMATOR_H
+#define TEST_POSITION_ESTIMATOR_H
+
+#include <unity.h>
+
+#include "config.h"
+#include <position_estimator.h>
+
+// Tolerance on angles in degrees (a couple of LSBs of the fixed point representation)
+constexpr float angleEps = 2.0f / AngleQ::ONE;
+
+constexpr unsigned long samplePeriodMs = (unsigned long)(TimingConfig::ENCODER_SAMPLE_PERIOD_S * 1000);
+
+// Dead-reckoned angle after pos steps from 0
+float expectedEstimate(float anchor, int32_t pos) {
+    return anchor + pos * HardwareConfig::DEGREES_PER_STEP;
+}
+
+// Steps covering the given angle
+int32_t stepsFor(float angle) {
+    return (int32_t)lroundf(angle / HardwareConfig::DEGREES_PER_STEP);
+}
+
+void test_position_estimator_dead_reckoning() {
+    PositionEstimator pe;
+    TEST_ASSERT_FALSE(pe.isInitialized());
+    TEST_ASSERT_TRUE(pe.isSampleDue(0));
+
+    pe.reset(degToAngle(45.0f), 1000, 0);
+    TEST_ASSERT_TRUE(pe.isInitialized());
+    TEST_ASSERT_FALSE(pe.isSampleDue(samplePeriodMs - 1));
+    TEST_ASSERT_TRUE(pe.isSampleDue(samplePeriodMs));
+
+    // The estimate follows the commanded steps in both directions
+    TEST_ASSERT_EQUAL_FLOAT(45.0f, angleToDeg(pe.estimate(1000)));
+    TEST_ASSERT_FLOAT_WITHIN(angleEps, 45.0f + 100 * HardwareConfig::DEGREES_PER_STEP, angleToDeg(pe.estimate(1100)));
+    TEST_ASSERT_FLOAT_WITHIN(angleEps, 45.0f - 100 * HardwareConfig::DEGREES_PER_STEP, angleToDeg(pe.estimate(900)));
+}
+
+void test_position_estimator_correction() {
+    PositionEstimator pe;
+    pe.reset(degToAngle(45.0f), 0, 0);
+
+    // Encoder agrees with the steps to within a bit of backlash
+    int32_t pos = stepsFor(2.0f);
+    TEST_ASSERT_EQUAL(EstimatorStatus::OK, pe.correct(degToAngle(46.9f), pos, samplePeriodMs));
+    TEST_ASSERT_FLOAT_WITHIN(angleEps, 46.9f - expectedEstimate(45.0f, pos), angleToDeg(pe.getMismatch()));
+
+    // The estimate is re-anchored on the encoder
+    TEST_ASSERT_FLOAT_WITHIN(angleEps, 46.9f, angleToDeg(pe.estimate(pos)));
+    TEST_ASSERT_FALSE(pe.isSampleDue(samplePeriodMs));
+}
+
+void test_position_estimator_no_motion() {
+    PositionEstimator pe;
+    pe.reset(degToAngle(45.0f), 0, 0);
+    unsigned long now = 0;
+    int32_t pos = 0;
+
+    // Stepping without the encoder moving faults after CONSEC_NO_MOTION_THRESHOLD samples
+    for (int i = 1; i < FDIRConfig::CONSEC_NO_MOTION_THRESHOLD; i++) {
+        pos += stepsFor(1.0f);
+        now += samplePeriodMs;
+        TEST_ASSERT_EQUAL(EstimatorStatus::OK, pe.correct(degToAngle(45.0f), pos, now));
+    }
+
+    // Samples without commanded motion do not reset or add to the count
+    now += samplePeriodMs;
+    TEST_ASSERT_EQUAL(EstimatorStatus::OK, pe.correct(degToAngle(45.0f), pos, now));
+
+    pos += stepsFor(1.0f);
+    now += samplePeriodMs;
+    TEST_ASSERT_EQUAL(EstimatorStatus::NO_MOTION, pe.correct(degToAngle(45.0f), pos, now));
+
+    // Motion resets the count
+    pe.reset(degToAngle(45.0f), 0, 0);
+    pos = stepsFor(1.0f);
+    TEST_ASSERT_EQUAL(EstimatorStatus::OK, pe.correct(degToAngle(45.0f), pos, samplePeriodMs));
+    pos += stepsFor(1.0f);
+    TEST_ASSERT_EQUAL(EstimatorStatus::OK, pe.correct(degToAngle(46.0f), pos, 2 * samplePeriodMs));
+    TEST_ASSERT_EQUAL(EstimatorStatus::OK, pe.correct(degToAngle(46.0f), pos + stepsFor(1.0f), 3 * samplePeriodMs));
+}
+
+void test_position_estimator_mismatch() {
+    PositionEstimator pe;
+    pe.reset(degToAngle(45.0f), 0, 0);
+    unsigned long now = 0;
+    float angle = 45.0f;
+    int32_t pos = 0;
+
+    // Moving only half as far as commanded (i.e. losing steps) faults after CONSEC_MISMATCH_THRESHOLD samples
+    for (int i = 1; i <= FDIRConfig::CONSEC_MISMATCH_THRESHOLD; i++) {
+        pos += stepsFor(4.0f * FDIRConfig::ENCODER_MISMATCH_THRESHOLD);
+        angle += 2.0f * FDIRConfig::ENCODER_MISMATCH_THRESHOLD;
+        now += samplePeriodMs;
+        EstimatorStatus status = pe.correct(degToAngle(angle), pos, now);
+        if (i < FDIRConfig::CONSEC_MISMATCH_THRESHOLD) TEST_ASSERT_EQUAL(EstimatorStatus::OK, status);
+        else TEST_ASSERT_EQUAL(EstimatorStatus::ENCODER_MISMATCH, status);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, -2.0f * FDIRConfig::ENCODER_MISMATCH_THRESHOLD, angleToDeg(pe.getMismatch()));
+}
+
+void run_all_position_estimator_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_position_estimator_dead_reckoning);
+    RUN_TEST(test_position_estimator_correction);
+    RUN_TEST(test_position_estimator_no_motion);
+    RUN_TEST(test_position_estimator_mismatch);
+}
+
+#endif // TEST_POSITION_ESTIMATOR_H
@@ -231,6 +231,18 @@ void test_pressure_validation_three_sensors_5() {
 
 #endif
 
+/* A changed fault threshold: as many differences as it says before the fault. */
+void test_pressure_validation_fault_threshold() {
+    float pressureReturned;
+    PressureSensor ps;
+    TEST_ASSERT_EQUAL(SensorConfig::CONSEC_BEFORE_ERR_THRESHOLD, ps.getFaultThreshold());
+    ps.setFaultThreshold(2);
+
+    float differing = SensorConfig::P_MIN + SensorConfig::PAIR_DIFFERENCE_THRESHOLD + 1;
+    TEST_ASSERT_EQUAL(SensorStatus::PENDING_FAULT, ps.processTwoValidSensors(SensorConfig::P_MIN, differing, pressureReturned));
+    TEST_ASSERT_EQUAL(SensorStatus::TWO_ILLOGICAL, ps.processTwoValidSensors(SensorConfig::P_MIN, differing, pressureReturned));
+}
+
 void run_all_pressure_sensor_tests() {
     UnitySetTestFile(__FILE__);
 #if USE_3_PTS
@@ -245,6 +257,7 @@ void run_all_pressure_sensor_tests() {
     RUN_TEST(test_pressure_validation_two_sensors_3);
     RUN_TEST(test_pressure_validation_two_sensors_4);
 #endif
+    RUN_TEST(test_pressure_validation_fault_threshold);
 }
 
 #endif // TEST_PRESSURE_SENSOR_H
@@ -0,0 +1,161 @@
+#ifndef TEST_SCHEDULER_H
+#define TEST_SCHEDULER_H
+
+#include <unity.h>
+
+#include "config.h"
+#include <scheduler.h>
+
+// Fake micros() clock; the tasks advance it to simulate their run time
+unsigned long fakeSchedulerNowUs = 0;
+unsigned long fakeSchedulerClock() { return fakeSchedulerNowUs; }
+
+int fastTaskRuns = 0, slowTaskRuns = 0;
+unsigned long slowTaskRunUs = 0;
+void fastTask() { fastTaskRuns++; }
+void slowTask() { slowTaskRuns++; fakeSchedulerNowUs += slowTaskRunUs; }
+
+void resetFakeScheduler() {
+    fakeSchedulerNowUs = 1000;
+    fastTaskRuns = 0;
+    slowTaskRuns = 0;
+    slowTaskRunUs = 0;
+}
+
+void test_scheduler_fixed_rate() {
+    resetFakeScheduler();
+    TaskScheduler scheduler(fakeSchedulerClock);
+    int8_t background = scheduler.addTask(fastTask, 0);
+    int8_t control = scheduler.addTask(slowTask, hzToPeriodUs(TimingConfig::CONTROL_PERIOD_HZ));
+    TEST_ASSERT_EQUAL(0, background);
+    TEST_ASSERT_EQUAL(1, control);
+    const unsigned long periodUs = hzToPeriodUs(TimingConfig::CONTROL_PERIOD_HZ);
+    TEST_ASSERT_EQUAL(50000, periodUs);
+
+    scheduler.start();
+    unsigned long startUs = fakeSchedulerNowUs;
+
+    // Loop passes every 300 us (not a divisor of the period) for one second
+    for (int pass = 0; fakeSchedulerNowUs < startUs + 1000000; pass++) {
+        scheduler.runPending();
+        fakeSchedulerNowUs += 300;
+    }
+
+    // 20 control releases, each on the 50 ms grid, while the background task ran on every pass
+    TEST_ASSERT_EQUAL(20, slowTaskRuns);
+    TEST_ASSERT_EQUAL(19 * periodUs, scheduler.getReleaseUs(control) - startUs);
+    TEST_ASSERT_EQUAL(0, scheduler.getStats(control).overruns);
+    TEST_ASSERT_TRUE(scheduler.getStats(control).maxLatencyUs < 300);
+    TEST_ASSERT_EQUAL((uint32_t)fastTaskRuns, scheduler.getStats(background).runs);
+    TEST_ASSERT_TRUE(fastTaskRuns > 3000);
+}
+
+void test_scheduler_overruns() {
+    resetFakeScheduler();
+    TaskScheduler scheduler(fakeSchedulerClock);
+    int8_t control = scheduler.addTask(slowTask, 10000);
+    scheduler.start();
+    unsigned long startUs = fakeSchedulerNowUs;
+
+    // A run taking 2.5 periods overruns the next release, and the one after that starts late
+    slowTaskRunUs = 25000;
+    scheduler.runPending();
+    TEST_ASSERT_EQUAL(25000, scheduler.getStats(control).maxRunUs);
+
+    slowTaskRunUs = 100;
+    scheduler.runPending();
+    TEST_ASSERT_EQUAL(2, slowTaskRuns);
+    TEST_ASSERT_EQUAL(1, scheduler.getStats(control).overruns);
+    TEST_ASSERT_EQUAL(20000, scheduler.getReleaseUs(control) - startUs);
+    TEST_ASSERT_EQUAL(5000, scheduler.getStats(control).maxLatencyUs);
+
+    // Back on the grid afterwards
+    fakeSchedulerNowUs = startUs + 29999;
+    scheduler.runPending();
+    TEST_ASSERT_EQUAL(2, slowTaskRuns);
+    fakeSchedulerNowUs = startUs + 30000;
+    scheduler.runPending();
+    TEST_ASSERT_EQUAL(3, slowTaskRuns);
+    TEST_ASSERT_EQUAL(1, scheduler.getStats(control).overruns);
+
+    // Each whole period of lateness is another overrun
+    scheduler.resetStats();
+    slowTaskRunUs = 35000;
+    fakeSchedulerNowUs = startUs + 40000;
+    scheduler.runPending();
+    scheduler.runPending();
+    TEST_ASSERT_EQUAL(2, scheduler.getStats(control).overruns);
+    TEST_ASSERT_EQUAL(70000, scheduler.getReleaseUs(control) - startUs);
+
+    scheduler.resetStats();
+    TEST_ASSERT_EQUAL(0, scheduler.getStats(control).runs);
+    TEST_ASSERT_EQUAL(0, scheduler.getStats(control).overruns);
+}
+
+void test_scheduler_clock_wraparound() {
+    resetFakeScheduler();
+    fakeSchedulerNowUs = 0xFFFFFFFFUL - 15000;
+    TaskScheduler scheduler(fakeSchedulerClock);
+    scheduler.addTask(slowTask, 10000);
+    scheduler.start();
+
+    for (int i = 0; i < 40; i++) {
+        scheduler.runPending();
+        fakeSchedulerNowUs += 1000;
+    }
+    TEST_ASSERT_EQUAL(4, slowTaskRuns);
+}
+
+void test_scheduler_next_release() {
+    resetFakeScheduler();
+    TaskScheduler scheduler(fakeSchedulerClock);
+    scheduler.addTask(fastTask, 0);
+    scheduler.addTask(slowTask, 10000);
+    scheduler.addTask(slowTask, 4000);
+    scheduler.start();
+    TEST_ASSERT_EQUAL(1000, scheduler.getNextReleaseUs(fakeSchedulerNowUs)); // Released by start()
+
+    scheduler.runPending();
+    fakeSchedulerNowUs += 500;
+    TEST_ASSERT_EQUAL(5000, scheduler.getNextReleaseUs(fakeSchedulerNowUs));
+
+    // Late
+    fakeSchedulerNowUs = 6000;
+    TEST_ASSERT_EQUAL(6000, scheduler.getNextReleaseUs(fakeSchedulerNowUs));
+}
+
+void test_scheduler_is_due() {
+    resetFakeScheduler();
+    TaskScheduler scheduler(fakeSchedulerClock);
+    scheduler.addTask(slowTask, 10000);
+    scheduler.start();
+    TEST_ASSERT_TRUE(scheduler.isDue(fakeSchedulerNowUs));
+
+    scheduler.runPending();
+    TEST_ASSERT_FALSE(scheduler.isDue(fakeSchedulerNowUs + 9999));
+    TEST_ASSERT_TRUE(scheduler.isDue(fakeSchedulerNowUs + 10000));
+    TEST_ASSERT_EQUAL(1, slowTaskRuns); // Only runPending() runs tasks
+
+    // A task with a period of 0 is always due
+    scheduler.addTask(fastTask, 0);
+    TEST_ASSERT_TRUE(scheduler.isDue(fakeSchedulerNowUs));
+}
+
+void test_scheduler_task_table_full() {
+    TaskScheduler scheduler(fakeSchedulerClock);
+    for (uint8_t i = 0; i < TaskScheduler::MAX_TASKS; i++)
+        TEST_ASSERT_EQUAL(i, scheduler.addTask(fastTask, 1000));
+    TEST_ASSERT_EQUAL(-1, scheduler.addTask(fastTask, 1000));
+}
+
+void run_all_scheduler_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_scheduler_fixed_rate);
+    RUN_TEST(test_scheduler_overruns);
+    RUN_TEST(test_scheduler_clock_wraparound);
+    RUN_TEST(test_scheduler_next_release);
+    RUN_TEST(test_scheduler_is_due);
+    RUN_TEST(test_scheduler_task_table_full);
+}
+
+#endif // TEST_SCHEDULER_H
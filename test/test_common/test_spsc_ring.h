@@ -0,0 +1,69 @@
+#ifndef TEST_SPSC_RING_H
+#define TEST_SPSC_RING_H
+
+#include <unity.h>
+
+#include <spsc_ring.h>
+
+void test_spsc_ring_push_pop() {
+    SpscRing<8> ring;
+    uint8_t byte;
+    TEST_ASSERT_FALSE(ring.pop(byte));
+
+    // Several times round the ring, so that the indices wrap around
+    for (uint8_t i = 0; i < 20; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+        TEST_ASSERT_TRUE(ring.push(i + 100));
+        TEST_ASSERT_EQUAL(2, ring.available());
+        TEST_ASSERT_TRUE(ring.pop(byte));
+        TEST_ASSERT_EQUAL(i, byte);
+        TEST_ASSERT_TRUE(ring.pop(byte));
+        TEST_ASSERT_EQUAL(i + 100, byte);
+    }
+    TEST_ASSERT_EQUAL(0, ring.available());
+    TEST_ASSERT_EQUAL(0, ring.getOverflowCount());
+}
+
+void test_spsc_ring_overflow() {
+    SpscRing<8> ring;
+    for (uint8_t i = 0; i < SpscRing<8>::CAPACITY; i++)
+        TEST_ASSERT_TRUE(ring.push(i));
+
+    // Full: further bytes are dropped and counted, and what was there is kept
+    TEST_ASSERT_FALSE(ring.push(0xAA));
+    TEST_ASSERT_FALSE(ring.push(0xBB));
+    TEST_ASSERT_EQUAL(2, ring.getOverflowCount());
+
+    uint8_t out[8];
+    TEST_ASSERT_EQUAL(SpscRing<8>::CAPACITY, ring.popBatch(out, sizeof(out)));
+    for (uint8_t i = 0; i < SpscRing<8>::CAPACITY; i++)
+        TEST_ASSERT_EQUAL(i, out[i]);
+    TEST_ASSERT_TRUE(ring.push(0xCC));
+}
+
+void test_spsc_ring_batches() {
+    SpscRing<256> ring;
+    uint8_t out[40];
+    uint8_t next = 0, expected = 0;
+
+    // Batches smaller and larger than what is buffered, across the wraparound
+    for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < 37; i++) TEST_ASSERT_TRUE(ring.push(next++));
+        uint8_t count;
+        while ((count = ring.popBatch(out, round % 2 ? sizeof(out) : 16)) > 0) {
+            for (uint8_t i = 0; i < count; i++)
+                TEST_ASSERT_EQUAL(expected++, out[i]);
+        }
+    }
+    TEST_ASSERT_EQUAL(next, expected);
+    TEST_ASSERT_EQUAL(0, ring.popBatch(out, sizeof(out)));
+}
+
+void run_all_spsc_ring_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_spsc_ring_push_pop);
+    RUN_TEST(test_spsc_ring_overflow);
+    RUN_TEST(test_spsc_ring_batches);
+}
+
+#endif // TEST_SPSC_RING_H
@@ -0,0 +1,140 @@
+#ifndef TEST_STEP_ENGINE_H
+#define TEST_STEP_ENGINE_H
+
+#include <unity.h>
+
+#include "config.h"
+#include <motion_planner.h>
+#include <step_engine.h>
+
+/*
+ * Fake step timer. Instead of a hardware compare interrupt, the tests call
+ * fakeTimerRun() which fires onTimerCompare() for as long as the timer is running.
+ */
+struct FakeStepTimer {
+    bool running;
+    bool isrMasked;
+    bool reverse;
+    uint16_t periodUs;
+    unsigned long nowUs;
+    unsigned long pulses;
+    unsigned long lastPulseUs;
+
+    void reset() {
+        running = false;
+        isrMasked = false;
+        reverse = false;
+        periodUs = 0;
+        nowUs = 0;
+        pulses = 0;
+        lastPulseUs = 0;
+    }
+};
+
+FakeStepTimer fakeStepTimer;
+
+void fakeTimerStart(uint16_t periodUs) { fakeStepTimer.running = true; fakeStepTimer.periodUs = periodUs; }
+void fakeTimerSetPeriod(uint16_t periodUs) { fakeStepTimer.periodUs = periodUs; }
+void fakeTimerStop() { fakeStepTimer.running = false; }
+void fakeTimerSetIsrMasked(bool masked) { fakeStepTimer.isrMasked = masked; }
+void fakeSetDirection(bool reverse) { fakeStepTimer.reverse = reverse; }
+void fakePulse() { fakeStepTimer.pulses++; fakeStepTimer.lastPulseUs = fakeStepTimer.nowUs; }
+
+const StepEngineHooks fakeStepEngineHooks = {
+    fakeTimerStart,
+    fakeTimerSetPeriod,
+    fakeTimerStop,
+    fakeTimerSetIsrMasked,
+    fakeSetDirection,
+    fakePulse
+};
+
+// Fire up to maxCompares compare interrupts, returning the number fired
+unsigned long fakeTimerRun(StepEngine& engine, unsigned long maxCompares) {
+    unsigned long n = 0;
+    while (fakeStepTimer.running && !fakeStepTimer.isrMasked && n < maxCompares) {
+        fakeStepTimer.nowUs += fakeStepTimer.periodUs;
+        engine.onTimerCompare();
+        n++;
+    }
+    return n;
+}
+
+void test_step_engine_move_completes_in_background() {
+    StepEngine engine;
+    engine.begin(&fakeStepEngineHooks);
+    fakeStepTimer.reset();
+
+    TEST_ASSERT_FALSE(engine.isBusy());
+    TEST_ASSERT_TRUE(engine.start(139, false));
+    TEST_ASSERT_TRUE(engine.isBusy());
+    TEST_ASSERT_EQUAL_UINT16(139, engine.stepsRemaining());
+    TEST_ASSERT_TRUE(fakeStepTimer.running);
+    TEST_ASSERT_EQUAL_UINT16(MotionConfig::START_STEP_PERIOD_US, fakeStepTimer.periodUs);
+    TEST_ASSERT_FALSE(fakeStepTimer.reverse);
+
+    // Partway through, the engine should still be busy (the control loop runs in between)
+    fakeTimerRun(engine, 100);
+    TEST_ASSERT_TRUE(engine.isBusy());
+    TEST_ASSERT_EQUAL_UINT16(39, engine.stepsRemaining());
+    TEST_ASSERT_EQUAL(100, fakeStepTimer.pulses);
+
+    fakeTimerRun(engine, 1000);
+    TEST_ASSERT_FALSE(engine.isBusy());
+    TEST_ASSERT_FALSE(fakeStepTimer.running);
+    TEST_ASSERT_EQUAL(139, fakeStepTimer.pulses);
+    TEST_ASSERT_EQUAL(plannedMoveDurationUs(139), fakeStepTimer.lastPulseUs);
+}
+
+void test_step_engine_rejects_start_while_busy() {
+    StepEngine engine;
+    engine.begin(&fakeStepEngineHooks);
+    fakeStepTimer.reset();
+
+    TEST_ASSERT_FALSE(engine.start(0, false));
+    TEST_ASSERT_FALSE(fakeStepTimer.running);
+
+    TEST_ASSERT_TRUE(engine.start(10, true));
+    TEST_ASSERT_TRUE(fakeStepTimer.reverse);
+    TEST_ASSERT_FALSE(engine.start(20, false));
+    TEST_ASSERT_TRUE(fakeStepTimer.reverse);
+    TEST_ASSERT_EQUAL_UINT16(10, engine.stepsRemaining());
+
+    fakeTimerRun(engine, 1000);
+    TEST_ASSERT_EQUAL(10, fakeStepTimer.pulses);
+    TEST_ASSERT_TRUE(engine.start(20, false));
+    TEST_ASSERT_FALSE(fakeStepTimer.reverse);
+}
+
+void test_step_engine_stop_and_isr_guard() {
+    StepEngine engine;
+    engine.begin(&fakeStepEngineHooks);
+    fakeStepTimer.reset();
+
+    TEST_ASSERT_TRUE(engine.start(50, false));
+    fakeTimerRun(engine, 5);
+
+    // No steps are emitted while an SPI user holds off the ISR
+    {
+        StepIsrGuard guard(engine);
+        TEST_ASSERT_TRUE(fakeStepTimer.isrMasked);
+        TEST_ASSERT_EQUAL(0, fakeTimerRun(engine, 5));
+    }
+    TEST_ASSERT_FALSE(fakeStepTimer.isrMasked);
+    TEST_ASSERT_EQUAL(5, fakeStepTimer.pulses);
+
+    engine.stop();
+    TEST_ASSERT_FALSE(engine.isBusy());
+    TEST_ASSERT_FALSE(fakeStepTimer.running);
+    TEST_ASSERT_EQUAL(0, fakeTimerRun(engine, 5));
+    TEST_ASSERT_EQUAL(5, fakeStepTimer.pulses);
+}
+
+void run_all_step_engine_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_step_engine_move_completes_in_background);
+    RUN_TEST(test_step_engine_rejects_start_while_busy);
+    RUN_TEST(test_step_engine_stop_and_isr_guard);
+}
+
+#endif // TEST_STEP_ENGINE_H
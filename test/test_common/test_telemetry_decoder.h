@@ -0,0 +1,112 @@
+#ifndef TEST_TELEMETRY_DECODER_H
+#define TEST_TELEMETRY_DECODER_H
+
+#include <string.h>
+#include <unity.h>
+
+#include <comm_handler.h>
+#include <telemetry_decoder.h>
+#include "test_tx_queue.h" // Fake TX hooks
+
+#ifdef BUILD_NATIVE
+    #include <ArduinoFake.h>
+    using namespace fakeit;
+#endif
+
+// Sends one telemetry packet through a CommHandler and returns it as built (unframed)
+size_t captureTelemetry(uint8_t* packet, float motorAngle, float deltaAngle, float intError) {
+    CommHandler commHandler(&fakeTxHooks);
+    resetFakeTx(sizeof(txWritten));
+    commHandler.sendTelemetry(SystemStateEnum::CLOSED_LOOP, motorAngle, deltaAngle, intError, "FUEL", true);
+    TEST_ASSERT_EQUAL(txFrameSize(TX_TELPKT_SIZE), txWrittenLen);
+
+#ifdef USE_COBS_FRAMING
+    CobsDecoder decoder;
+    size_t length = 0;
+    uint8_t decoded;
+    for (size_t i = 1; i < txWrittenLen; i++) {
+        CobsEvent event = decoder.feed(txWritten[i], decoded);
+        if (event == CobsEvent::BYTE) packet[length++] = decoded;
+        else TEST_ASSERT_TRUE(event == CobsEvent::NONE || (event == CobsEvent::FRAME_END && i == txWrittenLen - 1));
+    }
+    TEST_ASSERT_EQUAL(COMM_PROTOCOL_VERSION, packet[0]);
+    memmove(packet, packet + 1, --length);
+    return length;
+#else
+    memcpy(packet, txWritten, txWrittenLen);
+    return txWrittenLen;
+#endif
+}
+
+void test_telemetry_decoder_round_trip() {
+#ifdef BUILD_NATIVE
+    When(Method(ArduinoFake(), millis)).AlwaysReturn(123456);
+#endif
+    uint8_t packet[TX_TELPKT_SIZE];
+    size_t length = captureTelemetry(packet, 12.3441f, -0.678f, 0.0421f);
+    TEST_ASSERT_EQUAL(TX_TELPKT_SIZE, length);
+
+    TelemetrySample sample;
+    TEST_ASSERT_EQUAL(TelemetryDecodeResult::OK, decodeTelemetryPacket(packet, length, sample));
+    TEST_ASSERT_EQUAL(SystemStateEnum::CLOSED_LOOP, sample.systemState);
+    TEST_ASSERT_EQUAL_HEX8(TELPKT_FLAGS_MPV_SHD_BE_CLOSED | TELPKT_FLAGS_SYSTEM_TYPE,
+                           sample.flags & (TELPKT_FLAGS_MPV_SHD_BE_CLOSED | TELPKT_FLAGS_SYSTEM_TYPE));
+    TEST_ASSERT_EQUAL(0, sample.txSent);
+
+#ifdef USE_COMPACT_TELEMETRY
+    // Within half a quantisation step
+    TEST_ASSERT_TRUE(sample.compact);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f / CTELPKT_ANGLE_SCALE, 12.3441f, sample.motorAngle);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f / CTELPKT_ANGLE_SCALE, -0.678f, sample.deltaAngle);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f / CTELPKT_INTEGRAL_SCALE, 0.0421f, sample.intError);
+#ifdef BUILD_NATIVE
+    TEST_ASSERT_EQUAL(123456, sample.timestampMs);
+#endif
+#else
+    TEST_ASSERT_FALSE(sample.compact);
+    TEST_ASSERT_EQUAL_FLOAT(12.3441f, sample.motorAngle);
+    TEST_ASSERT_EQUAL_FLOAT(-0.678f, sample.deltaAngle);
+    TEST_ASSERT_EQUAL_FLOAT(0.0421f, sample.intError);
+#endif
+
+#ifdef BUILD_NATIVE
+    When(Method(ArduinoFake(), millis)).AlwaysReturn();
+#endif
+}
+
+void test_telemetry_decoder_rejects_bad_packets() {
+    uint8_t packet[TX_TELPKT_SIZE];
+    size_t length = captureTelemetry(packet, 1.0f, 0.0f, 0.0f);
+    TelemetrySample sample;
+
+    TEST_ASSERT_EQUAL(TelemetryDecodeResult::TOO_SHORT, decodeTelemetryPacket(packet, length - 1, sample));
+
+    packet[length - 1] ^= 0x01;
+    TEST_ASSERT_EQUAL(TelemetryDecodeResult::BAD_CHECKSUM, decodeTelemetryPacket(packet, length, sample));
+
+    packet[0] ^= 0x01;
+    TEST_ASSERT_EQUAL(TelemetryDecodeResult::BAD_MAGIC, decodeTelemetryPacket(packet, length, sample));
+}
+
+#ifdef USE_COMPACT_TELEMETRY
+void test_telemetry_decoder_compact_saturates() {
+    uint8_t packet[TX_TELPKT_SIZE];
+    size_t length = captureTelemetry(packet, 1000.0f, -1000.0f, 0.0f);
+
+    TelemetrySample sample;
+    TEST_ASSERT_EQUAL(TelemetryDecodeResult::OK, decodeTelemetryPacket(packet, length, sample));
+    TEST_ASSERT_EQUAL_FLOAT(INT16_MAX / CTELPKT_ANGLE_SCALE, sample.motorAngle);
+    TEST_ASSERT_EQUAL_FLOAT(INT16_MIN / CTELPKT_ANGLE_SCALE, sample.deltaAngle);
+}
+#endif
+
+void run_all_telemetry_decoder_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_telemetry_decoder_round_trip);
+    RUN_TEST(test_telemetry_decoder_rejects_bad_packets);
+#ifdef USE_COMPACT_TELEMETRY
+    RUN_TEST(test_telemetry_decoder_compact_saturates);
+#endif
+}
+
+#endif // TEST_TELEMETRY_DECODER_H
@@ -0,0 +1,139 @@
+#ifndef TEST_TX_QUEUE_H
+#define TEST_TX_QUEUE_H
+
+#include <string.h>
+#include <unity.h>
+
+#include <tx_queue.h>
+
+// Fake serial port: a TX buffer with txRoom bytes free, and everything written so far
+int txRoom;
+uint8_t txWritten[512];
+size_t txWrittenLen;
+
+int fakeAvailableForWrite() { return txRoom; }
+
+size_t fakeWrite(const uint8_t* data, size_t length) {
+    TEST_ASSERT_LESS_OR_EQUAL(txRoom, (int)length);
+    memcpy(txWritten + txWrittenLen, data, length);
+    txWrittenLen += length;
+    txRoom -= (int)length;
+    return length;
+}
+
+const TxHooks fakeTxHooks = { fakeAvailableForWrite, fakeWrite };
+
+void resetFakeTx(int room) {
+    txRoom = room;
+    txWrittenLen = 0;
+}
+
+void queueTestFrame(TxQueue& queue, int8_t slot, uint8_t fill, uint8_t length) {
+    uint8_t* frame = queue.beginFrame(slot);
+    TEST_ASSERT_NOT_NULL(frame);
+    memset(frame, fill, length);
+    queue.commit(slot, length);
+}
+
+void test_tx_queue_partial_writes() {
+    uint8_t buffer[40];
+    TxQueue queue(&fakeTxHooks);
+    int8_t slot = queue.addSlot(buffer, sizeof(buffer), TxPolicy::COALESCE);
+    resetFakeTx(0);
+
+    queueTestFrame(queue, slot, 0x11, 30);
+    queue.pump();
+    TEST_ASSERT_EQUAL(0, txWrittenLen);
+
+    // The frame goes out in pieces as the TX buffer empties
+    txRoom = 12;
+    queue.pump();
+    TEST_ASSERT_EQUAL(12, txWrittenLen);
+    TEST_ASSERT_FALSE(queue.isIdle());
+    txRoom = 64;
+    queue.pump();
+    TEST_ASSERT_EQUAL(30, txWrittenLen);
+    TEST_ASSERT_TRUE(queue.isIdle());
+    TEST_ASSERT_EQUAL(1, queue.getStats().sent);
+}
+
+void test_tx_queue_coalesce() {
+    uint8_t buffer[40];
+    TxQueue queue(&fakeTxHooks);
+    int8_t slot = queue.addSlot(buffer, sizeof(buffer), TxPolicy::COALESCE);
+    resetFakeTx(0);
+
+    // A stale frame that has not started going out is replaced
+    queueTestFrame(queue, slot, 0x11, 20);
+    queueTestFrame(queue, slot, 0x22, 20);
+    TEST_ASSERT_EQUAL(1, queue.getStats().coalesced);
+
+    // One that has started is finished, and the newer frame is dropped
+    txRoom = 5;
+    queue.pump();
+    TEST_ASSERT_NULL(queue.beginFrame(slot));
+    TEST_ASSERT_EQUAL(1, queue.getStats().dropped);
+
+    txRoom = 64;
+    queue.pump();
+    TEST_ASSERT_EQUAL(20, txWrittenLen);
+    for (size_t i = 0; i < txWrittenLen; i++) TEST_ASSERT_EQUAL_HEX8(0x22, txWritten[i]);
+    TEST_ASSERT_EQUAL(1, queue.getStats().sent);
+}
+
+void test_tx_queue_drop_newest() {
+    uint8_t buffer[40];
+    TxQueue queue(&fakeTxHooks);
+    int8_t slot = queue.addSlot(buffer, sizeof(buffer), TxPolicy::DROP_NEWEST);
+    resetFakeTx(0);
+
+    queueTestFrame(queue, slot, 0x11, 10);
+    TEST_ASSERT_NULL(queue.beginFrame(slot));
+    TEST_ASSERT_EQUAL(1, queue.getStats().dropped);
+    TEST_ASSERT_EQUAL(0, queue.getStats().coalesced);
+
+    txRoom = 64;
+    queue.pump();
+    TEST_ASSERT_EQUAL(10, txWrittenLen);
+    TEST_ASSERT_EQUAL_HEX8(0x11, txWritten[0]);
+}
+
+void test_tx_queue_oldest_first() {
+    uint8_t bufferA[16], bufferB[16];
+    TxQueue queue(&fakeTxHooks);
+    int8_t slotA = queue.addSlot(bufferA, sizeof(bufferA), TxPolicy::COALESCE);
+    int8_t slotB = queue.addSlot(bufferB, sizeof(bufferB), TxPolicy::COALESCE);
+    resetFakeTx(0);
+
+    // Frames are not interleaved, and go out in the order they were queued
+    queueTestFrame(queue, slotB, 0xBB, 8);
+    queueTestFrame(queue, slotA, 0xAA, 8);
+    txRoom = 3;
+    queue.pump();
+    txRoom = 64;
+    queue.pump();
+
+    TEST_ASSERT_EQUAL(16, txWrittenLen);
+    for (size_t i = 0; i < 8; i++) TEST_ASSERT_EQUAL_HEX8(0xBB, txWritten[i]);
+    for (size_t i = 8; i < 16; i++) TEST_ASSERT_EQUAL_HEX8(0xAA, txWritten[i]);
+    TEST_ASSERT_EQUAL(2, queue.getStats().sent);
+}
+
+void test_tx_queue_slot_table_full() {
+    uint8_t buffer[4];
+    TxQueue queue(&fakeTxHooks);
+    for (uint8_t i = 0; i < TxQueue::MAX_SLOTS; i++)
+        TEST_ASSERT_EQUAL(i, queue.addSlot(buffer, sizeof(buffer), TxPolicy::COALESCE));
+    TEST_ASSERT_EQUAL(-1, queue.addSlot(buffer, sizeof(buffer), TxPolicy::COALESCE));
+}
+
+void run_all_tx_queue_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_tx_queue_partial_writes);
+    RUN_TEST(test_tx_queue_coalesce);
+    RUN_TEST(test_tx_queue_drop_newest);
+    RUN_TEST(test_tx_queue_oldest_first);
+    RUN_TEST(test_tx_queue_slot_table_full);
+}
+
+#endif // TEST_TX_QUEUE_H
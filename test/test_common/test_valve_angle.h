@@ -0,0 +1,107 @@
+#ifndef TEST_VALVE_ANGLE_H
+#define TEST_VALVE_ANGLE_H
+
+#include <unity.h>
+
+#include "config.h"
+#include <valve_angle.h>
+#include "angle_tick.h"
+
+// The fixed point pipeline should agree with float to within its resolution
+constexpr float fixedAngleTolerance = 1.0f / AngleQ::ONE;
+
+void test_fixed_point_saturates() {
+    typedef Fixed<int16_t, int32_t, 8> Q8;
+    TEST_ASSERT_EQUAL_INT16(384, Q8(1.5f).raw());
+    TEST_ASSERT_EQUAL_INT16(-384, Q8(-1.5f).raw());
+    TEST_ASSERT_EQUAL_FLOAT(-0.75f, (Q8(1.5f) * Q8(-0.5f)).toFloat());
+
+    TEST_ASSERT_TRUE(Q8(1000.0f) == Q8::max());
+    TEST_ASSERT_TRUE(Q8(100.0f) + Q8(100.0f) == Q8::max());
+    TEST_ASSERT_TRUE(Q8(-100.0f) - Q8(100.0f) == Q8::min());
+    TEST_ASSERT_TRUE(Q8(16.0f) * Q8(16.0f) == Q8::max());
+    TEST_ASSERT_TRUE(-Q8::min() == Q8::max());
+}
+
+void test_valve_angle_from_counts() {
+    for (uint16_t counts = 0; counts <= (uint16_t)HardwareConfig::MAX_12_BIT_VAL; counts++) {
+        float ref = AngleOps<float>::fromCounts(counts);
+        AngleQ angle = AngleOps<AngleQ>::fromCounts(counts);
+        TEST_ASSERT_FLOAT_WITHIN(fixedAngleTolerance, ref, angle.toFloat());
+        TEST_ASSERT_EQUAL(isAngleValid(ref), isAngleValid(angle));
+    }
+}
+
+void test_valve_angle_steps() {
+    for (int32_t steps = -5000; steps <= 5000; steps += 7) {
+        TEST_ASSERT_FLOAT_WITHIN(fixedAngleTolerance, AngleOps<float>::fromSteps(steps),
+                                 AngleOps<AngleQ>::fromSteps(steps).toFloat());
+    }
+
+    // Steps from an angle round like lroundf() on the float error, up to the angle resolution
+    for (float deg = -90.0f; deg <= 90.0f; deg += 0.1f) {
+        AngleQ angle(deg);
+        long ref = AngleOps<float>::toSteps(angle.toFloat());
+        TEST_ASSERT_INT32_WITHIN(1, ref, AngleOps<AngleQ>::toSteps(angle));
+        TEST_ASSERT_EQUAL(-AngleOps<AngleQ>::toSteps(angle), AngleOps<AngleQ>::toSteps(-angle));
+    }
+    TEST_ASSERT_EQUAL(lroundf(10.0f * MotorControlConfig::KP_STEPS_PER_DEG), AngleOps<AngleQ>::toSteps(AngleQ(10.0f)));
+}
+
+void test_valve_angle_limits() {
+    AngleQ delta(12.0f);
+    applyMoveFilter(delta);
+    TEST_ASSERT_EQUAL_FLOAT(ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE, delta.toFloat());
+    delta = AngleQ(-12.0f);
+    applyMoveFilter(delta);
+    TEST_ASSERT_EQUAL_FLOAT(-ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE, delta.toFloat());
+    delta = AngleQ(1.25f);
+    applyMoveFilter(delta);
+    TEST_ASSERT_EQUAL_FLOAT(1.25f * ValveConfig::MOVE_FILTER_SCALE, delta.toFloat());
+
+    // A scale in Q8 agrees with the float one, up to the angle resolution
+    for (float scale = CommandConfig::MOVE_FILTER_SCALE_MIN; scale <= 1.0f; scale += 0.05f) {
+        AngleQ scaled(-3.0f);
+        applyMoveFilter(scaled, AngleQ(ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE), scaleToQ8(scale));
+        float ref = -3.0f;
+        applyMoveFilter(ref, ValveConfig::MAX_ANGLE_CHANGE_PER_CYCLE, scaleToQ8(scale));
+        TEST_ASSERT_FLOAT_WITHIN(1.0f / AngleQ::ONE, ref, scaled.toFloat());
+        TEST_ASSERT_FLOAT_WITHIN(3.0f / 512, -3.0f * scale, ref);
+    }
+
+    TEST_ASSERT_EQUAL_FLOAT(ValveConfig::MIN_VALVE_ANGLE, constrainAngle(AngleQ(10.0f)).toFloat());
+    TEST_ASSERT_EQUAL_FLOAT(ValveConfig::MAX_VALVE_ANGLE, constrainAngle(AngleQ(100.0f)).toFloat());
+    TEST_ASSERT_EQUAL_FLOAT(60.0f, constrainAngle(AngleQ(60.0f)).toFloat());
+
+    TEST_ASSERT_TRUE(isAtStartAngle(AngleQ(ValveConfig::START_ANGLE + ValveConfig::ANGLE_TOLERANCE)));
+    TEST_ASSERT_FALSE(isAtStartAngle(AngleQ(ValveConfig::START_ANGLE + 2 * ValveConfig::ANGLE_TOLERANCE)));
+    TEST_ASSERT_FALSE(isAngleValid(AngleQ(-1.0f)));
+    TEST_ASSERT_FALSE(isAngleValid(AngleQ(360.0f)));
+}
+
+void test_valve_angle_control_tick_matches_float() {
+    // Ticks agree to within a step (1/64 degree is less than half a step), except where an angle
+    // lands within the resolution of a threshold, so that only one of them moves
+    int thresholdFlips = 0, ticks = 0;
+    for (uint16_t counts = 0; counts <= (uint16_t)HardwareConfig::MAX_12_BIT_VAL; counts += 3) {
+        for (int32_t steps = -300; steps <= 300; steps += 50) {
+            long ref = angleControlTick<float>(counts, steps);
+            long fixed = angleControlTick<AngleQ>(counts, steps);
+            if ((ref == 0) != (fixed == 0)) thresholdFlips++;
+            else TEST_ASSERT_INT32_WITHIN(1, ref, fixed);
+            ticks++;
+        }
+    }
+    TEST_ASSERT_LESS_THAN(ticks / 1000, thresholdFlips);
+}
+
+void run_all_valve_angle_tests() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(test_fixed_point_saturates);
+    RUN_TEST(test_valve_angle_from_counts);
+    RUN_TEST(test_valve_angle_steps);
+    RUN_TEST(test_valve_angle_limits);
+    RUN_TEST(test_valve_angle_control_tick_matches_float);
+}
+
+#endif // TEST_VALVE_ANGLE_H
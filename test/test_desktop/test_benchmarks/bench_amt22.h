@@ -0,0 +1,46 @@
+#ifndef BENCH_AMT22_H
+#define BENCH_AMT22_H
+
+#include <unity.h>
+
+#include <AMT22_lib.h>
+#include "../../test_common/amt22_reference.h"
+#include "bench_common.h"
+
+constexpr unsigned long AMT22_BENCH_PASSES = 200;
+
+void bench_amt22_decode() {
+    double refNs = benchNsPerCall([] {
+        uint32_t acc = 0;
+        for (uint32_t response = 0; response <= 0xFFFF; response++)
+            acc += referenceDecodeAMT22(response, RES12);
+        benchSink = acc;
+    }, AMT22_BENCH_PASSES) / 0x10000;
+    uint32_t refSum = benchSink;
+
+    double fastNs = benchNsPerCall([] {
+        uint32_t acc = 0;
+        for (uint32_t response = 0; response <= 0xFFFF; response++)
+            acc += AMT22::decodeResponse(response, RES12);
+        benchSink = acc;
+    }, AMT22_BENCH_PASSES) / 0x10000;
+    uint32_t fastSum = benchSink;
+
+    benchReport("AMT22 decode, reference (bit array)", refNs, "response");
+    benchReport("AMT22 decode, XOR fold", fastNs, "response");
+    printf("[BENCH] AMT22 decode speedup: %.1fx\n", refNs / fastNs);
+
+    // Fixed delays per successful read, from the datasheet timings used by each implementation
+    const unsigned refDelayUs = 5 * AMT22_T_CS_US + 40;  // 2 x (CS setup + hold), byte gap, and the post-read sleep
+    const unsigned fastDelayUs = 2 * AMT22_T_CS_US + AMT22_T_BYTE_US;
+    printf("[BENCH] AMT22 fixed delays per successful read: %u us -> %u us\n", refDelayUs, fastDelayUs);
+
+    TEST_ASSERT_EQUAL_UINT32(refSum, fastSum);
+}
+
+void run_all_amt22_benchmarks() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(bench_amt22_decode);
+}
+
+#endif // BENCH_AMT22_H
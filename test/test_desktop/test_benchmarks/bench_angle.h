@@ -0,0 +1,43 @@
+#ifndef BENCH_ANGLE_H
+#define BENCH_ANGLE_H
+
+#include <unity.h>
+
+#include "config.h"
+#include <valve_angle.h>
+#include "../../test_common/angle_tick.h"
+#include "bench_common.h"
+
+/*
+ * On the host, float has hardware support, so this mostly shows that the fixed point pipeline
+ * is not slower. The cycle savings on the Uno are measured by test/embedded/test_bench_angle.
+ */
+
+constexpr unsigned long ANGLE_BENCH_PASSES = 500;
+constexpr uint16_t ANGLE_BENCH_TICKS = (uint16_t)HardwareConfig::MAX_12_BIT_VAL + 1;
+
+template <typename A>
+void angleBenchPass() {
+    long acc = 0;
+    for (uint16_t counts = 0; counts < ANGLE_BENCH_TICKS; counts++)
+        acc += angleControlTick<A>(counts, (int32_t)(counts & 0xFF) - 128);
+    benchSink = (uint32_t)acc;
+}
+
+void bench_angle_control_tick() {
+    double floatNs = benchNsPerCall(angleBenchPass<float>, ANGLE_BENCH_PASSES) / ANGLE_BENCH_TICKS;
+    double fixedNs = benchNsPerCall(angleBenchPass<AngleQ>, ANGLE_BENCH_PASSES) / ANGLE_BENCH_TICKS;
+
+    benchReport("Angle pipeline per control tick, float", floatNs, "tick");
+    benchReport("Angle pipeline per control tick, AngleQ", fixedNs, "tick");
+    printf("[BENCH] Angle pipeline speedup (host): %.1fx\n", floatNs / fixedNs);
+
+    TEST_ASSERT_TRUE(fixedNs > 0.0);
+}
+
+void run_all_angle_benchmarks() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(bench_angle_control_tick);
+}
+
+#endif // BENCH_ANGLE_H
@@ -0,0 +1,173 @@
+#ifndef BENCH_COMM_HANDLER_H
+#define BENCH_COMM_HANDLER_H
+
+#include <unity.h>
+#include <vector>
+
+#include "config.h"
+#include <comm_handler.h>
+#include <crc16_xmodem.h>
+#include "bench_common.h"
+
+/*
+ * Cost of CommHandler::processIncomingSerialByte() at each byte position of a pressure update
+ * packet (as framed on the wire). The worst position is the one that bounds the latency of the serial polling, which
+ * used to be the last byte (it checksummed the whole packet).
+ */
+
+constexpr unsigned long COMM_BENCH_PACKETS = 200000;
+constexpr size_t COMM_BENCH_MAX_WIRE = cobsFrameSize(UPDTPKT_SIZE + 1);
+
+// The packet as it is sent on the wire in the current build, returns its length
+size_t benchFramePacket(const pressureUpdatePacketU_t& packet, uint8_t* wire) {
+#ifdef USE_COBS_FRAMING
+    CobsEncoder encoder(wire);
+    encoder.add(COMM_PROTOCOL_VERSION);
+    encoder.add(packet.bytes, UPDTPKT_SIZE);
+    return encoder.finish();
+#else
+    memcpy(wire, packet.bytes, UPDTPKT_SIZE);
+    return UPDTPKT_SIZE;
+#endif
+}
+
+void bench_comm_handler_per_byte() {
+    pressureUpdatePacketU_t packet;
+    memset(packet.bytes, 0, UPDTPKT_SIZE);
+    packet.data._magic = MAGIC_START;
+    packet.data.otherState = SystemStateEnum::CLOSED_LOOP;
+    packet.data.pt1Reading = (SensorConfig::P_MIN + SensorConfig::P_MAX) / 2;
+    packet.data.pt2Reading = packet.data.pt1Reading;
+    packet.data._checksum = crc16Xmodem(packet.bytes + 4, UPDTPKT_SIZE - 4);
+
+    uint8_t wire[COMM_BENCH_MAX_WIRE];
+    const size_t wireLen = benchFramePacket(packet, wire);
+
+    // Each byte position is timed separately over many packets
+    CommHandler handler;
+    double nsPerPosition[COMM_BENCH_MAX_WIRE] = {};
+    for (unsigned long n = 0; n < COMM_BENCH_PACKETS; n++) {
+        for (unsigned int i = 0; i < wireLen; i++) {
+            auto start = std::chrono::steady_clock::now();
+            handler.processIncomingSerialByte(wire[i]);
+            auto end = std::chrono::steady_clock::now();
+            nsPerPosition[i] += std::chrono::duration<double, std::nano>(end - start).count();
+        }
+    }
+
+    double meanNs = 0.0, worstNs = 0.0;
+    unsigned int worstPosition = 0;
+    for (unsigned int i = 0; i < wireLen; i++) {
+        nsPerPosition[i] /= COMM_BENCH_PACKETS;
+        meanNs += nsPerPosition[i] / wireLen;
+        if (nsPerPosition[i] > worstNs) {
+            worstNs = nsPerPosition[i];
+            worstPosition = i;
+        }
+    }
+
+    // What the completing byte used to cost on top of parsing: the checksum of the whole payload
+    double bulkCrcNs = benchNsPerCall([&] {
+        benchSink = benchSink + crc16Xmodem(packet.bytes + 4, UPDTPKT_SIZE - 4);
+    }, COMM_BENCH_PACKETS);
+
+    benchReport("Serial RX byte, mean over a packet", meanNs, "byte");
+    benchReport("Serial RX byte, completing byte (incl. parse)", nsPerPosition[wireLen - 1], "byte");
+    printf("[BENCH] Serial RX byte, worst position %u of %u: %.3f ns\n", worstPosition, (unsigned)wireLen, worstNs);
+    benchReport("Payload checksum in one burst (previous)", bulkCrcNs, "packet");
+
+    TEST_ASSERT_TRUE(handler.getPressureUpdateSuccess());
+}
+
+/*
+ * Pressure update packets sent back to back through a noisy link (bit flips, dropped bytes and
+ * bursts of junk, some of them containing the magic bytes), as they would be framed in the
+ * current build (magic bytes, or COBS with USE_COBS_FRAMING). Reports how many packets the
+ * parser recovers and how fast.
+ */
+constexpr uint32_t NOISY_BENCH_PACKETS = 200000;
+constexpr uint32_t NOISY_FLIP_PER_MILLE = 2;    // Per byte
+constexpr uint32_t NOISY_DROP_PER_MILLE = 1;
+constexpr uint32_t NOISY_BURST_PER_MILLE = 1;
+
+void bench_comm_handler_noisy_stream() {
+    uint32_t seed = 12345;
+    auto random = [&seed](uint32_t range) {
+        seed = seed * 1103515245UL + 12345UL;
+        return (seed >> 8) % range;
+    };
+
+    std::vector<uint8_t> stream;
+    uint32_t damagedPackets = 0;
+    pressureUpdatePacketU_t packet;
+    for (uint32_t n = 0; n < NOISY_BENCH_PACKETS; n++) {
+        memset(packet.bytes, 0, UPDTPKT_SIZE);
+        packet.data._magic = MAGIC_START;
+        packet.data.otherState = SystemStateEnum::CLOSED_LOOP;
+        packet.data.sequence = (uint16_t)n;
+        packet.data.pt1Reading = (float)(n + 1); // Tells the recovered packets apart
+        packet.data.pt2Reading = (float)random(1000);
+        packet.data._checksum = crc16Xmodem(packet.bytes + 4, UPDTPKT_SIZE - 4);
+
+        uint8_t wire[COMM_BENCH_MAX_WIRE];
+        const size_t wireLen = benchFramePacket(packet, wire);
+
+        bool damaged = false;
+        for (size_t i = 0; i < wireLen; i++) {
+            if (random(1000) < NOISY_BURST_PER_MILLE) {
+                uint32_t burst = 1 + random(8);
+                for (uint32_t b = 0; b < burst; b++)
+                    stream.push_back(random(4) == 0 ? (b & 1 ? MAGIC_START >> 8 : MAGIC_START & 0xff) : (uint8_t)random(256));
+                damaged = true;
+            }
+            if (random(1000) < NOISY_DROP_PER_MILLE) {
+                damaged = true;
+                continue;
+            }
+            uint8_t byte = wire[i];
+            if (random(1000) < NOISY_FLIP_PER_MILLE) {
+                byte ^= 1 << random(8);
+                damaged = true;
+            }
+            stream.push_back(byte);
+        }
+        if (damaged) damagedPackets++;
+    }
+
+    CommHandler handler;
+    uint32_t recovered = 0;
+    float lastReading = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (uint8_t byte : stream) {
+        handler.processIncomingSerialByte(byte);
+        if (handler.getPressureData().sensor1 != lastReading) {
+            lastReading = handler.getPressureData().sensor1;
+            recovered++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+#ifdef USE_COBS_FRAMING
+    const char* framing = "COBS";
+#else
+    const char* framing = "magic bytes";
+#endif
+    printf("[BENCH] Noisy stream (%s framing): %u/%u packets recovered, %u damaged in transit, %u intact lost\n",
+           framing, (unsigned)recovered, (unsigned)NOISY_BENCH_PACKETS, (unsigned)damagedPackets,
+           (unsigned)(NOISY_BENCH_PACKETS - damagedPackets > recovered ? NOISY_BENCH_PACKETS - damagedPackets - recovered : 0));
+    const LinkStats& link = handler.getLinkStats();
+    printf("[BENCH] Noisy stream (%s framing): link stats: %u lost, %u CRC errors, %u resyncs (16-bit counters)\n",
+           framing, (unsigned)link.lost, (unsigned)link.crcErrors, (unsigned)link.resyncs);
+    printf("[BENCH] Noisy stream (%s framing): %.0f packets/s recovered, %.1f MB/s parsed\n",
+           framing, recovered / seconds, stream.size() / seconds / 1e6);
+
+    TEST_ASSERT_GREATER_THAN(NOISY_BENCH_PACKETS / 2, recovered);
+}
+
+void run_all_comm_handler_benchmarks() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(bench_comm_handler_per_byte);
+    RUN_TEST(bench_comm_handler_noisy_stream);
+}
+
+#endif // BENCH_COMM_HANDLER_H
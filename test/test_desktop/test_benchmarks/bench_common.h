@@ -0,0 +1,29 @@
+/* 
+ * Helpers for the native microbenchmarks. The numbers are host timings, so they are only
+ * meaningful relative to each other (e.g. reference VS optimised implementation).
+ */
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+
+// Results are accumulated here so that the benchmarked work is not optimised away
+volatile uint32_t benchSink;
+
+// Runs fn() the given number of times and returns the mean time per call in nanoseconds
+template <typename F>
+double benchNsPerCall(F fn, unsigned long calls) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < calls; i++) fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / calls;
+}
+
+void benchReport(const char* name, double nsPerOp, const char* unit = "op") {
+    printf("[BENCH] %-48s %10.3f ns/%s\n", name, nsPerOp, unit);
+}
+
+#endif // BENCH_COMMON_H
@@ -0,0 +1,49 @@
+#ifndef BENCH_CONTROLLER_H
+#define BENCH_CONTROLLER_H
+
+#include <unity.h>
+
+#include "config.h"
+#include <controller.h>
+#include "bench_common.h"
+
+/*
+ * Per update cost of the float and fixed point PID controllers. As with the angle benchmark,
+ * the host has a FPU; the Uno cycle counts come from test/embedded/test_bench_controller.
+ */
+
+constexpr unsigned long CONTROLLER_BENCH_UPDATES = 2000000;
+
+template <typename T>
+double controllerNsPerUpdate(float kd) {
+    typedef typename BasicController<T>::Error Error;
+    typedef typename BasicController<T>::Time Time;
+    BasicController<T> controller(ControllerConfig::KP, ControllerConfig::KI, kd);
+
+    // Inputs are precomputed so that only the update itself is timed
+    Error errors[256];
+    for (int i = 0; i < 256; i++) errors[i] = Error((float)(i - 128));
+    const Time dt(TimingConfig::CONTROL_PERIOD_S);
+
+    unsigned long i = 0;
+    double ns = benchNsPerCall([&] {
+        controller.update(errors[i++ & 0xFF], dt);
+    }, CONTROLLER_BENCH_UPDATES);
+    benchSink = (uint32_t)numericCast<float>(controller.getError());
+    return ns;
+}
+
+void bench_controller_update() {
+    benchReport("PID update, float", controllerNsPerUpdate<float>(ControllerConfig::KD), "update");
+    benchReport("PID update, PressureQ", controllerNsPerUpdate<PressureQ>(ControllerConfig::KD), "update");
+    benchReport("PID update with derivative, float", controllerNsPerUpdate<float>(0.02f), "update");
+    benchReport("PID update with derivative, PressureQ", controllerNsPerUpdate<PressureQ>(0.02f), "update");
+    TEST_PASS();
+}
+
+void run_all_controller_benchmarks() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(bench_controller_update);
+}
+
+#endif // BENCH_CONTROLLER_H
@@ -0,0 +1,57 @@
+#ifndef BENCH_CRC16_H
+#define BENCH_CRC16_H
+
+#include <CRC.h>
+#include <unity.h>
+
+#include <crc16_xmodem.h>
+#include "bench_common.h"
+
+/*
+ * Per byte cost of the packet checksum: the CRC16 library (bit by bit) VS the byte and nibble
+ * lookup tables. The Uno cycle counts come from test/embedded/test_bench_crc16.
+ */
+
+constexpr unsigned long CRC16_BENCH_PASSES = 20000;
+constexpr uint16_t CRC16_BENCH_BYTES = 256;
+
+uint8_t crc16BenchData[CRC16_BENCH_BYTES];
+
+template <typename F>
+double crc16NsPerByte(F update) {
+    double ns = benchNsPerCall([&] {
+        uint16_t crc = XMODEM_INIT;
+        for (uint16_t i = 0; i < CRC16_BENCH_BYTES; i++) crc = update(crc, crc16BenchData[i]);
+        benchSink = benchSink + crc;
+    }, CRC16_BENCH_PASSES);
+    return ns / CRC16_BENCH_BYTES;
+}
+
+void bench_crc16_per_byte() {
+    for (uint16_t i = 0; i < CRC16_BENCH_BYTES; i++) crc16BenchData[i] = (uint8_t)(i * 37 + 11);
+
+    CRC16 library(CRC16_XMODEM_POLYNOME, CRC16_XMODEM_INITIAL, CRC16_XMODEM_XOR_OUT, CRC16_XMODEM_REV_IN, CRC16_XMODEM_REV_OUT);
+    double libraryNs = benchNsPerCall([&] {
+        library.restart();
+        library.add(crc16BenchData, CRC16_BENCH_BYTES);
+        benchSink = benchSink + library.calc();
+    }, CRC16_BENCH_PASSES) / CRC16_BENCH_BYTES;
+    double bitwiseNs = crc16NsPerByte(crc16XmodemBitwise);
+    double nibbleNs = crc16NsPerByte(crc16XmodemNibbleUpdate);
+    double byteNs = crc16NsPerByte(crc16XmodemByteUpdate);
+
+    benchReport("CRC16-XMODEM, CRC16 library", libraryNs, "byte");
+    benchReport("CRC16-XMODEM, bitwise", bitwiseNs, "byte");
+    benchReport("CRC16-XMODEM, nibble table (32 B)", nibbleNs, "byte");
+    benchReport("CRC16-XMODEM, byte table (512 B)", byteNs, "byte");
+    printf("[BENCH] CRC16-XMODEM byte table speedup over the library: %.1fx\n", libraryNs / byteNs);
+
+    TEST_ASSERT_EQUAL_HEX16(library.calc(), crc16Xmodem(crc16BenchData, CRC16_BENCH_BYTES));
+}
+
+void run_all_crc16_benchmarks() {
+    UnitySetTestFile(__FILE__);
+    RUN_TEST(bench_crc16_per_byte);
+}
+
+#endif // BENCH_CRC16_H
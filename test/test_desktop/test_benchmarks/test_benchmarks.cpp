@@ -0,0 +1,57 @@
+/* 
+ * Native microbenchmarks, reported on stdout as "[BENCH] ..." lines. Run with
+ * `pio test -e native -f test_desktop/test_benchmarks -v` to see the output.
+ */
+
+#include "bench_amt22.h"
+#include "bench_angle.h"
+#include "bench_comm_handler.h"
+#include "bench_controller.h"
+#include "bench_crc16.h"
+
+#include <unity.h>
+
+// Because we extern some symbols which are accessible to utilities.h
+#include <AMT22_lib.h>
+#include <comm_handler.h>
+#include <controller.h>
+#include <encoder_sampler.h>
+#include <position_estimator.h>
+#include <pressure_sensor.h>
+#include <step_engine.h>
+#include <utilities.h>
+#include "state_machine.h"
+AMT22* encoder;
+StepEngine stepEngine;
+PositionEstimator positionEstimator;
+EncoderSampler encoderSampler(sampleEncoder);
+CommHandler* commHandler;
+Controller* controller;
+PressureSensor* pressureSensor;
+SystemState systemState;
+ChannelState channel;
+FaultFlags faults;
+FlightRecorder flightRecorder;
+Tunables tunables;
+
+#ifdef BUILD_NATIVE
+    #include <ArduinoFake.h>
+    using namespace fakeit;
+#endif
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int main(int argc, char **argv) {
+#ifdef BUILD_NATIVE
+    When(Method(ArduinoFake(), millis)).AlwaysReturn();
+#endif
+
+    UNITY_BEGIN();
+    run_all_amt22_benchmarks();
+    run_all_angle_benchmarks();
+    run_all_comm_handler_benchmarks();
+    run_all_controller_benchmarks();
+    run_all_crc16_benchmarks();
+    return UNITY_END();
+}
@@ -0,0 +1,177 @@
+/*
+ * Record and playback of the firmware's input journal (lib/modules/include/input_journal.h,
+ * lib/sim/include/journal_player.h): a closed loop run in the simulator is recorded, then played
+ * back without the simulated plant and Pi, and must make the same decisions and send the same
+ * bytes. Only runs in env:sim_journal (USE_INPUT_JOURNAL, and USE_FIXED_POINT_CONTROLLER as on the
+ * Uno):
+ *
+ *     pio test -e sim_journal -v
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+#include <unity.h>
+#include <vector>
+
+#include <input_journal.h>
+#include <journal_player.h>
+#include <replay.h>
+#include <sim_firmware.h>
+#include <sim_world.h>
+#include <utilities.h>
+#include "config.h"
+#include "state_machine.h"
+
+constexpr double RUN_S = 20.0;
+
+// Journals from the stand are recorded with the fixed point controller, so it is the one played back
+static_assert(std::is_same<Controller, BasicController<PressureQ>>::value, "Built without USE_FIXED_POINT_CONTROLLER");
+
+DecisionRecorder* recorder = nullptr;
+
+void observingLoop() {
+    loop();
+    recorder->observe();
+}
+
+void observe() {
+    recorder->observe();
+}
+
+struct RunResult {
+    SystemStateEnum state;
+    uint8_t faults;
+    float targetDeg;
+    int32_t integralRaw;
+    uint32_t txBytes;
+    uint32_t txHash;
+};
+
+RunResult takeResult() {
+    RunResult result;
+    result.state = systemState.currentState;
+    result.faults = CommHandler::telemetryFaults();
+    result.targetDeg = angleToDeg(channel.targetAngle);
+    result.integralRaw = controller->getIntegral().raw();
+    result.txBytes = Serial.txBytes();
+    result.txHash = Serial.txHash();
+    return result;
+}
+
+// Reads a whole temporary file back
+std::vector<uint8_t> readBack(FILE* file) {
+    std::vector<uint8_t> bytes(ftell(file));
+    rewind(file);
+    TEST_ASSERT_EQUAL(bytes.size(), fread(bytes.data(), 1, bytes.size(), file));
+    return bytes;
+}
+
+// The MPV opens, the tank pressure steps down, then the Pi goes quiet
+RunResult record(FILE* journal, FILE* decisionsOut) {
+    SimParams params;
+    params.scenario.tankStepAtS = 8.0;
+    params.scenario.tankStepPsi = -40.0f;
+    params.scenario.commLossAtS = 15.0;
+    SimWorld world(params);
+
+    simSetJournalFile(journal);
+    world.reset();
+    simBootFirmware();
+    DecisionRecorder decisions(decisionsOut, DecisionRecorder::Format::BINARY);
+    recorder = &decisions;
+    world.run(observingLoop, RUN_S);
+    simSetJournalFile(nullptr); // Writes the rest of the journal
+    return takeResult();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_journal_playback_bit_exact() {
+    FILE* journalFile = tmpfile();
+    FILE* recorded = tmpfile();
+    FILE* played = tmpfile();
+    TEST_ASSERT_NOT_NULL(journalFile);
+    TEST_ASSERT_NOT_NULL(recorded);
+    TEST_ASSERT_NOT_NULL(played);
+
+    RunResult live = record(journalFile, recorded);
+    TEST_ASSERT_EQUAL(SystemStateEnum::FORCED_OPEN_LOOP, live.state); // Comm loss
+
+    JournalPlayer player;
+    rewind(journalFile);
+    TEST_ASSERT_TRUE(player.load(journalFile));
+    TEST_ASSERT_TRUE(player.size() > 0);
+
+    auto start = std::chrono::steady_clock::now();
+    player.boot();
+    DecisionRecorder decisions(played, DecisionRecorder::Format::BINARY);
+    recorder = &decisions;
+    uint32_t passes = player.play(observe);
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    TEST_ASSERT_TRUE(player.isDone());
+    TEST_ASSERT_FALSE(player.hasDiverged());
+    TEST_ASSERT_FALSE(player.isTruncated());
+    TEST_ASSERT_EQUAL(player.size(), player.getPlayed());
+
+    RunResult replayed = takeResult();
+    TEST_ASSERT_EQUAL(live.state, replayed.state);
+    TEST_ASSERT_EQUAL_HEX8(live.faults, replayed.faults);
+    TEST_ASSERT_EQUAL_FLOAT(live.targetDeg, replayed.targetDeg);
+    TEST_ASSERT_TRUE(live.integralRaw != 0);
+    TEST_ASSERT_EQUAL_INT32(live.integralRaw, replayed.integralRaw);
+    TEST_ASSERT_EQUAL(live.txBytes, replayed.txBytes);
+    TEST_ASSERT_EQUAL_HEX32(live.txHash, replayed.txHash);
+
+    // The same decisions at the same times
+    std::vector<uint8_t> liveDecisions = readBack(recorded);
+    std::vector<uint8_t> playedDecisions = readBack(played);
+    TEST_ASSERT_TRUE(liveDecisions.size() >= 3 * sizeof(DecisionRecord));
+    TEST_ASSERT_EQUAL(liveDecisions.size(), playedDecisions.size());
+    TEST_ASSERT_EQUAL_MEMORY(liveDecisions.data(), playedDecisions.data(), liveDecisions.size());
+
+    printf("[BENCH] journal: %zu bytes for %.0f s (%.0f B/s), %u passes played back in %.1f ms\n",
+           player.size(), RUN_S, player.size() / RUN_S, passes, wallS * 1e3);
+    // Has to fit the link to the Pi beside the telemetry
+    TEST_ASSERT_TRUE(player.size() / RUN_S < 0.5 * CommConfig::BAUD_RATE / 10);
+
+    fclose(journalFile);
+    fclose(recorded);
+    fclose(played);
+}
+
+void test_journal_truncated() {
+    FILE* journalFile = tmpfile();
+    TEST_ASSERT_NOT_NULL(journalFile);
+    record(journalFile, nullptr);
+    std::vector<uint8_t> journal = readBack(journalFile);
+    fclose(journalFile);
+
+    // As if the last chunks from the stand got lost
+    JournalPlayer player;
+    player.add(journal.data(), journal.size() / 2);
+    player.boot();
+    TEST_ASSERT_TRUE(player.play() > 0);
+    TEST_ASSERT_TRUE(player.isDone());
+    TEST_ASSERT_TRUE(player.isTruncated());
+    TEST_ASSERT_FALSE(player.hasDiverged());
+
+    // The first input read is a clock: a journal starting with another input diverges at once
+    journal[0] = (uint8_t)JournalTag::RX_BYTES << 5;
+    JournalPlayer diverging;
+    diverging.add(journal.data(), journal.size());
+    diverging.boot();
+    diverging.play();
+    TEST_ASSERT_TRUE(diverging.hasDiverged());
+    TEST_ASSERT_EQUAL(0, diverging.getPlayed());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_journal_playback_bit_exact);
+    RUN_TEST(test_journal_truncated);
+    return UNITY_END();
+}
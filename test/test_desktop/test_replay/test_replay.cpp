@@ -0,0 +1,179 @@
+/*
+ * Replay of a recording through the firmware (lib/sim/include/replay.h), on a synthetic
+ * recording shaped like a coldflow: the MPV opens, the manifold comes up to the target, droops
+ * for a while (which the controller acts on), and the PTs disagree near the end. Doubles as a regression benchmark of the control path ("[BENCH]"
+ * line). Only runs in env:sim:
+ *
+ *     pio test -e sim -f test_desktop/test_replay -v
+ */
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include <replay.h>
+#include <sim_firmware.h>
+#include <sim_world.h>
+#include <utilities.h>
+#include "config.h"
+#include "state_machine.h"
+
+constexpr double RECORDING_S = 60.0;
+constexpr double MPV_OPEN_S = 2.0;
+constexpr double DROOP_S = 20.0;          // For DROOP_DURATION_S, by DROOP_PSI
+constexpr double DROOP_DURATION_S = 2.0;
+constexpr double DROOP_PSI = 15.0;
+constexpr double SENSOR_FAULT_S = 40.0;
+
+ReplayLog recording;
+DecisionRecorder* recorder = nullptr;
+
+void replayLoop() {
+    loop();
+    recorder->observe();
+}
+
+// 100 Hz samples with a little (deterministic) noise on each PT
+void buildRecording() {
+    recording.clear();
+    for (unsigned long n = 0; n < RECORDING_S * 100; n++) {
+        double t = n / 100.0;
+        double manifold = t < MPV_OPEN_S ? 0.0 : tunables.targetPressurePsi * (1.0 - exp(-(t - MPV_OPEN_S) / 0.1));
+        if (t >= DROOP_S && t < DROOP_S + DROOP_DURATION_S) manifold -= DROOP_PSI;
+        ReplaySample sample;
+        sample.timeUs = n * 10000;
+        for (uint8_t i = 0; i < 3; i++)
+            sample.pt[i] = (float)(manifold + sin(n * 0.7 + i * 2.1));
+        if (t >= SENSOR_FAULT_S) {
+            sample.pt[1] -= 100.0f;
+            sample.pt[2] -= 200.0f;
+        }
+        sample.mpvOpen = t >= MPV_OPEN_S;
+        sample.otherState = t < MPV_OPEN_S + 0.5 ? SystemStateEnum::OPEN_LOOP_INIT : SystemStateEnum::CLOSED_LOOP;
+        recording.add(sample);
+    }
+}
+
+// Replays the recording, writing the decisions to out. Returns the wall time
+double replay(DecisionRecorder& decisions) {
+    auto start = std::chrono::steady_clock::now();
+    SimWorld world;
+    world.setReplay(&recording);
+    world.reset();
+    simBootFirmware();
+    decisions.reset();
+    recorder = &decisions;
+    world.run(replayLoop, recording.durationS() + 1.0);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_replay_csv_parsing() {
+    ReplayLog log;
+    TEST_ASSERT_TRUE(log.addCsvLine("time_s,pt1,pt2,pt3,mpv_open,other_state\n"));
+    TEST_ASSERT_TRUE(log.addCsvLine("# Coldflow 2\n"));
+    TEST_ASSERT_TRUE(log.addCsvLine("0.010, 1.5,2.5,3.5, 1,2\n"));
+    TEST_ASSERT_EQUAL(1, log.size());
+    TEST_ASSERT_EQUAL(10000, log[0].timeUs);
+    TEST_ASSERT_EQUAL_FLOAT(2.5f, log[0].pt[1]);
+    TEST_ASSERT_TRUE(log[0].mpvOpen);
+    TEST_ASSERT_EQUAL(SystemStateEnum::CLOSED_LOOP, log[0].otherState);
+
+    TEST_ASSERT_FALSE(log.addCsvLine("0.020,1,2,3,1\n"));       // Missing a column
+    TEST_ASSERT_FALSE(log.addCsvLine("0.020,1,2,x,1,2\n"));
+    TEST_ASSERT_FALSE(log.addCsvLine("0.020,1,2,3,1,9\n"));     // Not a state
+    TEST_ASSERT_FALSE(log.addCsvLine("0.005,1,2,3,1,2\n"));     // Out of order
+    TEST_ASSERT_EQUAL(1, log.size());
+}
+
+void test_replay_decisions() {
+    buildRecording();
+    DecisionRecorder decisions;
+    double wallS = replay(decisions);
+
+    // OPEN_LOOP_INIT, CLOSED_LOOP, then FORCED_OPEN_LOOP on the sensor fault
+    TEST_ASSERT_EQUAL(SystemStateEnum::FORCED_OPEN_LOOP, systemState.currentState);
+    TEST_ASSERT_EQUAL(3, decisions.getCount(DecisionKind::STATE_CHANGE));
+    TEST_ASSERT_TRUE(faults.sensorFault);
+    TEST_ASSERT_TRUE(decisions.getCount(DecisionKind::FAULT_LATCHED) >= 1);
+    TEST_ASSERT_TRUE(decisions.getCount(DecisionKind::TARGET_ANGLE) >= 1);
+
+    printf("[BENCH] replay: %zu samples (%.0f s) in %.1f ms\n", recording.size(), recording.durationS(), wallS * 1e3);
+    TEST_ASSERT_TRUE(wallS < 1.0);
+}
+
+// The same recording gives the same decisions, bit for bit
+void test_replay_deterministic() {
+    buildRecording();
+    FILE* outs[2];
+    for (FILE*& out : outs) {
+        out = tmpfile();
+        TEST_ASSERT_NOT_NULL(out);
+        DecisionRecorder decisions(out, DecisionRecorder::Format::BINARY);
+        replay(decisions);
+    }
+
+    long size = ftell(outs[0]);
+    TEST_ASSERT_TRUE(size > 0 && size % sizeof(DecisionRecord) == 0);
+    TEST_ASSERT_EQUAL(size, ftell(outs[1]));
+    rewind(outs[0]);
+    rewind(outs[1]);
+    for (long i = 0; i < size; i++)
+        TEST_ASSERT_EQUAL(fgetc(outs[0]), fgetc(outs[1]));
+    fclose(outs[0]);
+    fclose(outs[1]);
+}
+
+// The controller sits in tolerance after closing the loop, until a droop: its first update
+// integrates a single control period, not the whole time it sat in tolerance
+float firstIntegral = 0.0f;
+float firstIntegralError = 0.0f;
+
+void integralLoop() {
+    loop();
+    float integral = numericCast<float>(controller->getIntegral());
+    if (firstIntegral == 0.0f && integral != 0.0f) {
+        firstIntegral = integral;
+        firstIntegralError = channel.error;
+    }
+}
+
+void test_replay_integrates_one_period() {
+    constexpr double DROOP_AT_S = MPV_OPEN_S + 4.0; // 3.5 s after closing the loop
+    ReplayLog log;
+    for (unsigned long n = 0; n < 900; n++) {
+        double t = n / 100.0;
+        ReplaySample sample;
+        sample.timeUs = n * 10000;
+        float manifold = t < MPV_OPEN_S ? 0.0f : tunables.targetPressurePsi - (t >= DROOP_AT_S ? (float)DROOP_PSI : 0.0f);
+        for (float& pt : sample.pt) pt = manifold;
+        sample.mpvOpen = t >= MPV_OPEN_S;
+        sample.otherState = t < MPV_OPEN_S + 0.5 ? SystemStateEnum::OPEN_LOOP_INIT : SystemStateEnum::CLOSED_LOOP;
+        log.add(sample);
+    }
+
+    SimWorld world;
+    world.setReplay(&log);
+    world.reset();
+    simBootFirmware();
+    firstIntegral = 0.0f;
+    world.run(integralLoop, log.durationS());
+
+    TEST_ASSERT_EQUAL(SystemStateEnum::CLOSED_LOOP, systemState.currentState);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, DROOP_PSI, firstIntegralError);
+    float expected = firstIntegralError * TimingConfig::CONTROL_PERIOD_S;
+    TEST_ASSERT_FLOAT_WITHIN(0.01f * expected, expected, firstIntegral);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_csv_parsing);
+    RUN_TEST(test_replay_decisions);
+    RUN_TEST(test_replay_deterministic);
+    RUN_TEST(test_replay_integrates_one_period);
+    return UNITY_END();
+}
@@ -0,0 +1,149 @@
+/*
+ * Closed loop simulations of the whole firmware (setup() and loop() of src/main.cpp, with the
+ * real CommHandler, Controller, PressureSensor, state machine and step engine) against the
+ * simulated valve, feed line and Pi of lib/sim, in virtual time. Only runs in env:sim, which
+ * replaces ArduinoFake with the simulator's Arduino API and builds src/ into the test:
+ *
+ *     pio test -e sim -v
+ *
+ * With SIM_TRACE_DIR set, every scenario also writes a CSV trace (a line at most every simulated ms)
+ * to that directory.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+
+#include <Arduino.h>
+#include <AMT22_lib.h>
+#include <comm_handler.h>
+#include <control_tasks.h>
+#include <controller.h>
+#include <encoder_sampler.h>
+#include <position_estimator.h>
+#include <pressure_sensor.h>
+#include <scheduler.h>
+#include <serial_rx.h>
+#include <sim_firmware.h>
+#include <sim_hardware.h>
+#include <sim_world.h>
+#include <step_engine.h>
+#include <utilities.h>
+#include "config.h"
+#include "state_machine.h"
+
+extern bool MPV_CONTROL;
+
+// Resets the world, boots the firmware in it and runs it for durationS. Returns the wall time
+double simulate(SimWorld& world, double durationS, const char* name) {
+    FILE* trace = nullptr;
+    const char* traceDir = getenv("SIM_TRACE_DIR");
+    if (traceDir != nullptr) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s.csv", traceDir, name);
+        trace = fopen(path, "w");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    world.reset();
+    simBootFirmware();
+    world.run(loop, durationS, trace);
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (trace != nullptr) fclose(trace);
+    const SimStats& stats = world.getStats();
+    printf("[SIM] %s: %.0f s in %.3f s wall (%.0fx), %lu loop passes, settled at %.2f s, "
+           "overshoot %.1f psi, RMS error %.2f psi, final state %u\n",
+           name, durationS, wallS, durationS / wallS, (unsigned long)stats.loopPasses, stats.settledAtS,
+           stats.maxOvershootPsi, stats.rmsErrorPsi, (unsigned)systemState.currentState);
+    return wallS;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// The MPV opens at 1 s, the loop closes 0.5 s later and regulates through a drop of the tank
+// pressure
+void test_sim_nominal() {
+    SimParams params;
+    params.scenario.tankStepAtS = 10.0;
+    params.scenario.tankStepPsi = -40.0f;
+    SimWorld world(params);
+
+    simulate(world, 20.0, "nominal");
+    const SimStats& stats = world.getStats();
+    TEST_ASSERT_EQUAL(SystemStateEnum::CLOSED_LOOP, systemState.currentState);
+    TEST_ASSERT_FALSE(faults.noMotion || faults.encoderMismatch || faults.sensorFault || faults.redBandFault);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, params.scenario.mpvOpenAtS + TimingConfig::SAFE_TIMER_S, stats.closedLoopAtS);
+    TEST_ASSERT_TRUE(stats.settledAtS > 0.0 && stats.settledAtS < 15.0);
+    TEST_ASSERT_TRUE(stats.maxOvershootPsi < tunables.redbandUpperPsi);
+    TEST_ASSERT_FLOAT_WITHIN(SensorConfig::PRESSURE_TOLERANCE,
+                             tunables.targetPressurePsi, world.getPlant().manifoldPressurePsi());
+}
+
+// Without pressure updates the watchdog falls back to open loop
+void test_sim_comm_loss() {
+    SimParams params;
+    params.scenario.commLossAtS = 5.0;
+    SimWorld world(params);
+
+    simulate(world, 10.0, "comm_loss");
+    const SimStats& stats = world.getStats();
+    TEST_ASSERT_EQUAL(SystemStateEnum::FORCED_OPEN_LOOP, systemState.currentState);
+    TEST_ASSERT_TRUE(faults.commTimeout);
+    // Unhealthy after COMM_TIMEOUT_S / 2, and in open loop after another COMM_TIMEOUT_S / 2
+    double closedLoopEndS = stats.closedLoopAtS + stats.timeInStateS[(uint8_t)SystemStateEnum::CLOSED_LOOP];
+    TEST_ASSERT_FLOAT_WITHIN(0.1, params.scenario.commLossAtS + TimingConfig::COMM_TIMEOUT_S, closedLoopEndS);
+    TEST_ASSERT_FLOAT_WITHIN(ValveConfig::ANGLE_TOLERANCE, ValveConfig::OPENLOOP_TARGET_ANGLE, simValve.angleDeg());
+}
+
+// A valve that stops following the steps is caught by the position estimator
+void test_sim_stuck_valve() {
+    SimParams params;
+    params.scenario.valveStuckAtS = 5.0;
+    params.scenario.tankStepAtS = 6.0;
+    params.scenario.tankStepPsi = -40.0f;
+    SimWorld world(params);
+
+    simulate(world, 10.0, "stuck_valve");
+    TEST_ASSERT_EQUAL(SystemStateEnum::EMERGENCY_STOP, systemState.currentState);
+    TEST_ASSERT_TRUE(faults.noMotion);
+    TEST_ASSERT_FALSE(MPV_CONTROL);
+}
+
+// The state handlers react to the manual abort like on the stand
+void test_sim_manual_abort() {
+    SimWorld world;
+
+    simulate(world, 3.0, "manual_abort");
+    TEST_ASSERT_EQUAL(SystemStateEnum::CLOSED_LOOP, systemState.currentState);
+    simPins.set(HardwareConfig::MANUAL_ABORT_PIN, LOW);
+    world.run(loop, 0.1);
+    TEST_ASSERT_EQUAL(SystemStateEnum::EMERGENCY_STOP, systemState.currentState);
+    TEST_ASSERT_TRUE(faults.manualAbort);
+    TEST_ASSERT_FALSE(MPV_CONTROL);
+    TEST_ASSERT_FALSE(simValve.isEnabled());
+}
+
+// Virtual time has to be much faster than real time for the simulator to be useful for sweeps
+void test_sim_speed() {
+    SimWorld world;
+    const double durationS = 600.0;
+
+    double wallS = simulate(world, durationS, "speed");
+    TEST_ASSERT_EQUAL(SystemStateEnum::CLOSED_LOOP, systemState.currentState);
+    TEST_ASSERT_TRUE(durationS / wallS > 100.0);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sim_nominal);
+    RUN_TEST(test_sim_comm_loss);
+    RUN_TEST(test_sim_stuck_valve);
+#ifndef NO_MANUAL_ABORT
+    RUN_TEST(test_sim_manual_abort);
+#endif
+    RUN_TEST(test_sim_speed);
+    return UNITY_END();
+}
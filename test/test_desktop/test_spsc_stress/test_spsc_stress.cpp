@@ -0,0 +1,76 @@
+/*
+ * Stress test of SpscRing with a real producer and consumer thread, which is as close as the
+ * host gets to the RX ISR interrupting loop() at any point. Run with
+ * `pio test -e native -f test_desktop/test_spsc_stress`.
+ */
+
+#include <atomic>
+#include <thread>
+#include <unity.h>
+
+#include <spsc_ring.h>
+
+constexpr uint32_t STRESS_BYTES = 20000000;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// The producer retries when the ring is full, so every byte must arrive once and in order
+void test_spsc_stress_lossless() {
+    static SpscRing<64> ring;
+
+    std::thread producer([] {
+        for (uint32_t i = 0; i < STRESS_BYTES; i++) {
+            while (!ring.push((uint8_t)(i * 7)))
+                std::this_thread::yield(); // Lets the consumer run on single core hosts
+        }
+    });
+
+    uint32_t received = 0, mismatches = 0;
+    uint8_t batch[16];
+    while (received < STRESS_BYTES) {
+        uint8_t count = ring.popBatch(batch, (received & 1) ? sizeof(batch) : 3);
+        if (count == 0) std::this_thread::yield();
+        for (uint8_t i = 0; i < count; i++, received++)
+            if (batch[i] != (uint8_t)(received * 7)) mismatches++;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+    TEST_ASSERT_EQUAL(0, ring.available());
+}
+
+// The producer never waits (like the ISR), so every byte is either received or counted
+void test_spsc_stress_overflow_accounting() {
+    static SpscRing<32> ring;
+    std::atomic<bool> done(false);
+    uint32_t pushed = 0, dropped = 0;
+
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < STRESS_BYTES / 4; i++) {
+            if (ring.push((uint8_t)i)) pushed++;
+            else dropped++;
+        }
+        done = true;
+    });
+
+    uint32_t received = 0;
+    uint8_t batch[8];
+    while (!done || ring.available() > 0) {
+        uint8_t count = ring.popBatch(batch, sizeof(batch));
+        if (count == 0) std::this_thread::yield();
+        received += count;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(STRESS_BYTES / 4, pushed + dropped);
+    TEST_ASSERT_EQUAL_UINT32(pushed, received);
+    TEST_ASSERT_EQUAL_UINT32(dropped < UINT16_MAX ? dropped : UINT16_MAX, ring.getOverflowCount());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_spsc_stress_lossless);
+    RUN_TEST(test_spsc_stress_overflow_accounting);
+    return UNITY_END();
+}
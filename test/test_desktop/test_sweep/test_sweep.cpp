@@ -0,0 +1,137 @@
+/*
+ * Monte Carlo sweep of the controller tuning over the closed loop simulation (lib/sim/include/sweep.h,
+ * tools/sweep/). Only runs in env:sim, which builds src/ into the test:
+ *
+ *     pio test -e sim -f test_desktop/test_sweep -v
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+#include <unity.h>
+#include <vector>
+
+#include <controller.h>
+#include <sweep.h>
+#include "config.h"
+
+constexpr double RUN_S = 6.0;
+
+// Tunes the gains of the controller that runs on the Uno
+static_assert(std::is_same<Controller, BasicController<PressureQ>>::value, "Built without USE_FIXED_POINT_CONTROLLER");
+
+struct TestJob {
+    SweepConfig configs[2];
+    SweepUncertainty uncertainty;
+    uint32_t runsPerConfig;
+};
+
+void runTestSample(size_t index, void* result, const void* context) {
+    const TestJob& job = *(const TestJob*)context;
+    SimParams params = job.uncertainty.draw(sweepSeed(7, index % job.runsPerConfig));
+    *(SweepOutcome*)result = runSweepSample(job.configs[index / job.runsPerConfig], params, RUN_S);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_sweep_grid() {
+    SweepSpace space;
+    space.kp = SweepAxis(0.1f, 0.3f, 3);
+    space.faultThreshold = SweepAxis(2.0f, 3.0f, 2);
+    TEST_ASSERT_EQUAL(6, space.gridSize());
+
+    // The last axis fastest
+    SweepConfig config = space.gridPoint(0);
+    TEST_ASSERT_EQUAL_FLOAT(0.1f, config.kp);
+    TEST_ASSERT_EQUAL(2, config.faultThreshold);
+    TEST_ASSERT_EQUAL_FLOAT(ControllerConfig::KI, config.ki);
+    config = space.gridPoint(1);
+    TEST_ASSERT_EQUAL_FLOAT(0.1f, config.kp);
+    TEST_ASSERT_EQUAL(3, config.faultThreshold);
+    config = space.gridPoint(5);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.3f, config.kp);
+    TEST_ASSERT_EQUAL(3, config.faultThreshold);
+
+    // Drawn within the axes, repeatably
+    for (uint32_t i = 0; i < 100; i++) {
+        config = space.randomPoint(sweepSeed(1, i));
+        TEST_ASSERT_TRUE(config.kp >= 0.1f && config.kp <= 0.3f);
+        TEST_ASSERT_TRUE(config.faultThreshold == 2 || config.faultThreshold == 3);
+        TEST_ASSERT_EQUAL_FLOAT(config.kp, space.randomPoint(sweepSeed(1, i)).kp);
+    }
+}
+
+void test_sweep_summary() {
+    SweepOutcome outcomes[4] = {
+        { 1.0f, 10.0f, 4.0f, (uint8_t)SystemStateEnum::CLOSED_LOOP, false },
+        { 3.0f, 20.0f, 8.0f, (uint8_t)SystemStateEnum::CLOSED_LOOP, false },
+        { 2.0f, 0.0f, 6.0f, (uint8_t)SystemStateEnum::CLOSED_LOOP, false },
+        { -1.0f, 30.0f, 2.0f, (uint8_t)SystemStateEnum::FORCED_OPEN_LOOP, true },
+    };
+    SweepSummary summary = summarize(outcomes, 4);
+    TEST_ASSERT_EQUAL(4, summary.runs);
+    TEST_ASSERT_EQUAL(3, summary.settled);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, summary.meanSettlingS);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, summary.p95SettlingS);
+    TEST_ASSERT_EQUAL_FLOAT(15.0f, summary.meanOvershootPsi);
+    TEST_ASSERT_EQUAL_FLOAT(30.0f, summary.maxOvershootPsi);
+    TEST_ASSERT_EQUAL_FLOAT(5.0f, summary.meanItaePsiS2);
+    TEST_ASSERT_EQUAL_FLOAT(0.25f, summary.falseAbortRate);
+}
+
+// The config.h tuning against an aggressive one with a tight redband, over the same plants
+void test_sweep_false_aborts() {
+    TestJob job;
+    job.configs[1].kp = 0.3f;
+    job.configs[1].redbandUpperPsi = 10.0f;
+    job.runsPerConfig = 20;
+
+    size_t numRuns = 2 * job.runsPerConfig;
+    std::vector<SweepOutcome> outcomes(numRuns);
+    auto start = std::chrono::steady_clock::now();
+    TEST_ASSERT_TRUE(runParallel(numRuns, outcomes.data(), sizeof(SweepOutcome), 4, runTestSample, &job));
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    SweepSummary tuned = summarize(&outcomes[0], job.runsPerConfig);
+    SweepSummary aggressive = summarize(&outcomes[job.runsPerConfig], job.runsPerConfig);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, tuned.falseAbortRate);
+    TEST_ASSERT_EQUAL(job.runsPerConfig, tuned.settled);
+    TEST_ASSERT_TRUE(tuned.meanSettlingS > 0.0f && tuned.meanSettlingS < RUN_S);
+    TEST_ASSERT_TRUE(aggressive.falseAbortRate > 0.5f);
+    TEST_ASSERT_TRUE(aggressive.meanOvershootPsi > tuned.meanOvershootPsi);
+
+    printf("[BENCH] sweep: %zu runs of %.0f s in %.3f s wall (%.0f runs per minute)\n",
+           numRuns, RUN_S, wallS, numRuns / wallS * 60.0);
+}
+
+// The same outcomes whichever worker ran them
+void test_sweep_parallel_matches_serial() {
+    TestJob job;
+    job.configs[1].ki = 0.15f;
+    job.runsPerConfig = 6;
+
+    size_t numRuns = 2 * job.runsPerConfig;
+    std::vector<SweepOutcome> serial(numRuns), parallel(numRuns);
+    TEST_ASSERT_TRUE(runParallel(numRuns, serial.data(), sizeof(SweepOutcome), 1, runTestSample, &job));
+    TEST_ASSERT_TRUE(runParallel(numRuns, parallel.data(), sizeof(SweepOutcome), 3, runTestSample, &job));
+    for (size_t i = 0; i < numRuns; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(serial[i].settlingS, parallel[i].settlingS);
+        TEST_ASSERT_EQUAL_FLOAT(serial[i].overshootPsi, parallel[i].overshootPsi);
+        TEST_ASSERT_EQUAL_FLOAT(serial[i].itaePsiS2, parallel[i].itaePsiS2);
+        TEST_ASSERT_EQUAL(serial[i].finalState, parallel[i].finalState);
+        TEST_ASSERT_EQUAL(serial[i].aborted, parallel[i].aborted);
+    }
+    // The plants differ between the runs of a configuration
+    TEST_ASSERT_TRUE(serial[0].itaePsiS2 != serial[1].itaePsiS2);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sweep_grid);
+    RUN_TEST(test_sweep_summary);
+    RUN_TEST(test_sweep_false_aborts);
+    RUN_TEST(test_sweep_parallel_matches_serial);
+    return UNITY_END();
+}
@@ -0,0 +1,87 @@
+/*
+ * Plays an input journal back through the firmware (see lib/modules/include/input_journal.h)
+ * and writes the firmware's decisions, as the replay tool does. The journal is either written
+ * by the simulator, or the journal packets of a run on the stand, appended in sequence order.
+ * Build and run with
+ *
+ *     pio run -e journal
+ *     .pio/build/journal/program run.jrn [-o decisions.csv] [--binary]
+ *
+ * The firmware has to be built with the same build flags and config.h as the one that recorded
+ * the journal, USE_FIXED_POINT_CONTROLLER included (a playback with the float controller would
+ * not diverge, but would compute other valve angles than the Uno did). Without -o the decisions go to stdout. A summary goes to stderr, and the exit
+ * status is 1 if the playback diverged from the recording.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#include <journal_player.h>
+#include <replay.h>
+#include <sim_hardware.h>
+#include <utilities.h>
+
+static DecisionRecorder* recorder = nullptr;
+
+static void observe() {
+    recorder->observe();
+}
+
+static int usage(const char* program) {
+    fprintf(stderr, "Usage: %s journal [-o decisions] [--binary]\n", program);
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    const char* inPath = nullptr;
+    const char* outPath = nullptr;
+    DecisionRecorder::Format format = DecisionRecorder::Format::CSV;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) outPath = argv[++i];
+        else if (strcmp(argv[i], "--binary") == 0) format = DecisionRecorder::Format::BINARY;
+        else if (argv[i][0] != '-' && inPath == nullptr) inPath = argv[i];
+        else return usage(argv[0]);
+    }
+    if (inPath == nullptr) return usage(argv[0]);
+
+    FILE* in = fopen(inPath, "rb");
+    if (in == nullptr) {
+        perror(inPath);
+        return 1;
+    }
+    JournalPlayer player;
+    bool loaded = player.load(in);
+    fclose(in);
+    if (!loaded) {
+        fprintf(stderr, "%s: could not be read\n", inPath);
+        return 1;
+    }
+
+    FILE* out = outPath != nullptr ? fopen(outPath, format == DecisionRecorder::Format::BINARY ? "wb" : "w") : stdout;
+    if (out == nullptr) {
+        perror(outPath);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    player.boot();
+    DecisionRecorder decisions(out, format);
+    recorder = &decisions;
+    uint32_t passes = player.play(observe);
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (out != stdout) fclose(out);
+
+    fprintf(stderr, "%zu of %zu bytes (%.1f s, %u passes) played back in %.3f s: %u state changes, %u fault latches, %u angle commands, final state %u\n",
+            player.getPlayed(), player.size(), simClock.nowUs() / 1e6, passes, wallS,
+            decisions.getCount(DecisionKind::STATE_CHANGE), decisions.getCount(DecisionKind::FAULT_LATCHED),
+            decisions.getCount(DecisionKind::TARGET_ANGLE), (unsigned)systemState.currentState);
+    if (player.hasDiverged()) {
+        fprintf(stderr, "%s: diverged after %zu bytes: the firmware took another path than when it was recorded\n",
+                inPath, player.getPlayed());
+        return 1;
+    }
+    if (player.isTruncated())
+        fprintf(stderr, "%s: ends within a pass, whose inputs were made up\n", inPath);
+    return 0;
+}
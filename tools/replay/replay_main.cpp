@@ -0,0 +1,83 @@
+/*
+ * Replays a recording of a test through the firmware (see lib/sim/include/replay.h for the
+ * recording format) and writes the firmware's decisions: state changes, fault latches and
+ * commanded valve angles. Build and run with
+ *
+ *     pio run -e replay
+ *     .pio/build/replay/program recording.csv [-o decisions.csv] [--binary]
+ *
+ * Without -o the decisions go to stdout. A summary goes to stderr.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#include <replay.h>
+#include <sim_firmware.h>
+#include <sim_world.h>
+#include <utilities.h>
+
+// Extra time after the last sample, for the firmware to react to the end of the recording
+static constexpr double TAIL_S = 1.0;
+
+static DecisionRecorder* recorder = nullptr;
+
+static void replayLoop() {
+    loop();
+    recorder->observe();
+}
+
+static int usage(const char* program) {
+    fprintf(stderr, "Usage: %s recording.csv [-o decisions] [--binary]\n", program);
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    const char* inPath = nullptr;
+    const char* outPath = nullptr;
+    DecisionRecorder::Format format = DecisionRecorder::Format::CSV;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) outPath = argv[++i];
+        else if (strcmp(argv[i], "--binary") == 0) format = DecisionRecorder::Format::BINARY;
+        else if (argv[i][0] != '-' && inPath == nullptr) inPath = argv[i];
+        else return usage(argv[0]);
+    }
+    if (inPath == nullptr) return usage(argv[0]);
+
+    FILE* in = fopen(inPath, "r");
+    if (in == nullptr) {
+        perror(inPath);
+        return 1;
+    }
+    ReplayLog log;
+    bool loaded = log.load(in);
+    fclose(in);
+    if (!loaded) {
+        fprintf(stderr, "%s:%lu: malformed or out of order sample\n", inPath, log.getErrorLine());
+        return 1;
+    }
+
+    FILE* out = outPath != nullptr ? fopen(outPath, format == DecisionRecorder::Format::BINARY ? "wb" : "w") : stdout;
+    if (out == nullptr) {
+        perror(outPath);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SimWorld world;
+    world.setReplay(&log);
+    world.reset();
+    simBootFirmware();
+    DecisionRecorder decisions(out, format);
+    recorder = &decisions;
+    world.run(replayLoop, log.durationS() + TAIL_S);
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (out != stdout) fclose(out);
+
+    fprintf(stderr, "%zu samples (%.1f s) replayed in %.3f s: %u state changes, %u fault latches, %u angle commands, final state %u\n",
+            log.size(), log.durationS(), wallS, decisions.getCount(DecisionKind::STATE_CHANGE),
+            decisions.getCount(DecisionKind::FAULT_LATCHED), decisions.getCount(DecisionKind::TARGET_ANGLE),
+            (unsigned)systemState.currentState);
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * Monte Carlo sweep of the controller tuning over the closed loop simulation (see
+ * lib/sim/include/sweep.h), with the fixed point controller of the Uno. Every configuration of the swept parameters is run against the same
+ * plants, drawn from the uncertainties, so that the configurations are compared on equal terms.
+ * Writes one CSV line per configuration. Build and run with
+ *
+ *     pio run -e sweep
+ *     .pio/build/sweep/program --kp 0.05:0.2:4 --ki 0.02:0.1:4 --runs 200 -o sweep.csv
+ *
+ * A parameter is MIN:MAX:POINTS in a grid, or MIN:MAX with --random N (N configurations drawn
+ * uniformly), or a single value. Parameters that are not given keep their config.h values:
+ *
+ *     --kp, --ki (within CommandConfig::GAIN_MIN to GAIN_MAX, as the command packets),
+ *     --max-angle (degrees per cycle), --redband-upper, --redband-lower (psi),
+ *     --fault-threshold (consecutive readings)
+ *
+ * The plant of each run is drawn uniformly from (MIN:MAX, or a single value):
+ *
+ *     --tank (psi), --cv-scale (of the nominal Cv), --cv-exponent (of the Cv curve),
+ *     --delay (transport delay, s), --noise (PT noise, psi)
+ *
+ * Other options: --runs (per configuration, 100), --duration (simulated s per run, 6),
+ * --jobs (worker processes, one per CPU), --seed, -o (else stdout). A summary goes to stderr.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include <sweep.h>
+
+struct SweepJob {
+    const std::vector<SweepConfig>* configs;
+    const SweepUncertainty* uncertainty;
+    uint32_t seed;
+    uint32_t runsPerConfig;
+    double durationS;
+};
+
+static void runOne(size_t index, void* result, const void* context) {
+    const SweepJob& job = *(const SweepJob*)context;
+    // The same plants for every configuration
+    SimParams params = job.uncertainty->draw(sweepSeed(job.seed, index % job.runsPerConfig));
+    *(SweepOutcome*)result = runSweepSample((*job.configs)[index / job.runsPerConfig], params, job.durationS);
+}
+
+// MIN:MAX:POINTS, MIN:MAX or a single value
+static bool parseAxis(const char* text, SweepAxis& axis) {
+    char* end;
+    float min = strtof(text, &end);
+    if (end == text) return false;
+    if (*end == '\0') {
+        axis = SweepAxis(min);
+        return true;
+    }
+    if (*end != ':') return false;
+    text = end + 1;
+    float max = strtof(text, &end);
+    if (end == text || max < min) return false;
+    unsigned long points = 2;
+    if (*end == ':') {
+        text = end + 1;
+        points = strtoul(text, &end, 10);
+        if (end == text || points < 1 || points > UINT16_MAX) return false;
+    }
+    if (*end != '\0') return false;
+    axis = SweepAxis(min, max, (uint16_t)points);
+    return true;
+}
+
+// The gains that the command packets would accept, which the fixed point controller can hold
+static bool isGainAxis(const SweepAxis& axis) {
+    return axis.min >= CommandConfig::GAIN_MIN && axis.max <= CommandConfig::GAIN_MAX;
+}
+
+static int usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--kp A] [--ki A] [--max-angle A] [--redband-upper A] [--redband-lower A]\n"
+                    "    [--fault-threshold A] [--random N] [--tank R] [--cv-scale R] [--cv-exponent R] [--delay R]\n"
+                    "    [--noise R] [--runs N] [--duration S] [--jobs N] [--seed N] [-o results.csv]\n"
+                    "  A is MIN:MAX:POINTS, MIN:MAX (with --random) or VALUE, R is MIN:MAX or VALUE\n", program);
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    SweepSpace space;
+    SweepUncertainty uncertainty;
+    unsigned long randomConfigs = 0, runsPerConfig = 100, seed = 1;
+    unsigned jobs = std::thread::hardware_concurrency();
+    double durationS = 6.0;
+    const char* outPath = nullptr;
+
+    struct { const char* name; SweepAxis* axis; bool gain; } axes[] = {
+        { "--kp", &space.kp, true }, { "--ki", &space.ki, true }, { "--max-angle", &space.maxAngleChangeDeg, false },
+        { "--redband-upper", &space.redbandUpperPsi, false }, { "--redband-lower", &space.redbandLowerPsi, false },
+        { "--fault-threshold", &space.faultThreshold, false }, { "--tank", &uncertainty.tankPressurePsi, false },
+        { "--cv-scale", &uncertainty.valveCvScale, false }, { "--cv-exponent", &uncertainty.valveCvExponent, false },
+        { "--delay", &uncertainty.transportDelayS, false }, { "--noise", &uncertainty.sensorNoisePsi, false },
+    };
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        bool parsed = false;
+        for (auto& option : axes) {
+            if (strcmp(argv[i], option.name) != 0) continue;
+            if (!hasValue || !parseAxis(argv[++i], *option.axis)) return usage(argv[0]);
+            if (option.gain && !isGainAxis(*option.axis)) {
+                fprintf(stderr, "%s: the gains are from %g to %g\n", option.name, CommandConfig::GAIN_MIN, CommandConfig::GAIN_MAX);
+                return 2;
+            }
+            parsed = true;
+        }
+        if (parsed) continue;
+
+        if (strcmp(argv[i], "--random") == 0 && hasValue) randomConfigs = strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--runs") == 0 && hasValue) runsPerConfig = strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--duration") == 0 && hasValue) durationS = strtod(argv[++i], nullptr);
+        else if (strcmp(argv[i], "--jobs") == 0 && hasValue) jobs = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--seed") == 0 && hasValue) seed = strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "-o") == 0 && hasValue) outPath = argv[++i];
+        else return usage(argv[0]);
+    }
+    if (runsPerConfig == 0 || durationS <= 0.0) return usage(argv[0]);
+    if (jobs == 0) jobs = 1;
+
+    std::vector<SweepConfig> configs;
+    if (randomConfigs > 0) {
+        // Other seeds than the plants'
+        for (unsigned long i = 0; i < randomConfigs; i++)
+            configs.push_back(space.randomPoint(sweepSeed((uint32_t)seed ^ 0xc0ffee, i)));
+    } else {
+        for (size_t i = 0; i < space.gridSize(); i++)
+            configs.push_back(space.gridPoint(i));
+    }
+
+    FILE* out = outPath != nullptr ? fopen(outPath, "w") : stdout;
+    if (out == nullptr) {
+        perror(outPath);
+        return 1;
+    }
+
+    size_t numRuns = configs.size() * runsPerConfig;
+    std::vector<SweepOutcome> outcomes(numRuns);
+    SweepJob job = { &configs, &uncertainty, (uint32_t)seed, (uint32_t)runsPerConfig, durationS };
+    auto start = std::chrono::steady_clock::now();
+    if (!runParallel(numRuns, outcomes.data(), sizeof(SweepOutcome), jobs, runOne, &job)) {
+        fprintf(stderr, "A worker failed\n");
+        return 1;
+    }
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fprintf(out, "kp,ki,max_angle_deg,redband_upper_psi,redband_lower_psi,fault_threshold,runs,settled,"
+                 "settling_mean_s,settling_p95_s,overshoot_mean_psi,overshoot_max_psi,itae_mean,false_abort_rate\n");
+    size_t best = configs.size();
+    float bestItae = 0.0f;
+    for (size_t i = 0; i < configs.size(); i++) {
+        const SweepConfig& config = configs[i];
+        SweepSummary summary = summarize(&outcomes[i * runsPerConfig], runsPerConfig);
+        fprintf(out, "%.4f,%.4f,%.3f,%.2f,%.2f,%d,%u,%u,%.3f,%.3f,%.2f,%.2f,%.2f,%.4f\n",
+                config.kp, config.ki, config.maxAngleChangeDeg, config.redbandUpperPsi, config.redbandLowerPsi,
+                config.faultThreshold, summary.runs, summary.settled, summary.meanSettlingS, summary.p95SettlingS,
+                summary.meanOvershootPsi, summary.maxOvershootPsi, summary.meanItaePsiS2, summary.falseAbortRate);
+        if (summary.falseAbortRate == 0.0f && summary.settled == summary.runs &&
+                (best == configs.size() || summary.meanItaePsiS2 < bestItae)) {
+            best = i;
+            bestItae = summary.meanItaePsiS2;
+        }
+    }
+    if (out != stdout) fclose(out);
+
+    fprintf(stderr, "%zu configurations x %lu runs of %.1f s on %u jobs in %.1f s wall (%.0f runs per minute)\n",
+            configs.size(), runsPerConfig, durationS, jobs, wallS, numRuns / wallS * 60.0);
+    if (best < configs.size())
+        fprintf(stderr, "Lowest ITAE without aborts: kp %.4f, ki %.4f, max angle %.3f, redband +%.2f/-%.2f, fault threshold %d (ITAE %.2f)\n",
+                configs[best].kp, configs[best].ki, configs[best].maxAngleChangeDeg, configs[best].redbandUpperPsi,
+                configs[best].redbandLowerPsi, configs[best].faultThreshold, bestItae);
+    else
+        fprintf(stderr, "No configuration settled in every run without an abort\n");
+    return 0;
+}